@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+Build-time memory budget from the linker map file.
+
+Attributes every input section in the GNU ld map to its output region
+(IRAM, DRAM data/bss, PSRAM bss, flash text/rodata) and to the module
+it came from (object file, or archive name for libraries), then prints
+a per-module table and writes it as JSON next to the map.
+
+Usage (standalone):
+    python scripts/mem_report.py .pio/build/m5stack-atoms3/firmware.map
+    python scripts/mem_report.py firmware.map --top 30 --json mem_report.json
+
+As a PlatformIO post-build step (see platformio.ini):
+    extra_scripts = post:scripts/mem_report.py
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+from collections import defaultdict
+
+# Output section prefix -> budget column
+REGIONS = [
+    ('.iram0', 'iram'),
+    ('.dram0.data', 'dram_data'),
+    ('.dram0.bss', 'dram_bss'),
+    ('.noinit', 'dram_bss'),
+    ('.ext_ram.bss', 'psram_bss'),
+    ('.flash.text', 'flash_text'),
+    ('.flash.rodata', 'flash_rodata'),
+    ('.flash.appdesc', 'flash_rodata'),
+]
+COLUMNS = ['iram', 'dram_data', 'dram_bss', 'psram_bss', 'flash_text', 'flash_rodata']
+
+# "  .text.foo  0x40370000  0x1c  path/to/obj.o"  (section name may be on the previous line)
+INPUT_RE = re.compile(r'^\s+(\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+OUTPUT_RE = re.compile(r'^(\.\S+)')
+
+
+def module_name(path):
+    """Short module label for an object path or archive member."""
+    path = path.strip()
+    m = re.match(r'(.*?)\((.*)\)$', path)
+    if m:
+        lib = os.path.basename(m.group(1))
+        if lib.startswith('lib'):
+            lib = lib[3:]
+        return re.sub(r'\.a$', '', lib)
+    base = os.path.basename(path)
+    return re.sub(r'\.(c|cpp|S)?\.?o$', '', base) or base
+
+
+def region_for(out_section):
+    for prefix, column in REGIONS:
+        if out_section.startswith(prefix):
+            return column
+    return None
+
+
+def parse_map(lines):
+    """Return {module: {column: bytes}} from the 'Linker script and memory map' part."""
+    usage = defaultdict(lambda: defaultdict(int))
+    in_map = False
+    out_section = None
+    pending_name = None
+    for line in lines:
+        if not in_map:
+            if line.startswith('Linker script and memory map'):
+                in_map = True
+            continue
+        line = line.rstrip('\n')
+        m = OUTPUT_RE.match(line)
+        if m:
+            out_section = m.group(1)
+            pending_name = None
+            continue
+        column = region_for(out_section or '')
+        if column is None:
+            continue
+        m = INPUT_RE.match(line)
+        if m:
+            name = m.group(1) or pending_name
+            pending_name = None
+            size = int(m.group(3), 16)
+            obj = m.group(4)
+            if not name or size == 0 or obj.startswith('*') or '=' in obj:
+                continue
+            usage[module_name(obj)][column] += size
+            continue
+        # Long input section names are printed alone on their own line
+        stripped = line.strip()
+        if stripped.startswith('.') and ' ' not in stripped:
+            pending_name = stripped
+    return usage
+
+
+def format_table(usage, top):
+    rows = sorted(usage.items(),
+                  key=lambda kv: -(kv[1]['iram'] + kv[1]['dram_data'] + kv[1]['dram_bss']))
+    out = []
+    header = f"{'module':<28}{'SRAM':>9}" + ''.join(f"{c:>14}" for c in COLUMNS)
+    out.append(header)
+    out.append('-' * len(header))
+    totals = defaultdict(int)
+    for i, (mod, cols) in enumerate(rows):
+        for c in COLUMNS:
+            totals[c] += cols[c]
+        if i < top:
+            sram = cols['iram'] + cols['dram_data'] + cols['dram_bss']
+            out.append(f"{mod[:27]:<28}{sram:>9}" + ''.join(f"{cols[c]:>14}" for c in COLUMNS))
+    if len(rows) > top:
+        out.append(f"... {len(rows) - top} more modules")
+    out.append('-' * len(header))
+    sram = totals['iram'] + totals['dram_data'] + totals['dram_bss']
+    out.append(f"{'total':<28}{sram:>9}" + ''.join(f"{totals[c]:>14}" for c in COLUMNS))
+    return '\n'.join(out)
+
+
+def report(map_path, top=20, json_path=None):
+    with open(map_path, errors='replace') as f:
+        usage = parse_map(f)
+    print(f"Memory budget from {map_path} (bytes; SRAM = iram + dram_data + dram_bss)")
+    print(format_table(usage, top))
+    if json_path is None:
+        json_path = os.path.join(os.path.dirname(map_path), 'mem_report.json')
+    with open(json_path, 'w') as f:
+        json.dump({m: dict(c) for m, c in usage.items()}, f, indent=1, sort_keys=True)
+    print(f"Written {json_path}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Per-module memory budget from a linker map')
+    parser.add_argument('map', help='firmware.map produced with -Wl,-Map')
+    parser.add_argument('--top', type=int, default=20, help='Modules to list (default: 20)')
+    parser.add_argument('--json', default=None, help='JSON output path (default: next to map)')
+    args = parser.parse_args()
+    report(args.map, args.top, args.json)
+
+
+try:
+    Import("env")  # noqa: F821 - defined when run by PlatformIO/SCons
+except NameError:
+    if __name__ == '__main__':
+        sys.exit(main())
+else:
+    _map = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")  # noqa: F821
+    env.Append(LINKFLAGS=["-Wl,-Map," + _map])  # noqa: F821
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf",  # noqa: F821
+                      lambda target, source, env: report(_map))
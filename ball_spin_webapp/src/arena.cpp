@@ -0,0 +1,120 @@
+/**
+ * Session-scoped arena - see arena.h
+ */
+
+#include "arena.h"
+#include "jsonout.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+bool arenaInit(Arena &a, const char* name, size_t psramBytes, size_t fallbackBytes) {
+    a = Arena{};
+    a.name = name;
+    if (psramBytes && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > psramBytes) {
+        a.base = (uint8_t*)heap_caps_malloc(psramBytes, MALLOC_CAP_SPIRAM);
+        if (a.base) {
+            a.capacity = psramBytes;
+            a.inPsram = true;
+            return true;
+        }
+    }
+    a.base = (uint8_t*)heap_caps_malloc(fallbackBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    a.capacity = a.base ? fallbackBytes : 0;
+    return a.base != nullptr;
+}
+
+void* arenaAlloc(Arena &a, size_t bytes, size_t align) {
+    size_t start = (a.used + align - 1) & ~(align - 1);
+    if (!a.base || start + bytes > a.capacity) {
+        a.failed++;
+        return nullptr;
+    }
+    a.used = start + bytes;
+    if (a.used > a.peak) a.peak = a.used;
+    a.allocs++;
+    return a.base + start;
+}
+
+void arenaReset(Arena &a) {
+    a.used = 0;
+    a.allocs = 0;
+    a.resets++;
+}
+
+// ==================== Benchmark ====================
+
+static const int    BENCH_N = 1000;
+// Internal SRAM is shared with the Wi-Fi / lwIP / WebSocket tasks on core 0
+// (and is all there is on a board without PSRAM): runs that allocate from it
+// stay within this budget and half the largest free block
+static const size_t BENCH_INTERNAL_BYTES = 16 * 1024;
+
+// Allocations a run of `bytes` blocks may make from the internal heap
+static int internalBudget(size_t bytes) {
+    size_t n = BENCH_INTERNAL_BYTES / bytes;
+    size_t half = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) / 2 / bytes;
+    if (half < n) n = half;
+    return n < (size_t)BENCH_N ? (int)n : BENCH_N;
+}
+
+// Average cycles per allocation (+ free for the heap variants)
+static uint32_t benchArena(Arena &a, size_t bytes, int n, int &done) {
+    arenaReset(a);
+    done = 0;
+    uint32_t t0 = ESP.getCycleCount();
+    for (int i = 0; i < n; i++) {
+        if (arenaAlloc(a, bytes)) done++;
+    }
+    uint32_t cyc = ESP.getCycleCount() - t0;
+    arenaReset(a);  // O(1) release of all n blocks
+    return done ? cyc / done : 0;
+}
+
+static uint32_t benchHeap(uint32_t caps, size_t bytes, int n, int &done) {
+    done = 0;
+    // Pointer table from the heap under test, only for the run
+    void** ptrs = (void**)heap_caps_malloc(n * sizeof(void*), caps);
+    if (!ptrs) return 0;
+    uint32_t t0 = ESP.getCycleCount();
+    for (int i = 0; i < n; i++) {
+        ptrs[i] = heap_caps_malloc(bytes, caps);
+        if (ptrs[i]) done++;
+    }
+    for (int i = 0; i < n; i++) {
+        if (ptrs[i]) heap_caps_free(ptrs[i]);
+    }
+    uint32_t cyc = ESP.getCycleCount() - t0;
+    heap_caps_free(ptrs);
+    return done ? cyc / done : 0;
+}
+
+size_t arenaBenchmarkJson(char* buf, size_t size) {
+    static const size_t SIZES[] = {32, 256};
+    static const uint32_t INTERNAL = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    bool havePsram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, "{\"n\":%d,\"internal_budget\":%u,\"cpu_mhz\":%lu,\"cycles_per_alloc\":[",
+               BENCH_N, (unsigned)BENCH_INTERNAL_BYTES, (unsigned long)ESP.getCpuFreqMHz());
+    bool arenaPsram = false;
+    for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+        // One arena per size, freed before the heap runs so they never overlap
+        Arena scratch;
+        bool ok = arenaInit(scratch, "bench", BENCH_N * SIZES[i], BENCH_INTERNAL_BYTES);
+        arenaPsram = scratch.inPsram;
+        int nArena = 0, nInt = 0, nPs = 0;
+        size_t fit = scratch.capacity / SIZES[i];
+        int runArena = fit < (size_t)BENCH_N ? (int)fit : BENCH_N;
+        uint32_t cArena = ok ? benchArena(scratch, SIZES[i], runArena, nArena) : 0;
+        heap_caps_free(scratch.base);
+        uint32_t cInt = benchHeap(INTERNAL, SIZES[i], internalBudget(SIZES[i]), nInt);
+        uint32_t cPs = havePsram ? benchHeap(MALLOC_CAP_SPIRAM, SIZES[i], BENCH_N, nPs) : 0;
+        jsonAppend(o, "%s{\"bytes\":%u,\"arena\":%lu,\"arena_ok\":%d,"
+                      "\"malloc_internal\":%lu,\"internal_ok\":%d,"
+                      "\"malloc_psram\":%lu,\"psram_ok\":%d}",
+                   i ? "," : "", (unsigned)SIZES[i], (unsigned long)cArena, nArena,
+                   (unsigned long)cInt, nInt, (unsigned long)cPs, nPs);
+    }
+    jsonAppend(o, "],\"arena_in_psram\":%s}", arenaPsram ? "true" : "false");
+    return o.len;
+}
@@ -0,0 +1,78 @@
+/**
+ * Session-scoped arena and typed record pools
+ *
+ * Lifetime-bounded storage (shot records, frame capture windows, later
+ * replay/trace buffers) is carved from one PSRAM block instead of the
+ * general heap, so it never fragments internal SRAM. Allocation is a
+ * pointer bump and the whole session is released in O(1) by resetting
+ * the arena (on "clear_shots" / new session), after which the pools are
+ * carved again.
+ *
+ * Without PSRAM the arena falls back to a smaller internal-SRAM block.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct Arena {
+    const char* name;
+    uint8_t*    base;
+    size_t      capacity;
+    size_t      used;
+    size_t      peak;
+    uint32_t    allocs;
+    uint32_t    failed;
+    uint32_t    resets;
+    bool        inPsram;
+};
+
+// Reserves the backing block: PSRAM first, else fallbackBytes of internal SRAM
+bool arenaInit(Arena &a, const char* name, size_t psramBytes, size_t fallbackBytes);
+
+// Bump allocation; nullptr (and failed++) when the arena is exhausted
+void* arenaAlloc(Arena &a, size_t bytes, size_t align = 4);
+
+// Releases everything allocated from the arena in O(1)
+void arenaReset(Arena &a);
+
+// Runs arena vs heap_caps_malloc allocation timings; writes a JSON summary
+size_t arenaBenchmarkJson(char* buf, size_t size);
+
+/**
+ * Fixed-capacity typed pool carved from an arena.
+ * append() fails when full; appendRing() overwrites the oldest record.
+ * Index 0 is always the oldest record still held.
+ */
+template <typename T>
+struct RecordPool {
+    T*       slots    = nullptr;
+    uint32_t capacity = 0;
+    uint32_t head     = 0;   // index of the oldest record
+    uint32_t count    = 0;
+
+    bool carve(Arena &a, uint32_t n) {
+        slots = (T*)arenaAlloc(a, sizeof(T) * n, alignof(T));
+        capacity = slots ? n : 0;
+        head = count = 0;
+        return slots != nullptr;
+    }
+
+    T* append() {
+        if (count >= capacity) return nullptr;
+        return &slots[(head + count++) % capacity];
+    }
+
+    T* appendRing() {
+        if (capacity == 0) return nullptr;
+        if (count < capacity) return append();
+        T* slot = &slots[head];
+        head = (head + 1) % capacity;
+        return slot;
+    }
+
+    T&       at(uint32_t i)       { return slots[(head + i) % capacity]; }
+    const T& at(uint32_t i) const { return slots[(head + i) % capacity]; }
+    void     clear()              { head = count = 0; }
+};
@@ -0,0 +1,106 @@
+/**
+ * Codec benchmark on live data - see codecbench.h
+ */
+
+#include "codecbench.h"
+#include "bschunk.h"
+#include "bsstream.h"
+#include "jsonout.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+static const uint16_t BENCH_CHUNK = 64;  // as the flash log (sessionlog.cpp)
+
+static uint32_t rawSampleBytes(uint16_t columns) {
+    uint32_t n = 0;
+    for (int id = 0; id < BS_COL_COUNT; id++) {
+        if ((columns >> id) & 1) n += bsColumnWidth(id);
+    }
+    return n;
+}
+
+static void appendResult(JsonOut &o, const char* name, size_t bytes, uint32_t n,
+                         uint32_t rawPer, uint64_t cycles, bool last) {
+    jsonAppend(o, "{\"codec\":\"%s\",\"bytes_per_sample\":%.2f,\"ratio\":%.2f,"
+                  "\"cycles_per_sample\":%lu}%s",
+               name, (float)bytes / n, bytes ? (float)n * rawPer / bytes : 0.0f,
+               (unsigned long)(cycles / n), last ? "" : ",");
+}
+
+// Chunk encode of all samples; bsChunkAdd is counted too (the flash path pays it)
+static size_t benchChunks(const BsSample* s, uint32_t n, uint8_t encoding, void* store,
+                          uint8_t* out, size_t cap, uint64_t &cycles) {
+    BsChunkBuilder b;
+    bsChunkInit(b, store, BENCH_CHUNK, 0, BS_COLS_ALL);
+    size_t total = 0;
+    cycles = 0;
+    for (uint32_t i = 0; i < n; i += BENCH_CHUNK) {
+        uint32_t c0 = ESP.getCycleCount();
+        bsChunkReset(b, i);
+        for (uint32_t k = i; k < n && k < i + BENCH_CHUNK; k++) bsChunkAdd(b, s[k]);
+        total += bsChunkEncode(b, encoding, out, cap);
+        cycles += ESP.getCycleCount() - c0;
+    }
+    return total;
+}
+
+static size_t benchStream(const BsSample* s, uint32_t n, uint8_t order, uint64_t &cycles) {
+    BsStreamEncoder e;
+    bsStreamInit(e, BS_COLS_ALL, order, 50);
+    uint8_t packet[BS_STREAM_MAX];
+    size_t total = 0;
+    cycles = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t c0 = ESP.getCycleCount();
+        total += bsStreamEncode(e, s[i], packet);
+        cycles += ESP.getCycleCount() - c0;
+    }
+    return total;
+}
+
+size_t codecBenchJson(const BsSample* samples, uint32_t n, const CodecLiveStats &live,
+                      char* buf, size_t size) {
+    JsonOut o = jsonBegin(buf, size);
+    uint32_t rawPer = rawSampleBytes(BS_COLS_ALL);
+    jsonAppend(o, "{\"samples\":%lu,\"raw_bytes_per_sample\":%lu,\"chunk_samples\":%u,",
+               (unsigned long)n, (unsigned long)rawPer, BENCH_CHUNK);
+
+    size_t cap = bsChunkMaxBytes(BENCH_CHUNK, 0, BS_COLS_ALL, BS_ENC_RAW);
+    for (uint8_t e = BS_ENC_DELTA_VARINT; e < BS_ENC_COUNT; e++) {
+        size_t m = bsChunkMaxBytes(BENCH_CHUNK, 0, BS_COLS_ALL, e);
+        if (m > cap) cap = m;
+    }
+    void* store = heap_caps_malloc(bsChunkStorageBytes(BENCH_CHUNK, 0), MALLOC_CAP_8BIT);
+    uint8_t* out = (uint8_t*)heap_caps_malloc(cap, MALLOC_CAP_8BIT);
+
+    jsonAppend(o, "\"chunk\":[");
+    if (n && store && out) {
+        static const uint8_t ENCODINGS[] = {
+            BS_ENC_RAW, BS_ENC_DELTA_VARINT, BS_ENC_DELTA2_VARINT,
+            BS_ENC_DELTA_BITPACK, BS_ENC_DELTA2_BITPACK, BS_ENC_AUTO
+        };
+        const size_t count = sizeof(ENCODINGS) / sizeof(ENCODINGS[0]);
+        for (size_t i = 0; i < count; i++) {
+            uint64_t cycles;
+            size_t bytes = benchChunks(samples, n, ENCODINGS[i], store, out, cap, cycles);
+            appendResult(o, bsEncodingName(ENCODINGS[i]), bytes, n, rawPer, cycles, i + 1 == count);
+        }
+    }
+    jsonAppend(o, "],\"stream\":[");
+    if (n) {
+        for (uint8_t order = 1; order <= 2; order++) {
+            uint64_t cycles;
+            size_t bytes = benchStream(samples, n, order, cycles);
+            appendResult(o, order == 2 ? "delta2" : "delta", bytes, n, rawPer, cycles, order == 2);
+        }
+    }
+    heap_caps_free(store);
+    heap_caps_free(out);
+
+    // Live "bin" WebSocket frames since boot (serial framing would add 3 bytes each)
+    jsonAppend(o, "],\"ws_bin\":{\"packets\":%lu,\"bytes_per_packet\":%.2f,\"cycles_per_packet\":%lu}}",
+               (unsigned long)live.packets,
+               live.packets ? (float)live.bytes / live.packets : 0.0f,
+               (unsigned long)(live.packets ? live.cycles / live.packets : 0));
+    return o.len;
+}
@@ -0,0 +1,26 @@
+/**
+ * Codec benchmark on live data (GET /codec)
+ *
+ * Runs a window of recent samples through every chunk encoding (as the
+ * flash log stores them, 64-sample chunks) and through the stream codec
+ * used for the WebSocket "bin" frames and the imu_logger serial binary
+ * mode. Reports bytes per sample, the ratio against fixed-point samples
+ * and ESP32-S3 cycles per sample for each.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ballsession.h"
+
+// Counters of the live WebSocket stream encoder, reported alongside
+struct CodecLiveStats {
+    uint32_t packets;
+    uint64_t bytes;
+    uint64_t cycles;
+};
+
+// Encodes samples[0..n) with each codec; writes a JSON summary
+size_t codecBenchJson(const BsSample* samples, uint32_t n, const CodecLiveStats &live,
+                      char* buf, size_t size);
@@ -0,0 +1,161 @@
+/**
+ * Energy accounting per subsystem - see energy.h
+ */
+
+#include "energy.h"
+#include "jsonout.h"
+#include <Arduino.h>
+#include <string.h>
+
+EnergyTable energyTable = {
+    /* cpu_240_ma      */ 40.0f,
+    /* cpu_160_ma      */ 30.0f,
+    /* cpu_80_ma       */ 20.0f,
+    /* radio_idle_ma   */ 60.0f,
+    /* radio_tx_ma     */ 190.0f,
+    /* display_base_ma */ 2.0f,
+    /* display_full_ma */ 20.0f,
+    /* imu_ma          */ 0.5f,
+    /* sleep_ma        */ 0.8f,
+    /* supply_v        */ 3.7f,
+    /* phy_mbps        */ 24.0f,
+    /* tx_overhead_us  */ 150.0f,
+};
+
+static const struct { const char* name; float* field; } ENERGY_FIELDS[] = {
+    {"cpu_240_ma",      &energyTable.cpu_240_ma},
+    {"cpu_160_ma",      &energyTable.cpu_160_ma},
+    {"cpu_80_ma",       &energyTable.cpu_80_ma},
+    {"radio_idle_ma",   &energyTable.radio_idle_ma},
+    {"radio_tx_ma",     &energyTable.radio_tx_ma},
+    {"display_base_ma", &energyTable.display_base_ma},
+    {"display_full_ma", &energyTable.display_full_ma},
+    {"imu_ma",          &energyTable.imu_ma},
+    {"sleep_ma",        &energyTable.sleep_ma},
+    {"supply_v",        &energyTable.supply_v},
+    {"phy_mbps",        &energyTable.phy_mbps},
+    {"tx_overhead_us",  &energyTable.tx_overhead_us},
+};
+static const int ENERGY_FIELD_COUNT = sizeof(ENERGY_FIELDS) / sizeof(ENERGY_FIELDS[0]);
+
+// Time accumulators (microseconds) for the current session
+struct EnergyTimes {
+    uint64_t cpuUs[3];        // 240 / 160 / 80 MHz
+    uint64_t radioOnUs;
+    uint64_t radioTxUs;       // estimated airtime, subset of radioOnUs
+    uint64_t radioOffUs;
+    uint64_t displayUs;
+    uint64_t backlightLvlUs;  // sum(dt * level), level 0..255
+    uint64_t sleepUs;
+    uint64_t awakeUs;
+    uint32_t txBytes;
+};
+
+static EnergyTimes times;
+static uint32_t lastTickUs = 0;
+static bool     ticking = false;
+static uint32_t sessionNo = 0;
+
+void energyTick(uint32_t nowUs, uint32_t cpuMhz, bool radioOn, uint8_t backlight) {
+    if (!ticking) {
+        ticking = true;
+        lastTickUs = nowUs;
+        return;
+    }
+    uint32_t dt = nowUs - lastTickUs;
+    lastTickUs = nowUs;
+
+    times.awakeUs += dt;
+    times.cpuUs[cpuMhz >= 200 ? 0 : cpuMhz >= 120 ? 1 : 2] += dt;
+    if (radioOn) times.radioOnUs += dt;
+    else         times.radioOffUs += dt;
+    times.displayUs += dt;
+    times.backlightLvlUs += (uint64_t)dt * backlight;
+}
+
+void energyRadioTx(size_t bytes, int frames) {
+    if (frames <= 0) return;
+    times.txBytes += bytes * frames;
+    float us = frames * (bytes * 8.0f / energyTable.phy_mbps + energyTable.tx_overhead_us);
+    times.radioTxUs += (uint64_t)us;
+}
+
+void energyAddSleep(uint32_t us) {
+    times.sleepUs += us;
+    ticking = false;  // next tick restarts from the wake time
+}
+
+int energySetField(const char* name, float value) {
+    for (int i = 0; i < ENERGY_FIELD_COUNT; i++) {
+        if (strcmp(name, ENERGY_FIELDS[i].name) == 0) {
+            *ENERGY_FIELDS[i].field = value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ==================== Conversion ====================
+
+struct EnergyBreakdown {
+    float cpu, radio, display, imu, sleep;  // mA*us
+    float total() const { return cpu + radio + display + imu + sleep; }
+};
+
+static EnergyBreakdown breakdown() {
+    const EnergyTable &t = energyTable;
+    EnergyBreakdown b;
+    uint64_t txUs = times.radioTxUs < times.radioOnUs ? times.radioTxUs : times.radioOnUs;
+    b.cpu = times.cpuUs[0] * t.cpu_240_ma + times.cpuUs[1] * t.cpu_160_ma +
+            times.cpuUs[2] * t.cpu_80_ma;
+    b.radio = (times.radioOnUs - txUs) * t.radio_idle_ma + txUs * t.radio_tx_ma;
+    b.display = times.displayUs * t.display_base_ma +
+                times.backlightLvlUs / 255.0f * t.display_full_ma;
+    b.imu = times.awakeUs * t.imu_ma;
+    b.sleep = times.sleepUs * t.sleep_ma;
+    return b;
+}
+
+static float toMah(float maUs) { return maUs / 3.6e9f; }
+static float toMj(float maUs)  { return maUs * energyTable.supply_v * 1e-6f; }
+
+void energyLogSession(const char* reason) {
+    EnergyBreakdown b = breakdown();
+    float secs = (times.awakeUs + times.sleepUs) * 1e-6f;
+    Serial.printf("# energy session %lu (%s): %.1f s, %.3f mAh, %.0f mJ, avg %.1f mA | "
+                  "cpu %.0f radio %.0f display %.0f imu %.0f sleep %.0f mJ | tx %.1f%% of radio-on\n",
+                  (unsigned long)sessionNo, reason, secs, toMah(b.total()), toMj(b.total()),
+                  secs > 0 ? b.total() / (secs * 1e6f) : 0.0f,
+                  toMj(b.cpu), toMj(b.radio), toMj(b.display), toMj(b.imu), toMj(b.sleep),
+                  times.radioOnUs ? 100.0f * times.radioTxUs / times.radioOnUs : 0.0f);
+    memset(&times, 0, sizeof(times));
+    sessionNo++;
+}
+
+size_t energyToJson(char* buf, size_t size) {
+    if (size == 0) return 0;
+    EnergyBreakdown b = breakdown();
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, "{\"session\":%lu,\"time_ms\":{\"awake\":%lu,\"sleep\":%lu,"
+                  "\"cpu_240\":%lu,\"cpu_160\":%lu,\"cpu_80\":%lu,"
+                  "\"radio_on\":%lu,\"radio_tx\":%lu,\"radio_off\":%lu,"
+                  "\"backlight_avg\":%.1f},\"tx_bytes\":%lu,",
+               (unsigned long)sessionNo,
+               (unsigned long)(times.awakeUs / 1000), (unsigned long)(times.sleepUs / 1000),
+               (unsigned long)(times.cpuUs[0] / 1000), (unsigned long)(times.cpuUs[1] / 1000),
+               (unsigned long)(times.cpuUs[2] / 1000),
+               (unsigned long)(times.radioOnUs / 1000), (unsigned long)(times.radioTxUs / 1000),
+               (unsigned long)(times.radioOffUs / 1000),
+               times.displayUs ? (float)times.backlightLvlUs / times.displayUs : 0.0f,
+               (unsigned long)times.txBytes);
+    jsonAppend(o, "\"mj\":{\"cpu\":%.1f,\"radio\":%.1f,\"display\":%.1f,\"imu\":%.1f,"
+                  "\"sleep\":%.1f,\"total\":%.1f},\"mah\":%.4f,\"table\":{",
+               toMj(b.cpu), toMj(b.radio), toMj(b.display), toMj(b.imu), toMj(b.sleep),
+               toMj(b.total()), toMah(b.total()));
+    for (int i = 0; i < ENERGY_FIELD_COUNT; i++) {
+        jsonAppend(o, "%s\"%s\":%.2f", i ? "," : "", ENERGY_FIELDS[i].name,
+                   *ENERGY_FIELDS[i].field);
+    }
+    jsonAppend(o, "}}");
+    return o.len;
+}
@@ -0,0 +1,57 @@
+/**
+ * Energy accounting per subsystem
+ *
+ * Time spent in each power-relevant state is accumulated every loop
+ * iteration (CPU frequency, radio off/idle/TX, display backlight level)
+ * plus light-sleep intervals, then converted to charge and energy with a
+ * per-state current table. Radio TX time is estimated from the bytes
+ * handed to the WebSocket server (airtime at the configured PHY rate
+ * plus a per-frame overhead).
+ *
+ * Currents are incremental per subsystem (mA at the supply rail) and
+ * can be overridden at runtime on GET /energy?<field>=<mA>, e.g.
+ * /energy?radio_tx_ma=180&cpu_240_ma=45.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum RadioState { RADIO_OFF, RADIO_IDLE, RADIO_TX };
+
+struct EnergyTable {
+    float cpu_240_ma;       // CPU active at 240 / 160 / 80 MHz
+    float cpu_160_ma;
+    float cpu_80_ma;
+    float radio_idle_ma;    // AP up, listening / beaconing
+    float radio_tx_ma;      // while transmitting
+    float display_base_ma;  // panel logic, backlight off
+    float display_full_ma;  // extra at backlight 255 (scaled linearly)
+    float imu_ma;
+    float sleep_ma;         // whole device in light sleep
+    float supply_v;
+    float phy_mbps;         // for TX airtime estimate
+    float tx_overhead_us;   // per frame: preamble, ACK, contention
+};
+
+// Defaults; datasheet-level estimates until measured on the ball
+extern EnergyTable energyTable;
+
+// Accounts the time since the previous tick to the given states
+void energyTick(uint32_t nowUs, uint32_t cpuMhz, bool radioOn, uint8_t backlight);
+
+// Bytes queued for transmission (once per receiving client)
+void energyRadioTx(size_t bytes, int frames);
+
+// Light sleep that just ended
+void energyAddSleep(uint32_t us);
+
+// Applies name=value overrides from an HTTP query; returns fields changed
+int energySetField(const char* name, float value);
+
+// Serial summary for the session that is ending, then clears counters
+void energyLogSession(const char* reason);
+
+// Writes the /energy JSON document; returns bytes written
+size_t energyToJson(char* buf, size_t size);
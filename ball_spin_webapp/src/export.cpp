@@ -0,0 +1,357 @@
+/**
+ * Bulk session export from the flash log - see export.h
+ */
+
+#include "export.h"
+#include "sessionlog.h"
+#include "bschunk.h"
+#include "bspyramid.h"
+#include "jsonout.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <math.h>
+#include <string.h>
+
+static const uint16_t EXPORT_CHUNK_MAX  = 64;    // samples per chunk the writer produces
+static const size_t   EXPORT_HTTP_CHUNK = 2048;  // payload bytes per chunked-encoding chunk
+static const uint32_t EXPORT_STACK      = 6144;
+
+static const char CSV_HEADER[] =
+    "timestamp_ms,accel_x_g,accel_y_g,accel_z_g,gyro_x_dps,gyro_y_dps,gyro_z_dps,"
+    "accel_mag_g,impact\n";
+
+static ExportStats stats;
+static std::atomic<bool> busy{false};
+static WiFiClient exportClient;  // keeps the request's socket open after the handler returns
+static uint32_t   exportSessionId = 0;
+static uint8_t    exportFormat = EXPORT_YBS;
+
+// Counts what goes out and passes it on
+struct CountingSink {
+    BsWriteFn    write;
+    void*        ctx;
+    ExportStats* st;
+};
+
+static size_t countingWrite(void* ctx, const void* data, size_t len) {
+    CountingSink &s = *(CountingSink*)ctx;
+    size_t n = s.write(s.ctx, data, len);
+    s.st->bytes += n;
+    return n;
+}
+
+// ==================== Session file ====================
+
+static const BsSummary* recordSummaries(const uint8_t* rec) {
+    return (const BsSummary*)(rec + sizeof(LogSummaryHeader));
+}
+
+static bool summaryRecordValid(const uint8_t* rec, uint16_t len, uint32_t session) {
+    const LogSummaryHeader* h = (const LogSummaryHeader*)rec;
+    return len >= sizeof(*h) && h->session == session &&
+           len >= sizeof(*h) + h->count * sizeof(BsSummary);
+}
+
+static bool exportYbs(uint32_t session, uint8_t* rec, size_t cap, BsWriteFn write, void* ctx,
+                      ExportStats &st) {
+    LogCursor c;
+    if (!logOpenSession(c, session)) return false;
+    BsFileWriter w;
+    bsFileBegin(w, c.header, write, ctx, nullptr, 0);
+
+    // Chunks as stored; count the summaries per level on the way
+    uint32_t counts[BS_PYRAMID_LEVELS] = {};
+    uint16_t base = 0, len;
+    uint8_t type;
+    while (!w.failed && (type = logNextRecord(c, rec, cap, len)) != 0) {
+        if (type == LOG_CHUNK && bsChunkValid(rec, len)) {
+            bsFileAddChunk(w, rec);
+            st.chunks++;
+            st.samples += bsChunkHeader(rec)->count;
+        } else if (type == LOG_SUMMARY && summaryRecordValid(rec, len, session)) {
+            const LogSummaryHeader* h = (const LogSummaryHeader*)rec;
+            base = h->base;
+            for (uint16_t i = 0; i < h->count; i++) {
+                uint8_t k = recordSummaries(rec)[i].level;
+                if (k < BS_PYRAMID_LEVELS) counts[k]++;
+            }
+        }
+    }
+
+    // Pyramid only when every level is complete (not for a session still
+    // being recorded: its last buckets are emitted at session end)
+    BsPyramidHeader ph;
+    bsPyramidHeaderInit(ph, w.samples, base ? base : BS_PYRAMID_BASE);
+    bool whole = base && ph.levels;
+    for (uint8_t k = 0; k < BS_PYRAMID_LEVELS; k++) {
+        whole = whole && counts[k] == (k < ph.levels ? ph.counts[k] : 0);
+    }
+    if (whole && !w.failed) {
+        bsFilePyramidBegin(w, ph);
+        for (uint8_t k = 0; k < ph.levels && !w.failed; k++) {
+            uint32_t n = 0;
+            if (!logOpenSession(c, session)) return false;
+            while ((type = logNextRecord(c, rec, cap, len, LOG_SUMMARY)) != 0) {
+                if (type != LOG_SUMMARY || !summaryRecordValid(rec, len, session)) continue;
+                const LogSummaryHeader* h = (const LogSummaryHeader*)rec;
+                for (uint16_t i = 0; i < h->count; i++) {
+                    if (recordSummaries(rec)[i].level != k) continue;
+                    bsFilePyramidAdd(w, recordSummaries(rec) + i, 1);
+                    n++;
+                }
+            }
+            if (n != ph.counts[k]) return false;  // log recycled underneath the export
+        }
+        bsFilePyramidEnd(w);
+        st.pyramid = true;
+    }
+
+    // Index: the same chunks again, header and footer only
+    bsFileIndexBegin(w);
+    uint64_t offset = sizeof(BsFileHeader);
+    if (logOpenSession(c, session)) {
+        while (!w.failed && w.indexStreamed < w.chunks &&
+               (type = logNextRecord(c, rec, cap, len, LOG_CHUNK)) != 0) {
+            if (type != LOG_CHUNK || !bsChunkValid(rec, len)) continue;
+            const BsChunkHeader* h = bsChunkHeader(rec);
+            const BsChunkFooter* f = bsChunkFooter(rec);
+            BsIndexEntry e = {offset, f->tFirstUs, f->tLastUs, f->firstSample, f->shotFirst,
+                              h->shotCount};
+            bsFileIndexAdd(w, e);
+            offset += h->bytes;
+        }
+    }
+    return bsFileEnd(w);
+}
+
+// ==================== CSV ====================
+
+// Decoded columns of one chunk
+struct CsvColumns {
+    int64_t  t[EXPORT_CHUNK_MAX];
+    int16_t  v[6][EXPORT_CHUNK_MAX];  // ax, ay, az, gx, gy, gz
+    uint16_t flags[EXPORT_CHUNK_MAX];
+};
+
+static char* putInt(char* p, int64_t v) {
+    char tmp[24];
+    int n = 0;
+    uint64_t u = v < 0 ? -(uint64_t)v : v;
+    if (v < 0) *p++ = '-';
+    do { tmp[n++] = '0' + u % 10; u /= 10; } while (u);
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+// x / 10^dec, x already rounded
+static char* putDecimal(char* p, int64_t x, int dec) {
+    static const int32_t POW10[] = {1, 10, 100, 1000, 10000};
+    if (x < 0) {
+        *p++ = '-';
+        x = -x;
+    }
+    p = putInt(p, x / POW10[dec]);
+    *p++ = '.';
+    int32_t frac = x % POW10[dec];
+    for (int d = dec - 1; d >= 0; d--) *p++ = '0' + (frac / POW10[d]) % 10;
+    return p;
+}
+
+// v / scale with dec decimals, rounded half away from zero (as printf %.Nf,
+// so rows match the imu_logger's) in integer arithmetic
+static char* putFixed(char* p, int32_t v, int32_t scale, int dec) {
+    static const int32_t POW10[] = {1, 10, 100, 1000, 10000};
+    int64_t num = (int64_t)v * POW10[dec] * 2;
+    return putDecimal(p, (num + (num < 0 ? -scale : scale)) / (2 * scale), dec);
+}
+
+// floor(sqrt(n)), seeded in float and corrected
+static uint64_t isqrt64(uint64_t n) {
+    uint64_t r = (uint64_t)sqrtf((float)n);
+    if (r) r = (r + n / r) / 2;
+    while (r > 0 && r * r > n) r--;
+    while ((r + 1) * (r + 1) <= n) r++;
+    return r;
+}
+
+// |a| * num / den with 4 decimals, rounded like putFixed: exact where
+// float would flip the last digit on one row in a thousand
+static char* putMagnitude(char* p, const int16_t* const v[3], uint16_t i, int32_t num, int32_t den) {
+    uint64_t sq = 0;
+    for (int k = 0; k < 3; k++) sq += (uint64_t)((int32_t)v[k][i] * v[k][i]);
+    if (num != 1) {
+        // Raw counts: sq * num^2 * 4 * 10^8 does not fit 64 bits
+        return putDecimal(p, llround(sqrt((double)sq) * num / den * 1e4), 4);
+    }
+    uint64_t twice = isqrt64(sq * 400000000ULL);  // floor(2 * 10^4 * |a|)
+    return putDecimal(p, (twice + den) / (2 * (uint64_t)den), 4);
+}
+
+static bool decodeCsvColumns(const uint8_t* chunk, CsvColumns &cols) {
+    uint16_t count = bsChunkHeader(chunk)->count;
+    if (count > EXPORT_CHUNK_MAX) return false;
+    memset(&cols, 0, sizeof(cols));
+    const BsColumnDesc* d = bsChunkColumns(chunk);
+    for (uint8_t i = 0; i < bsChunkHeader(chunk)->ncols; i++) {
+        uint8_t id = d[i].id;
+        void* out = id == BS_COL_T                       ? (void*)cols.t
+                  : id == BS_COL_FLAGS                   ? (void*)cols.flags
+                  : id >= BS_COL_AX && id <= BS_COL_GZ   ? (void*)cols.v[id - BS_COL_AX]
+                  :                                        nullptr;  // quaternion: not in the CSV
+        if (out && !bsChunkDecode(chunk, d[i], out)) return false;
+    }
+    return true;
+}
+
+static bool exportCsv(uint32_t session, uint8_t* rec, size_t cap, BsWriteFn write, void* ctx,
+                      ExportStats &st) {
+    LogCursor c;
+    if (!logOpenSession(c, session)) return false;
+    CsvColumns* cols = (CsvColumns*)heap_caps_malloc(sizeof(CsvColumns), MALLOC_CAP_8BIT);
+    if (!cols) return false;
+    int32_t an, ad, gn, gd;   // value = count * num / den
+    bsAccelRatio(c.header, an, ad);
+    bsGyroRatio(c.header, gn, gd);
+    const int16_t* const accel[3] = {cols->v[0], cols->v[1], cols->v[2]};
+
+    bool ok = write(ctx, CSV_HEADER, sizeof(CSV_HEADER) - 1) == sizeof(CSV_HEADER) - 1;
+    uint16_t len;
+    uint8_t type;
+    while (ok && (type = logNextRecord(c, rec, cap, len, LOG_CHUNK)) != 0) {
+        if (type != LOG_CHUNK || !bsChunkValid(rec, len) || !decodeCsvColumns(rec, *cols)) continue;
+        uint16_t count = bsChunkHeader(rec)->count;
+        for (uint16_t i = 0; ok && i < count; i++) {
+            char row[128];
+            char* p = putInt(row, cols->t[i] / 1000);
+            for (int k = 0; k < 3; k++) { *p++ = ','; p = putFixed(p, cols->v[k][i] * an, ad, 4); }
+            for (int k = 3; k < 6; k++) { *p++ = ','; p = putFixed(p, cols->v[k][i] * gn, gd, 2); }
+            *p++ = ',';
+            p = putMagnitude(p, accel, i, an, ad);
+            *p++ = ',';
+            *p++ = cols->flags[i] & BS_FLAG_IMPACT ? '1' : '0';
+            *p++ = '\n';
+            ok = write(ctx, row, p - row) == (size_t)(p - row);
+        }
+        st.chunks++;
+        st.samples += count;
+    }
+    heap_caps_free(cols);
+    return ok;
+}
+
+bool exportSession(uint32_t session, uint8_t format, BsWriteFn write, void* ctx, ExportStats &st) {
+    memset(&st, 0, sizeof(st));
+    st.session = session;
+    st.format = format;
+    st.active = true;
+    st.startMs = millis();
+
+    CountingSink sink = {write, ctx, &st};
+    size_t cap = logRecordMax();
+    uint8_t* rec = (uint8_t*)heap_caps_malloc(cap, MALLOC_CAP_8BIT);
+    bool ok = rec && (format == EXPORT_CSV ? exportCsv(session, rec, cap, countingWrite, &sink, st)
+                                           : exportYbs(session, rec, cap, countingWrite, &sink, st));
+    heap_caps_free(rec);
+    st.ms = millis() - st.startMs;
+    st.active = false;
+    return ok;
+}
+
+// ==================== HTTP ====================
+
+// One chunked-encoding chunk: fixed-width size line, payload, CRLF, so
+// each goes out in a single write
+struct HttpSink {
+    uint8_t buf[6 + EXPORT_HTTP_CHUNK + 2];
+    size_t  len;
+    bool    failed;
+};
+
+static bool sinkFlush(HttpSink &s) {
+    if (s.failed || s.len == 0) return !s.failed;
+    char size[7];
+    snprintf(size, sizeof(size), "%04x\r\n", (unsigned)s.len);
+    memcpy(s.buf, size, 6);
+    memcpy(s.buf + 6 + s.len, "\r\n", 2);
+    size_t total = 6 + s.len + 2;
+    s.failed = exportClient.write(s.buf, total) != total;
+    s.len = 0;
+    return !s.failed;
+}
+
+static size_t sinkWrite(void* ctx, const void* data, size_t len) {
+    HttpSink &s = *(HttpSink*)ctx;
+    const uint8_t* p = (const uint8_t*)data;
+    size_t left = len;
+    while (left && !s.failed) {
+        size_t n = EXPORT_HTTP_CHUNK - s.len < left ? EXPORT_HTTP_CHUNK - s.len : left;
+        memcpy(s.buf + 6 + s.len, p, n);
+        s.len += n;
+        p += n;
+        left -= n;
+        if (s.len == EXPORT_HTTP_CHUNK) sinkFlush(s);
+    }
+    return s.failed ? 0 : len;
+}
+
+static void exportTask(void*) {
+    HttpSink* s = (HttpSink*)heap_caps_malloc(sizeof(HttpSink), MALLOC_CAP_8BIT);
+    bool csv = exportFormat == EXPORT_CSV;
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+        "HTTP/1.1 200 OK\r\nContent-Type: %s\r\n"
+        "Content-Disposition: attachment; filename=\"session_%lu.%s\"\r\n"
+        "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n",
+        csv ? "text/csv" : "application/octet-stream", (unsigned long)exportSessionId,
+        csv ? "csv" : "ybs");
+    if (s && exportClient.write((const uint8_t*)head, n) == (size_t)n) {
+        s->len = 0;
+        s->failed = false;
+        bool ok = exportSession(exportSessionId, exportFormat, sinkWrite, s, stats) && sinkFlush(*s);
+        stats.complete = ok && exportClient.write((const uint8_t*)"0\r\n\r\n", 5) == 5;
+        Serial.printf("# export: session %lu %s, %llu bytes in %lu ms (%.1f KB/s)%s\n",
+                      (unsigned long)stats.session, csv ? "csv" : "ybs",
+                      (unsigned long long)stats.bytes, (unsigned long)stats.ms,
+                      stats.ms ? stats.bytes / (float)stats.ms : 0.0f,
+                      stats.complete ? "" : " - incomplete");
+    }
+    exportClient.stop();
+    heap_caps_free(s);
+    busy = false;
+    vTaskDelete(nullptr);
+}
+
+int exportStart(const WiFiClient &client, uint32_t session, uint8_t format) {
+    if (busy) return 503;
+    LogCursor c;
+    if (!logOpenSession(c, session)) return 404;
+    busy = true;
+    exportClient = client;
+    exportSessionId = session;
+    exportFormat = format;
+    // Core 0 beside the log writer, same priority: blocking on the socket never touches the loop
+    if (xTaskCreatePinnedToCore(exportTask, "export", EXPORT_STACK, nullptr, 1, nullptr, 0) != pdPASS) {
+        exportClient.stop();
+        busy = false;
+        return 503;
+    }
+    return 0;
+}
+
+size_t exportToJson(char* buf, size_t size) {
+    const ExportStats &s = stats;
+    uint32_t ms = s.active ? millis() - s.startMs : s.ms;
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, "{\"active\":%s,\"session\":%lu,\"format\":\"%s\",\"complete\":%s,\"pyramid\":%s,",
+               s.active ? "true" : "false", (unsigned long)s.session,
+               s.format == EXPORT_CSV ? "csv" : "ybs", s.complete ? "true" : "false",
+               s.pyramid ? "true" : "false");
+    jsonAppend(o, "\"chunks\":%lu,\"samples\":%llu,\"bytes\":%llu,\"ms\":%lu,\"kb_per_s\":%.1f}",
+               (unsigned long)s.chunks, (unsigned long long)s.samples,
+               (unsigned long long)s.bytes, (unsigned long)ms, ms ? s.bytes / (float)ms : 0.0f);
+    return o.len;
+}
@@ -0,0 +1,56 @@
+/**
+ * Bulk session export from the flash log (GET /export)
+ *
+ * Streams a whole stored session as a session file (.ybs, the layout of
+ * lib/ballsession, readable by every host tool) or as imu_logger CSV,
+ * straight from flash with HTTP chunked transfer encoding. Nothing is
+ * buffered beyond one flash record and one HTTP chunk:
+ *
+ *   .ybs  header, chunks copied as stored; the LOG_SUMMARY records
+ *         regrouped level by level into the pyramid section (one pass
+ *         over the session's summary records per level); the index
+ *         rebuilt by a last pass over the chunks
+ *   .csv  chunks decoded one at a time, one row per 200Hz sample
+ *
+ * The transfer runs on its own task on core 0 and blocks only itself
+ * when the TCP window is full, so the loop task keeps sampling and
+ * streaming; its flash reads are the only cost to the sampler (see the
+ * stall figures in GET /log). One export at a time.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bsfile.h"
+
+class WiFiClient;
+
+enum ExportFormat : uint8_t {
+    EXPORT_YBS = 0,
+    EXPORT_CSV,
+};
+
+struct ExportStats {
+    uint32_t session;
+    uint8_t  format;
+    bool     active;
+    bool     complete;    // every record written and the client took it all
+    bool     pyramid;     // .ybs: summary pyramid included
+    uint32_t chunks;
+    uint64_t samples;
+    uint64_t bytes;       // payload, excluding the chunked-encoding framing
+    uint32_t startMs;
+    uint32_t ms;
+};
+
+// Writes the session through write from the calling task; false if it
+// is not on flash or a write failed
+bool exportSession(uint32_t session, uint8_t format, BsWriteFn write, void* ctx, ExportStats &st);
+
+// Answers the request on client from the export task; 0 when started,
+// otherwise the HTTP status to reply with (404 no such session, 503 busy)
+int exportStart(const WiFiClient &client, uint32_t session, uint8_t format);
+
+// Last / current export: size, duration and sustained rate
+size_t exportToJson(char* buf, size_t size);
@@ -0,0 +1,97 @@
+/**
+ * Sample tick and output rates - see filterbank.h
+ */
+
+#include "filterbank.h"
+#include "imusample.h"
+#include "jsonout.h"
+#include "profile.h"
+#include "sessionlog.h"   // LOG_SAMPLE_HZ
+#include <Esp.h>
+
+static const uint32_t TICK_US = 1000000 / LOG_SAMPLE_HZ;
+static const char* const BRANCH_NAMES[FILTER_BRANCHES] = {"stream", "display"};
+
+static BsDecimator bank;
+static uint32_t nextTickUs;
+static bool     tickStarted;
+static uint32_t ticksSkipped;
+static uint64_t pushCycles;
+static uint32_t pushCyclesMax;
+
+void filterInit() {
+    bsDecInit(bank);
+    bsDecAddBranch(bank, FILTER_STREAM_FACTOR, FILTER_STREAM_TAPS);
+    bsDecAddBranch(bank, FILTER_DISPLAY_FACTOR, FILTER_DISPLAY_TAPS);
+    tickStarted = false;
+    ticksSkipped = 0;
+    pushCycles = 0;
+    pushCyclesMax = 0;
+}
+
+void filterTickRestart() {
+    tickStarted = false;
+}
+
+IRAM_HOT bool filterTickDue(uint32_t nowUs) {
+    if (!tickStarted) {
+        tickStarted = true;
+        nextTickUs = nowUs + TICK_US;
+        return true;
+    }
+    int32_t late = (int32_t)(nowUs - nextTickUs);
+    if (late < 0) return false;
+    if (late >= (int32_t)TICK_US) {
+        // Stalled (flash erase, sleep): restart the grid rather than catch up
+        ticksSkipped += late / TICK_US;
+        nextTickUs = nowUs + TICK_US;
+    } else {
+        nextTickUs += TICK_US;
+    }
+    return true;
+}
+
+IRAM_HOT uint32_t filterPush(float ax, float ay, float az, float gx, float gy, float gz, const BsDecTag &tag) {
+    const float in[BS_DEC_CHANNELS] = {ax, ay, az, gx, gy, gz};
+    uint32_t c0 = ESP.getCycleCount();
+    uint32_t ready = bsDecPush(bank, in, &tag);
+    uint32_t cycles = ESP.getCycleCount() - c0;
+    pushCycles += cycles;
+    if (cycles > pushCyclesMax) pushCyclesMax = cycles;
+    return ready;
+}
+
+const float* filterOut(uint8_t branch) {
+    return bank.b[branch].out;
+}
+
+const BsDecTag &filterOutTag(uint8_t branch) {
+    return bank.b[branch].outTag;
+}
+
+float filterRpm(uint8_t branch) {
+    return bsDecRpm(bank, branch) * IMU_DPS_PER_UNIT;
+}
+
+size_t filterMemBytes() {
+    return sizeof(bank);
+}
+
+size_t filterToJson(char* buf, size_t size) {
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, "{\"input_hz\":%d,\"inputs\":%lu,\"ticks_skipped\":%lu,"
+                  "\"cycles_per_input\":%lu,\"cycles_max\":%lu,"
+                  "\"units\":\"%s\",\"scale_ok\":%s,\"sample_bytes\":%u,\"branches\":[",
+               LOG_SAMPLE_HZ, (unsigned long)bank.inputs, (unsigned long)ticksSkipped,
+               (unsigned long)(bank.inputs ? pushCycles / bank.inputs : 0), (unsigned long)pushCyclesMax,
+               imuUnitsName(), imuScaleOk() ? "true" : "false", (unsigned)sizeof(ImuSample));
+    for (int k = 0; k < bank.branches; k++) {
+        const BsDecBranch &b = bank.b[k];
+        jsonAppend(o, "%s{\"name\":\"%s\",\"hz\":%.1f,\"factor\":%u,\"taps\":%u,\"delay_ms\":%.1f,"
+                      "\"outputs\":%lu}",
+                   k ? "," : "", BRANCH_NAMES[k], (float)LOG_SAMPLE_HZ / b.factor, b.factor, b.taps,
+                   bsDecDelay(bank, k) * 1000.0f / LOG_SAMPLE_HZ, (unsigned long)b.outputs);
+    }
+    jsonAppend(o, "]}");
+    return o.len;
+}
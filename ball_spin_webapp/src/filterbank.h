@@ -0,0 +1,72 @@
+/**
+ * Sample tick and output rates (bsdecimate.h)
+ *
+ * The IMU is read once per loop iteration; every LOG_SAMPLE_HZ tick of
+ * that (the flash log's 200Hz sample) also feeds one decimation bank
+ * whose branches give the rates slower consumers run at, low-pass
+ * filtered at half their rate instead of sampled:
+ *
+ *   FILTER_STREAM    50Hz    WebSocket frames (JSON and "bin"), frame window
+ *   FILTER_DISPLAY   33.3Hz  ATOM S3 screen
+ *
+ * Shot detection keeps running on every loop iteration (bsFuse /
+ * bsDetect), as stored sessions are re-analysed.
+ *
+ * Each tick's sample is pushed with its read time, quaternion and impact
+ * flag; a branch output carries those of its filter's centre
+ * (filterOutTag), FILTER_DISPLAY_TAPS / FILTER_STREAM_TAPS' group delay
+ * behind the newest tick, so frames are stamped with the instant their
+ * values describe.
+ *
+ * The tick is kept on a fixed grid of micros(), so the rates hold on
+ * average whatever the loop period; when the loop stalls past a whole
+ * tick the grid restarts and the ticks skipped are counted. Served on
+ * GET /filters with the cycles per input the bank costs and the sample
+ * units the build runs in.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bsdecimate.h"
+
+enum FilterBranch : uint8_t {
+    FILTER_STREAM = 0,
+    FILTER_DISPLAY,
+    FILTER_BRANCHES
+};
+
+// Branch rates and lengths: 4 x 200Hz -> 50Hz, 6 x 200Hz -> 33.3Hz
+static const uint8_t  FILTER_STREAM_FACTOR  = 4;
+static const uint16_t FILTER_STREAM_TAPS    = 24;   // 57.5 ms delay, alias >= 36 dB down
+static const uint8_t  FILTER_DISPLAY_FACTOR = 6;
+static const uint16_t FILTER_DISPLAY_TAPS   = 24;   // 57.5 ms delay, alias >= 21 dB down
+
+void filterInit();
+
+// True once per sample tick; call with the sample's micros() every loop iteration
+bool filterTickDue(uint32_t nowUs);
+
+// Next call starts the tick grid anew (after light sleep: not counted as skipped)
+void filterTickRestart();
+
+// Feeds one tick's sample in sample units (imusample.h: counts or g and
+// deg/s) with its tag (read time, quaternion, BS_FLAG_IMPACT); bit
+// FILTER_x set when that branch has a new output
+uint32_t filterPush(float ax, float ay, float az, float gx, float gy, float gz, const BsDecTag &tag);
+
+// Latest output of a branch: ax ay az gx gy gz, sample units
+const float* filterOut(uint8_t branch);
+
+// Latest output's time, quaternion and flags (the filter's centre)
+const BsDecTag &filterOutTag(uint8_t branch);
+
+// Latest output's RPM (|gyro| / 6 in deg/s, as bsFuse)
+float filterRpm(uint8_t branch);
+
+// Bytes of static filter storage (memory budget report)
+size_t filterMemBytes();
+
+// Writes the /filters JSON document; returns bytes written
+size_t filterToJson(char* buf, size_t size);
@@ -0,0 +1,68 @@
+/**
+ * IMU sample units - see imusample.h
+ */
+
+#include "imusample.h"
+#include "profile.h"
+#include "sessionlog.h"   // LOG_ACCEL_PER_G, LOG_GYRO_PER_DPS
+#include <M5Unified.h>
+
+static bool scaleOk = true;
+
+IRAM_HOT void imuRead(ImuSample &s) {
+#if RAW_COUNTS
+    // Counts as the driver read them: accel x/y/z, gyro x/y/z, mag x/y/z
+    for (int k = 0; k < 3; k++) {
+        s.a[k] = M5.Imu.getRawData(k);
+        s.g[k] = M5.Imu.getRawData(3 + k);
+    }
+#else
+    // Note: M5Unified@0.1.17 getImuData() returns void, not bool
+    m5::imu_data_t d;
+    M5.Imu.getImuData(&d);
+    s.a[0] = d.accel.x; s.a[1] = d.accel.y; s.a[2] = d.accel.z;
+    s.g[0] = d.gyro.x;  s.g[1] = d.gyro.y;  s.g[2] = d.gyro.z;
+#endif
+}
+
+bool imuCheckScale() {
+#if RAW_COUNTS
+    M5.Imu.update();
+    m5::imu_data_t d;
+    M5.Imu.getImuData(&d);
+    ImuSample s;
+    imuRead(s);
+    const float ref[6] = {d.accel.x, d.accel.y, d.accel.z, d.gyro.x, d.gyro.y, d.gyro.z};
+    scaleOk = true;
+    for (int k = 0; k < 6; k++) {
+        float mine = k < 3 ? s.a[k] * IMU_G_PER_UNIT : s.g[k - 3] * IMU_DPS_PER_UNIT;
+        // 2% plus a few counts (the two reads round differently)
+        float tol = 0.02f * fabsf(ref[k]) + (k < 3 ? 4 * IMU_G_PER_UNIT : 4 * IMU_DPS_PER_UNIT);
+        if (fabsf(mine - ref[k]) > tol) scaleOk = false;
+    }
+    if (!scaleOk) {
+        Serial.printf("[IMU] raw counts x full scale disagree with M5Unified: "
+                      "a %.3f %.3f %.3f g vs %.3f %.3f %.3f\n",
+                      s.a[0] * IMU_G_PER_UNIT, s.a[1] * IMU_G_PER_UNIT, s.a[2] * IMU_G_PER_UNIT,
+                      ref[0], ref[1], ref[2]);
+    }
+#endif
+    return scaleOk;
+}
+
+void imuLogScales(BsFileHeader &h) {
+#if RAW_COUNTS
+    bsFileHeaderSetFullScale(h, IMU_ACCEL_FS_G, IMU_GYRO_FS_DPS);
+#else
+    h.accelPerG = LOG_ACCEL_PER_G;
+    h.gyroPerDps = LOG_GYRO_PER_DPS;
+#endif
+}
+
+const char* imuUnitsName() {
+    return RAW_COUNTS ? "counts" : "physical";
+}
+
+bool imuScaleOk() {
+    return scaleOk;
+}
@@ -0,0 +1,77 @@
+/**
+ * IMU sample units - raw sensor counts or g / deg/s through the pipeline
+ *
+ * RAW_COUNTS=0 (default): M5Unified converts every read to float g and
+ *   deg/s; the log converts those back to its fixed point (mg, 0.1 deg/s).
+ * RAW_COUNTS=1: the sample path carries the MPU6886's own int16 counts.
+ *   The log stores them as read (BS_HEADER_FULL_SCALE header: +-8 g,
+ *   +-2000 deg/s over 32768 counts), the decimation bank filters them and
+ *   the frame window keeps them as int16. Only the fusion kernel (bsFuse,
+ *   bsDetect) and the consumers that show physical values (JSON frames,
+ *   screen, session stats) multiply by IMU_G_PER_UNIT / IMU_DPS_PER_UNIT;
+ *   "bin" clients get counts and the full scale on the "bin" event.
+ *
+ * Float builds keep the same code with both factors 1.0.
+ *
+ * The full scale is what M5Unified programs into the MPU6886; raw builds
+ * check it at boot against M5Unified's own conversion (imuCheckScale)
+ * and report the result on GET /filters.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "ballsession.h"
+
+#ifndef RAW_COUNTS
+#define RAW_COUNTS 0
+#endif
+
+static const uint16_t IMU_ACCEL_FS_G   = 8;      // M5Unified's MPU6886 setup
+static const uint16_t IMU_GYRO_FS_DPS  = 2000;
+
+#if RAW_COUNTS
+typedef int16_t ImuUnit;
+static const float IMU_G_PER_UNIT   = (float)IMU_ACCEL_FS_G / BS_FULL_SCALE_COUNTS;
+static const float IMU_DPS_PER_UNIT = (float)IMU_GYRO_FS_DPS / BS_FULL_SCALE_COUNTS;
+#else
+typedef float ImuUnit;
+static const float IMU_G_PER_UNIT   = 1.0f;
+static const float IMU_DPS_PER_UNIT = 1.0f;
+#endif
+
+// One read: accel x/y/z, gyro x/y/z in sample units
+struct ImuSample {
+    ImuUnit a[3];
+    ImuUnit g[3];
+};
+
+// A filtered value back in sample units (raw builds: rounded, clamped)
+static inline ImuUnit imuUnit(float v) {
+#if RAW_COUNTS
+    if (v > 32767.0f) return 32767;
+    if (v < -32768.0f) return -32768;
+    return (int16_t)lroundf(v);
+#else
+    return v;
+#endif
+}
+
+// Latest sample; call after M5.Imu.update()
+void imuRead(ImuSample &s);
+
+// Raw builds: compares counts x full scale with M5Unified's getImuData()
+// on one read (device at rest: gravity on some axis). Always true for
+// float builds.
+bool imuCheckScale();
+
+// Sample scales for the session log header
+void imuLogScales(BsFileHeader &h);
+
+// "counts" or "physical"
+const char* imuUnitsName();
+
+// Result of the boot check
+bool imuScaleOk();
@@ -0,0 +1,46 @@
+/**
+ * Bounded JSON writer for the HTTP report endpoints
+ *
+ * Appends printf-formatted fragments into a caller-owned buffer and
+ * silently truncates once it is full (the buffer stays NUL-terminated).
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stddef.h>
+
+struct JsonOut {
+    char*  buf;
+    size_t size;
+    size_t len;
+};
+
+static inline JsonOut jsonBegin(char* buf, size_t size) {
+    if (size) buf[0] = '\0';
+    return JsonOut{buf, size, 0};
+}
+
+static inline void jsonAppend(JsonOut &o, const char* fmt, ...) {
+    if (o.len + 1 >= o.size) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int w = vsnprintf(o.buf + o.len, o.size - o.len, fmt, ap);
+    va_end(ap);
+    if (w > 0) o.len += (size_t)w;
+    if (o.len >= o.size) o.len = o.size - 1;
+}
+
+// Appends s as a quoted JSON string, escaping quotes, backslashes and
+// control characters (for text that comes from user input)
+static inline void jsonAppendString(JsonOut &o, const char* s) {
+    jsonAppend(o, "\"");
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') jsonAppend(o, "\\%c", c);
+        else if (c < 0x20)         jsonAppend(o, "\\u%04x", c);
+        else                       jsonAppend(o, "%c", c);
+    }
+    jsonAppend(o, "\"");
+}
@@ -0,0 +1,125 @@
+/**
+ * Sensor-to-glass latency accounting - see latency.h
+ */
+
+#include "latency.h"
+#include "jsonout.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct LatHist {
+    uint32_t n;
+    uint32_t maxUs;
+    uint64_t sumUs;
+    uint32_t bins[LAT_BINS];
+};
+
+struct ClientLatency {
+    bool     active;
+    uint32_t lastSeq;
+    LatHist  rx;    // sensor read -> client receive
+    LatHist  draw;  // sensor read -> client render
+};
+
+static LatHist       encodeHist;            // sensor read -> WS send (device only)
+static ClientLatency clientLat[LAT_MAX_CLIENTS];
+
+// ==================== Histogram helpers ====================
+
+static void histAdd(LatHist &h, uint32_t us) {
+    uint32_t bin = us / (1000 * LAT_BIN_MS);
+    if (bin >= (uint32_t)LAT_BINS) bin = LAT_BINS - 1;
+    h.bins[bin]++;
+    h.n++;
+    h.sumUs += us;
+    if (us > h.maxUs) h.maxUs = us;
+}
+
+// Percentile as the upper edge (ms) of the bin containing it
+static int histPercentileMs(const LatHist &h, float p) {
+    if (h.n == 0) return -1;
+    uint32_t target = (uint32_t)(p * h.n);
+    if (target >= h.n) target = h.n - 1;
+    uint32_t acc = 0;
+    for (int i = 0; i < LAT_BINS; i++) {
+        acc += h.bins[i];
+        if (acc > target) return (i + 1) * LAT_BIN_MS;
+    }
+    return LAT_BINS * LAT_BIN_MS;
+}
+
+// ==================== Recording ====================
+
+size_t latencyMemBytes() {
+    return sizeof(encodeHist) + sizeof(clientLat);
+}
+
+void latencyResetClient(uint8_t num) {
+    if (num >= LAT_MAX_CLIENTS) return;
+    memset(&clientLat[num], 0, sizeof(ClientLatency));
+}
+
+void latencyResetAll() {
+    memset(&encodeHist, 0, sizeof(encodeHist));
+    memset(clientLat, 0, sizeof(clientLat));
+}
+
+void latencyRecordEncode(uint32_t us) {
+    histAdd(encodeHist, us);
+}
+
+void latencyRecordClient(uint8_t num, uint32_t seq, int32_t rxUs, int32_t drawUs) {
+    if (num >= LAT_MAX_CLIENTS) return;
+    ClientLatency &c = clientLat[num];
+    c.active = true;
+    c.lastSeq = seq;
+    // Negative values come from a stale clock-offset estimate - drop them
+    if (rxUs >= 0) histAdd(c.rx, (uint32_t)rxUs);
+    if (drawUs >= 0) histAdd(c.draw, (uint32_t)drawUs);
+}
+
+bool latencyHandleReport(uint8_t num, const char* payload) {
+    unsigned long seq;
+    long rxUs, drawUs;
+    if (sscanf(payload, "lat %lu %ld %ld", &seq, &rxUs, &drawUs) != 3) return false;
+    latencyRecordClient(num, (uint32_t)seq, (int32_t)rxUs, (int32_t)drawUs);
+    return true;
+}
+
+// ==================== JSON report ====================
+
+static void jsonHist(JsonOut &o, const char* name, const LatHist &h) {
+    jsonAppend(o, "\"%s\":{\"n\":%lu,\"mean_us\":%lu,\"max_us\":%lu,"
+                  "\"p50_ms\":%d,\"p95_ms\":%d,\"p99_ms\":%d,\"bins\":[",
+               name, (unsigned long)h.n,
+               (unsigned long)(h.n ? h.sumUs / h.n : 0), (unsigned long)h.maxUs,
+               histPercentileMs(h, 0.50f), histPercentileMs(h, 0.95f),
+               histPercentileMs(h, 0.99f));
+    for (int i = 0; i < LAT_BINS; i++) {
+        jsonAppend(o, i ? ",%lu" : "%lu", (unsigned long)h.bins[i]);
+    }
+    jsonAppend(o, "]}");
+}
+
+size_t latencyToJson(char* buf, size_t size) {
+    if (size == 0) return 0;
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, "{\"bin_ms\":%d,", LAT_BIN_MS);
+    jsonHist(o, "encode", encodeHist);
+    jsonAppend(o, ",\"clients\":[");
+    bool first = true;
+    for (int i = 0; i < LAT_MAX_CLIENTS; i++) {
+        const ClientLatency &c = clientLat[i];
+        if (!c.active) continue;
+        jsonAppend(o, "%s{\"id\":%d,\"seq\":%lu,", first ? "" : ",", i,
+                   (unsigned long)c.lastSeq);
+        jsonHist(o, "rx", c.rx);
+        jsonAppend(o, ",");
+        jsonHist(o, "draw", c.draw);
+        jsonAppend(o, "}");
+        first = false;
+    }
+    jsonAppend(o, "]}");
+    return o.len;
+}
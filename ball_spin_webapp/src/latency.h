@@ -0,0 +1,49 @@
+/**
+ * Sensor-to-glass latency accounting
+ *
+ * Every streamed frame carries "seq", "ts" (micros() when the IMU sample
+ * its values describe was read: the stream filter's centre, 57.5 ms
+ * before the newest sample) and "tx" (micros() right before the
+ * WebSocket send). Clients
+ * estimate their clock offset against micros() with a ping/pong exchange
+ * and report back, per sampled frame, how long after "ts" the frame was
+ * received and drawn on screen.
+ *
+ * WS commands (text):
+ *   "ping <client_us>"            -> {"event":"pong","c":<client_us>,"d":<device_us>}
+ *   "lat <seq> <rx_us> <draw_us>" -> latencies already mapped to device clock,
+ *                                    draw_us < 0 when the client does not render
+ *
+ * Latencies are kept as 2 ms histograms per WebSocket client slot and
+ * served as JSON on GET /latency for plotting.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const int LAT_MAX_CLIENTS = 8;   // >= WEBSOCKETS_SERVER_CLIENT_MAX
+static const int LAT_BIN_MS      = 2;
+static const int LAT_BINS        = 61;  // 0..119 ms in 2 ms bins + overflow (ts includes the 57.5 ms filter delay)
+
+// Bytes of static histogram storage (memory budget report)
+size_t latencyMemBytes();
+
+// Client slot connected / disconnected: clears its histograms
+void latencyResetClient(uint8_t num);
+
+// Clears every histogram (including device-side encode latency)
+void latencyResetAll();
+
+// Device-side: time between sensor read and WebSocket send
+void latencyRecordEncode(uint32_t us);
+
+// Client report; drawUs < 0 means "not rendered"
+void latencyRecordClient(uint8_t num, uint32_t seq, int32_t rxUs, int32_t drawUs);
+
+// Parses a "lat ..." command payload and records it; false if malformed
+bool latencyHandleReport(uint8_t num, const char* payload);
+
+// Writes the /latency JSON document; returns bytes written (truncated if buf too small)
+size_t latencyToJson(char* buf, size_t size);
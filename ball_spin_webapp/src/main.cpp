@@ -2,7 +2,8 @@
  * Tennis Ball Spin Tracker - WebSocket Streaming Firmware
  * M5Stack ATOM S3 (ESP32-S3)
  *
- * Creates a WiFi Access Point and serves a web-based dashboard
+ * Creates a WiFi Access Point (or joins a shared network, see
+ * wifilink.h) and serves a web-based dashboard
  * that visualizes real-time IMU data via WebSocket. Tracks ball
  * orientation with quaternion integration and streams at 50Hz.
  *
@@ -11,6 +12,7 @@
  * WiFi AP: "TennisBall_IMU" / "tennis123"
  * Web UI:  http://192.168.4.1
  * WS:      ws://192.168.4.1:81
+ * Station: GET /wifi?ssid=..&pass=.. then ws://ball-xxxxxx.local:81 (mDNS _yotb._tcp)
  */
 
 #include <M5Unified.h>
@@ -20,8 +22,26 @@
 #include <math.h>
 #include <string.h>
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "driver/gpio.h"
 #include "webpage.h"  // contains: const char index_html[] PROGMEM = R"rawliteral(...)rawliteral";
+#include "latency.h"
+#include "profile.h"   // PROF_BEGIN/PROF_END, IRAM_HOT/DRAM_HOT placement
+#include "memreport.h"
+#include "arena.h"
+#include "energy.h"
+#include "sessionlog.h"
+#include "codecbench.h"
+#include "bsstream.h"
+#include "bspipeline.h"
+#include "replay.h"
+#include "export.h"
+#include "wifilink.h"
+#include "sessionstats.h"
+#include "filterbank.h"
+#include "bsdecimate.h"
+#include "imusample.h"
 
 // --- WiFi AP Config ---
 const char* AP_SSID = "TennisBall_IMU";
@@ -41,10 +61,10 @@ static M5Canvas canvas(&M5.Display);
 
 // --- 3D types ---
 struct Vec3 { float x, y, z; };
-struct Quat { float w, x, y, z; };
+typedef BsQuat Quat;
 
-// --- Orientation state ---
-static Quat orient = {1, 0, 0, 0};
+// --- Orientation, filters, gyro bias and impact state (bspipeline.h) ---
+static BsPipeline ball;
 
 // --- Seam curve ---
 static const float SEAM_AMP = 0.44f;
@@ -59,34 +79,58 @@ static const uint16_t COL_BALL_HI = 0xDF00;  // highlight
 static const uint16_t COL_SEAM    = 0xFFFF;  // white seam
 static const uint16_t COL_SEAM_DIM= 0x4208;  // gray back seam
 
-// --- Filtered sensor values ---
-static float filtGx  = 0, filtGy = 0, filtGz = 0;
-static float filtRPM = 0;
-
 // --- Sleep mode ---
 static bool sleepPending = false;
 static uint32_t btnPressStartMs = 0;
 static bool btnWasDown = false;
 static const uint32_t SLEEP_HOLD_MS = 3000; // 3 seconds to trigger sleep
 
-// --- Gyro bias estimation (auto-calibration when stationary) ---
-static float gyroBiasX = 0, gyroBiasY = 0, gyroBiasZ = 0;
-
 // --- Timing ---
 static uint32_t lastUs       = 0;
-static uint32_t lastWsSendMs = 0;
+static uint32_t frameSeq     = 0;  // streamed frame sequence number, one per 50Hz tick
+
+// --- Buffers (sizes reported by the memory budget) ---
+static const size_t WS_FRAME_BUF = 384;
+static size_t wsFrameHighWater   = 0;  // longest 50Hz frame seen
+static size_t wsShotHighWater    = 0;  // longest shot event seen
+static char httpJson[4096];            // shared by the JSON report handlers (/latency, /mem, /log, ...)
 
 // --- WebSocket client tracking ---
 static uint8_t clientCount = 0;
 
+// --- Binary frames (clients opt in with "bin", see bsstream.h) ---
+static const uint16_t WS_KEY_INTERVAL = 50;  // keyframe every 1s at 50Hz
+static BsStreamEncoder wsStream;
+static uint32_t binClients = 0;               // bit per client number
+static uint64_t wsStreamCycles = 0;           // bsStreamEncode, over wsStreamPackets
+static uint32_t wsStreamPackets = 0;
+static uint64_t wsStreamBytes = 0;
+
+// --- Power state (energy accounting) ---
+static bool radioOn = false;
+
+// --- Session replay: one client at a time, left out of the live stream meanwhile ---
+static const int64_t REPLAY_BUDGET_US = 4000;  // loop time per iteration when not paced
+static int8_t   replayClient = -1;
+static uint8_t  replayEvery  = 4;       // stored 200Hz samples per frame (4 = live 50Hz)
+static uint32_t replayFrames = 0;
+static uint64_t replayBytes  = 0;
+static BsDecimator replayDec;           // the live stream filter, one branch at every
+
+// --- Resume: a reconnecting client catches up from the frame window ---
+static uint32_t resumeClients = 0;                          // bit per client number
+static uint32_t resumeSeq[WEBSOCKETS_SERVER_CLIENT_MAX];    // next frame to resend
+static uint32_t resumeShot[WEBSOCKETS_SERVER_CLIENT_MAX];   // next shot to resend
+static uint32_t resumeFrames[WEBSOCKETS_SERVER_CLIENT_MAX];
+static uint32_t resumeMissed[WEBSOCKETS_SERVER_CLIENT_MAX]; // asked for but out of the window
+
+// Clients the live frames and shot events skip
+static uint32_t liveSkipMask() { return (replayClient >= 0 ? 1u << replayClient : 0) | resumeClients; }
+
 // --- Impact detection ---
-static const float IMPACT_THRESH = 4.0f;  // g threshold
-static const uint32_t IMPACT_COOLDOWN_MS = 200; // debounce
-static uint32_t lastImpactMs = 0;
-static bool impactFlag = false;  // set true on impact, cleared after WS send
+static bool logImpactPending = false;  // set true on impact, cleared by the next 200Hz tick
 
 // --- Shot tracking ---
-static const int MAX_SHOTS = 50;
 struct ShotEvent {
     uint32_t timestamp;
     float peakRPM;
@@ -94,38 +138,32 @@ struct ShotEvent {
     float gx, gy, gz;  // gyro at impact for classification
     char spinType[12];
 };
-static ShotEvent shots[MAX_SHOTS];
-static int shotCount = 0;
 
-// --- Peak tracking after impact ---
-static bool trackingPeak = false;
-static uint32_t peakTrackStartMs = 0;
-static float peakRPMval = 0;
-static float peakGval = 0;
-static float peakGx = 0, peakGy = 0, peakGz = 0;
+// --- Session storage: PSRAM arena, released in O(1) on clear_shots ---
+struct FrameRecord {
+    uint32_t t;
+    uint32_t seq;      // frameSeq of the tick, for "resume"
+    bool  imp;
+    ImuUnit ax, ay, az;  // FILTER_STREAM output, sample units (imusample.h)
+    ImuUnit gx, gy, gz;
+    Quat  q;
+    float rpm;
+};
+static const size_t   SESSION_ARENA_PSRAM = 256 * 1024;
+static const size_t   SESSION_ARENA_SRAM  = 8 * 1024;   // no-PSRAM fallback
+static const uint32_t MAX_SHOTS_PSRAM     = 2000;
+static const uint32_t MAX_SHOTS_SRAM      = 50;
+static const uint32_t FRAME_WINDOW_PSRAM  = 500;        // last 10 s at 50Hz
+static const uint32_t FRAME_WINDOW_SRAM   = 100;
+static Arena sessionArena;
+static RecordPool<ShotEvent>   shots;   // append-only for the session
+static RecordPool<FrameRecord> frames;  // ring of recent 50Hz frames
 
 // ==================== Quaternion math ====================
 
-static Quat qmul(Quat a, Quat b) {
-    return {
-        a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
-        a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
-        a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
-        a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w
-    };
-}
-
-static void qnorm(Quat &q) {
-    float len = sqrtf(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z);
-    if (len > 0.0001f) {
-        float inv = 1.0f / len;
-        q.w *= inv; q.x *= inv; q.y *= inv; q.z *= inv;
-    }
-}
-
 // Optimized quaternion-vector rotation: q * v * q^-1
 // Uses the cross-product form (no full quaternion multiply needed)
-static Vec3 qrot(Quat q, Vec3 v) {
+static IRAM_HOT Vec3 qrot(Quat q, Vec3 v) {
     float tx = 2.0f * (q.y * v.z - q.z * v.y);
     float ty = 2.0f * (q.z * v.x - q.x * v.z);
     float tz = 2.0f * (q.x * v.y - q.y * v.x);
@@ -136,22 +174,402 @@ static Vec3 qrot(Quat q, Vec3 v) {
     };
 }
 
-// ==================== Spin classification ====================
-
-static void classifySpin(float gx, float gy, float gz, float rpm, char* out) {
-    if (rpm < 5.0f) { strcpy(out, "FLAT"); return; }
-    float agx = fabsf(gx), agy = fabsf(gy), agz = fabsf(gz);
-    float total = agx + agy + agz;
-    if (total < 1.0f) { strcpy(out, "FLAT"); return; }
-    float rx = agx / total, ry = agy / total, rz = agz / total;
-    if (rx > 0.5f) {
-        strcpy(out, gx > 0 ? "TOPSPIN" : "BACKSPIN");
-    } else if (ry > 0.5f) {
-        strcpy(out, gy > 0 ? "SIDE_R" : "SIDE_L");
-    } else if (rz > 0.5f) {
-        strcpy(out, "SLICE");
+// ==================== Pipeline stages ====================
+
+// Impact detection with 100ms peak tracking (bsDetect). Returns true
+// when a shot has just been recorded as the last entry of shots.
+static IRAM_HOT bool detectImpact(float ax, float ay, float az, uint32_t nowMs) {
+    BsShot ls;
+    uint8_t r = bsDetect(ball, ax, ay, az, nowMs, ls);
+    if (r == BS_DETECT_IMPACT) logImpactPending = true;
+    if (r != BS_DETECT_SHOT) return false;
+    // Session aggregates count every shot, also once the pool is full
+    statsAddShot(ball.lastImpactMs, ls.peakRpm, ls.peakG, ls.gx, ls.gy, ls.gz);
+    // Record shot event
+    ShotEvent* slot = shots.append();
+    if (!slot) return false;
+    ShotEvent &s = *slot;
+    s.timestamp = ball.lastImpactMs;
+    s.peakRPM = ls.peakRpm;
+    s.peakG = ls.peakG;
+    s.gx = ls.gx; s.gy = ls.gy; s.gz = ls.gz;
+    memcpy(s.spinType, ls.spinType, sizeof(s.spinType));
+
+    ls.id = shots.count - 1;
+    logPushShot(ls);
+    return true;
+}
+
+static void sendShotEvent(int id) {
+    const ShotEvent &s = shots.at(id);
+    char shotJson[200];
+    int len = snprintf(shotJson, sizeof(shotJson),
+        "{\"event\":\"shot\",\"id\":%d,\"t\":%lu,\"rpm\":%.0f,\"peakG\":%.1f,"
+        "\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,\"type\":\"%s\"}",
+        id, s.timestamp, s.peakRPM, s.peakG,
+        s.gx, s.gy, s.gz, s.spinType);
+    if (len > 0 && (size_t)len > wsShotHighWater) wsShotHighWater = len;
+    uint32_t skip = liveSkipMask();
+    if (skip == 0) {
+        wsServer.broadcastTXT(shotJson);
+        energyRadioTx(len, clientCount);
+        return;
+    }
+    for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; num++) {
+        if (!((skip >> num) & 1) && wsServer.clientIsConnected(num)) wsServer.sendTXT(num, shotJson);
+    }
+    energyRadioTx(len, clientCount - __builtin_popcount(skip));
+}
+
+// 50Hz frame format. The values come from the stream filter, so "t",
+// "ts" (micros() of the read), the quaternion and "imp" are those of the
+// filter's centre (filterOutTag), FILTER_STREAM_TAPS' group delay
+// (57.5 ms) before the newest sample: every field describes the same
+// instant. "tx" is a fixed-width placeholder patched with the send time
+// after formatting, so tx - ts covers the filter delay and the encode cost.
+static const char FRAME_FMT[] DRAM_HOT =
+    "{\"t\":%lu,\"seq\":%lu,\"ts\":%lu,"
+    "\"ax\":%.3f,\"ay\":%.3f,\"az\":%.3f,"
+    "\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,"
+    "\"qw\":%.4f,\"qx\":%.4f,\"qy\":%.4f,\"qz\":%.4f,"
+    "\"rpm\":%.0f,\"spin\":\"%s\",\"imp\":%d,\"tx\":0000000000}";
+
+static IRAM_HOT int encodeFrame(char* json, size_t size) {
+    const float* o = filterOut(FILTER_STREAM);
+    const BsDecTag &tag = filterOutTag(FILTER_STREAM);
+    const float f[BS_DEC_CHANNELS] = {o[0] * IMU_G_PER_UNIT, o[1] * IMU_G_PER_UNIT, o[2] * IMU_G_PER_UNIT,
+                                      o[3] * IMU_DPS_PER_UNIT, o[4] * IMU_DPS_PER_UNIT, o[5] * IMU_DPS_PER_UNIT};
+    float rpm = filterRpm(FILTER_STREAM);
+    const char* spinLabel = bsSpinLabel(f[3], f[4], f[5], rpm);
+
+    int len = snprintf(json, size, FRAME_FMT,
+        (unsigned long)(tag.tUs / 1000), (unsigned long)frameSeq, (unsigned long)(uint32_t)tag.tUs,
+        f[0], f[1], f[2],
+        f[3], f[4], f[5],
+        tag.q[0], tag.q[1], tag.q[2], tag.q[3],
+        rpm, spinLabel, tag.flags & BS_FLAG_IMPACT ? 1 : 0);
+    return len;
+}
+
+// ==================== Session storage ====================
+
+// Drops all session records in O(1) and carves the pools again
+static void sessionReset() {
+    arenaReset(sessionArena);
+    bool psram = sessionArena.inPsram;
+    shots.carve(sessionArena, psram ? MAX_SHOTS_PSRAM : MAX_SHOTS_SRAM);
+    frames.carve(sessionArena, psram ? FRAME_WINDOW_PSRAM : FRAME_WINDOW_SRAM);
+    statsReset(millis());
+}
+
+static void sessionArenaStats(size_t* used, size_t* peak, size_t* capacity) {
+    *used = sessionArena.used;
+    *peak = sessionArena.peak;
+    *capacity = sessionArena.capacity;
+}
+
+static void recordFrame() {
+    const float* o = filterOut(FILTER_STREAM);
+    const BsDecTag &tag = filterOutTag(FILTER_STREAM);
+    float rpm = filterRpm(FILTER_STREAM);
+    statsAddFrame(rpm);
+    FrameRecord* f = frames.appendRing();
+    if (!f) return;
+    f->t = (uint32_t)(tag.tUs / 1000);
+    f->seq = frameSeq;
+    f->imp = tag.flags & BS_FLAG_IMPACT;
+    f->ax = imuUnit(o[0]); f->ay = imuUnit(o[1]); f->az = imuUnit(o[2]);
+    f->gx = imuUnit(o[3]); f->gy = imuUnit(o[4]); f->gz = imuUnit(o[5]);
+    f->q = {tag.q[0], tag.q[1], tag.q[2], tag.q[3]};
+    f->rpm = rpm;
+}
+
+static int16_t toFixed(float v, float scale) {
+    float x = v * scale;
+    if (x > 32767.0f) return 32767;
+    if (x < -32768.0f) return -32768;
+    return (int16_t)lroundf(x);
+}
+
+// Log fixed point per sample unit: raw count builds log the counts themselves
+static const float LOG_ACCEL_PER_UNIT = RAW_COUNTS ? 1.0f : LOG_ACCEL_PER_G;
+static const float LOG_GYRO_PER_UNIT  = RAW_COUNTS ? 1.0f : LOG_GYRO_PER_DPS;
+
+// micros() is the low word of esp_timer; extends a recent stamp to 64 bits
+static int64_t sampleTime(uint32_t sampleUs) {
+    int64_t now64 = esp_timer_get_time();
+    return now64 - (int32_t)((uint32_t)now64 - sampleUs);
+}
+
+// Time, quaternion and flags of a sample in the session log scales
+static void fillSample(BsSample &s, int64_t tUs, const Quat &q, bool impact) {
+    s.tUs = tUs;
+    s.q[0] = toFixed(q.w, LOG_QUAT_ONE);
+    s.q[1] = toFixed(q.x, LOG_QUAT_ONE);
+    s.q[2] = toFixed(q.y, LOG_QUAT_ONE);
+    s.q[3] = toFixed(q.z, LOG_QUAT_ONE);
+    s.flags = impact ? BS_FLAG_IMPACT : 0;
+}
+
+// Accel / gyro in sample units (raw or filtered) into the log's fixed point
+static void fillAxes(BsSample &s, float ax, float ay, float az, float gx, float gy, float gz) {
+    s.a[0] = toFixed(ax, LOG_ACCEL_PER_UNIT);
+    s.a[1] = toFixed(ay, LOG_ACCEL_PER_UNIT);
+    s.a[2] = toFixed(az, LOG_ACCEL_PER_UNIT);
+    s.g[0] = toFixed(gx, LOG_GYRO_PER_UNIT);
+    s.g[1] = toFixed(gy, LOG_GYRO_PER_UNIT);
+    s.g[2] = toFixed(gz, LOG_GYRO_PER_UNIT);
+}
+
+// 200Hz raw sample into the flash session log (ring copy only)
+static void logSample(const ImuSample &d, int64_t tUs, bool impact) {
+    BsSample s;
+    fillSample(s, tUs, ball.orient, impact);
+#if RAW_COUNTS
+    // Counts are the log's own fixed point (BS_HEADER_FULL_SCALE): copied as read
+    memcpy(s.a, d.a, sizeof(s.a));
+    memcpy(s.g, d.g, sizeof(s.g));
+#else
+    fillAxes(s, d.a[0], d.a[1], d.a[2], d.g[0], d.g[1], d.g[2]);
+#endif
+    logPushSample(s);
+}
+
+// 50Hz frame as a stream packet for the "bin" clients: the JSON frame's
+// values, time, quaternion and flag (FILTER_STREAM and its centre) in log
+// fixed point; rpm/spin are derived client-side
+static size_t encodeBinFrame(uint8_t* packet) {
+    const float* f = filterOut(FILTER_STREAM);
+    const BsDecTag &tag = filterOutTag(FILTER_STREAM);
+    BsSample s;
+    fillSample(s, tag.tUs, {tag.q[0], tag.q[1], tag.q[2], tag.q[3]}, tag.flags & BS_FLAG_IMPACT);
+    fillAxes(s, f[0], f[1], f[2], f[3], f[4], f[5]);
+    uint32_t c0 = ESP.getCycleCount();
+    size_t len = bsStreamEncode(wsStream, s, packet);
+    wsStreamCycles += ESP.getCycleCount() - c0;
+    wsStreamPackets++;
+    wsStreamBytes += len;
+    return len;
+}
+
+// Recent 50Hz window in log fixed point, for the /codec benchmark
+static size_t codecJson(char* buf, size_t size) {
+    uint32_t n = frames.count;
+    BsSample* s = n ? (BsSample*)heap_caps_malloc(n * sizeof(BsSample), MALLOC_CAP_8BIT) : nullptr;
+    if (!s) n = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const FrameRecord &f = frames.at(i);
+        fillSample(s[i], (int64_t)f.t * 1000, f.q, false);
+        fillAxes(s[i], f.ax, f.ay, f.az, f.gx, f.gy, f.gz);
+    }
+    CodecLiveStats live = {wsStreamPackets, wsStreamBytes, wsStreamCycles};
+    size_t len = codecBenchJson(s, n, live, buf, size);
+    heap_caps_free(s);
+    return len;
+}
+
+// ==================== Session replay ====================
+
+// Stored session as live frames (without the ts/tx latency stamps) and
+// shot events. The frames come from the stream filter (filterbank.h)
+// rerun over the stored 200Hz samples - the samples it was fed live - so
+// at every = 4 they match the live frames up to the fixed-point rounding
+// of the log; other every values get a branch with that factor. Time,
+// quaternion and "imp" are the filter centre's, as live.
+static const char REPLAY_FMT[] DRAM_HOT =
+    "{\"t\":%lu,\"seq\":%lu,"
+    "\"ax\":%.3f,\"ay\":%.3f,\"az\":%.3f,"
+    "\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,"
+    "\"qw\":%.4f,\"qx\":%.4f,\"qy\":%.4f,\"qz\":%.4f,"
+    "\"rpm\":%.0f,\"spin\":\"%s\",\"imp\":%d}";
+
+static void replaySend(const char* json, int len) {
+    if (len <= 0) return;
+    wsServer.sendTXT(replayClient, json);
+    replayBytes += len;
+    energyRadioTx(len, 1);
+}
+
+// End event with the sync throughput, then back to the live stream
+static void replayFinish(bool stopped) {
+    const ReplayStats &st = replayStats();
+    float sec = (st.endUs - st.startUs) * 1e-6f;
+    char json[320];
+    snprintf(json, sizeof(json),
+        "{\"event\":\"replay\",\"state\":\"end\",\"session\":%lu,\"stopped\":%s,"
+        "\"samples\":%lu,\"shots\":%lu,\"frames\":%lu,\"bytes\":%llu,\"bad_chunks\":%lu,"
+        "\"ms\":%.0f,\"samples_per_s\":%.0f}",
+        (unsigned long)st.session, stopped ? "true" : "false", (unsigned long)st.samples,
+        (unsigned long)st.shots, (unsigned long)replayFrames, (unsigned long long)replayBytes,
+        (unsigned long)st.badChunks, sec * 1e3f, sec > 0 ? st.samples / sec : 0.0f);
+    replayStop();
+    wsServer.sendTXT(replayClient, json);
+    replayClient = -1;
+}
+
+// "replay <session> [speed] [every]" (speed 0 = as fast as possible) or "replay stop"
+static void replayCommand(uint8_t num, const char* args) {
+    if (strcmp(args, "stop") == 0) {
+        if (replayClient == num) replayFinish(true);
+        return;
+    }
+    unsigned long session = 0;
+    float speed = 1.0f;
+    unsigned every = 4;
+    char json[160];
+    if (sscanf(args, "%lu %f %u", &session, &speed, &every) < 1) return;
+    const char* error = nullptr;
+    if (replayClient >= 0 && replayClient != num) {
+        error = "busy";
     } else {
-        strcpy(out, "MIXED");
+        if (replayClient == num) replayFinish(true);
+        if (!replayStart(session, speed, esp_timer_get_time())) error = "not on flash";
+    }
+    if (error) {
+        snprintf(json, sizeof(json), "{\"event\":\"replay\",\"state\":\"error\",\"session\":%lu,\"error\":\"%s\"}",
+                 session, error);
+        wsServer.sendTXT(num, json);
+        return;
+    }
+    replayClient = num;
+    replayEvery = every < 1 ? 1 : every > 50 ? 50 : every;
+    replayFrames = 0;
+    replayBytes = 0;
+    bsDecInit(replayDec);
+    uint16_t taps = replayEvery * FILTER_STREAM_TAPS / FILTER_STREAM_FACTOR;
+    bsDecAddBranch(replayDec, replayEvery, taps < BS_DEC_MAX_TAPS ? taps : BS_DEC_MAX_TAPS);
+    snprintf(json, sizeof(json),
+             "{\"event\":\"replay\",\"state\":\"start\",\"session\":%lu,\"speed\":%.1f,\"every\":%u,\"hz\":%u}",
+             session, speed > 0 ? speed : 0.0f, replayEvery, replayHeader().sampleHz);
+    wsServer.sendTXT(num, json);
+}
+
+// Sends what is due (everything left, within the loop budget, at speed 0)
+static void replayPump() {
+    const BsFileHeader &h = replayHeader();
+    float perG = 1.0f / bsAccelPerG(h), perDps = 1.0f / bsGyroPerDps(h), perQ = 1.0f / h.quatOne;
+    int64_t t0 = esp_timer_get_time(), now = t0;
+    while (replayClient >= 0 && now - t0 < REPLAY_BUDGET_US) {
+        BsSample s;
+        BsShot shot;
+        uint8_t item = replayNext(now, s, shot);
+        if (item == REPLAY_IDLE) break;
+        if (item == REPLAY_DONE) {
+            replayFinish(false);
+            break;
+        }
+        if (item == REPLAY_SHOT) {
+            char json[200];
+            replaySend(json, snprintf(json, sizeof(json),
+                "{\"event\":\"shot\",\"id\":%lu,\"t\":%lu,\"rpm\":%.0f,\"peakG\":%.1f,"
+                "\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,\"type\":\"%.12s\"}",
+                (unsigned long)shot.id, (unsigned long)(shot.tUs / 1000), shot.peakRpm, shot.peakG,
+                shot.gx, shot.gy, shot.gz, shot.spinType));
+        } else {
+            const float in[BS_DEC_CHANNELS] = {s.a[0] * perG, s.a[1] * perG, s.a[2] * perG,
+                                               s.g[0] * perDps, s.g[1] * perDps, s.g[2] * perDps};
+            const BsDecTag tag = {s.tUs, {s.q[0] * perQ, s.q[1] * perQ, s.q[2] * perQ, s.q[3] * perQ}, s.flags};
+
+            if (bsDecPush(replayDec, in, &tag)) {
+                const BsDecTag &c = replayDec.b[0].outTag;
+                const float* f = replayDec.b[0].out;
+                float rpm = bsDecRpm(replayDec, 0);
+                const char* spinLabel = bsSpinLabel(f[3], f[4], f[5], rpm);
+                char json[WS_FRAME_BUF];
+                replaySend(json, snprintf(json, sizeof(json), REPLAY_FMT,
+                    (unsigned long)(c.tUs / 1000), (unsigned long)replayFrames,
+                    f[0], f[1], f[2], f[3], f[4], f[5],
+                    c.q[0], c.q[1], c.q[2], c.q[3],
+                    rpm, spinLabel, c.flags & BS_FLAG_IMPACT ? 1 : 0));
+                replayFrames++;
+            }
+        }
+        now = esp_timer_get_time();
+    }
+}
+
+// ==================== Resume ====================
+
+// "resume <seq>": a client that lost its connection asks for the frames
+// from <seq> on. They come from the 50Hz frame window (the last 10 s)
+// in the replay frame format, with the session's shots in time order
+// between them; the client gets no live frames or shots until it has
+// caught up, so what it receives stays in order. The end event carries
+// the seq of the next live frame (the base for "bin" packets, which
+// have only an 8-bit stream seq of their own).
+static void resumeCommand(uint8_t num, const char* args) {
+    unsigned long seq = 0;
+    if (sscanf(args, "%lu", &seq) != 1 || num >= WEBSOCKETS_SERVER_CLIENT_MAX || (int8_t)num == replayClient) return;
+    uint32_t oldest = frames.count ? frames.at(0).seq : frameSeq;
+    uint32_t from = seq;
+    uint32_t missed = 0;
+    if ((int32_t)(from - frameSeq) > 0) from = oldest;     // device restarted: seq began again
+    if ((int32_t)(oldest - from) > 0) {
+        missed = oldest - from;
+        from = oldest;
+    }
+    uint32_t fromMs = frames.count && from != frameSeq ? frames.at(from - oldest).t : millis();
+    uint32_t shot = 0;
+    while (shot < shots.count && shots.at(shot).timestamp < fromMs) shot++;
+    resumeSeq[num] = from;
+    resumeShot[num] = shot;
+    resumeFrames[num] = 0;
+    resumeMissed[num] = missed;
+    resumeClients |= 1u << num;
+    char json[128];
+    snprintf(json, sizeof(json), "{\"event\":\"resume\",\"state\":\"start\",\"from\":%lu,\"missed\":%lu}",
+             (unsigned long)from, (unsigned long)missed);
+    wsServer.sendTXT(num, json);
+}
+
+static void resumeSendShot(uint8_t num, uint32_t id) {
+    const ShotEvent &s = shots.at(id);
+    char json[200];
+    int len = snprintf(json, sizeof(json),
+        "{\"event\":\"shot\",\"id\":%lu,\"t\":%lu,\"rpm\":%.0f,\"peakG\":%.1f,"
+        "\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,\"type\":\"%s\"}",
+        (unsigned long)id, (unsigned long)s.timestamp, s.peakRPM, s.peakG, s.gx, s.gy, s.gz, s.spinType);
+    wsServer.sendTXT(num, json);
+    energyRadioTx(len, 1);
+}
+
+// Resends what each resuming client still lacks, within the loop budget;
+// a client that reaches the live frame goes back to the live stream
+static void resumePump() {
+    int64_t t0 = esp_timer_get_time();
+    for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX && resumeClients; num++) {
+        if (!((resumeClients >> num) & 1)) continue;
+        uint32_t oldest = frames.count ? frames.at(0).seq : frameSeq;
+        while (esp_timer_get_time() - t0 < REPLAY_BUDGET_US) {
+            if ((int32_t)(oldest - resumeSeq[num]) > 0) {        // overtaken by the ring meanwhile
+                resumeMissed[num] += oldest - resumeSeq[num];
+                resumeSeq[num] = oldest;
+            }
+            if (resumeSeq[num] == frameSeq || !frames.count) break;
+            const FrameRecord &f = frames.at(resumeSeq[num] - oldest);
+            while (resumeShot[num] < shots.count && shots.at(resumeShot[num]).timestamp <= f.t) {
+                resumeSendShot(num, resumeShot[num]++);
+            }
+            float gx = f.gx * IMU_DPS_PER_UNIT, gy = f.gy * IMU_DPS_PER_UNIT, gz = f.gz * IMU_DPS_PER_UNIT;
+            char json[WS_FRAME_BUF];
+            int len = snprintf(json, sizeof(json), REPLAY_FMT,
+                (unsigned long)f.t, (unsigned long)f.seq,
+                f.ax * IMU_G_PER_UNIT, f.ay * IMU_G_PER_UNIT, f.az * IMU_G_PER_UNIT, gx, gy, gz,
+                f.q.w, f.q.x, f.q.y, f.q.z, f.rpm, bsSpinLabel(gx, gy, gz, f.rpm), f.imp ? 1 : 0);
+            wsServer.sendTXT(num, json);
+            energyRadioTx(len, 1);
+            resumeSeq[num]++;
+            resumeFrames[num]++;
+        }
+        if (resumeSeq[num] != frameSeq && frames.count) continue;
+        while (resumeShot[num] < shots.count) resumeSendShot(num, resumeShot[num]++);
+        char json[160];
+        snprintf(json, sizeof(json),
+                 "{\"event\":\"resume\",\"state\":\"end\",\"seq\":%lu,\"frames\":%lu,\"missed\":%lu}",
+                 (unsigned long)frameSeq, (unsigned long)resumeFrames[num], (unsigned long)resumeMissed[num]);
+        wsServer.sendTXT(num, json);
+        resumeClients &= ~(1u << num);
+        if ((binClients >> num) & 1) bsStreamKey(wsStream);
     }
 }
 
@@ -161,17 +579,80 @@ void onWsEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
     switch (type) {
         case WStype_CONNECTED:
             clientCount++;
+            binClients &= ~(1u << num);
+            resumeClients &= ~(1u << num);
+            latencyResetClient(num);
+            {
+                // Which ball this is, for observers taking several over one network
+                char hello[96];
+                snprintf(hello, sizeof(hello), "{\"event\":\"hello\",\"id\":\"%s\",\"mode\":\"%s\",\"seq\":%lu}",
+                         wifiLinkId(), wifiLinkMode() == WIFI_LINK_STA ? "sta" : "ap", (unsigned long)frameSeq);
+                wsServer.sendTXT(num, hello);
+            }
             break;
         case WStype_DISCONNECTED:
             if (clientCount > 0) clientCount--;
+            binClients &= ~(1u << num);
+            resumeClients &= ~(1u << num);
+            latencyResetClient(num);
+            if (replayClient == num) {
+                replayStop();
+                replayClient = -1;
+            }
             break;
         case WStype_TEXT:
             // Handle commands from web page
             if (strcmp((char*)payload, "reset") == 0) {
-                orient = {1, 0, 0, 0};
+                ball.orient = {1, 0, 0, 0};
             }
             if (strcmp((char*)payload, "clear_shots") == 0) {
-                shotCount = 0;
+                energyLogSession("clear_shots");
+                sessionReset();
+                logNewSession(millis());
+            }
+            // Clock-offset probe: echo the client stamp with our micros()
+            if (strncmp((char*)payload, "ping ", 5) == 0) {
+                char pong[80];
+                double clientUs = strtod((char*)payload + 5, nullptr);
+                snprintf(pong, sizeof(pong), "{\"event\":\"pong\",\"c\":%.0f,\"d\":%lu}",
+                         clientUs, (unsigned long)micros());
+                wsServer.sendTXT(num, pong);
+                energyRadioTx(strlen(pong), 1);
+            }
+            // Session aggregates (sessionstats.h) for this client
+            if (strcmp((char*)payload, "stats") == 0) {
+                size_t len = statsToJson(httpJson, sizeof(httpJson), millis(), true);
+                wsServer.sendTXT(num, httpJson, len);
+                energyRadioTx(len, 1);
+            }
+            if (strncmp((char*)payload, "lat ", 4) == 0) {
+                latencyHandleReport(num, (char*)payload);
+            }
+            // Frame format: "bin" = stream packets (bsstream.h), "json" = text (default)
+            if (strcmp((char*)payload, "bin") == 0) {
+                binClients |= 1u << num;
+                bsStreamKey(wsStream);  // new decoder needs a keyframe
+                // Packets carry an 8-bit seq; this is the frame seq of the next one.
+                // Raw count builds send counts: the client scales them by the full scale
+                char json[80];
+                if (RAW_COUNTS) {
+                    snprintf(json, sizeof(json), "{\"event\":\"bin\",\"seq\":%lu,\"accel_fs\":%u,\"gyro_fs\":%u}",
+                             (unsigned long)frameSeq, IMU_ACCEL_FS_G, IMU_GYRO_FS_DPS);
+                } else {
+                    snprintf(json, sizeof(json), "{\"event\":\"bin\",\"seq\":%lu}", (unsigned long)frameSeq);
+                }
+                wsServer.sendTXT(num, json);
+            }
+            if (strcmp((char*)payload, "json") == 0) {
+                binClients &= ~(1u << num);
+            }
+            // Missed frames after a reconnect (see resumeCommand)
+            if (strncmp((char*)payload, "resume ", 7) == 0) {
+                resumeCommand(num, (char*)payload + 7);
+            }
+            // Stored session back over this connection (JSON frames, see replayCommand)
+            if (strncmp((char*)payload, "replay ", 7) == 0) {
+                replayCommand(num, (char*)payload + 7);
             }
             break;
         default:
@@ -193,23 +674,112 @@ void setup() {
         M5.Display.println("IMU FAIL!");
         while (1) { delay(1000); }
     }
+    // Raw count builds: the assumed full scale must match the sensor setup
+    imuCheckScale();
 
     // Double-buffered canvas for flicker-free screen updates
     canvas.createSprite(W, H);
     canvas.setSwapBytes(true);
 
-    // Start WiFi Access Point
-    WiFi.mode(WIFI_AP);
-    WiFi.softAP(AP_SSID, AP_PASS);
-    // Default AP IP is 192.168.4.1
+    // Start WiFi: own Access Point (192.168.4.1) or the configured network
+    wifiLinkStart();
+    radioOn = true;
 
     // HTTP server - serve the web dashboard
     httpServer.on("/", HTTP_GET, []() {
         httpServer.send_P(200, "text/html", index_html);
     });
+#ifdef PROFILE_STAGES
+    // Per-stage cycle statistics; ?reset=1 starts a new measurement window
+    httpServer.on("/profile", HTTP_GET, []() {
+        profToJson(httpJson, sizeof(httpJson));
+        if (httpServer.hasArg("reset")) profReset();
+        httpServer.send(200, "application/json", httpJson);
+    });
+#endif
+    // Sensor-to-glass latency histograms per client
+    httpServer.on("/latency", HTTP_GET, []() {
+        latencyToJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Memory budget: heap, module regions, buffer high-water, task stacks
+    httpServer.on("/mem", HTTP_GET, []() {
+        memReportToJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Energy breakdown for the current session; query args override the current table
+    httpServer.on("/energy", HTTP_GET, []() {
+        for (int i = 0; i < httpServer.args(); i++) {
+            energySetField(httpServer.argName(i).c_str(), httpServer.arg(i).toFloat());
+        }
+        energyToJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Running session aggregates: per spin type, spin-axis histogram, shot rate
+    httpServer.on("/stats", HTTP_GET, []() {
+        statsToJson(httpJson, sizeof(httpJson), millis(), false);
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Flash session log: throughput, compression, worst-case sampler stall
+    httpServer.on("/log", HTTP_GET, []() {
+        logToJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Sessions stored on flash, newest first (ids for "replay"); served from the log writer's session
+    // table ("scanning" until the mount scan finishes), no flash reads
+    httpServer.on("/sessions", HTTP_GET, []() {
+        logSessionsJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Whole stored session from flash, chunked: ?session=N[&format=csv] (.ybs by default);
+    // answered by the export task, so the loop keeps sampling. Without session: last export's rate
+    httpServer.on("/export", HTTP_GET, []() {
+        if (!httpServer.hasArg("session")) {
+            exportToJson(httpJson, sizeof(httpJson));
+            httpServer.send(200, "application/json", httpJson);
+            return;
+        }
+        uint8_t format = httpServer.arg("format") == "csv" ? EXPORT_CSV : EXPORT_YBS;
+        int status = exportStart(httpServer.client(), httpServer.arg("session").toInt(), format);
+        if (status) {
+            httpServer.send(status, "text/plain", status == 404 ? "no such session\n" : "export busy\n");
+        }
+    });
+    // Arena vs heap_caps_malloc allocation cost (stalls the loop for a few ms)
+    httpServer.on("/arena_bench", HTTP_GET, []() {
+        arenaBenchmarkJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Sample tick and decimation filters: branch rates, delays, cycles per input
+    httpServer.on("/filters", HTTP_GET, []() {
+        filterToJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Codec ratio and cycles/sample on the recent frame window (stalls the loop briefly)
+    httpServer.on("/codec", HTTP_GET, []() {
+        codecJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
+    // Network mode: status; ?ssid=..&pass=.. joins that network from the next
+    // start (restarts now), ?ssid= (empty) goes back to the ball's own AP
+    httpServer.on("/wifi", HTTP_GET, []() {
+        if (httpServer.hasArg("ssid")) {
+            if (!wifiLinkConfigure(httpServer.arg("ssid").c_str(), httpServer.arg("pass").c_str())) {
+                httpServer.send(400, "text/plain", "ssid / pass too long or NVS error\n");
+                return;
+            }
+            httpServer.send(200, "application/json", "{\"restart\":true}");
+            logFlush(500);
+            delay(200);
+            ESP.restart();
+        }
+        wifiLinkToJson(httpJson, sizeof(httpJson));
+        httpServer.send(200, "application/json", httpJson);
+    });
     httpServer.begin();
 
     // WebSocket server for real-time IMU streaming
+    bsStreamInit(wsStream, BS_COLS_ALL, 2, WS_KEY_INTERVAL);
     wsServer.begin();
     wsServer.onEvent(onWsEvent);
 
@@ -224,6 +794,32 @@ void setup() {
         };
     }
 
+    bsPipelineInit(ball);
+    filterInit();
+
+    // Session arena (PSRAM when present) for shot and frame records
+    arenaInit(sessionArena, "session", SESSION_ARENA_PSRAM, SESSION_ARENA_SRAM);
+    sessionReset();
+
+    // Flash session log ("sessions" partition), one log session per boot
+    if (logBegin()) logNewSession(millis());
+
+    // Memory budget: what each module holds, printed once at boot
+    memRegisterArena("session", sessionArenaStats);
+    memRegisterRegion("main", "seamPts", sizeof(seamPts));
+    memRegisterRegion("main", "httpJson", sizeof(httpJson));
+    memRegisterRegion("display", "canvas (heap)", (size_t)W * H * sizeof(uint16_t));
+    memRegisterRegion("websocket", "clients", sizeof(WSclient_t) * WEBSOCKETS_SERVER_CLIENT_MAX);
+    memRegisterRegion("latency", "histograms", latencyMemBytes());
+    memRegisterRegion("sessionstats", "aggregates", statsMemBytes());
+    memRegisterRegion("filterbank", "decimation bank", filterMemBytes());
+    memRegisterRegion("main", "replay filter", sizeof(replayDec));
+    memRegisterRegion("profile", "stage stats", profMemBytes());
+    memRegisterRegion("sessionlog", "sample ring", logMemBytes());
+    memRegisterBuffer("ws_frame", &wsFrameHighWater, WS_FRAME_BUF);
+    memRegisterBuffer("ws_shot", &wsShotHighWater, 200);
+    memReportPrint();
+
     lastUs = micros();
 }
 
@@ -245,10 +841,13 @@ void enterLightSleep() {
     // Turn off display backlight
     M5.Display.setBrightness(0);
 
+    // Get queued log samples onto flash before the CPU halts
+    logFlush(500);
+
     // Stop WiFi (frees ~80mA)
     wsServer.close();
-    WiFi.softAPdisconnect(true);
-    WiFi.mode(WIFI_OFF);
+    wifiLinkStop();
+    radioOn = false;
 
     // Configure GPIO wakeup on BtnA (GPIO 41 on ATOM S3)
     // BtnA is active LOW (pressed = LOW)
@@ -256,7 +855,9 @@ void enterLightSleep() {
     gpio_wakeup_enable(GPIO_NUM_41, GPIO_INTR_LOW_LEVEL);
 
     // Enter Light Sleep - CPU halts here, RAM preserved
+    uint32_t sleepStartUs = micros();
     esp_light_sleep_start();
+    energyAddSleep(micros() - sleepStartUs);  // esp_timer keeps counting in light sleep
 
     // === Execution resumes here after wake ===
 }
@@ -382,8 +983,8 @@ void wakeFromSleep() {
 
     // Play sunrise animation while WiFi restarts in background
     // Start WiFi first (it takes ~500ms to come up, overlaps with animation)
-    WiFi.mode(WIFI_AP);
-    WiFi.softAP(AP_SSID, AP_PASS);
+    wifiLinkStart();
+    radioOn = true;
 
     // Play the sunrise animation (~1.2s)
     playSunriseAnimation();
@@ -398,13 +999,14 @@ void wakeFromSleep() {
 
     // Reset timing to avoid huge dt jump
     lastUs = micros();
-    lastWsSendMs = millis();
+    filterTickRestart();
 
     // Full brightness
     M5.Display.setBrightness(80);
 
     // Reset client count since all were disconnected
     clientCount = 0;
+    binClients = 0;
 }
 
 // ==================== Main loop ====================
@@ -412,6 +1014,7 @@ void wakeFromSleep() {
 void loop() {
     M5.update();
     httpServer.handleClient();
+    wifiLinkPoll(millis());
     wsServer.loop();
 
     // --- Button handling: short press = reset quaternion, long press 3s = Light Sleep ---
@@ -453,157 +1056,119 @@ void loop() {
 
             if (held < 1000) {
                 // Short press: reset quaternion (existing behavior)
-                orient = {1, 0, 0, 0};
+                ball.orient = {1, 0, 0, 0};
             }
             // If held 1-3s, just cancel - do nothing
         }
     }
 
-    // Read IMU data
-    // Note: M5Unified@0.1.17 getImuData() returns void, not bool
+    // Read IMU data (sample units: counts or g / deg/s, see imusample.h)
+    PROF_BEGIN(PROF_IMU_READ);
     M5.Imu.update();
-    m5::imu_data_t d;
-    M5.Imu.getImuData(&d);
+    ImuSample d;
+    imuRead(d);
+    uint32_t sampleUs = micros();  // sensor read time, streamed as "ts"
+    PROF_END(PROF_IMU_READ);
 
     // Delta time calculation
-    uint32_t nowUs = micros();
+    uint32_t nowUs = sampleUs;
     float dt = (nowUs - lastUs) * 1e-6f;
     if (dt > 0.1f) dt = 0.033f;  // clamp on overflow / first frame
     lastUs = nowUs;
 
-    // Gyro in rad/s for quaternion integration
-    float gxRaw = d.gyro.x * (M_PI / 180.0f);
-    float gyRaw = d.gyro.y * (M_PI / 180.0f);
-    float gzRaw = d.gyro.z * (M_PI / 180.0f);
-
-    // Adaptive gyro bias estimation: when angular velocity is low
-    // (ball likely stationary), learn the zero-rate offset.
-    float rawMag = sqrtf(gxRaw * gxRaw + gyRaw * gyRaw + gzRaw * gzRaw);
-    if (rawMag < 0.2f) {  // < ~11.5 deg/s → likely stationary
-        const float biasAlpha = 0.01f;  // faster adaptation to track temp drift
-        gyroBiasX += biasAlpha * (gxRaw - gyroBiasX);
-        gyroBiasY += biasAlpha * (gyRaw - gyroBiasY);
-        gyroBiasZ += biasAlpha * (gzRaw - gyroBiasZ);
-    }
-
-    // Subtract estimated bias
-    float gx = gxRaw - gyroBiasX;
-    float gy = gyRaw - gyroBiasY;
-    float gz = gzRaw - gyroBiasZ;
-
-    // Filtered gyro (deg/s) for display and streaming
-    filtGx += 0.15f * (d.gyro.x - filtGx);
-    filtGy += 0.15f * (d.gyro.y - filtGy);
-    filtGz += 0.15f * (d.gyro.z - filtGz);
-
-    // RPM (heavily smoothed)
-    float rawRPM = sqrtf(d.gyro.x * d.gyro.x +
-                         d.gyro.y * d.gyro.y +
-                         d.gyro.z * d.gyro.z) / 6.0f;
-    filtRPM += 0.08f * (rawRPM - filtRPM);
+    // The fusion kernel works in deg/s and g: the only per-sample conversion
+    PROF_BEGIN(PROF_FUSION);
+    bsFuse(ball, d.g[0] * IMU_DPS_PER_UNIT, d.g[1] * IMU_DPS_PER_UNIT, d.g[2] * IMU_DPS_PER_UNIT, dt);
+    PROF_END(PROF_FUSION);
 
     uint32_t nowMs = millis();
-
-    // --- Impact detection ---
-    float accelMag = sqrtf(d.accel.x * d.accel.x + d.accel.y * d.accel.y + d.accel.z * d.accel.z);
-
-    if (accelMag > IMPACT_THRESH && (nowMs - lastImpactMs) > IMPACT_COOLDOWN_MS) {
-        lastImpactMs = nowMs;
-        impactFlag = true;
-        trackingPeak = true;
-        peakTrackStartMs = nowMs;
-        peakRPMval = filtRPM;
-        peakGval = accelMag;
-        peakGx = filtGx; peakGy = filtGy; peakGz = filtGz;
+    energyTick(nowUs, getCpuFrequencyMhz(), radioOn, M5.Display.getBrightness());
+
+    PROF_BEGIN(PROF_DETECT);
+    bool shotDone = detectImpact(d.a[0] * IMU_G_PER_UNIT, d.a[1] * IMU_G_PER_UNIT, d.a[2] * IMU_G_PER_UNIT, nowMs);
+    PROF_END(PROF_DETECT);
+    if (shotDone) sendShotEvent(shots.count - 1);
+
+    // --- 200Hz sample tick: flash log, and the decimation bank for the slower rates ---
+    uint32_t filtered = 0;
+    if (filterTickDue(nowUs)) {
+        PROF_BEGIN(PROF_TICK);
+        // Latched: an impact seen between ticks flags the next logged sample
+        // and, once the filters' centre reaches it, the frames
+        const BsDecTag tag = {sampleTime(sampleUs), {ball.orient.w, ball.orient.x, ball.orient.y, ball.orient.z},
+                              (uint16_t)(logImpactPending ? BS_FLAG_IMPACT : 0)};
+        logSample(d, tag.tUs, logImpactPending);
+        logImpactPending = false;
+        filtered = filterPush(d.a[0], d.a[1], d.a[2], d.g[0], d.g[1], d.g[2], tag);
+        PROF_END(PROF_TICK);
     }
 
-    // Track peak values for 100ms after impact
-    if (trackingPeak) {
-        if (filtRPM > peakRPMval) peakRPMval = filtRPM;
-        if (accelMag > peakGval) peakGval = accelMag;
-        if (fabsf(filtGx) + fabsf(filtGy) + fabsf(filtGz) > fabsf(peakGx) + fabsf(peakGy) + fabsf(peakGz)) {
-            peakGx = filtGx; peakGy = filtGy; peakGz = filtGz;
+    // --- 50Hz frame (every 4th tick): record into the session window, send via WebSocket ---
+    bool frameDue = (filtered >> FILTER_STREAM) & 1;
+    if (frameDue) recordFrame();
+    if (frameDue && clientCount > 0) {
+        uint32_t skip = liveSkipMask();
+        uint32_t binLive = binClients & ~skip;
+        uint8_t binCount = __builtin_popcount(binLive);
+        uint8_t jsonCount = clientCount - __builtin_popcount(binClients | skip);
+        if (binCount > 0) {
+            PROF_BEGIN(PROF_ENCODE);
+            uint8_t packet[BS_STREAM_MAX];
+            size_t len = encodeBinFrame(packet);
+            PROF_END(PROF_ENCODE);
+            PROF_BEGIN(PROF_SEND);
+            for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; num++) {
+                if ((binLive >> num) & 1) wsServer.sendBIN(num, packet, len);
+            }
+            PROF_END(PROF_SEND);
+            energyRadioTx(len, binCount);
         }
+        if (jsonCount > 0) {
+            PROF_BEGIN(PROF_ENCODE);
+            char json[WS_FRAME_BUF];
+            int len = encodeFrame(json, sizeof(json));
+            PROF_END(PROF_ENCODE);
+            if (len > 0 && (size_t)len > wsFrameHighWater) wsFrameHighWater = len;
+
+            if (len > 12 && len < (int)sizeof(json)) {
+                uint32_t txUs = micros();
+                char txField[11];
+                snprintf(txField, sizeof(txField), "%10lu", (unsigned long)txUs);
+                memcpy(json + len - 11, txField, 10);
+                latencyRecordEncode(txUs - (uint32_t)filterOutTag(FILTER_STREAM).tUs);
+            }
 
-        if (nowMs - peakTrackStartMs > 100) {
-            trackingPeak = false;
-            // Record shot event
-            if (shotCount < MAX_SHOTS) {
-                ShotEvent &s = shots[shotCount];
-                s.timestamp = lastImpactMs;
-                s.peakRPM = peakRPMval;
-                s.peakG = peakGval;
-                s.gx = peakGx; s.gy = peakGy; s.gz = peakGz;
-                classifySpin(peakGx, peakGy, peakGz, peakRPMval, s.spinType);
-
-                // Send shot event via WebSocket
-                char shotJson[200];
-                snprintf(shotJson, sizeof(shotJson),
-                    "{\"event\":\"shot\",\"id\":%d,\"t\":%lu,\"rpm\":%.0f,\"peakG\":%.1f,"
-                    "\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,\"type\":\"%s\"}",
-                    shotCount, s.timestamp, s.peakRPM, s.peakG,
-                    s.gx, s.gy, s.gz, s.spinType);
-                wsServer.broadcastTXT(shotJson);
-                shotCount++;
+            PROF_BEGIN(PROF_SEND);
+            if (binClients == 0 && skip == 0) {
+                wsServer.broadcastTXT(json);
+            } else {
+                for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; num++) {
+                    if (!(((binClients | skip) >> num) & 1) && wsServer.clientIsConnected(num)) {
+                        wsServer.sendTXT(num, json);
+                    }
+                }
             }
+            PROF_END(PROF_SEND);
+            energyRadioTx(len, jsonCount);
         }
     }
+    if (frameDue) frameSeq++;
 
-    // Integrate quaternion from angular velocity
-    // Dead zone 0.1 rad/s (~5.7 deg/s) to reject residual gyro drift after bias removal
-    float wmag = sqrtf(gx * gx + gy * gy + gz * gz);
-    if (wmag > 0.10f) {
-        float angle = wmag * dt;
-        float ha    = angle * 0.5f;
-        float sha   = sinf(ha);
-        float invW  = 1.0f / wmag;
-        Quat dq = {
-            cosf(ha),
-            gx * invW * sha,
-            gy * invW * sha,
-            gz * invW * sha
-        };
-        orient = qmul(orient, dq);
-        qnorm(orient);
-    } else {
-        // Below dead zone (ball is static): slowly decay quaternion toward
-        // identity to auto-correct any accumulated drift over time.
-        // Slerp toward {1,0,0,0} with a small factor each frame.
-        const float decay = 0.005f;  // ~0.5% per frame toward identity
-        orient.w += decay * (1.0f - orient.w);
-        orient.x += decay * (0.0f - orient.x);
-        orient.y += decay * (0.0f - orient.y);
-        orient.z += decay * (0.0f - orient.z);
-        qnorm(orient);
-    }
-
-    // --- Send WebSocket data at 50Hz (every 20ms) ---
-    if (nowMs - lastWsSendMs >= 20 && clientCount > 0) {
-        lastWsSendMs = nowMs;
-
-        char spinLabel[12];
-        classifySpin(filtGx, filtGy, filtGz, filtRPM, spinLabel);
+    // --- Stored session replay (after the live frame, so it never delays one) ---
+    if (replayClient >= 0) replayPump();
+    if (resumeClients) resumePump();
 
-        char json[320];
-        snprintf(json, sizeof(json),
-            "{\"t\":%lu,\"ax\":%.3f,\"ay\":%.3f,\"az\":%.3f,"
-            "\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,"
-            "\"qw\":%.4f,\"qx\":%.4f,\"qy\":%.4f,\"qz\":%.4f,"
-            "\"rpm\":%.0f,\"spin\":\"%s\",\"imp\":%d}",
-            nowMs, d.accel.x, d.accel.y, d.accel.z,
-            filtGx, filtGy, filtGz,
-            orient.w, orient.x, orient.y, orient.z,
-            filtRPM, spinLabel, impactFlag ? 1 : 0);
-
-        if (impactFlag) impactFlag = false;  // clear after sending
-
-        wsServer.broadcastTXT(json);
+#ifdef PROFILE_STAGES
+    static uint32_t lastProfMs = 0;
+    if (nowMs - lastProfMs >= 5000) {
+        lastProfMs = nowMs;
+        profPrint();
     }
+#endif
 
-    // --- Update ATOM S3 screen (~30fps for smooth ball rotation) ---
-    static uint32_t lastScreenMs = 0;
-    if (nowMs - lastScreenMs >= 33) {
-        lastScreenMs = nowMs;
+    // --- Update ATOM S3 screen (every 6th tick, 33.3fps for smooth ball rotation) ---
+    if ((filtered >> FILTER_DISPLAY) & 1) {
+        PROF_BEGIN(PROF_DISPLAY);
 
         canvas.fillSprite(TFT_BLACK);
         char buf[32];
@@ -619,8 +1184,8 @@ void loop() {
         // Seam
         for (int i = 0; i < SEAM_N; i++) {
             int j = (i + 1) % SEAM_N;
-            Vec3 p1 = qrot(orient, seamPts[i]);
-            Vec3 p2 = qrot(orient, seamPts[j]);
+            Vec3 p1 = qrot(ball.orient, seamPts[i]);
+            Vec3 p2 = qrot(ball.orient, seamPts[j]);
             int16_t sx1 = CX + (int16_t)(p1.x * BALL_R);
             int16_t sy1 = BALL_CY - (int16_t)(p1.y * BALL_R);
             int16_t sx2 = CX + (int16_t)(p2.x * BALL_R);
@@ -638,10 +1203,11 @@ void loop() {
         canvas.setFont(&fonts::FreeSansBold9pt7b);
         canvas.setTextDatum(top_center);
         canvas.setTextColor(TFT_WHITE);
-        if (filtRPM < 1.0f) {
+        float rpm = filterRpm(FILTER_DISPLAY);
+        if (rpm < 1.0f) {
             canvas.drawString("READY", CX, 0);
         } else {
-            snprintf(buf, sizeof(buf), "%d RPM", (int)filtRPM);
+            snprintf(buf, sizeof(buf), "%d RPM", (int)rpm);
             canvas.drawString(buf, CX, 0);
         }
 
@@ -657,18 +1223,25 @@ void loop() {
         canvas.drawString(buf, 10, 87);
 
         // Shot count
-        if (shotCount > 0) {
+        if (shots.count > 0) {
             canvas.setTextColor(0xFD20);  // orange
-            snprintf(buf, sizeof(buf), "%d shots", shotCount);
+            snprintf(buf, sizeof(buf), "%d shots", (int)shots.count);
             canvas.drawString(buf, 70, 87);
         }
 
+        // AP: network and password to join; station: the ball's id on the shared network
         canvas.setTextColor(0x8410);  // dim gray
-        canvas.drawString(AP_SSID, 4, 100);
-        snprintf(buf, sizeof(buf), "pw: %s", AP_PASS);
-        canvas.drawString(buf, 4, 110);
+        if (wifiLinkMode() == WIFI_LINK_STA) {
+            canvas.drawString(wifiLinkId(), 4, 100);
+            canvas.drawString(wifiLinkSsid(), 4, 110);
+        } else {
+            canvas.drawString(AP_SSID, 4, 100);
+            snprintf(buf, sizeof(buf), "pw: %s", AP_PASS);
+            canvas.drawString(buf, 4, 110);
+        }
         canvas.setTextColor(TFT_CYAN);
-        canvas.drawString(WiFi.softAPIP().toString().c_str(), 4, 120);
+        wifiLinkIp(buf, sizeof(buf));
+        canvas.drawString(buf, 4, 120);
 
         // Sea-level rise sleep countdown overlay
         if (sleepPending && btnWasDown) {
@@ -722,5 +1295,6 @@ void loop() {
         }
 
         canvas.pushSprite(0, 0);
+        PROF_END(PROF_DISPLAY);
     }
 }
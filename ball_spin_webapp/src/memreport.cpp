@@ -0,0 +1,154 @@
+/**
+ * Memory budget report - see memreport.h
+ */
+
+#include "memreport.h"
+#include "jsonout.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const int MEM_MAX_REGIONS = 24;
+static const int MEM_MAX_BUFFERS = 8;
+static const int MEM_MAX_ARENAS  = 8;
+
+struct MemRegion { const char* module; const char* name; size_t bytes; };
+struct MemBuffer { const char* name; const size_t* highWater; size_t capacity; };
+struct MemArena  { const char* name; MemArenaStatFn fn; };
+
+static MemRegion regions[MEM_MAX_REGIONS];
+static MemBuffer buffers[MEM_MAX_BUFFERS];
+static MemArena  arenas[MEM_MAX_ARENAS];
+static int regionCount = 0, bufferCount = 0, arenaCount = 0;
+
+// Tasks whose stacks we size ourselves or that share SRAM with us.
+// Missing ones (different core version / not started) are skipped.
+static const char* const TASK_NAMES[] = {
+    "loopTask", "wifi", "tiT", "esp_timer", "sys_evt", "arduino_events",
+    "IDLE", "IDLE0", "IDLE1", "ipc0", "ipc1", "logwriter"
+};
+static const int TASK_COUNT = sizeof(TASK_NAMES) / sizeof(TASK_NAMES[0]);
+
+void memRegisterRegion(const char* module, const char* name, size_t bytes) {
+    if (regionCount >= MEM_MAX_REGIONS) return;
+    regions[regionCount++] = {module, name, bytes};
+}
+
+void memRegisterBuffer(const char* name, const size_t* highWater, size_t capacity) {
+    if (bufferCount >= MEM_MAX_BUFFERS) return;
+    buffers[bufferCount++] = {name, highWater, capacity};
+}
+
+void memRegisterArena(const char* name, MemArenaStatFn fn) {
+    if (arenaCount >= MEM_MAX_ARENAS) return;
+    arenas[arenaCount++] = {name, fn};
+}
+
+// ==================== Serial report ====================
+
+static void printHeap(const char* label, uint32_t caps) {
+    size_t total = heap_caps_get_total_size(caps);
+    if (total == 0) {
+        Serial.printf("#   %-9s not present\n", label);
+        return;
+    }
+    Serial.printf("#   %-9s total %7u  free %7u  min_free %7u  largest %7u\n", label,
+                  (unsigned)total, (unsigned)heap_caps_get_free_size(caps),
+                  (unsigned)heap_caps_get_minimum_free_size(caps),
+                  (unsigned)heap_caps_get_largest_free_block(caps));
+}
+
+void memReportPrint() {
+    Serial.println("# ---- memory budget ----");
+    Serial.println("# heap:");
+    printHeap("internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    printHeap("psram", MALLOC_CAP_SPIRAM);
+
+    size_t regionTotal = 0;
+    Serial.println("# regions (module/name bytes):");
+    for (int i = 0; i < regionCount; i++) {
+        Serial.printf("#   %-10s %-16s %7u\n", regions[i].module, regions[i].name,
+                      (unsigned)regions[i].bytes);
+        regionTotal += regions[i].bytes;
+    }
+    Serial.printf("#   %-27s %7u\n", "total", (unsigned)regionTotal);
+
+    Serial.println("# buffers (high-water / capacity):");
+    for (int i = 0; i < bufferCount; i++) {
+        Serial.printf("#   %-16s %7u / %7u\n", buffers[i].name,
+                      (unsigned)*buffers[i].highWater, (unsigned)buffers[i].capacity);
+    }
+
+    if (arenaCount) Serial.println("# arenas (used / peak / capacity):");
+    for (int i = 0; i < arenaCount; i++) {
+        size_t used = 0, peak = 0, cap = 0;
+        arenas[i].fn(&used, &peak, &cap);
+        Serial.printf("#   %-16s %7u / %7u / %7u\n", arenas[i].name,
+                      (unsigned)used, (unsigned)peak, (unsigned)cap);
+    }
+
+    Serial.println("# task stacks (high-water = bytes never used):");
+    for (int i = 0; i < TASK_COUNT; i++) {
+        TaskHandle_t h = xTaskGetHandle(TASK_NAMES[i]);
+        if (!h) continue;
+        Serial.printf("#   %-16s %7u\n", TASK_NAMES[i],
+                      (unsigned)uxTaskGetStackHighWaterMark(h));
+    }
+#ifdef CONFIG_ARDUINO_LOOP_STACK_SIZE
+    Serial.printf("#   (loopTask stack size %u)\n", (unsigned)CONFIG_ARDUINO_LOOP_STACK_SIZE);
+#endif
+}
+
+// ==================== JSON report ====================
+
+static void jsonHeap(JsonOut &o, const char* label, uint32_t caps) {
+    jsonAppend(o, "\"%s\":{\"total\":%u,\"free\":%u,\"min_free\":%u,\"largest\":%u}", label,
+               (unsigned)heap_caps_get_total_size(caps), (unsigned)heap_caps_get_free_size(caps),
+               (unsigned)heap_caps_get_minimum_free_size(caps),
+               (unsigned)heap_caps_get_largest_free_block(caps));
+}
+
+size_t memReportToJson(char* buf, size_t size) {
+    if (size == 0) return 0;
+    JsonOut o = jsonBegin(buf, size);
+
+    jsonAppend(o, "{\"heap\":{");
+    jsonHeap(o, "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    jsonAppend(o, ",");
+    jsonHeap(o, "psram", MALLOC_CAP_SPIRAM);
+
+    jsonAppend(o, "},\"regions\":[");
+    for (int i = 0; i < regionCount; i++) {
+        jsonAppend(o, "%s{\"module\":\"%s\",\"name\":\"%s\",\"bytes\":%u}", i ? "," : "",
+                   regions[i].module, regions[i].name, (unsigned)regions[i].bytes);
+    }
+
+    jsonAppend(o, "],\"buffers\":[");
+    for (int i = 0; i < bufferCount; i++) {
+        jsonAppend(o, "%s{\"name\":\"%s\",\"high_water\":%u,\"capacity\":%u}", i ? "," : "",
+                   buffers[i].name, (unsigned)*buffers[i].highWater,
+                   (unsigned)buffers[i].capacity);
+    }
+
+    jsonAppend(o, "],\"arenas\":[");
+    for (int i = 0; i < arenaCount; i++) {
+        size_t used = 0, peak = 0, cap = 0;
+        arenas[i].fn(&used, &peak, &cap);
+        jsonAppend(o, "%s{\"name\":\"%s\",\"used\":%u,\"peak\":%u,\"capacity\":%u}",
+                   i ? "," : "", arenas[i].name, (unsigned)used, (unsigned)peak,
+                   (unsigned)cap);
+    }
+
+    jsonAppend(o, "],\"tasks\":[");
+    bool first = true;
+    for (int i = 0; i < TASK_COUNT; i++) {
+        TaskHandle_t h = xTaskGetHandle(TASK_NAMES[i]);
+        if (!h) continue;
+        jsonAppend(o, "%s{\"name\":\"%s\",\"stack_free_min\":%u}", first ? "" : ",",
+                   TASK_NAMES[i], (unsigned)uxTaskGetStackHighWaterMark(h));
+        first = false;
+    }
+    jsonAppend(o, "]}");
+    return o.len;
+}
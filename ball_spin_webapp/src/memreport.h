@@ -0,0 +1,35 @@
+/**
+ * Memory budget report
+ *
+ * Collects, in one place, everything needed to size stacks and buffers:
+ *   - heap: internal SRAM and PSRAM free / minimum-ever / largest block
+ *   - regions: fixed buffers each module owns (registered at setup)
+ *   - buffers: live buffers with a high-water mark (e.g. WS frame JSON)
+ *   - arenas: PSRAM arenas reporting used / peak / capacity
+ *   - tasks: FreeRTOS stack high-water marks (bytes never touched)
+ *
+ * Printed to Serial at boot and served on GET /mem. The build-time view
+ * (per-object SRAM/flash from the linker map) comes from
+ * scripts/mem_report.py, run as a PlatformIO post-build action.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed-size memory owned by a module; bytes known at compile time
+void memRegisterRegion(const char* module, const char* name, size_t bytes);
+
+// Live buffer: *highWater is updated by the owner, capacity is its size
+void memRegisterBuffer(const char* name, const size_t* highWater, size_t capacity);
+
+// Arena statistics callback (used/peak/capacity in bytes)
+typedef void (*MemArenaStatFn)(size_t* used, size_t* peak, size_t* capacity);
+void memRegisterArena(const char* name, MemArenaStatFn fn);
+
+// Full report to Serial
+void memReportPrint();
+
+// Writes the /mem JSON document; returns bytes written
+size_t memReportToJson(char* buf, size_t size);
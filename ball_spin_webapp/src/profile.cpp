@@ -0,0 +1,100 @@
+/**
+ * Pipeline stage profiling - see profile.h
+ */
+
+#include "profile.h"
+#include "jsonout.h"
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+
+// log2 buckets of the cycle count: bucket k holds [2^k, 2^(k+1))
+static const int PROF_BUCKETS = 32;
+
+struct StageStats {
+    uint32_t n;
+    uint32_t minCyc;
+    uint32_t maxCyc;
+    double   mean;     // Welford running mean / M2
+    double   m2;
+    uint32_t buckets[PROF_BUCKETS];
+};
+
+static StageStats stats[PROF_COUNT];
+
+static const char* const STAGE_NAMES[PROF_COUNT] = {
+    "imu_read", "fusion", "detect", "tick", "encode", "send", "display"
+};
+
+void profRecord(ProfStage stage, uint32_t cycles) {
+    StageStats &s = stats[stage];
+    if (s.n == 0 || cycles < s.minCyc) s.minCyc = cycles;
+    if (cycles > s.maxCyc) s.maxCyc = cycles;
+    s.n++;
+    double delta = cycles - s.mean;
+    s.mean += delta / s.n;
+    s.m2 += delta * (cycles - s.mean);
+    int k = cycles ? 31 - __builtin_clz(cycles) : 0;
+    s.buckets[k]++;
+}
+
+size_t profMemBytes() {
+    return sizeof(stats);
+}
+
+void profReset() {
+    memset(stats, 0, sizeof(stats));
+}
+
+// Upper edge of the log2 bucket holding the 99th percentile
+static uint32_t p99Cycles(const StageStats &s) {
+    uint32_t target = s.n - s.n / 100;
+    uint32_t acc = 0;
+    for (int k = 0; k < PROF_BUCKETS; k++) {
+        acc += s.buckets[k];
+        if (acc >= target) {
+            uint32_t edge = k >= 31 ? 0xFFFFFFFFu : (2u << k);
+            return edge < s.maxCyc ? edge : s.maxCyc;
+        }
+    }
+    return s.maxCyc;
+}
+
+static float stddevCycles(const StageStats &s) {
+    return s.n > 1 ? (float)sqrt(s.m2 / (s.n - 1)) : 0.0f;
+}
+
+void profPrint() {
+    float mhz = (float)ESP.getCpuFreqMHz();
+    Serial.printf("# profile (%s, %.0f MHz) cycles: n min mean p99 max stddev | stall_us(mean-min) jitter_us(max-min)\n",
+                  HOT_IRAM ? "iram" : "flash", mhz);
+    for (int i = 0; i < PROF_COUNT; i++) {
+        const StageStats &s = stats[i];
+        if (s.n == 0) continue;
+        Serial.printf("# %-9s %7lu %7lu %9.0f %8lu %8lu %8.0f | %7.2f %8.2f\n",
+                      STAGE_NAMES[i], (unsigned long)s.n, (unsigned long)s.minCyc,
+                      s.mean, (unsigned long)p99Cycles(s), (unsigned long)s.maxCyc,
+                      stddevCycles(s),
+                      (s.mean - s.minCyc) / mhz, (s.maxCyc - s.minCyc) / mhz);
+    }
+}
+
+size_t profToJson(char* buf, size_t size) {
+    if (size == 0) return 0;
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, "{\"placement\":\"%s\",\"cpu_mhz\":%lu,\"stages\":{",
+               HOT_IRAM ? "iram" : "flash", (unsigned long)ESP.getCpuFreqMHz());
+    bool first = true;
+    for (int i = 0; i < PROF_COUNT; i++) {
+        const StageStats &s = stats[i];
+        if (s.n == 0) continue;
+        jsonAppend(o, "%s\"%s\":{\"n\":%lu,\"min\":%lu,\"mean\":%.0f,\"p99\":%lu,"
+                      "\"max\":%lu,\"stddev\":%.0f}",
+                   first ? "" : ",", STAGE_NAMES[i], (unsigned long)s.n,
+                   (unsigned long)s.minCyc, s.mean, (unsigned long)p99Cycles(s),
+                   (unsigned long)s.maxCyc, stddevCycles(s));
+        first = false;
+    }
+    jsonAppend(o, "}}");
+    return o.len;
+}
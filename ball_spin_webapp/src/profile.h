@@ -0,0 +1,70 @@
+/**
+ * Pipeline stage profiling and hot-path placement
+ *
+ * Code executing from flash goes through the ESP32-S3 instruction cache;
+ * a miss stalls the core until the line is fetched over SPI, and the
+ * penalty grows when Wi-Fi or flash writes hold the bus. The per-stage
+ * cycle spread (max - min, stddev) is therefore a direct measure of
+ * cache-stall jitter.
+ *
+ * PROFILE_STAGES  - time each loop stage with the CPU cycle counter,
+ *                   print a report every 5 s and serve GET /profile
+ * HOT_IRAM=1      - place the hot integration / detection / encode
+ *                   functions in IRAM and their tables in DRAM
+ *
+ * See the m5stack-atoms3-profile* envs in platformio.ini for the
+ * flash vs IRAM comparison builds.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_attr.h>
+
+#ifndef HOT_IRAM
+#define HOT_IRAM 1
+#endif
+
+#if HOT_IRAM
+#define IRAM_HOT IRAM_ATTR
+#define DRAM_HOT DRAM_ATTR
+#else
+#define IRAM_HOT
+#define DRAM_HOT
+#endif
+
+enum ProfStage {
+    PROF_IMU_READ,   // M5.Imu.update() + imuRead()
+    PROF_FUSION,     // bias estimation, filters, quaternion integration
+    PROF_DETECT,     // impact detection + peak tracking
+    PROF_TICK,       // 200Hz tick: log sample + decimation bank
+    PROF_ENCODE,     // JSON frame formatting
+    PROF_SEND,       // WebSocket broadcast
+    PROF_DISPLAY,    // sprite render + SPI push
+    PROF_COUNT
+};
+
+#ifdef PROFILE_STAGES
+#include <Esp.h>
+#define PROF_BEGIN(s) const uint32_t _prof_##s = ESP.getCycleCount()
+#define PROF_END(s)   profRecord(s, ESP.getCycleCount() - _prof_##s)
+#else
+#define PROF_BEGIN(s)
+#define PROF_END(s)
+#endif
+
+// Adds one cycle-count sample for a stage
+void profRecord(ProfStage stage, uint32_t cycles);
+
+// Bytes of static statistics storage (memory budget report)
+size_t profMemBytes();
+
+// Clears all stage statistics
+void profReset();
+
+// Prints the per-stage table to Serial
+void profPrint();
+
+// Writes the /profile JSON document; returns bytes written
+size_t profToJson(char* buf, size_t size);
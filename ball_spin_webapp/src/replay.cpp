@@ -0,0 +1,136 @@
+/**
+ * Session replay from the flash log - see replay.h
+ */
+
+#include "replay.h"
+#include "sessionlog.h"
+#include "bschunk.h"
+#include <esp_heap_caps.h>
+#include <string.h>
+
+static const uint16_t REPLAY_CHUNK_MAX = 64;  // samples per chunk the writer produces
+
+// One decoded chunk, column-wise as bsChunkDecode writes it
+struct ReplayChunk {
+    int64_t  t[REPLAY_CHUNK_MAX];
+    int16_t  col[10][REPLAY_CHUNK_MAX];  // ax .. qz
+    uint16_t flags[REPLAY_CHUNK_MAX];
+};
+
+static bool         active = false;
+static float        speed = 1.0f;
+static LogCursor    cursor;
+static uint8_t*     rec = nullptr;        // record payload: the encoded chunk
+static size_t       recCap = 0;
+static ReplayChunk* chunk = nullptr;
+static uint16_t     count = 0, pos = 0;   // samples in / taken from chunk
+static uint16_t     shotCount = 0, shotPos = 0;
+static bool         timed = false;        // t0 set from the first sample
+static int64_t      t0Rec = 0, t0Wall = 0;
+static ReplayStats  stats;
+
+void replayStop() {
+    active = false;
+    heap_caps_free(rec);
+    heap_caps_free(chunk);
+    rec = nullptr;
+    chunk = nullptr;
+}
+
+bool replayStart(uint32_t session, float playSpeed, int64_t nowUs) {
+    replayStop();
+    memset(&stats, 0, sizeof(stats));
+    stats.session = session;
+    stats.startUs = stats.endUs = nowUs;
+    if (!logOpenSession(cursor, session)) return false;
+
+    recCap = logRecordMax();
+    rec = (uint8_t*)heap_caps_malloc(recCap, MALLOC_CAP_8BIT);
+    chunk = (ReplayChunk*)heap_caps_malloc(sizeof(ReplayChunk), MALLOC_CAP_8BIT);
+    if (!rec || !chunk) {
+        replayStop();
+        return false;
+    }
+    speed = playSpeed > 0 ? playSpeed : 0;
+    count = pos = shotCount = shotPos = 0;
+    timed = false;
+    active = true;
+    return true;
+}
+
+bool replayActive() { return active; }
+
+const ReplayStats &replayStats() { return stats; }
+
+const BsFileHeader &replayHeader() { return cursor.header; }
+
+// Decodes the chunk in rec; false if it is malformed
+static bool loadChunk(uint16_t len) {
+    if (!bsChunkValid(rec, len)) return false;
+    const BsChunkHeader* h = bsChunkHeader(rec);
+    if (h->count > REPLAY_CHUNK_MAX) return false;
+
+    // Columns the session did not store read as zero / identity orientation
+    memset(chunk, 0, sizeof(*chunk));
+    for (uint16_t i = 0; i < h->count; i++) chunk->col[BS_COL_QW - BS_COL_AX][i] = cursor.header.quatOne;
+    const BsColumnDesc* cols = bsChunkColumns(rec);
+    for (uint8_t i = 0; i < h->ncols; i++) {
+        uint8_t id = cols[i].id;
+        void* out = id == BS_COL_T     ? (void*)chunk->t
+                  : id == BS_COL_FLAGS ? (void*)chunk->flags
+                  :                      (void*)chunk->col[id - BS_COL_AX];
+        if (!bsChunkDecode(rec, cols[i], out)) return false;
+    }
+    count = h->count;
+    shotCount = h->shotCount;
+    pos = shotPos = 0;
+    return true;
+}
+
+uint8_t replayNext(int64_t nowUs, BsSample &s, BsShot &shot) {
+    while (active) {
+        if (pos < count) {
+            int64_t t = chunk->t[pos];
+            if (!timed) {
+                timed = true;
+                t0Rec = t;
+                t0Wall = nowUs;
+            }
+            if (speed > 0 && (float)(t - t0Rec) > (float)(nowUs - t0Wall) * speed) {
+                return REPLAY_IDLE;
+            }
+            s.tUs = t;
+            for (int k = 0; k < 3; k++) {
+                s.a[k] = chunk->col[k][pos];
+                s.g[k] = chunk->col[3 + k][pos];
+            }
+            for (int k = 0; k < 4; k++) s.q[k] = chunk->col[6 + k][pos];
+            s.flags = chunk->flags[pos];
+            pos++;
+            stats.samples++;
+            stats.endUs = nowUs;
+            return REPLAY_SAMPLE;
+        }
+        if (shotPos < shotCount) {
+            memcpy(&shot, bsChunkShots(rec) + shotPos++, sizeof(shot));
+            stats.shots++;
+            stats.endUs = nowUs;
+            return REPLAY_SHOT;
+        }
+
+        uint16_t len;
+        uint8_t type = logNextRecord(cursor, rec, recCap, len);
+        if (type == 0) {
+            stats.endUs = nowUs;
+            replayStop();
+            return REPLAY_DONE;
+        }
+        if (type != LOG_CHUNK) continue;
+        stats.chunks++;
+        if (!loadChunk(len)) {
+            count = shotCount = 0;
+            stats.badChunks++;
+        }
+    }
+    return REPLAY_IDLE;
+}
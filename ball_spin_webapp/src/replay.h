@@ -0,0 +1,50 @@
+/**
+ * Session replay from the flash log
+ *
+ * Reads a stored session back chunk by chunk (sessionlog.h cursor) and
+ * hands out its samples and shots in recorded order, paced to the
+ * recorded timestamps at a chosen speed: 1 = real time, N = N times
+ * faster, 0 = as fast as the caller takes them. The caller (main.cpp)
+ * turns them into live-protocol frames, so the dashboard can review a
+ * session and the observer can pull one in at link speed.
+ *
+ * Only one chunk is decoded at a time (about 6 KB of heap while a replay
+ * runs, nothing otherwise), and all flash reads happen in replayNext(),
+ * one record per chunk, from the task that calls it.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ballsession.h"
+
+enum ReplayItem : uint8_t {
+    REPLAY_IDLE = 0,  // nothing due yet (or no replay running)
+    REPLAY_SAMPLE,
+    REPLAY_SHOT,      // a chunk's shots follow its samples
+    REPLAY_DONE,      // session finished; the replay is stopped
+};
+
+struct ReplayStats {
+    uint32_t session;
+    uint32_t samples;
+    uint32_t shots;
+    uint32_t chunks;
+    uint32_t badChunks;   // failed validation or decoding, skipped
+    int64_t  startUs;     // esp_timer time of replayStart
+    int64_t  endUs;       // of the last item (REPLAY_DONE included)
+};
+
+// Opens the session; false if it is not on flash or memory is short
+bool replayStart(uint32_t session, float speed, int64_t nowUs);
+void replayStop();
+bool replayActive();
+
+// Next due item into s or shot; nowUs from esp_timer_get_time()
+uint8_t replayNext(int64_t nowUs, BsSample &s, BsShot &shot);
+
+const ReplayStats &replayStats();
+
+// Scales of the session being replayed (its BsFileHeader)
+const BsFileHeader &replayHeader();
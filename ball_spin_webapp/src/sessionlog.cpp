@@ -0,0 +1,822 @@
+/**
+ * On-device session log - see sessionlog.h
+ */
+
+#include "sessionlog.h"
+#include "bschunk.h"
+#include "bspyramid.h"
+#include "jsonout.h"
+#include "imusample.h"  // imuLogScales
+#include "profile.h"  // IRAM_HOT
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <string.h>
+
+static const uint32_t LOG_RING          = 512;   // samples, ~2.5 s at 200 Hz
+static const uint32_t LOG_EVENTS        = 16;
+static const uint16_t LOG_CHUNK_SAMPLES = 64;    // samples per flash record
+static const uint16_t LOG_CHUNK_SHOTS   = 8;
+static const uint8_t  LOG_ENCODING      = BS_ENC_AUTO;  // smallest predictor / packing per column
+static const uint32_t LOG_IDLE_FLUSH_MS = 1000;  // max age of unwritten samples
+static const uint32_t LOG_LATE_GAP_US   = 2 * 1000000 / LOG_SAMPLE_HZ;
+static const uint16_t LOG_SUMMARY_BATCH = 32;    // summaries per LOG_SUMMARY record (~40 s)
+static const int      LOG_LIST_MAX      = 24;    // newest sessions in the /sessions table
+static const int      LOG_SCAN_RECORDS  = 64;    // records per mount scan slice
+
+// Record buffer; logBegin() checks it against bsChunkMaxBytes()
+static const size_t LOG_RECORD_MAX = 3584;
+static_assert(sizeof(LogSectorHeader) + LOG_RECORD_MAX <= LOG_SECTOR_SIZE,
+              "a chunk record must fit in one sector");
+
+// ==================== Queues (loop task -> writer task) ====================
+
+// Event type for shots; the others are LogRecordType values
+static const uint8_t LOG_SHOT_EVENT = 0x80;
+
+struct LogEvent {
+    uint8_t  type;
+    uint32_t sampleMark;  // samples pushed before this event
+    union {
+        BsFileHeader  start;
+        LogSessionEnd end;
+        BsShot        shot;
+    };
+};
+
+static BsSample  sampleRing[LOG_RING];
+static LogEvent  eventRing[LOG_EVENTS];
+static std::atomic<uint32_t> sampleHead{0}, sampleTail{0};
+static std::atomic<uint32_t> eventHead{0}, eventTail{0};
+static std::atomic<bool>     flushReq{false};
+static TaskHandle_t writerHandle = nullptr;
+
+// Producer-side session state
+static uint32_t session = 0;
+static bool     sessionOpen = false;
+static uint32_t sessionSamples = 0, sessionShots = 0;
+static uint32_t lastPushUs = 0;
+
+// ==================== Flash state (writer task) ====================
+
+static const esp_partition_t* part = nullptr;
+static uint32_t sectorCount = 0;
+static int32_t  headSector = -1;   // -1: nothing written yet
+static uint32_t headSeq = 0;
+// headSeq << 32 | headSector for the readers in other tasks, published
+// as one value so a new seq is never seen with the old sector
+static const uint64_t HEAD_NONE = UINT64_MAX;
+static std::atomic<uint64_t> headPos{HEAD_NONE};
+static uint32_t headOffset = LOG_SECTOR_SIZE;
+static int32_t  preErased = -1;
+static uint32_t preErasedCount = 0;
+static uint32_t writerSession = 0;
+static uint64_t writerSamples = 0;  // samples of writerSession already chunked
+static uint8_t  recBuf[LOG_RECORD_MAX];
+static uint64_t chunkStore[(LOG_CHUNK_SAMPLES * 30 + LOG_CHUNK_SHOTS * sizeof(BsShot)) / 8];
+static BsChunkBuilder chunk;
+static BsPyramidBuilder pyramid;
+static BsSummary summaryBuf[LOG_SUMMARY_BATCH];
+static uint16_t  summaryPending = 0;
+
+struct LogStats {
+    uint32_t samples, dropped, shots, eventsDropped;
+    uint32_t chunks, records;
+    uint32_t rawBytes, encodedBytes, flashBytes;
+    uint32_t writes, writeUsTotal, writeUsMax;
+    uint32_t erases, eraseUsTotal, eraseUsMax, preErases, eraseCountMax;
+    uint32_t sectorSwitches, wraps, tornRecords, mountValidSectors;
+    uint32_t ringHighWater, gapUsMax, lateSamples;
+    uint32_t startMs;
+    uint64_t encodeCycles;    // bsChunkEncode, over encodedSamples
+    uint32_t encodedSamples;
+    uint64_t pyramidCycles;   // bsPyramidAdd, over encodedSamples
+    uint32_t summaries, summaryBytes;
+};
+static LogStats stats;
+
+// Per-session summary for /sessions, kept by the writer task: filled by a
+// scan of the log after mount (in slices between drains), then updated
+// as records are appended. Readers copy it under a seqlock.
+struct LogSessionInfo {
+    uint32_t id, chunks, samples, shots, bytes;
+    uint32_t startSeq;    // sector seq of the start record
+    int64_t  tFirstUs, tLastUs;
+    bool     complete;
+};
+struct LogSessionTable {
+    LogSessionInfo s[LOG_LIST_MAX];   // ring, oldest at first
+    uint8_t        first, count;
+    bool           ready;             // mount scan done
+};
+static LogSessionTable table;
+static std::atomic<uint32_t> tableVersion{0};   // odd while the writer changes table
+static LogCursor scanCursor;
+
+// ==================== Records ====================
+
+static uint32_t recordCrc(const LogRecordHeader &h, const uint8_t* payload) {
+    uint32_t crc = bsCrc32(0, &h, offsetof(LogRecordHeader, crc));
+    return bsCrc32(crc, payload, h.len);
+}
+
+static uint32_t sectorCrc(const LogSectorHeader &h) {
+    return bsCrc32(0, &h, offsetof(LogSectorHeader, crc));
+}
+
+static uint32_t pad4(uint32_t n) { return (n + 3) & ~3u; }
+
+// ==================== Sectors ====================
+
+static void publishHead() {
+    headPos.store((uint64_t)headSeq << 32 | (uint32_t)headSector);
+}
+
+// Head as last published; false while nothing has been written
+static bool loadHead(uint32_t &sector, uint32_t &seq) {
+    uint64_t v = headPos.load();
+    if (v == HEAD_NONE) return false;
+    sector = (uint32_t)v;
+    seq = (uint32_t)(v >> 32);
+    return true;
+}
+
+// A sector of this pass still holds what it held at seq: the oldest one
+// counts as gone, it is pre-erased once the head is half full
+static bool seqLive(uint32_t head, uint32_t seq) {
+    return head - seq < sectorCount - 1;
+}
+
+static bool readSectorHeader(uint32_t sector, LogSectorHeader &h) {
+    if (esp_partition_read(part, sector * LOG_SECTOR_SIZE, &h, sizeof(h)) != ESP_OK) return false;
+    return h.magic == LOG_SECTOR_MAGIC && h.crc == sectorCrc(h);
+}
+
+static void tableEvict(uint32_t head);
+
+// Erases a sector and returns its new erase count
+static uint32_t eraseSector(uint32_t sector) {
+    LogSectorHeader old;
+    uint32_t count = readSectorHeader(sector, old) ? old.eraseCount + 1 : 1;
+    uint32_t t0 = micros();
+    esp_partition_erase_range(part, sector * LOG_SECTOR_SIZE, LOG_SECTOR_SIZE);
+    uint32_t us = micros() - t0;
+    stats.erases++;
+    stats.eraseUsTotal += us;
+    if (us > stats.eraseUsMax) stats.eraseUsMax = us;
+    if (count > stats.eraseCountMax) stats.eraseCountMax = count;
+    return count;
+}
+
+static void timedWrite(uint32_t offset, const void* data, size_t len) {
+    uint32_t t0 = micros();
+    esp_partition_write(part, offset, data, len);
+    uint32_t us = micros() - t0;
+    stats.writes++;
+    stats.writeUsTotal += us;
+    if (us > stats.writeUsMax) stats.writeUsMax = us;
+    stats.flashBytes += len;
+}
+
+static void openNextSector() {
+    uint32_t next = headSector < 0 ? 0 : (headSector + 1) % sectorCount;
+    if (headSector >= 0 && next == 0) stats.wraps++;
+    uint32_t count = (int32_t)next == preErased ? preErasedCount : eraseSector(next);
+    preErased = -1;
+
+    LogSectorHeader h = {LOG_SECTOR_MAGIC, ++headSeq, count, writerSession, 0};
+    h.crc = sectorCrc(h);
+    timedWrite(next * LOG_SECTOR_SIZE, &h, sizeof(h));
+    headSector = next;
+    headOffset = pad4(sizeof(h));
+    publishHead();
+    tableEvict(headSeq);
+    stats.sectorSwitches++;
+}
+
+// Appends the record staged in recBuf (payload at recBuf + header)
+static void tableRecord(uint8_t type, uint32_t seq, uint16_t len, const uint8_t* head, const uint8_t* tail);
+
+static void appendRecord(uint8_t type, uint16_t len) {
+    uint32_t total = sizeof(LogRecordHeader) + pad4(len);
+    if (headSector < 0 || headOffset + total > LOG_SECTOR_SIZE) openNextSector();
+
+    uint8_t* payload = recBuf + sizeof(LogRecordHeader);
+    memset(payload + len, 0, pad4(len) - len);
+    LogRecordHeader h = {type, 0, len, 0};
+    h.crc = recordCrc(h, payload);
+    memcpy(recBuf, &h, sizeof(h));
+    timedWrite(headSector * LOG_SECTOR_SIZE + headOffset, recBuf, total);
+    headOffset += total;
+    stats.records++;
+    // Until the mount scan is done it reaches this record itself
+    if (table.ready) {
+        tableRecord(type, headSeq, len, payload,
+                    len >= sizeof(BsChunkFooter) ? payload + len - sizeof(BsChunkFooter) : payload);
+    }
+
+    // Keep the sector switch free of erase time (the writer's; the sampler stalls either way)
+    uint32_t next = (headSector + 1) % sectorCount;
+    if (headOffset > LOG_SECTOR_SIZE / 2 && preErased != (int32_t)next) {
+        preErasedCount = eraseSector(next);
+        preErased = next;
+        stats.preErases++;
+    }
+}
+
+// Finds the head sector and the end of its last intact record
+static void mount() {
+    LogSectorHeader h;
+    uint32_t bestSeq = 0;
+    for (uint32_t i = 0; i < sectorCount; i++) {
+        if (!readSectorHeader(i, h)) continue;
+        stats.mountValidSectors++;
+        if (h.eraseCount > stats.eraseCountMax) stats.eraseCountMax = h.eraseCount;
+        if (headSector < 0 || (int32_t)(h.seq - bestSeq) > 0) {
+            headSector = i;
+            bestSeq = h.seq;
+            writerSession = h.session;
+        }
+    }
+    if (headSector < 0) return;
+    headSeq = bestSeq;
+    publishHead();
+
+    uint32_t off = pad4(sizeof(LogSectorHeader));
+    uint8_t* payload = recBuf + sizeof(LogRecordHeader);
+    bool torn = false;
+    while (off + sizeof(LogRecordHeader) <= LOG_SECTOR_SIZE) {
+        LogRecordHeader rh;
+        esp_partition_read(part, headSector * LOG_SECTOR_SIZE + off, &rh, sizeof(rh));
+        if (rh.type == 0xFF) break;  // erased: clean end of log
+        if (rh.len > LOG_RECORD_MAX - sizeof(rh) ||
+            off + sizeof(rh) + rh.len > LOG_SECTOR_SIZE) {
+            torn = true;
+            break;
+        }
+        esp_partition_read(part, headSector * LOG_SECTOR_SIZE + off + sizeof(rh), payload, rh.len);
+        if (rh.crc != recordCrc(rh, payload)) {
+            torn = true;
+            break;
+        }
+        if (rh.type == LOG_SESSION_START) {
+            writerSession = ((BsFileHeader*)payload)->session;
+        }
+        off += sizeof(rh) + pad4(rh.len);
+    }
+    // Programmed bits cannot be rewritten: continue after a torn tail in a fresh sector
+    headOffset = torn ? LOG_SECTOR_SIZE : off;
+    if (torn) stats.tornRecords++;
+}
+
+// ==================== Writer task ====================
+
+static uint8_t* recordPayload() { return recBuf + sizeof(LogRecordHeader); }
+
+static void flushChunk() {
+    if (chunk.count == 0 && chunk.shotCount == 0) return;
+    uint32_t c0 = ESP.getCycleCount();
+    size_t len = bsChunkEncode(chunk, LOG_ENCODING, recordPayload(),
+                               sizeof(recBuf) - sizeof(LogRecordHeader));
+    stats.encodeCycles += ESP.getCycleCount() - c0;
+    stats.encodedSamples += chunk.count;
+    appendRecord(LOG_CHUNK, len);
+    stats.chunks++;
+    stats.rawBytes += chunk.count * sizeof(BsSample);
+    stats.encodedBytes += len;
+    writerSamples += chunk.count;
+    bsChunkReset(chunk, writerSamples);
+}
+
+// Writes the buffered pyramid summaries as one LOG_SUMMARY record
+static void flushSummaries() {
+    if (!summaryPending) return;
+    LogSummaryHeader h = {writerSession, BS_PYRAMID_BASE, summaryPending};
+    size_t len = sizeof(h) + summaryPending * sizeof(BsSummary);
+    memcpy(recordPayload(), &h, sizeof(h));
+    memcpy(recordPayload() + sizeof(h), summaryBuf, summaryPending * sizeof(BsSummary));
+    appendRecord(LOG_SUMMARY, len);
+    stats.summaryBytes += len;
+    summaryPending = 0;
+}
+
+static void onSummary(void*, const BsSummary &s) {
+    if (summaryPending == LOG_SUMMARY_BATCH) flushSummaries();
+    summaryBuf[summaryPending++] = s;
+    stats.summaries++;
+}
+
+static void writeEvent(const LogEvent &e) {
+    switch (e.type) {
+        case LOG_SHOT_EVENT:
+            if (!bsChunkAddShot(chunk, e.shot)) {
+                flushChunk();
+                bsChunkAddShot(chunk, e.shot);
+            }
+            break;
+        case LOG_SESSION_START:
+            flushChunk();
+            writerSession = e.start.session;
+            writerSamples = 0;
+            bsChunkReset(chunk, 0);
+            bsPyramidInit(pyramid, BS_PYRAMID_BASE, onSummary, nullptr);
+            memcpy(recordPayload(), &e.start, sizeof(e.start));
+            appendRecord(LOG_SESSION_START, sizeof(e.start));
+            break;
+        case LOG_SESSION_END:
+            flushChunk();
+            bsPyramidFinish(pyramid);
+            flushSummaries();
+            memcpy(recordPayload(), &e.end, sizeof(e.end));
+            appendRecord(LOG_SESSION_END, sizeof(e.end));
+            break;
+    }
+}
+
+// Moves samples into the chunk builder and writes queued events in order
+// with the samples around them. A partly filled chunk is written only
+// when forced (idle timeout, flush).
+static void drain(bool partial) {
+    for (;;) {
+        uint32_t tail = sampleTail.load();
+        uint32_t limit = sampleHead.load();
+        uint32_t ev = eventTail.load();
+        if (ev != eventHead.load()) {
+            const LogEvent &e = eventRing[ev % LOG_EVENTS];
+            if (e.sampleMark == tail) {
+                writeEvent(e);
+                eventTail.store(ev + 1);
+                continue;
+            }
+            limit = e.sampleMark;  // samples before the event go first
+        }
+        if (limit == tail) break;
+        while (tail != limit && !bsChunkFull(chunk)) {
+            const BsSample &s = sampleRing[tail % LOG_RING];
+            bsChunkAdd(chunk, s);
+            uint32_t c0 = ESP.getCycleCount();
+            bsPyramidAdd(pyramid, s);
+            stats.pyramidCycles += ESP.getCycleCount() - c0;
+            tail++;
+        }
+        sampleTail.store(tail);  // slots are free once copied
+        if (bsChunkFull(chunk)) flushChunk();
+    }
+    if (partial) {
+        flushChunk();
+        flushSummaries();
+    }
+}
+
+static void scanStart();
+static void scanSlice();
+
+static void writerTask(void*) {
+    scanStart();
+    uint32_t lastWokenMs = millis();
+    for (;;) {
+        // While the mount scan runs, a slice per tick between drains
+        uint32_t woken = ulTaskNotifyTake(pdTRUE, table.ready ? pdMS_TO_TICKS(LOG_IDLE_FLUSH_MS) : 1);
+        uint32_t now = millis();
+        if (woken) lastWokenMs = now;
+        bool flush = flushReq.load();
+        drain(now - lastWokenMs >= LOG_IDLE_FLUSH_MS || flush);
+        if (flush) flushReq.store(false);
+        if (!table.ready) scanSlice();
+    }
+}
+
+// ==================== Reading stored sessions ====================
+
+// Sector `back` sectors behind the head at the time head/seq were taken;
+// true while it still holds that pass over the ring
+static bool sectorBehind(uint32_t head, uint32_t seq, uint32_t back, uint32_t &sector,
+                         LogSectorHeader &h) {
+    if (back + 1 >= sectorCount) return false;   // the oldest is not live (seqLive)
+    sector = (head + sectorCount - back) % sectorCount;
+    return readSectorHeader(sector, h) && h.seq == seq - back;
+}
+
+// Largest `back` for which pred holds; pred(0) must hold and pred must
+// stay true up to the answer and false after it
+template <typename Pred>
+static uint32_t searchBack(Pred pred) {
+    uint32_t lo = 0, hi = sectorCount;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (pred(mid)) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// The cursor's sector still holds c.seq. Its header was checked on the
+// way in; after that the published head tells whether the writer has
+// come round to it, without a flash read per record.
+static bool cursorLive(const LogCursor &c) {
+    uint32_t head, seq;
+    return loadHead(head, seq) && seqLive(seq, c.seq);
+}
+
+// Header of the record at the cursor, moving on to the next sector of the
+// same pass at the end of one; false at the tail of the log
+static bool cursorRecord(LogCursor &c, LogRecordHeader &rh) {
+    for (;;) {
+        LogSectorHeader h;
+        if (!cursorLive(c)) return false;  // recycled
+        if (c.offset + sizeof(rh) <= LOG_SECTOR_SIZE) {
+            esp_partition_read(part, c.sector * LOG_SECTOR_SIZE + c.offset, &rh, sizeof(rh));
+            if (rh.type != 0xFF && rh.len <= LOG_RECORD_MAX - sizeof(rh) &&
+                c.offset + sizeof(rh) + rh.len <= LOG_SECTOR_SIZE) {
+                return true;
+            }
+        }
+        // Erased space or a torn header ends the sector (as in mount)
+        uint32_t next = (c.sector + 1) % sectorCount;
+        if (!readSectorHeader(next, h) || h.seq != c.seq + 1) return false;
+        c.sector = next;
+        c.seq = h.seq;
+        c.offset = pad4(sizeof(h));
+    }
+}
+
+// Walks records, returning those of c.session once its start has been seen
+static uint8_t cursorNext(LogCursor &c, uint8_t* buf, size_t cap, uint16_t &len, uint8_t only) {
+    LogRecordHeader rh;
+    while (!c.done && cursorRecord(c, rh)) {
+        uint32_t at = c.sector * LOG_SECTOR_SIZE + c.offset + sizeof(rh);
+        c.offset += sizeof(rh) + pad4(rh.len);
+        if (!c.started && rh.type != LOG_SESSION_START) continue;
+        if (only && rh.type != only && rh.type != LOG_SESSION_START &&
+            rh.type != LOG_SESSION_END) {
+            continue;
+        }
+        if (rh.len > cap) continue;
+        esp_partition_read(part, at, buf, rh.len);
+        if (!cursorLive(c)) break;  // erased while it was read
+        if (rh.crc != recordCrc(rh, buf)) {
+            c.offset = LOG_SECTOR_SIZE;  // torn tail before a reboot: resume in the next sector
+            continue;
+        }
+        if (rh.type == LOG_SESSION_START) {
+            uint32_t s = ((const BsFileHeader*)buf)->session;
+            if (!c.started && s == c.session) {
+                memcpy(&c.header, buf, sizeof(c.header));
+                c.started = true;
+                len = rh.len;
+                return rh.type;
+            }
+            if (c.started || s > c.session) break;
+            continue;
+        }
+        if (rh.type == LOG_SESSION_END) {
+            if (((const LogSessionEnd*)buf)->session != c.session) break;
+            c.done = true;
+        }
+        len = rh.len;
+        return rh.type;
+    }
+    c.done = true;
+    return 0;
+}
+
+bool logOpenSession(LogCursor &c, uint32_t session) {
+    memset(&c, 0, sizeof(c));
+    c.session = session;
+    uint32_t head, seq;
+    if (!part || !loadHead(head, seq)) return false;
+
+    // Sessions never decrease going forward through the log: find the
+    // oldest sector started in this session or later; the start record is
+    // in it or in the sector before
+    uint32_t sector;
+    LogSectorHeader h;
+    auto atOrAfter = [&](uint32_t back) {
+        return sectorBehind(head, seq, back, sector, h) && h.session >= session;
+    };
+    if (!atOrAfter(0)) return false;
+    uint32_t back = searchBack(atOrAfter);
+    if (!sectorBehind(head, seq, back + 1, sector, h)) sectorBehind(head, seq, back, sector, h);
+    c.sector = sector;
+    c.seq = h.seq;
+    c.offset = pad4(sizeof(h));
+
+    uint8_t start[sizeof(BsFileHeader)];
+    uint16_t len;
+    return cursorNext(c, start, sizeof(start), len, 0) == LOG_SESSION_START;
+}
+
+uint8_t logNextRecord(LogCursor &c, uint8_t* buf, size_t cap, uint16_t &len, uint8_t only) {
+    return c.started ? cursorNext(c, buf, cap, len, only) : 0;
+}
+
+size_t logRecordMax() { return LOG_RECORD_MAX - sizeof(LogRecordHeader); }
+
+// ==================== Session table ====================
+
+static void tableWriteBegin() {
+    tableVersion.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+static void tableWriteEnd() { tableVersion.fetch_add(1, std::memory_order_release); }
+
+static LogSessionInfo &tableAt(uint32_t i) { return table.s[(table.first + i) % LOG_LIST_MAX]; }
+
+// One record of the log in order; head holds the payload's first bytes
+// (start header, chunk header), tail its last (chunk footer)
+static void tableRecord(uint8_t type, uint32_t seq, uint16_t len, const uint8_t* head, const uint8_t* tail) {
+    tableWriteBegin();
+    LogSessionInfo* cur = table.count ? &tableAt(table.count - 1) : nullptr;
+    if (type == LOG_SESSION_START && len == sizeof(BsFileHeader)) {
+        if (table.count == LOG_LIST_MAX) {
+            table.first = (table.first + 1) % LOG_LIST_MAX;
+            table.count--;
+        }
+        cur = &tableAt(table.count++);
+        memset(cur, 0, sizeof(*cur));
+        BsFileHeader fh;
+        memcpy(&fh, head, sizeof(fh));
+        cur->id = fh.session;
+        cur->startSeq = seq;
+    } else if (!cur) {
+        tableWriteEnd();
+        return;  // session started before the oldest sector
+    } else if (type == LOG_CHUNK && len >= sizeof(BsChunkHeader) + sizeof(BsChunkFooter)) {
+        BsChunkHeader ch;
+        BsChunkFooter cf;
+        memcpy(&ch, head, sizeof(ch));
+        memcpy(&cf, tail, sizeof(cf));
+        if (!cur->chunks) cur->tFirstUs = cf.tFirstUs;
+        if (ch.count) cur->tLastUs = cf.tLastUs;
+        cur->chunks++;
+        cur->samples += ch.count;
+        cur->shots += ch.shotCount;
+    } else if (type == LOG_SESSION_END) {
+        cur->complete = true;
+    }
+    cur->bytes += sizeof(LogRecordHeader) + pad4(len);
+    tableWriteEnd();
+}
+
+// Drops the sessions whose start sector is no longer live
+static void tableEvict(uint32_t head) {
+    tableWriteBegin();
+    while (table.count && !seqLive(head, tableAt(0).startSeq)) {
+        table.first = (table.first + 1) % LOG_LIST_MAX;
+        table.count--;
+    }
+    tableWriteEnd();
+}
+
+// Mount scan from the oldest live sector; restarted if the writer
+// recycles the sector under it
+static void scanStart() {
+    tableWriteBegin();
+    table.first = table.count = 0;
+    table.ready = false;
+    tableWriteEnd();
+    uint32_t head, seq, sector;
+    LogSectorHeader h;
+    if (!part || !loadHead(head, seq)) {
+        tableWriteBegin();
+        table.ready = true;  // empty log: every record goes in as written
+        tableWriteEnd();
+        return;
+    }
+    uint32_t oldest = searchBack([&](uint32_t back) {
+        return sectorBehind(head, seq, back, sector, h);
+    });
+    sectorBehind(head, seq, oldest, sector, h);
+    memset(&scanCursor, 0, sizeof(scanCursor));
+    scanCursor.sector = sector;
+    scanCursor.seq = h.seq;
+    scanCursor.offset = pad4(sizeof(h));
+}
+
+// Record headers only, plus the fixed-size parts that carry the counts
+static void scanSlice() {
+    for (int i = 0; i < LOG_SCAN_RECORDS; i++) {
+        LogRecordHeader rh;
+        if (!cursorRecord(scanCursor, rh)) {
+            uint32_t head, seq;
+            if (loadHead(head, seq) && scanCursor.seq != seq) {
+                scanStart();
+                return;
+            }
+            tableWriteBegin();
+            table.ready = true;   // at the tail: appendRecord takes over
+            tableWriteEnd();
+            return;
+        }
+        uint32_t at = scanCursor.sector * LOG_SECTOR_SIZE + scanCursor.offset + sizeof(rh);
+        scanCursor.offset += sizeof(rh) + pad4(rh.len);
+        uint8_t head[sizeof(BsFileHeader)];
+        uint8_t tail[sizeof(BsChunkFooter)];
+        static_assert(sizeof(BsFileHeader) >= sizeof(BsChunkHeader), "scan buffer");
+        if (rh.type == LOG_SESSION_START && rh.len == sizeof(BsFileHeader)) {
+            esp_partition_read(part, at, head, sizeof(BsFileHeader));
+        } else if (rh.type == LOG_CHUNK && rh.len >= sizeof(BsChunkHeader) + sizeof(BsChunkFooter)) {
+            esp_partition_read(part, at, head, sizeof(BsChunkHeader));
+            esp_partition_read(part, at + rh.len - sizeof(tail), tail, sizeof(tail));
+        }
+        tableRecord(rh.type, scanCursor.seq, rh.len, head, tail);
+    }
+}
+
+size_t logSessionsJson(char* buf, size_t size) {
+    // Seqlock copy: the writer task only holds it for one record's update
+    static LogSessionTable copy;
+    uint32_t v;
+    do {
+        while ((v = tableVersion.load(std::memory_order_acquire)) & 1) {}
+        memcpy(&copy, &table, sizeof(copy));
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (tableVersion.load() != v);
+
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, "{\"current\":%lu,\"sessions\":[", (unsigned long)session);
+    for (uint32_t i = 0; i < copy.count; i++) {
+        const LogSessionInfo &s = copy.s[(copy.first + copy.count - 1 - i) % LOG_LIST_MAX];  // newest first
+        jsonAppend(o, "%s{\"id\":%lu,\"samples\":%lu,\"shots\":%lu,\"chunks\":%lu,"
+                      "\"bytes\":%lu,\"seconds\":%.1f,\"complete\":%s}",
+                   i ? "," : "", (unsigned long)s.id, (unsigned long)s.samples,
+                   (unsigned long)s.shots, (unsigned long)s.chunks, (unsigned long)s.bytes,
+                   s.samples ? (s.tLastUs - s.tFirstUs) * 1e-6f : 0.0f,
+                   s.complete ? "true" : "false");
+    }
+    jsonAppend(o, "],\"listed_max\":%d,\"scanning\":%s}", LOG_LIST_MAX, copy.ready ? "false" : "true");
+    return o.len;
+}
+
+// ==================== Producer API (loop task) ====================
+
+static bool pushEvent(LogEvent &e) {
+    uint32_t head = eventHead.load();
+    if (head - eventTail.load() >= LOG_EVENTS) {
+        stats.eventsDropped++;
+        return false;
+    }
+    e.sampleMark = sampleHead.load();
+    eventRing[head % LOG_EVENTS] = e;
+    eventHead.store(head + 1);
+    return true;
+}
+
+bool logBegin() {
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                    (esp_partition_subtype_t)LOG_PARTITION_SUBTYPE, "sessions");
+    if (!part) {
+        Serial.println("# sessionlog: no \"sessions\" partition, logging disabled");
+        return false;
+    }
+    size_t chunkMax = sizeof(LogRecordHeader) +
+                      bsChunkMaxBytes(LOG_CHUNK_SAMPLES, LOG_CHUNK_SHOTS, BS_COLS_ALL,
+                                      LOG_ENCODING);
+    if (chunkMax > sizeof(recBuf) ||
+        bsChunkStorageBytes(LOG_CHUNK_SAMPLES, LOG_CHUNK_SHOTS) > sizeof(chunkStore)) {
+        Serial.printf("# sessionlog: chunk needs %u bytes, logging disabled\n", (unsigned)chunkMax);
+        part = nullptr;
+        return false;
+    }
+    bsChunkInit(chunk, chunkStore, LOG_CHUNK_SAMPLES, LOG_CHUNK_SHOTS, BS_COLS_ALL);
+    bsPyramidInit(pyramid, BS_PYRAMID_BASE, onSummary, nullptr);
+    sectorCount = part->size / LOG_SECTOR_SIZE;
+    uint32_t t0 = millis();
+    mount();
+    session = writerSession;
+    stats.startMs = millis();
+    Serial.printf("# sessionlog: %lu sectors, %lu valid, head %ld seq %lu, session %lu, "
+                  "torn %lu, mount %lu ms\n",
+                  (unsigned long)sectorCount, (unsigned long)stats.mountValidSectors,
+                  (long)headSector, (unsigned long)headSeq, (unsigned long)session,
+                  (unsigned long)stats.tornRecords, (unsigned long)(millis() - t0));
+
+    // Core 0 next to the Wi-Fi stack; the sampling loop runs on core 1
+    xTaskCreatePinnedToCore(writerTask, "logwriter", 4096, nullptr, 1, &writerHandle, 0);
+    return true;
+}
+
+IRAM_HOT void logPushSample(const BsSample &s) {
+    if (!part) return;
+    if (lastPushUs) {
+        uint32_t gap = (uint32_t)s.tUs - lastPushUs;
+        if (gap > stats.gapUsMax) stats.gapUsMax = gap;
+        if (gap > LOG_LATE_GAP_US) stats.lateSamples++;
+    }
+    lastPushUs = s.tUs;
+
+    uint32_t head = sampleHead.load();
+    uint32_t fill = head - sampleTail.load();
+    if (fill >= LOG_RING) {
+        stats.dropped++;
+        return;
+    }
+    sampleRing[head % LOG_RING] = s;
+    sampleHead.store(head + 1);
+    stats.samples++;
+    sessionSamples++;
+    if (fill + 1 > stats.ringHighWater) stats.ringHighWater = fill + 1;
+    if ((fill + 1) % LOG_CHUNK_SAMPLES == 0) xTaskNotifyGive(writerHandle);
+}
+
+void logPushShot(const BsShot &shot) {
+    if (!part) return;
+    LogEvent e;
+    e.type = LOG_SHOT_EVENT;
+    e.shot = shot;
+    if (pushEvent(e)) {
+        stats.shots++;
+        sessionShots++;
+    }
+}
+
+void logNewSession(uint32_t nowMs) {
+    if (!part) return;
+    LogEvent e;
+    if (sessionOpen) {
+        e.type = LOG_SESSION_END;
+        e.end = {session, sessionSamples, sessionShots, nowMs};
+        pushEvent(e);
+    }
+    session++;
+    e.type = LOG_SESSION_START;
+    bsFileHeaderInit(e.start, session, LOG_SAMPLE_HZ, BS_COLS_ALL, "ball_spin_webapp");
+    imuLogScales(e.start);
+    e.start.quatOne = LOG_QUAT_ONE;
+    e.start.startUs = esp_timer_get_time();
+    e.start.crc = bsCrc32(0, &e.start, offsetof(BsFileHeader, crc));
+    pushEvent(e);
+    sessionOpen = true;
+    sessionSamples = sessionShots = 0;
+}
+
+bool logFlush(uint32_t timeoutMs) {
+    if (!part) return false;
+    lastPushUs = 0;  // the pause that follows is not a sampling stall
+    flushReq.store(true);
+    xTaskNotifyGive(writerHandle);
+    uint32_t t0 = millis();
+    while (flushReq.load()) {
+        if (millis() - t0 >= timeoutMs) return false;
+        delay(2);
+    }
+    return true;
+}
+
+size_t logMemBytes() {
+    return sizeof(sampleRing) + sizeof(eventRing) + sizeof(recBuf) + sizeof(chunkStore) +
+           sizeof(pyramid) + sizeof(summaryBuf) + sizeof(stats) + sizeof(table) + sizeof(scanCursor);
+}
+
+size_t logToJson(char* buf, size_t size) {
+    JsonOut o = jsonBegin(buf, size);
+    if (!part) {
+        jsonAppend(o, "{\"enabled\":false}");
+        return o.len;
+    }
+    const LogStats &s = stats;
+    float secs = (millis() - s.startMs) * 1e-3f;
+    uint32_t head = 0, seq = 0;
+    long sector = loadHead(head, seq) ? (long)head : -1;
+    jsonAppend(o, "{\"enabled\":true,\"session\":%lu,\"partition_kb\":%lu,\"sectors\":%lu,"
+                  "\"head\":{\"sector\":%ld,\"seq\":%lu,\"offset\":%lu},\"wraps\":%lu,",
+               (unsigned long)session, (unsigned long)(part->size / 1024),
+               (unsigned long)sectorCount, sector, (unsigned long)seq,
+               (unsigned long)headOffset, (unsigned long)s.wraps);
+    jsonAppend(o, "\"samples\":%lu,\"dropped\":%lu,\"shots\":%lu,\"events_dropped\":%lu,"
+                  "\"chunks\":%lu,\"records\":%lu,\"ring\":{\"size\":%lu,\"high_water\":%lu},",
+               (unsigned long)s.samples, (unsigned long)s.dropped, (unsigned long)s.shots,
+               (unsigned long)s.eventsDropped, (unsigned long)s.chunks,
+               (unsigned long)s.records, (unsigned long)LOG_RING,
+               (unsigned long)s.ringHighWater);
+    jsonAppend(o, "\"bytes\":{\"raw\":%lu,\"encoded\":%lu,\"flash\":%lu,\"ratio\":%.2f},"
+                  "\"throughput\":{\"sustained_Bps\":%.0f,\"program_Bps\":%.0f},",
+               (unsigned long)s.rawBytes, (unsigned long)s.encodedBytes,
+               (unsigned long)s.flashBytes,
+               s.encodedBytes ? (float)s.rawBytes / s.encodedBytes : 0.0f,
+               secs > 0 ? s.flashBytes / secs : 0.0f,
+               s.writeUsTotal ? s.flashBytes * 1e6f / s.writeUsTotal : 0.0f);
+    jsonAppend(o, "\"write_us\":{\"n\":%lu,\"mean\":%lu,\"max\":%lu},"
+                  "\"erase_us\":{\"n\":%lu,\"mean\":%lu,\"max\":%lu,\"pre\":%lu},"
+                  "\"erase_count_max\":%lu,\"torn\":%lu,",
+               (unsigned long)s.writes,
+               (unsigned long)(s.writes ? s.writeUsTotal / s.writes : 0),
+               (unsigned long)s.writeUsMax, (unsigned long)s.erases,
+               (unsigned long)(s.erases ? s.eraseUsTotal / s.erases : 0),
+               (unsigned long)s.eraseUsMax, (unsigned long)s.preErases,
+               (unsigned long)s.eraseCountMax, (unsigned long)s.tornRecords);
+    jsonAppend(o, "\"encode\":{\"encoding\":\"%s\",\"cycles_per_sample\":%lu},",
+               bsEncodingName(LOG_ENCODING),
+               (unsigned long)(s.encodedSamples ? s.encodeCycles / s.encodedSamples : 0));
+    jsonAppend(o, "\"pyramid\":{\"base\":%u,\"summaries\":%lu,\"bytes\":%lu,"
+                  "\"cycles_per_sample\":%lu},",
+               BS_PYRAMID_BASE, (unsigned long)s.summaries, (unsigned long)s.summaryBytes,
+               (unsigned long)(s.encodedSamples ? s.pyramidCycles / s.encodedSamples : 0));
+    jsonAppend(o, "\"sampler\":{\"gap_us_max\":%lu,\"late\":%lu,\"nominal_us\":%lu}}",
+               (unsigned long)s.gapUsMax, (unsigned long)s.lateSamples,
+               (unsigned long)(1000000 / LOG_SAMPLE_HZ));
+    return o.len;
+}
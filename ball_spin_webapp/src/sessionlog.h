@@ -0,0 +1,165 @@
+/**
+ * On-device session log in the raw "sessions" flash partition
+ *
+ * Samples and shot records are appended to a circular, log-structured
+ * store of 4 KB flash sectors so a session survives without a laptop
+ * attached. The sampling path only copies a fixed-size sample into an
+ * internal-SRAM ring; a "logwriter" task on core 0 drains the ring into
+ * ball session chunks (lib/ballsession, delta + zigzag varint columns)
+ * and does all erase/program work, so encoding and waiting on the flash
+ * stay out of the loop.
+ *
+ * That does not keep flash time off the sampler: an erase or program
+ * turns the flash cache off on both cores, and the loop (flash-resident
+ * Arduino / M5 code on core 1, polling the IMU) cannot run until it is
+ * back on. A 4 KB sector erase takes tens of ms, so each one loses
+ * several 5 ms samples; a program of one record costs well under one.
+ * GET /log's sampler "gap_us_max" and "late" are the measurement.
+ *
+ * Layout (little endian):
+ *   sector  = LogSectorHeader, then records until erased (0xFF) space
+ *   record  = LogRecordHeader + payload, padded to 4 bytes
+ *   session = LOG_SESSION_START (BsFileHeader), (LOG_CHUNK | LOG_SUMMARY)*,
+ *             LOG_SESSION_END
+ *
+ * A session's records are the session file minus its index, so export
+ * copies chunks as they are and rebuilds the index on the fly. The
+ * writer also keeps the session's summary pyramid (bspyramid.h) up to
+ * date and stores completed buckets in LOG_SUMMARY records, all levels
+ * interleaved in completion order; export writes them out level by level
+ * as the file's pyramid section, so an overview of a long session never
+ * needs the samples.
+ *
+ * Power-loss safety: every sector header and record carries a CRC32.
+ * On mount the sector with the highest sequence number is the head; its
+ * records are scanned up to the first erased or corrupt header and a
+ * torn tail is abandoned by continuing in the next sector.
+ *
+ * Wear: sectors are used strictly round-robin, so erases are spread
+ * evenly over the partition; each header carries the sector's erase
+ * count. The next sector is pre-erased once the head is half full, so
+ * the writer never waits on an erase at a sector switch (the sampler
+ * stall is the same, it only happens mid-sector).
+ *
+ * Stored sessions are read back with a cursor (replay, export): the
+ * sector holding a session's start is found by binary search over the
+ * sector headers, then records are walked in sequence order. Reads go
+ * through the partition API like the writer's, so they may run in any
+ * task; a cursor stops at the live tail of the log or at a sector that
+ * has been recycled underneath it.
+ *
+ * Readers in other tasks take the head (sector, seq) from one atomic
+ * the writer publishes after each sector switch, and check a cursor's
+ * sector header once when entering it; after that the head alone tells
+ * whether the writer has come round to the sector.
+ *
+ * GET /log reports throughput, compression and the worst-case stall;
+ * GET /sessions lists the sessions still on flash from a summary table
+ * the writer task keeps: filled after mount by a scan of the log in
+ * slices between its drains ("scanning" until done), then updated with
+ * every record it appends. Serving it reads no flash.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ballsession.h"
+
+static const uint32_t LOG_SECTOR_MAGIC = 0x474F4C59;  // "YLOG"
+static const uint32_t LOG_SECTOR_SIZE  = 4096;
+static const uint8_t  LOG_PARTITION_SUBTYPE = 0x40;   // see partitions.csv
+
+// Fixed-point scales of the logged samples (BsFileHeader defaults; raw
+// count builds log the IMU's counts instead, see imusample.h)
+static const int LOG_ACCEL_PER_G   = 1000;   // mg
+static const int LOG_GYRO_PER_DPS  = 10;     // 0.1 deg/s
+static const int LOG_QUAT_ONE      = 16384;  // Q14
+static const int LOG_SAMPLE_HZ     = 200;
+
+enum LogRecordType : uint8_t {
+    LOG_SESSION_START = 1,  // BsFileHeader
+    LOG_CHUNK         = 2,  // one ball session chunk (samples + shots)
+    LOG_SESSION_END   = 3,  // LogSessionEnd
+    LOG_SUMMARY       = 4,  // LogSummaryHeader + BsSummary[count]
+};
+
+struct LogSectorHeader {
+    uint32_t magic;
+    uint32_t seq;         // increases by one per sector written
+    uint32_t eraseCount;
+    uint32_t session;     // session open when the sector was started
+    uint32_t crc;         // CRC32 of the fields above
+};
+
+struct LogRecordHeader {
+    uint8_t  type;        // LogRecordType; 0xFF = erased, end of sector
+    uint8_t  flags;
+    uint16_t len;         // payload bytes, excluding padding
+    uint32_t crc;         // CRC32 of type/flags/len + payload
+};
+
+struct LogSessionEnd {
+    uint32_t session;
+    uint32_t samples;
+    uint32_t shots;
+    uint32_t endMs;
+};
+
+struct LogSummaryHeader {
+    uint32_t session;
+    uint16_t base;        // pyramid base (samples per level-0 bucket)
+    uint16_t count;
+};
+
+// Mounts the partition and starts the writer task; false if no partition
+bool logBegin();
+
+// Sampling path: copies one sample into the ring, never touches flash
+void logPushSample(const BsSample &s);
+
+// Queues a shot, stored in the chunk holding the samples pushed before it
+void logPushShot(const BsShot &shot);
+
+// Closes the current session (if any) and opens a new one
+void logNewSession(uint32_t nowMs);
+
+// Blocks until everything queued so far is on flash (or timeoutMs)
+bool logFlush(uint32_t timeoutMs);
+
+// Read position in one stored session
+struct LogCursor {
+    BsFileHeader header;  // from the session's LOG_SESSION_START
+    uint32_t session;
+    uint32_t sector;
+    uint32_t seq;         // sequence number the sector must still carry
+    uint32_t offset;      // next record within the sector
+    bool     started;
+    bool     done;
+};
+
+// Positions c after the session's start record (c.header); false when
+// the session is not (or no longer) on flash
+bool logOpenSession(LogCursor &c, uint32_t session);
+
+// Next record of the session (LOG_CHUNK, LOG_SUMMARY, LOG_SESSION_END):
+// payload into buf (up to cap bytes), length in len. Returns 0 after the
+// session's last record: its end record, the start of the next session,
+// the tail of the log or a sector recycled by the writer. With only set,
+// records of other types are stepped over without reading their payload
+// (the end record is still returned).
+uint8_t logNextRecord(LogCursor &c, uint8_t* buf, size_t cap, uint16_t &len, uint8_t only = 0);
+
+// Largest record payload logNextRecord can return
+size_t logRecordMax();
+
+// Writes the /sessions JSON document (sessions still on flash, from the
+// writer's table); returns bytes
+size_t logSessionsJson(char* buf, size_t size);
+
+// Bytes of static ring storage (memory budget report)
+size_t logMemBytes();
+
+// Writes the /log JSON document; returns bytes written
+size_t logToJson(char* buf, size_t size);
+
@@ -0,0 +1,154 @@
+/**
+ * Running session aggregates - see sessionstats.h
+ */
+
+#include "sessionstats.h"
+#include "bspipeline.h"
+#include "jsonout.h"
+#include <math.h>
+#include <string.h>
+
+struct TypeStats {
+    uint32_t n;
+    float    rpmSum, rpmMax;
+    float    gSum, gMax;
+    uint16_t rpmHist[STATS_RPM_BINS];
+    uint16_t gHist[STATS_G_BINS];
+};
+
+static TypeStats typeStats[BS_SPIN_TYPES];
+static uint16_t  axisHist[STATS_THETA_BINS][STATS_PHI_BINS];
+static uint32_t  axisNone;                    // shots without an axis (|gyro| < 1 deg/s)
+static uint16_t  rateBins[STATS_RATE_BINS];   // ring, indexed by session minute
+static uint32_t  rateLastMin;                 // newest minute held
+static uint32_t  startMs;
+static uint32_t  shotTotal;
+static uint32_t  frameCount;
+static double    frameRpmSum;                 // hours of 50Hz frames: float would stall
+static float     frameRpmMax;
+
+// ==================== Helpers ====================
+
+static inline void bump(uint16_t &c) {
+    if (c != 0xFFFF) c++;
+}
+
+static inline int binOf(float v, float lo, float width, int bins) {
+    if (v < lo) return 0;
+    int b = (int)((v - lo) / width);
+    return b >= bins ? bins - 1 : b;
+}
+
+// Moves the ring forward to minute m, clearing the minutes skipped
+static void rateAdvance(uint32_t m) {
+    if (m <= rateLastMin) return;
+    if (m - rateLastMin >= (uint32_t)STATS_RATE_BINS) {
+        memset(rateBins, 0, sizeof(rateBins));
+    } else {
+        for (uint32_t k = rateLastMin + 1; k <= m; k++) rateBins[k % STATS_RATE_BINS] = 0;
+    }
+    rateLastMin = m;
+}
+
+// ==================== Recording ====================
+
+size_t statsMemBytes() {
+    return sizeof(typeStats) + sizeof(axisHist) + sizeof(rateBins);
+}
+
+void statsReset(uint32_t nowMs) {
+    memset(typeStats, 0, sizeof(typeStats));
+    memset(axisHist, 0, sizeof(axisHist));
+    memset(rateBins, 0, sizeof(rateBins));
+    axisNone = 0;
+    rateLastMin = 0;
+    startMs = nowMs;
+    shotTotal = 0;
+    frameCount = 0;
+    frameRpmSum = 0.0;
+    frameRpmMax = 0.0f;
+}
+
+void statsAddShot(uint32_t tMs, float rpm, float peakG, float gx, float gy, float gz) {
+    // Same classification as the shot's label (bsDetect)
+    TypeStats &t = typeStats[bsSpinType(gx, gy, gz, rpm)];
+    t.n++;
+    t.rpmSum += rpm;
+    t.gSum += peakG;
+    if (rpm > t.rpmMax) t.rpmMax = rpm;
+    if (peakG > t.gMax) t.gMax = peakG;
+    bump(t.rpmHist[binOf(rpm, 0.0f, STATS_RPM_BIN, STATS_RPM_BINS)]);
+    bump(t.gHist[binOf(peakG, STATS_G_MIN, 1.0f, STATS_G_BINS)]);
+
+    // Spin axis as spin_analysis.calc_spin_axis
+    float omega = sqrtf(gx * gx + gy * gy + gz * gz);
+    if (omega < 1.0f) {
+        axisNone++;
+    } else {
+        float c = gz / omega;
+        if (c > 1.0f) c = 1.0f;
+        if (c < -1.0f) c = -1.0f;
+        float theta = acosf(c) * (float)(180.0 / M_PI);
+        float phi = atan2f(gy, gx) * (float)(180.0 / M_PI);
+        if (phi < 0.0f) phi += 360.0f;
+        bump(axisHist[binOf(theta, 0.0f, 180.0f / STATS_THETA_BINS, STATS_THETA_BINS)]
+                     [binOf(phi, 0.0f, 360.0f / STATS_PHI_BINS, STATS_PHI_BINS)]);
+    }
+
+    // Impact just before a reset counts in the first minute
+    uint32_t m = (int32_t)(tMs - startMs) > 0 ? (tMs - startMs) / 60000 : 0;
+    rateAdvance(m);
+    if (m + STATS_RATE_BINS > rateLastMin) bump(rateBins[m % STATS_RATE_BINS]);
+    shotTotal++;
+}
+
+void statsAddFrame(float rpm) {
+    frameCount++;
+    frameRpmSum += rpm;
+    if (rpm > frameRpmMax) frameRpmMax = rpm;
+}
+
+// ==================== Report ====================
+
+static void appendCounts(JsonOut &o, const uint16_t* c, int n) {
+    jsonAppend(o, "[");
+    for (int i = 0; i < n; i++) jsonAppend(o, i ? ",%u" : "%u", (unsigned)c[i]);
+    jsonAppend(o, "]");
+}
+
+size_t statsToJson(char* buf, size_t size, uint32_t nowMs, bool asEvent) {
+    rateAdvance((nowMs - startMs) / 60000);
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, asEvent ? "{\"event\":\"stats\"," : "{");
+    jsonAppend(o, "\"seconds\":%.1f,\"shots\":%lu,\"frames\":%lu,\"avg_rpm\":%.1f,\"max_rpm\":%.0f,",
+               (nowMs - startMs) / 1000.0f, (unsigned long)shotTotal, (unsigned long)frameCount,
+               frameCount ? frameRpmSum / frameCount : 0.0, frameRpmMax);
+    jsonAppend(o, "\"rpm_bin\":%.0f,\"g_min\":%.0f,\"g_bin\":1,\"types\":[", STATS_RPM_BIN, STATS_G_MIN);
+    for (int k = 0; k < BS_SPIN_TYPES; k++) {
+        const TypeStats &t = typeStats[k];
+        jsonAppend(o, "%s{\"type\":\"%s\",\"n\":%lu", k ? "," : "", bsSpinName(k), (unsigned long)t.n);
+        if (t.n) {
+            jsonAppend(o, ",\"rpm_mean\":%.0f,\"rpm_max\":%.0f,\"g_mean\":%.1f,\"g_max\":%.1f,\"rpm_hist\":",
+                       t.rpmSum / t.n, t.rpmMax, t.gSum / t.n, t.gMax);
+            appendCounts(o, t.rpmHist, STATS_RPM_BINS);
+            jsonAppend(o, ",\"g_hist\":");
+            appendCounts(o, t.gHist, STATS_G_BINS);
+        }
+        jsonAppend(o, "}");
+    }
+    // Axis: one row of phi bins per theta bin
+    jsonAppend(o, "],\"axis\":{\"theta_bin\":%d,\"phi_bin\":%d,\"none\":%lu,\"counts\":[",
+               180 / STATS_THETA_BINS, 360 / STATS_PHI_BINS, (unsigned long)axisNone);
+    for (int i = 0; i < STATS_THETA_BINS; i++) {
+        if (i) jsonAppend(o, ",");
+        appendCounts(o, axisHist[i], STATS_PHI_BINS);
+    }
+    // Rate: oldest minute held first, the current (partial) minute last
+    uint32_t first = rateLastMin + 1 >= (uint32_t)STATS_RATE_BINS ? rateLastMin + 1 - STATS_RATE_BINS : 0;
+    jsonAppend(o, "]},\"rate\":{\"bin_s\":60,\"first_min\":%lu,\"per_min\":[", (unsigned long)first);
+    for (uint32_t m = first; m <= rateLastMin; m++) {
+        jsonAppend(o, m > first ? ",%u" : "%u", (unsigned)rateBins[m % STATS_RATE_BINS]);
+    }
+    jsonAppend(o, "]}}");
+    return o.len;
+}
@@ -0,0 +1,49 @@
+/**
+ * Running session aggregates
+ *
+ * Updated as the session goes, O(1) per shot and per 50Hz frame, so a
+ * dashboard gets the whole session's summary at once instead of
+ * recomputing it from every shot and frame it has received (or missed,
+ * when it connected late):
+ *
+ *   per spin type   shots, RPM / peak G mean and max, RPM histogram
+ *                   (50 RPM bins) and peak G histogram (1 g bins from 4 g)
+ *   spin axis       polar histogram of the shots' gyro direction, 15 deg
+ *                   bins of theta (from +Z, 0..180) x phi (0..360), the
+ *                   angles spin_analysis.py computes per shot
+ *   shot rate       shots per minute of the session, last STATS_RATE_BINS
+ *   frames          50Hz frames, their RPM mean and max (the observer's
+ *                   session avg_rpm / max_rpm)
+ *
+ * Reset with the session (clear_shots). Served on GET /stats and as
+ * {"event":"stats",...} in reply to the WebSocket command "stats".
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const int   STATS_RPM_BINS   = 20;     // 50 RPM each, last = 950+
+static const float STATS_RPM_BIN    = 50.0f;
+static const int   STATS_G_BINS     = 13;     // 1 g each from 4 g, last = 16 g+
+static const float STATS_G_MIN      = 4.0f;   // bsDetect's impact threshold
+static const int   STATS_THETA_BINS = 12;     // 15 deg
+static const int   STATS_PHI_BINS   = 24;     // 15 deg
+static const int   STATS_RATE_BINS  = 60;     // minutes
+
+// New session starting at nowMs
+void statsReset(uint32_t nowMs);
+
+// A recorded shot: impact time, peaks and filtered gyro vector (deg/s)
+void statsAddShot(uint32_t tMs, float rpm, float peakG, float gx, float gy, float gz);
+
+// A 50Hz frame's display RPM
+void statsAddFrame(float rpm);
+
+// Bytes of static aggregate storage (memory budget report)
+size_t statsMemBytes();
+
+// Writes the /stats JSON document (asEvent: the WebSocket "stats" event);
+// returns bytes written (truncated if buf too small)
+size_t statsToJson(char* buf, size_t size, uint32_t nowMs, bool asEvent);
@@ -48,6 +48,8 @@ body{background:#0a0e27;color:#fff;font-family:system-ui,-apple-system,sans-seri
 .btn:active{opacity:.7}
 .btn-rec{background:#c0392b}.btn-rec.active{animation:pulse 1s infinite}
 .btn-exp{background:#2563EB}.btn-rst{background:#555}.btn-clr{background:#d97706}
+.btn-rp{background:#0d9488}.rp-sel{background:#222;color:#ddd;border:1px solid #444;border-radius:6px;padding:5px;font-size:.75rem}
+.rp-info{font-size:.72rem;color:#999}
 .rec-info{font-size:.75rem;color:#FF4444;display:flex;align-items:center;gap:5px}
 .rec-dot{width:7px;height:7px;background:#FF4444;border-radius:50%;display:inline-block}
 @keyframes pulse{0%,100%{opacity:1}50%{opacity:.5}}
@@ -57,6 +59,7 @@ body{background:#0a0e27;color:#fff;font-family:system-ui,-apple-system,sans-seri
 .stat-box{background:#111633;border-radius:10px;padding:12px;text-align:center}
 .stat-val{font-size:1.6rem;font-weight:700;color:#C8D820;font-family:'Courier New',monospace}
 .stat-lbl{font-size:.65rem;color:#667788;margin-top:2px;text-transform:uppercase;letter-spacing:1px}
+.stat-types{font-size:.7rem;color:#667788;margin:-6px 0 12px;text-align:center}
 .timeline-scroll{overflow-x:auto;padding:8px 0}
 .timeline-bar{position:relative;height:80px;min-width:100%;background:#111633;border-radius:10px}
 .shot-mark{position:absolute;bottom:0;width:40px;transform:translateX(-20px);cursor:pointer;text-align:center;transition:opacity .2s}
@@ -139,6 +142,13 @@ body{background:#0a0e27;color:#fff;font-family:system-ui,-apple-system,sans-seri
 <button class="btn btn-rst" onclick="resetBall()">Reset</button>
 <button class="btn btn-clr" onclick="clearShots()">Clear</button>
 </div>
+<div class="ctrl-bar">
+<select class="rp-sel" id="rpSel"></select>
+<select class="rp-sel" id="rpSpeed"><option value="1">1x</option><option value="4">4x</option><option value="16">16x</option><option value="0">max</option></select>
+<button class="btn btn-rp" id="btnReplay" onclick="toggleReplay()">Replay</button>
+<button class="btn btn-exp" onclick="downloadSession()">CSV</button>
+<span class="rp-info" id="rpInfo"></span>
+</div>
 </div>
 </div>
 <div class="col">
@@ -205,6 +215,7 @@ body{background:#0a0e27;color:#fff;font-family:system-ui,-apple-system,sans-seri
 <div class="stat-box"><div class="stat-val" id="stMax">0</div><div class="stat-lbl">Max RPM</div></div>
 <div class="stat-box"><div class="stat-val" id="stG">0</div><div class="stat-lbl">Max G</div></div>
 </div>
+<div class="stat-types" id="stTypes"></div>
 <div class="timeline-scroll"><div class="timeline-bar" id="timelineBar"></div></div>
 <div class="shot-detail" id="shotDetail">
 <h3 id="sdTitle">Shot #1</h3>
@@ -324,15 +335,38 @@ if(agy>agx&&agy>agz)return'SIDESPIN';
 return'GYRO';
 }
 
+/* Latency: NTP-style offset from ping/pong, keep the min-RTT sample of the last 8 */
+let clkOff=null,pongs=[],latN=0,lastSeq=-1,lastTs=0,lastRx=-1,drawPending=false;
+function devNow(){return performance.now()*1000+clkOff;}
+function latUs(ts){const v=(Math.round(devNow())-ts)>>>0;return v>2147483647?-1:v;}
+function sendPing(){if(ws&&ws.readyState===1)ws.send('ping '+Math.round(performance.now()*1000));}
+function onPong(d){
+const now=performance.now()*1000,rtt=now-d.c;
+pongs.push({rtt,off:d.d-(d.c+now)/2});if(pongs.length>8)pongs.shift();
+clkOff=pongs.reduce((a,b)=>b.rtt<a.rtt?b:a).off;
+}
+function reportLat(){
+if(clkOff===null||lastSeq<0||!drawPending)return;
+drawPending=false;
+if(++latN%5)return;
+if(ws&&ws.readyState===1)ws.send('lat '+lastSeq+' '+lastRx+' '+latUs(lastTs));
+}
+setInterval(sendPing,2000);
+
 /* WebSocket */
 function connectWS(){
 try{ws=new WebSocket('ws://'+window.location.hostname+':81');}catch(e){setTimeout(connectWS,2000);return;}
-ws.onopen=()=>{connected=true;sDot.className='conn-dot on';sTxt.textContent='Connected';};
+ws.onopen=()=>{connected=true;sDot.className='conn-dot on';sTxt.textContent='Connected';pongs=[];clkOff=null;for(let i=0;i<4;i++)setTimeout(sendPing,i*100);loadSessions();ws.send('stats');};
 ws.onclose=()=>{connected=false;sDot.className='conn-dot off';sTxt.textContent='Disconnected';setTimeout(connectWS,2000);};
 ws.onerror=()=>{ws.close();};
 ws.onmessage=e=>{
 try{
 const d=JSON.parse(e.data);
+if(d.event==='pong'){onPong(d);return;}
+if(d.event==='replay'){onReplay(d);return;}
+if(d.event==='stats'){onStats(d);return;}
+if(d.event&&d.event!=='shot')return;
+if(d.ts!=null&&clkOff!==null){lastSeq=d.seq;lastTs=d.ts;lastRx=latUs(d.ts);drawPending=true;}
 ax=d.ax||0;ay=d.ay||0;az=d.az||0;
 gx=d.gx||0;gy=d.gy||0;gz=d.gz||0;
 quat={w:d.qw||1,x:d.qx||0,y:d.qy||0,z:d.qz||0};
@@ -356,7 +390,7 @@ eulerR=Math.atan2(sinr,cosr)*180/Math.PI;
 }
 if(d.imp===1){impactFlash.classList.add('active');setTimeout(()=>impactFlash.classList.remove('active'),150);}
 if(d.spin){spinType.textContent=d.spin;spinType.className='spin-label spin-'+d.spin;}
-if(d.event==='shot'){shots.push(d);if(shots.length===1)firstShotTime=d.t;updateTimeline();updateTlDots();}
+if(d.event==='shot'){shots.push(d);if(shots.length===1)firstShotTime=d.t;updateTimeline();updateTlDots();if(!replaying)ws.send('stats');}
 }catch(err){}
 };
 }
@@ -620,6 +654,7 @@ total.textContent=shots.length;
 avgEl.textContent=Math.round(sumR/shots.length);
 maxEl.textContent=Math.round(mxR);
 maxGEl.textContent=mxG.toFixed(1);
+if(devStats&&!replaying&&devStats.shots>=shots.length)showStats();
 
 const timeSpan=Math.max(shots[shots.length-1].t-firstShotTime,1000);
 const barW=Math.max(shots.length*50,bar.parentElement.clientWidth);
@@ -638,6 +673,22 @@ bar.appendChild(mk);
 updateTlDots();
 }
 
+/* Session totals from the device (GET /stats, "stats"): the whole session,
+   also the shots from before this page connected */
+let devStats=null;
+function onStats(d){devStats=d;if(!replaying)showStats();}
+function showStats(){
+const d=devStats;let n=0,sumR=0,mxR=0,mxG=0;
+d.types.forEach(t=>{if(!t.n)return;n+=t.n;sumR+=t.rpm_mean*t.n;if(t.rpm_max>mxR)mxR=t.rpm_max;if(t.g_max>mxG)mxG=t.g_max;});
+document.getElementById('stTotal').textContent=d.shots;
+document.getElementById('stAvg').textContent=n?Math.round(sumR/n):0;
+document.getElementById('stMax').textContent=Math.round(mxR);
+document.getElementById('stG').textContent=mxG.toFixed(1);
+const pm=d.rate.per_min,last=pm.length?pm[pm.length-1]:0;
+document.getElementById('stTypes').innerHTML=d.types.filter(t=>t.n).map(t=>'<span class="spin-'+t.type+'">'+t.type+' '+t.n+'</span>').join(' &middot; ')+
+(d.shots?' &middot; '+last+' this min':'');
+}
+
 function showShotDetail(idx){
 const s=shots[idx];
 const detail=document.getElementById('shotDetail');
@@ -688,7 +739,36 @@ function clearShots(){
 shots=[];firstShotTime=0;
 updateTimeline();
 document.getElementById('shotDetail').classList.remove('show');
-if(ws&&ws.readyState===1)ws.send('clear_shots');
+if(ws&&ws.readyState===1){ws.send('clear_shots');ws.send('stats');}
+}
+
+/* Session replay from the device flash log */
+let replaying=false;
+function loadSessions(){
+fetch('/sessions').then(r=>r.json()).then(j=>{
+const sel=document.getElementById('rpSel');sel.innerHTML='';
+j.sessions.forEach(s=>{const o=document.createElement('option');o.value=s.id;
+o.textContent='#'+s.id+(s.id===j.current?' (now)':'')+' '+s.seconds.toFixed(0)+'s '+s.shots+' shots';sel.appendChild(o);});
+}).catch(()=>{});
+}
+function toggleReplay(){
+if(!ws||ws.readyState!==1)return;
+if(replaying){ws.send('replay stop');return;}
+const id=document.getElementById('rpSel').value;
+if(id)ws.send('replay '+id+' '+document.getElementById('rpSpeed').value);
+}
+function downloadSession(){
+const id=document.getElementById('rpSel').value;
+if(!id)return;
+const a=document.createElement('a');a.href='/export?session='+id+'&format=csv';a.download='session_'+id+'.csv';a.click();
+}
+function onReplay(d){
+const info=document.getElementById('rpInfo');
+replaying=d.state==='start';
+document.getElementById('btnReplay').textContent=replaying?'Stop':'Replay';
+if(replaying){shots=[];firstShotTime=0;updateTimeline();info.textContent='replaying #'+d.session;}
+else if(d.state==='error')info.textContent='#'+d.session+': '+d.error;
+else{info.textContent='#'+d.session+': '+d.samples+' samples, '+d.samples_per_s+'/s';loadSessions();}
 }
 
 /* Raw data toggle & drawing */
@@ -808,6 +888,7 @@ drawBall();
 drawGauge();
 drawRpmChart();
 drawRawData();
+reportLat();
 if(!connected)spinType.textContent=classifySpin(gx,gy,gz);
 const me=document.getElementById('mRpmVal');
 if(me)me.textContent=Math.round(rpm);
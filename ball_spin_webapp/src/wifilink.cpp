@@ -0,0 +1,174 @@
+/**
+ * WiFi link - see wifilink.h
+ */
+
+#include "wifilink.h"
+#include "jsonout.h"
+#include <Arduino.h>
+#include <ESPmDNS.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <string.h>
+
+#ifndef STA_SSID
+#define STA_SSID ""
+#endif
+#ifndef STA_PASS
+#define STA_PASS ""
+#endif
+
+extern const char* AP_SSID;   // main.cpp
+extern const char* AP_PASS;
+
+static const uint32_t WIFI_JOIN_MS    = 10000;   // station join before falling back to the AP
+static const uint32_t WIFI_POLL_MS    = 100;
+static const uint16_t WIFI_WS_PORT    = 81;
+static const uint16_t WIFI_HTTP_PORT  = 80;
+
+static char     ballId[16];
+static char     staSsid[33];
+static char     staPass[65];
+static uint8_t  linkMode = WIFI_LINK_AP;
+static bool     joining = false;
+static bool     staUp = false;
+static bool     fellBack = false;        // station configured but not joined: running the AP
+static bool     mdnsUp = false;
+static uint32_t joinStartMs = 0;
+static uint32_t joinMs = 0;              // last successful join
+static uint32_t lastPollMs = 0;
+static uint32_t drops = 0;               // station link lost after joining
+
+// ==================== Setup ====================
+
+static void makeId() {
+    if (ballId[0]) return;
+    uint64_t mac = ESP.getEfuseMac();    // byte 0 of the MAC in the low byte
+    snprintf(ballId, sizeof(ballId), "ball-%02x%02x%02x",
+             (unsigned)((mac >> 24) & 0xFF), (unsigned)((mac >> 32) & 0xFF), (unsigned)((mac >> 40) & 0xFF));
+}
+
+static void loadCredentials() {
+    Preferences prefs;
+    staSsid[0] = staPass[0] = '\0';
+    if (prefs.begin("wifi", true)) {
+        prefs.getString("ssid", staSsid, sizeof(staSsid));
+        prefs.getString("pass", staPass, sizeof(staPass));
+        bool stored = prefs.isKey("ssid");
+        prefs.end();
+        if (stored) return;              // stored empty: AP mode chosen explicitly
+    }
+    strncpy(staSsid, STA_SSID, sizeof(staSsid) - 1);
+    strncpy(staPass, STA_PASS, sizeof(staPass) - 1);
+}
+
+static void startMdns() {
+    if (mdnsUp || !MDNS.begin(ballId)) return;
+    MDNS.addService("yotb", "tcp", WIFI_WS_PORT);
+    MDNS.addServiceTxt("yotb", "tcp", "id", ballId);
+    MDNS.addServiceTxt("yotb", "tcp", "http", "80");
+    MDNS.addServiceTxt("yotb", "tcp", "mode", linkMode == WIFI_LINK_STA ? "sta" : "ap");
+    MDNS.addService("http", "tcp", WIFI_HTTP_PORT);
+    mdnsUp = true;
+}
+
+static void stopMdns() {
+    if (!mdnsUp) return;
+    MDNS.end();
+    mdnsUp = false;
+}
+
+static void startAp() {
+    WiFi.mode(WIFI_AP);
+    WiFi.softAP(AP_SSID, AP_PASS);
+    linkMode = WIFI_LINK_AP;
+    startMdns();
+}
+
+void wifiLinkStart() {
+    makeId();
+    loadCredentials();
+    joining = staUp = fellBack = false;
+    if (!staSsid[0]) {
+        startAp();
+        return;
+    }
+    WiFi.mode(WIFI_STA);
+    WiFi.setHostname(ballId);
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(staSsid, staPass);
+    linkMode = WIFI_LINK_STA;
+    joining = true;
+    joinStartMs = millis();
+}
+
+void wifiLinkPoll(uint32_t nowMs) {
+    if (linkMode != WIFI_LINK_STA || nowMs - lastPollMs < WIFI_POLL_MS) return;
+    lastPollMs = nowMs;
+    bool up = WiFi.status() == WL_CONNECTED;
+    if (joining) {
+        if (up) {
+            joining = false;
+            staUp = true;
+            joinMs = nowMs - joinStartMs;
+            startMdns();
+        } else if (nowMs - joinStartMs > WIFI_JOIN_MS) {
+            joining = false;
+            fellBack = true;
+            WiFi.disconnect(true);
+            startAp();
+        }
+        return;
+    }
+    // Auto-reconnect rejoins; mDNS follows the new address by itself
+    if (staUp && !up) drops++;
+    staUp = up;
+}
+
+void wifiLinkStop() {
+    stopMdns();
+    if (linkMode == WIFI_LINK_AP) WiFi.softAPdisconnect(true);
+    else WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    joining = staUp = false;
+}
+
+bool wifiLinkConfigure(const char* ssid, const char* pass) {
+    if (strlen(ssid) >= sizeof(staSsid) || strlen(pass) >= sizeof(staPass)) return false;
+    Preferences prefs;
+    if (!prefs.begin("wifi", false)) return false;
+    bool ok = prefs.putString("ssid", ssid) == strlen(ssid) && prefs.putString("pass", pass) == strlen(pass);
+    prefs.end();
+    return ok;
+}
+
+// ==================== Status ====================
+
+const char* wifiLinkId() { return ballId; }
+
+uint8_t wifiLinkMode() { return linkMode; }
+
+const char* wifiLinkSsid() { return linkMode == WIFI_LINK_STA ? staSsid : AP_SSID; }
+
+void wifiLinkIp(char* buf, size_t size) {
+    String ip = linkMode == WIFI_LINK_STA ? WiFi.localIP().toString() : WiFi.softAPIP().toString();
+    snprintf(buf, size, "%s", ip.c_str());
+}
+
+size_t wifiLinkToJson(char* buf, size_t size) {
+    char ip[16];
+    wifiLinkIp(ip, sizeof(ip));
+    JsonOut o = jsonBegin(buf, size);
+    jsonAppend(o, "{\"mode\":\"%s\",\"id\":\"%s\",\"host\":\"%s.local\",\"ssid\":",
+               linkMode == WIFI_LINK_STA ? "sta" : "ap", ballId, ballId);
+    jsonAppendString(o, wifiLinkSsid());   // set through /wifi?ssid=, may hold any character
+    jsonAppend(o, ",\"ip\":\"%s\"", ip);
+    jsonAppend(o, ",\"connected\":%s,\"joining\":%s,\"fallback\":%s,\"mdns\":%s",
+               linkMode == WIFI_LINK_AP || staUp ? "true" : "false", joining ? "true" : "false",
+               fellBack ? "true" : "false", mdnsUp ? "true" : "false");
+    if (linkMode == WIFI_LINK_STA) {
+        jsonAppend(o, ",\"rssi\":%d,\"join_ms\":%lu,\"drops\":%lu", staUp ? WiFi.RSSI() : 0,
+                   (unsigned long)joinMs, (unsigned long)drops);
+    }
+    jsonAppend(o, ",\"service\":\"_yotb._tcp\",\"ws_port\":%u}", WIFI_WS_PORT);
+    return o.len;
+}
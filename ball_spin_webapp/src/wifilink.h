@@ -0,0 +1,52 @@
+/**
+ * WiFi link: the ball's own access point, or a station on a shared network
+ *
+ * AP mode (the default) is the original setup: the ball is its own
+ * network ("TennisBall_IMU", 192.168.4.1), so a laptop watches one ball
+ * at a time. Station mode joins an existing network instead, so one
+ * observer can take the streams of many balls at once. To be found there
+ * every ball announces itself over mDNS under an id made from its MAC:
+ *
+ *   host     <id>.local                   id = "ball-" + last 3 MAC bytes
+ *   service  _yotb._tcp  port 81          the WebSocket stream
+ *            TXT id=<id> http=80 mode=sta|ap
+ *
+ * Station credentials come from NVS (GET /wifi?ssid=..&pass=.., applied
+ * on the restart that follows) or, with nothing stored, from the STA_SSID
+ * / STA_PASS build flags. If the network is not joined within
+ * WIFI_JOIN_MS the ball falls back to its own AP, so it stays reachable
+ * and can be reconfigured; a station link lost later reconnects by
+ * itself. mDNS runs in both modes.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum WifiLinkMode : uint8_t {
+    WIFI_LINK_AP = 0,
+    WIFI_LINK_STA,
+};
+
+// Brings the link up (setup, wake from sleep); station joins finish in wifiLinkPoll
+void wifiLinkStart();
+
+// Loop: station join timeout / fallback, mDNS once joined, link drops
+void wifiLinkPoll(uint32_t nowMs);
+
+// Radio off (before light sleep)
+void wifiLinkStop();
+
+// Stores station credentials for the next start; an empty ssid means AP mode
+bool wifiLinkConfigure(const char* ssid, const char* pass);
+
+const char* wifiLinkId();
+uint8_t     wifiLinkMode();
+const char* wifiLinkSsid();        // network joined (or being joined), else the AP's
+
+// Current address as text ("0.0.0.0" while joining)
+void wifiLinkIp(char* buf, size_t size);
+
+// Mode, id, network, address, signal, join time and drops
+size_t wifiLinkToJson(char* buf, size_t size);
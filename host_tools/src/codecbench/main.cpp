@@ -0,0 +1,279 @@
+/**
+ * codecbench - compression ratio and speed of the session codecs
+ *
+ * Usage:
+ *   codecbench [--chunk N] [--key N] in.ybs
+ *   codecbench [--chunk N] [--key N] --synthetic SECONDS [--rate HZ] [--full-scale G:DPS]
+ *
+ * Loads the samples, then for every chunk encoding (flash log, files)
+ * and for the per-sample stream codec (serial / WebSocket, delta and
+ * delta2) reports bytes per sample, the ratio against fixed-point raw
+ * samples, encode speed and decode speed in GB/s of decoded samples.
+ * Every round trip is checked against the input.
+ *
+ * --chunk is the samples per chunk (64 = the device flash log), --key
+ * the stream keyframe interval in samples. --full-scale synthesizes the
+ * raw counts of a sensor at that range (8:2000 = what a RAW_COUNTS ball
+ * logs) instead of the default mg / 0.1 deg/s.
+ */
+
+#include "bschunk.h"
+#include "bsstream.h"
+#include "sessionout.h"
+#include "sessionread.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: codecbench [--chunk N] [--key N] in.ybs\n"
+            "       codecbench [--chunk N] [--key N] --synthetic SECONDS [--rate HZ] [--full-scale G:DPS]\n");
+    exit(2);
+}
+
+static const double MIN_BENCH_SEC = 0.5;   // repeat decodes until this long
+
+static void onSample(void* ctx, const BsSample &s) {
+    ((std::vector<BsSample>*)ctx)->push_back(s);
+}
+static void onShot(void*, const BsShot &) {}
+
+static bool loadFile(const char* path, std::vector<BsSample> &out, uint16_t &columns) {
+    SessionReader r;
+    if (!sessionOpen(r, path)) {
+        fprintf(stderr, "%s: %s\n", path, r.error);
+        return false;
+    }
+    columns = r.header->columns;
+    SessionChunk c;
+    for (uint32_t i = 0; i < r.chunks; i++) {
+        if (!sessionLoadChunk(r, i, c)) {
+            fprintf(stderr, "%s: chunk %u is corrupt\n", path, i);
+            return false;
+        }
+        for (size_t k = 0; k < c.t.size; k++) {
+            BsSample s = {};
+            s.tUs = c.t[k];
+            for (int a = 0; a < 3; a++) if (!c.col[a].empty()) s.a[a] = c.col[a][k];
+            for (int a = 0; a < 3; a++) if (!c.col[3 + a].empty()) s.g[a] = c.col[3 + a][k];
+            for (int a = 0; a < 4; a++) if (!c.col[6 + a].empty()) s.q[a] = c.col[6 + a][k];
+            if (!c.flags.empty()) s.flags = c.flags[k];
+            out.push_back(s);
+        }
+    }
+    sessionClose(r);
+    return true;
+}
+
+static uint32_t rawSampleBytes(uint16_t columns) {
+    uint32_t n = 0;
+    for (int id = 0; id < BS_COL_COUNT; id++) {
+        if ((columns >> id) & 1) n += bsColumnWidth(id);
+    }
+    return n;
+}
+
+// Samples equal in the columns the codec carries
+static bool sameSample(const BsSample &a, const BsSample &b, uint16_t columns) {
+    if (a.tUs != b.tUs) return false;
+    for (int k = 0; k < 3; k++) {
+        if (((columns >> (BS_COL_AX + k)) & 1) && a.a[k] != b.a[k]) return false;
+        if (((columns >> (BS_COL_GX + k)) & 1) && a.g[k] != b.g[k]) return false;
+    }
+    for (int k = 0; k < 4; k++) {
+        if (((columns >> (BS_COL_QW + k)) & 1) && a.q[k] != b.q[k]) return false;
+    }
+    return !((columns >> BS_COL_FLAGS) & 1) || a.flags == b.flags;
+}
+
+static void report(const char* name, size_t bytes, size_t samples, uint32_t rawPer,
+                   double encSec, double decSec, int decReps, bool ok) {
+    double raw = (double)samples * rawPer;
+    printf("  %-14s %7.2f B/sample  %5.2fx  enc %7.1f MB/s  dec %6.2f GB/s  %s\n", name,
+           (double)bytes / samples, raw / bytes, raw / encSec / 1e6,
+           raw * decReps / decSec / 1e9, ok ? "ok" : "MISMATCH");
+}
+
+// ==================== Chunks ====================
+
+static bool benchChunks(const std::vector<BsSample> &in, uint16_t columns, uint16_t chunkSamples,
+                        uint8_t encoding) {
+    BsChunkBuilder b;
+    std::vector<uint64_t> store(bsChunkStorageBytes(chunkSamples, 0) / 8 + 1);
+    bsChunkInit(b, store.data(), chunkSamples, 0, columns);
+    size_t maxChunk = bsChunkMaxBytes(chunkSamples, 0, columns, encoding);
+    std::vector<uint8_t> out(maxChunk * (in.size() / chunkSamples + 1));
+    std::vector<size_t> offsets;
+
+    double t0 = hostSeconds();
+    size_t used = 0;
+    for (size_t i = 0; i < in.size(); i += chunkSamples) {
+        bsChunkReset(b, i);
+        size_t n = std::min<size_t>(chunkSamples, in.size() - i);
+        for (size_t k = 0; k < n; k++) bsChunkAdd(b, in[i + k]);
+        offsets.push_back(used);
+        used += bsChunkEncode(b, encoding, out.data() + used, maxChunk);
+    }
+    double encSec = hostSeconds() - t0;
+
+    // Decode every column of every chunk, repeated for a stable time
+    std::vector<int64_t> t(chunkSamples);
+    std::vector<int16_t> col(chunkSamples);
+    int reps = 0;
+    bool ok = true;
+    t0 = hostSeconds();
+    double decSec = 0;
+    while (decSec < MIN_BENCH_SEC) {
+        for (size_t off : offsets) {
+            const uint8_t* chunk = out.data() + off;
+            const BsColumnDesc* d = bsChunkColumns(chunk);
+            for (int k = 0; k < bsChunkHeader(chunk)->ncols; k++) {
+                ok &= bsChunkDecode(chunk, d[k], d[k].id == BS_COL_T ? (void*)t.data() : col.data());
+            }
+        }
+        reps++;
+        decSec = hostSeconds() - t0;
+    }
+
+    // Round trip check (not timed)
+    for (size_t c = 0; c < offsets.size() && ok; c++) {
+        const uint8_t* chunk = out.data() + offsets[c];
+        ok = bsChunkValid(chunk, out.size() - offsets[c]);
+        const BsColumnDesc* d = bsChunkColumns(chunk);
+        uint16_t count = bsChunkHeader(chunk)->count;
+        for (int k = 0; k < bsChunkHeader(chunk)->ncols && ok; k++) {
+            uint8_t id = d[k].id;
+            ok = bsChunkDecode(chunk, d[k], id == BS_COL_T ? (void*)t.data() : col.data());
+            for (uint16_t i = 0; i < count && ok; i++) {
+                const BsSample &s = in[c * chunkSamples + i];
+                int64_t want = id == BS_COL_T ? s.tUs : id == BS_COL_FLAGS ? (int16_t)s.flags
+                             : id < BS_COL_GX ? s.a[id - BS_COL_AX]
+                             : id < BS_COL_QW ? s.g[id - BS_COL_GX] : s.q[id - BS_COL_QW];
+                ok = (id == BS_COL_T ? t[i] : col[i]) == want;
+            }
+        }
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "chunk %s", bsEncodingName(encoding));
+    report(name, used, in.size(), rawSampleBytes(columns), encSec, decSec, reps, ok);
+    return ok;
+}
+
+// ==================== Stream ====================
+
+static bool benchStream(const std::vector<BsSample> &in, uint16_t columns, uint8_t order,
+                        uint16_t keyInterval) {
+    BsStreamEncoder e;
+    bsStreamInit(e, columns, order, keyInterval);
+    std::vector<uint8_t> out(in.size() * (BS_STREAM_MAX + 3));
+    std::vector<uint32_t> ends;
+    ends.reserve(in.size());
+
+    double t0 = hostSeconds();
+    size_t used = 0;
+    uint8_t packet[BS_STREAM_MAX];
+    for (const BsSample &s : in) {
+        size_t len = bsStreamEncode(e, s, packet);
+        used += bsFramePut(out.data() + used, packet, (uint8_t)len);
+        ends.push_back(used);
+    }
+    double encSec = hostSeconds() - t0;
+
+    // Packet decode (message boundaries known, as on a WebSocket)
+    BsStreamDecoder d;
+    BsSample s;
+    int reps = 0;
+    bool ok = true;
+    t0 = hostSeconds();
+    double decSec = 0;
+    while (decSec < MIN_BENCH_SEC) {
+        bsStreamDecoderInit(d);
+        size_t start = 0;
+        for (uint32_t end : ends) {
+            ok &= bsStreamDecode(d, out.data() + start + 2, end - start - 3, s);
+            start = end;
+        }
+        reps++;
+        decSec = hostSeconds() - t0;
+    }
+
+    // Framed decode (byte stream, as on a UART) doubles as the round trip check
+    BsFrameParser f;
+    bsFrameInit(f);
+    bsStreamDecoderInit(d);
+    size_t next = 0;
+    t0 = hostSeconds();
+    for (size_t i = 0; i < used; i++) {
+        const uint8_t* payload;
+        int len = bsFrameFeed(f, out[i], &payload);
+        if (len && bsStreamDecode(d, payload, len, s)) {
+            ok &= next < in.size() && sameSample(s, in[next], e.columns);
+            next++;
+        }
+    }
+    double framedSec = hostSeconds() - t0;
+    ok &= next == in.size() && d.lost == 0;
+
+    char name[32];
+    snprintf(name, sizeof(name), "stream %s", order == 2 ? "delta2" : "delta");
+    report(name, used, in.size(), rawSampleBytes(e.columns), encSec, decSec, reps, ok);
+    printf("  %-14s framed decode %.2f GB/s, %u keyframes\n", "",
+           (double)in.size() * rawSampleBytes(e.columns) / framedSec / 1e9, d.keyframes);
+    return ok;
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+    uint16_t chunkSamples = 64;
+    uint16_t keyInterval = 200;
+    double synthSeconds = 0;
+    uint16_t rate = 200;
+    int fsG = 0, fsDps = 0;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--chunk") && more)          chunkSamples = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--key") && more)       keyInterval = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--synthetic") && more) synthSeconds = atof(argv[++i]);
+        else if (!strcmp(a, "--rate") && more)      rate = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--full-scale") && more) {
+            if (sscanf(argv[++i], "%d:%d", &fsG, &fsDps) != 2 || fsG <= 0 || fsDps <= 0) usage();
+        }
+        else if (a[0] == '-' || path)               usage();
+        else                                        path = a;
+    }
+    if (chunkSamples == 0 || (!path == !(synthSeconds > 0))) usage();
+
+    std::vector<BsSample> samples;
+    uint16_t columns = BS_COLS_ALL;
+    if (path) {
+        if (!loadFile(path, samples, columns)) return 1;
+    } else {
+        BsFileHeader h;
+        bsFileHeaderInit(h, 0, rate, columns, "synthetic");
+        if (fsG) bsFileHeaderSetFullScale(h, (uint16_t)fsG, (uint16_t)fsDps);
+        TraceCallbacks cb = {onSample, onShot, &samples};
+        TraceStats st;
+        traceSynthetic(synthSeconds, rate, 1, h, cb, st);
+    }
+    if (samples.empty()) {
+        fprintf(stderr, "no samples\n");
+        return 1;
+    }
+    printf("%zu samples, %u bytes/sample raw, %u samples/chunk, keyframe every %u\n",
+           samples.size(), rawSampleBytes(columns), chunkSamples, keyInterval);
+
+    bool ok = true;
+    for (uint8_t e = BS_ENC_DELTA_VARINT; e < BS_ENC_COUNT; e++) {
+        ok &= benchChunks(samples, columns, chunkSamples, e);
+    }
+    ok &= benchChunks(samples, columns, chunkSamples, BS_ENC_AUTO);
+    ok &= benchStream(samples, columns, 1, keyInterval);
+    ok &= benchStream(samples, columns, 2, keyInterval);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+/**
+ * Observer database conventions - see observer.h
+ */
+
+#include "observer.h"
+#include <stdio.h>
+#include <string.h>
+
+const char* OBSERVER_SCHEMA =
+    "CREATE TABLE IF NOT EXISTS sessions (\n"
+    "    id INTEGER PRIMARY KEY AUTOINCREMENT,\n"
+    "    start_time TEXT,\n"
+    "    end_time TEXT,\n"
+    "    duration_sec REAL,\n"
+    "    total_samples INTEGER DEFAULT 0,\n"
+    "    total_shots INTEGER DEFAULT 0,\n"
+    "    avg_rpm REAL DEFAULT 0,\n"
+    "    max_rpm REAL DEFAULT 0,\n"
+    "    notes TEXT,\n"
+    "    device TEXT,\n"
+    "    clock_skew_ppm REAL,\n"
+    "    clock_err_us REAL\n"
+    ");\n"
+    "CREATE TABLE IF NOT EXISTS imu_data (\n"
+    "    id INTEGER PRIMARY KEY AUTOINCREMENT,\n"
+    "    session_id INTEGER,\n"
+    "    device_ts INTEGER,\n"
+    "    local_ts TEXT,\n"
+    "    ax REAL, ay REAL, az REAL,\n"
+    "    gx REAL, gy REAL, gz REAL,\n"
+    "    qw REAL, qx REAL, qy REAL, qz REAL,\n"
+    "    rpm REAL,\n"
+    "    spin TEXT,\n"
+    "    impact INTEGER,\n"
+    "    sync_us INTEGER\n"
+    ");\n"
+    "CREATE INDEX IF NOT EXISTS idx_imu_session_ts ON imu_data (session_id, device_ts);\n"
+    "CREATE TABLE IF NOT EXISTS shots (\n"
+    "    id INTEGER PRIMARY KEY AUTOINCREMENT,\n"
+    "    session_id INTEGER,\n"
+    "    shot_id INTEGER,\n"
+    "    device_ts INTEGER,\n"
+    "    local_ts TEXT,\n"
+    "    rpm REAL,\n"
+    "    peak_g REAL,\n"
+    "    gx REAL, gy REAL, gz REAL,\n"
+    "    spin_type TEXT,\n"
+    "    spin_axis_theta REAL,\n"
+    "    spin_axis_phi REAL,\n"
+    "    sync_us INTEGER\n"
+    ");\n";
+
+const char* OBSERVER_IMU_INDEX =
+    "CREATE INDEX IF NOT EXISTS idx_imu_session_ts ON imu_data (session_id, device_ts)";
+
+const char* observerLocalTime(ObserverClock &c, int64_t tUs) {
+    int64_t ms = tUs / 1000;
+    int64_t sec = ms / 1000;
+    if (sec != c.cachedSec) {
+        time_t t = c.wallBase + sec;
+        struct tm tm;
+        localtime_r(&t, &tm);
+        strftime(c.cachedIso, sizeof(c.cachedIso), "%Y-%m-%dT%H:%M:%S", &tm);
+        c.cachedSec = sec;
+    }
+    // Only the milliseconds change within a second: patch them in
+    size_t n = strlen(c.cachedIso);
+    int frac = (int)(ms % 1000);
+    memcpy(c.iso, c.cachedIso, n);
+    c.iso[n] = '.';
+    c.iso[n + 1] = '0' + frac / 100;
+    c.iso[n + 2] = '0' + frac / 10 % 10;
+    c.iso[n + 3] = '0' + frac % 10;
+    c.iso[n + 4] = '\0';
+    return c.iso;
+}
+
+bool observerSpinAxis(const BsShot &s, double &theta, double &phi) {
+    double omega = sqrt(s.gx * s.gx + s.gy * s.gy + s.gz * s.gz);
+    if (omega < 1.0) return false;
+    theta = acos(fmax(-1.0, fmin(1.0, s.gz / omega))) * 180.0 / M_PI;
+    phi = atan2(s.gy / omega, s.gx / omega) * 180.0 / M_PI;
+    if (phi < 0) phi += 360.0;
+    return true;
+}
+
+void observerSpinType(const BsShot &s, char* out, size_t size) {
+    size_t n = sizeof(s.spinType) < size - 1 ? sizeof(s.spinType) : size - 1;
+    memcpy(out, s.spinType, n);
+    out[n] = '\0';
+    for (char* q = out; *q; q++) if (*q == '\'') *q = ' ';
+}
@@ -0,0 +1,51 @@
+/**
+ * Observer database conventions for host tools
+ *
+ * The observer (observer/db.py) owns the SQLite schema; tools that write
+ * sessions into it (sessionconv .sql scripts, sessiondb) share the table
+ * definitions and the derived fields here so their rows read exactly like
+ * recorded ones in dashboard.py.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// CREATE TABLE / INDEX IF NOT EXISTS statements, as observer/db.py
+extern const char* OBSERVER_SCHEMA;
+
+// Index the dashboard's per-session queries use; bulk loads may drop it
+extern const char* OBSERVER_IMU_INDEX;
+
+// Device time -> observer local_ts ("YYYY-mm-ddTHH:MM:SS.mmm" local time)
+struct ObserverClock {
+    time_t  wallBase = 0;         // wall clock second of device time 0
+    int64_t cachedSec = -1;
+    char    cachedIso[32];
+    char    iso[40];
+};
+
+// Anchors the clock so that device time lastUs falls on wall time endWall
+static inline void observerClockAnchor(ObserverClock &c, int64_t lastUs, time_t endWall) {
+    c.wallBase = endWall - lastUs / 1000000;
+    c.cachedSec = -1;
+}
+
+// Formatted local time; valid until the next call
+const char* observerLocalTime(ObserverClock &c, int64_t tUs);
+
+// rpm as the ball reports it, from a gyro vector in deg/s
+static inline double observerRpm(double gx, double gy, double gz) {
+    return sqrt(gx * gx + gy * gy + gz * gz) / 6.0;
+}
+
+// Spin axis of a shot in degrees (theta from +Z, phi in [0, 360)), as the
+// observer stores it; false when the ball was barely spinning
+bool observerSpinAxis(const BsShot &s, double &theta, double &phi);
+
+// Shot spin type as a NUL-terminated string with quotes replaced
+void observerSpinType(const BsShot &s, char* out, size_t size);
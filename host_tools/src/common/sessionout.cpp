@@ -0,0 +1,87 @@
+/**
+ * Session file output for host tools - see sessionout.h
+ */
+
+#include "sessionout.h"
+#include <chrono>
+
+double hostSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t fileWrite(void* ctx, const void* data, size_t len) {
+    return fwrite(data, 1, len, (FILE*)ctx);
+}
+
+static void onSummary(void* ctx, const BsSummary &s) {
+    ((SessionOut*)ctx)->levels[s.level].push_back(s);
+}
+
+bool sessionOutOpen(SessionOut &o, const char* path, const BsFileHeader &h, uint8_t encoding,
+                    uint16_t chunkSamples) {
+    o.fp = fopen(path, "wb");
+    if (!o.fp) return false;
+    setvbuf(o.fp, nullptr, _IOFBF, 1 << 20);
+    o.encoding = encoding;
+    o.store.resize(bsChunkStorageBytes(chunkSamples, SESSION_OUT_SHOTS) / 8 + 1);
+    o.encoded.resize(bsChunkMaxBytes(chunkSamples, SESSION_OUT_SHOTS, BS_COLS_ALL, encoding));
+    bsChunkInit(o.chunk, o.store.data(), chunkSamples, SESSION_OUT_SHOTS, h.columns);
+    o.index.resize(1024);
+    bsPyramidInit(o.pyramid, BS_PYRAMID_BASE, onSummary, &o);
+    for (auto &l : o.levels) l.clear();
+    bsFileBegin(o.writer, h, fileWrite, o.fp, o.index.data(), o.index.size());
+    return !o.writer.failed;
+}
+
+static bool flushChunk(SessionOut &o) {
+    if (o.chunk.count == 0 && o.chunk.shotCount == 0) return true;
+    double t0 = hostSeconds();
+    size_t len = bsChunkEncode(o.chunk, o.encoding, o.encoded.data(), o.encoded.size());
+    o.encodeSec += hostSeconds() - t0;
+    if (!len) return false;
+
+    // Grow the index before the writer runs out of entries
+    if (o.writer.chunks == o.index.size()) {
+        o.index.resize(o.index.size() * 2);
+        o.writer.index = o.index.data();
+        o.writer.indexCapacity = o.index.size();
+    }
+    bool ok = bsFileAddChunk(o.writer, o.encoded.data());
+    o.samples += o.chunk.count;
+    bsChunkReset(o.chunk, o.samples);
+    return ok;
+}
+
+bool sessionOutSample(SessionOut &o, const BsSample &s) {
+    if (bsChunkFull(o.chunk) && !flushChunk(o)) return false;
+    bsPyramidAdd(o.pyramid, s);
+    return bsChunkAdd(o.chunk, s);
+}
+
+bool sessionOutShot(SessionOut &o, const BsShot &s) {
+    if (!bsChunkAddShot(o.chunk, s)) {
+        if (!flushChunk(o)) return false;
+        return bsChunkAddShot(o.chunk, s);
+    }
+    return true;
+}
+
+bool sessionOutClose(SessionOut &o) {
+    if (!o.fp) return false;
+    bool ok = flushChunk(o);
+    if (ok && o.pyramid.samples) {
+        bsPyramidFinish(o.pyramid);
+        BsPyramidHeader h;
+        bsPyramidHeaderInit(h, o.pyramid.samples, o.pyramid.base);
+        bsFilePyramidBegin(o.writer, h);
+        for (uint8_t k = 0; k < h.levels; k++) {
+            bsFilePyramidAdd(o.writer, o.levels[k].data(), o.levels[k].size());
+        }
+        ok = bsFilePyramidEnd(o.writer);
+    }
+    ok = ok && bsFileEnd(o.writer);
+    ok = fclose(o.fp) == 0 && ok;
+    o.fp = nullptr;
+    return ok;
+}
@@ -0,0 +1,47 @@
+/**
+ * Session file output for host tools
+ *
+ * Wraps the shared chunk builder and file writer around a FILE*, with
+ * the index growing in a vector. Samples and shots are added in time
+ * order; chunks are written whenever the builder fills. The summary
+ * pyramid is built as samples arrive and written on close.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include "bschunk.h"
+#include "bsfile.h"
+#include "bspyramid.h"
+#include <stdio.h>
+#include <vector>
+
+struct SessionOut {
+    FILE*                     fp = nullptr;
+    BsFileWriter              writer;
+    BsChunkBuilder            chunk;
+    std::vector<uint64_t>     store;
+    std::vector<uint8_t>      encoded;
+    std::vector<BsIndexEntry> index;
+    BsPyramidBuilder          pyramid;
+    std::vector<BsSummary>    levels[BS_PYRAMID_LEVELS];
+    uint8_t                   encoding = BS_ENC_RAW;
+    uint64_t                  samples = 0;
+    double                    encodeSec = 0;  // time spent in bsChunkEncode
+};
+
+static const uint16_t SESSION_OUT_CHUNK = 4096;
+static const uint16_t SESSION_OUT_SHOTS = 256;
+
+// Opens path and writes the header; false on I/O error
+bool sessionOutOpen(SessionOut &o, const char* path, const BsFileHeader &h, uint8_t encoding,
+                    uint16_t chunkSamples = SESSION_OUT_CHUNK);
+
+bool sessionOutSample(SessionOut &o, const BsSample &s);
+bool sessionOutShot(SessionOut &o, const BsShot &s);
+
+// Flushes the last chunk, writes index + trailer and closes the file
+bool sessionOutClose(SessionOut &o);
+
+// Monotonic seconds, for throughput reports
+double hostSeconds();
@@ -0,0 +1,256 @@
+/**
+ * Session file reader for host tools - see sessionread.h
+ */
+
+#include "sessionread.h"
+#include "bsfile.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool fail(SessionReader &r, const char* why) {
+    r.error = why;
+    sessionClose(r);
+    return false;
+}
+
+// Pyramid section at off, at most len bytes; left unset when invalid
+static void loadPyramid(SessionReader &r, uint64_t off, uint64_t len) {
+    if (len < sizeof(BsPyramidHeader) + sizeof(BsPyramidFooter)) return;
+    const BsPyramidHeader* h = (const BsPyramidHeader*)(r.base + off);
+    if (h->magic != BS_PYRAMID_MAGIC || h->levels == 0 || h->levels > BS_PYRAMID_LEVELS) return;
+    uint64_t entries = 0;
+    for (uint8_t k = 0; k < h->levels; k++) entries += h->counts[k];
+    uint64_t bytes = sizeof(BsPyramidHeader) + entries * sizeof(BsSummary) + sizeof(BsPyramidFooter);
+    if (bytes > len) return;
+    const BsPyramidFooter* f = (const BsPyramidFooter*)(r.base + off + bytes - sizeof(BsPyramidFooter));
+    if (f->bytes != bytes || f->crc != bsCrc32(0, h, bytes - sizeof(BsPyramidFooter))) return;
+
+    const BsSummary* s = (const BsSummary*)(h + 1);
+    for (uint8_t k = 0; k < h->levels; k++) {
+        r.level[k].data = s;
+        r.level[k].size = h->counts[k];
+        s += h->counts[k];
+    }
+    r.pyramid = h;
+}
+
+// Index from the trailer, when it is intact and complete
+static bool loadIndex(SessionReader &r) {
+    if (r.size < sizeof(BsFileHeader) + sizeof(BsTrailer)) return false;
+    const BsTrailer* t = (const BsTrailer*)(r.base + r.size - sizeof(BsTrailer));
+    if (t->magic != BS_INDEX_MAGIC || (t->flags & BS_TRAILER_INDEX_PARTIAL)) return false;
+    uint64_t indexBytes = (uint64_t)t->chunks * sizeof(BsIndexEntry);
+    if (t->indexOffset < sizeof(BsFileHeader) ||
+        t->indexOffset + indexBytes != r.size - sizeof(BsTrailer)) return false;
+    const BsIndexEntry* index = (const BsIndexEntry*)(r.base + t->indexOffset);
+    uint32_t crc = bsCrc32(0, index, indexBytes);
+    if (t->crc != bsCrc32(crc, t, offsetof(BsTrailer, crc))) return false;
+
+    if (t->flags & BS_TRAILER_PYRAMID && t->pyramidBytes <= t->indexOffset) {
+        loadPyramid(r, t->indexOffset - t->pyramidBytes, t->pyramidBytes);
+    }
+    r.index = index;
+    r.chunks = t->chunks;
+    r.samples = t->samples;
+    r.shots = t->shots;
+    return true;
+}
+
+// Walks chunk headers until the first one that is torn or invalid
+static void scanChunks(SessionReader &r) {
+    uint64_t off = sizeof(BsFileHeader);
+    r.scanned.clear();
+    r.samples = 0;
+    r.shots = 0;
+    while (off + sizeof(BsChunkHeader) <= r.size) {
+        const uint8_t* chunk = r.base + off;
+        if (!bsChunkValid(chunk, r.size - off)) break;
+        const BsChunkHeader* h = bsChunkHeader(chunk);
+        const BsChunkFooter* f = bsChunkFooter(chunk);
+        BsIndexEntry e = {off, f->tFirstUs, f->tLastUs, f->firstSample, f->shotFirst,
+                          h->shotCount};
+        r.scanned.push_back(e);
+        r.samples += h->count;
+        r.shots += h->shotCount;
+        off += h->bytes;
+    }
+    r.index = r.scanned.data();
+    r.chunks = r.scanned.size();
+    r.recovered = true;
+    // An interrupted index write can leave a complete pyramid behind the chunks
+    loadPyramid(r, off, r.size - off);
+}
+
+bool sessionOpen(SessionReader &r, const char* path) {
+    r.fd = open(path, O_RDONLY);
+    if (r.fd < 0) return fail(r, strerror(errno));
+    struct stat st;
+    if (fstat(r.fd, &st) != 0) return fail(r, strerror(errno));
+    r.size = st.st_size;
+    if (r.size < sizeof(BsFileHeader)) return fail(r, "too short for a session file");
+    void* map = mmap(nullptr, r.size, PROT_READ, MAP_SHARED, r.fd, 0);
+    if (map == MAP_FAILED) return fail(r, strerror(errno));
+    r.base = (const uint8_t*)map;
+
+    r.header = (const BsFileHeader*)r.base;
+    if (!bsFileHeaderValid(*r.header)) return fail(r, "bad session file header");
+    if (!loadIndex(r)) scanChunks(r);
+
+    for (uint32_t i = 0; i < r.chunks; i++) {
+        for (uint32_t k = 0; k < r.index[i].shotCount; k++) r.shotChunks.push_back(i);
+    }
+    return true;
+}
+
+void sessionClose(SessionReader &r) {
+    if (r.base) munmap((void*)r.base, r.size);
+    if (r.fd >= 0) close(r.fd);
+    r.fd = -1;
+    r.base = nullptr;
+    r.header = nullptr;
+    r.index = nullptr;
+    r.chunks = 0;
+    r.pyramid = nullptr;
+}
+
+void sessionSequential(const SessionReader &r) {
+    if (r.base) madvise((void*)r.base, r.size, MADV_SEQUENTIAL);
+}
+
+bool sessionVerifyChunk(const SessionReader &r, uint32_t i) {
+    uint64_t off = r.index[i].offset;
+    return off < r.size && bsChunkValid(r.base + off, r.size - off);
+}
+
+template <typename T>
+static Span<T> span(const void* p, size_t n) {
+    Span<T> s;
+    s.data = (const T*)p;
+    s.size = n;
+    return s;
+}
+
+bool sessionLoadChunk(SessionReader &r, uint32_t i, SessionChunk &c, uint16_t mask) {
+    const uint8_t* chunk = sessionChunkAt(r, i);
+    const BsChunkHeader* h = bsChunkHeader(chunk);
+    c = SessionChunk();
+    c.raw = chunk;
+    c.firstSample = r.index[i].firstSample;
+    c.shots = span<BsShot>(bsChunkShots(chunk), h->shotCount);
+
+    // Scratch for the delta columns that are asked for
+    size_t need = 0;
+    const BsColumnDesc* d = bsChunkColumns(chunk);
+    for (int k = 0; k < h->ncols; k++) {
+        if (((mask >> d[k].id) & 1) && d[k].encoding != BS_ENC_RAW) {
+            need += bsAlign8((size_t)h->count * bsColumnWidth(d[k].id));
+        }
+    }
+    if (r.scratch.size() < need / 8) r.scratch.resize(need / 8);
+    uint8_t* out = (uint8_t*)r.scratch.data();
+
+    for (int k = 0; k < h->ncols; k++) {
+        const BsColumnDesc &cd = d[k];
+        if (!((mask >> cd.id) & 1)) continue;
+        const void* p = chunk + cd.offset;
+        if (cd.encoding != BS_ENC_RAW) {
+            if (!bsChunkDecode(chunk, cd, out)) return false;
+            p = out;
+            out += bsAlign8((size_t)h->count * bsColumnWidth(cd.id));
+        }
+        if (cd.id == BS_COL_T)          c.t = span<int64_t>(p, h->count);
+        else if (cd.id == BS_COL_FLAGS) c.flags = span<uint16_t>(p, h->count);
+        else                            c.col[cd.id - BS_COL_AX] = span<int16_t>(p, h->count);
+    }
+    return true;
+}
+
+uint32_t sessionFindTime(const SessionReader &r, int64_t tUs) {
+    const BsIndexEntry* end = r.index + r.chunks;
+    const BsIndexEntry* e = std::lower_bound(r.index, end, tUs,
+        [](const BsIndexEntry &a, int64_t t) { return a.tLastUs < t; });
+    return e - r.index;
+}
+
+uint32_t sessionFindShot(const SessionReader &r, uint32_t id, const BsShot** shot) {
+    // Shot ids are numbered in recording order: one shotChunks entry per id
+    if (r.shotChunks.empty()) return r.chunks;
+    uint32_t first = r.index[r.shotChunks[0]].shotFirst;
+    if (id < first || id - first >= r.shotChunks.size()) return r.chunks;
+
+    uint32_t i = r.shotChunks[id - first];
+    const uint8_t* chunk = sessionChunkAt(r, i);
+    const BsShot* s = bsChunkShots(chunk);
+    for (uint16_t k = 0; k < bsChunkHeader(chunk)->shotCount; k++) {
+        if (s[k].id == id) {
+            if (shot) *shot = &s[k];
+            return i;
+        }
+    }
+    return r.chunks;
+}
+
+// ==================== Overview ====================
+
+static uint32_t binOf(int64_t t, int64_t t0Us, int64_t t1Us, uint32_t pixels) {
+    if (t <= t0Us) return 0;
+    uint64_t b = (uint64_t)(t - t0Us) * pixels / (uint64_t)(t1Us - t0Us + 1);
+    return b >= pixels ? pixels - 1 : (uint32_t)b;
+}
+
+static void fromSamples(SessionReader &r, int64_t t0Us, int64_t t1Us, uint32_t pixels,
+                        std::vector<BsPyramidPartial> &acc) {
+    SessionChunk c;
+    for (uint32_t i = sessionFindTime(r, t0Us); i < r.chunks && r.index[i].tFirstUs <= t1Us; i++) {
+        if (!sessionLoadChunk(r, i, c, BS_COLS_IMU)) break;
+        if (c.col[0].empty() || c.col[3].empty()) continue;
+        const int64_t* t = c.t.data;
+        size_t k = std::lower_bound(t, t + c.t.size, t0Us) - t;
+        for (; k < c.t.size && t[k] <= t1Us; k++) {
+            const int16_t a[3] = {c.col[0][k], c.col[1][k], c.col[2][k]};
+            const int16_t g[3] = {c.col[3][k], c.col[4][k], c.col[5][k]};
+            bool impact = !c.flags.empty() && (c.flags[k] & BS_FLAG_IMPACT);
+            bsSummaryAdd(acc[binOf(t[k], t0Us, t1Us, pixels)], t[k], bsMagnitude(a),
+                         bsMagnitude(g), impact);
+        }
+    }
+}
+
+int sessionOverview(SessionReader &r, int64_t t0Us, int64_t t1Us, uint32_t pixels,
+                    std::vector<BsSummary> &bins, bool raw) {
+    bins.clear();
+    if (pixels == 0 || t1Us < t0Us) return -1;
+    BsPyramidPartial empty = {};
+    for (int c = 0; c < BS_SUM_COUNT; c++) empty.min[c] = 0xFFFF;
+    std::vector<BsPyramidPartial> acc(pixels, empty);
+
+    auto startsAfter = [](const BsSummary &s, int64_t t) { return s.tFirstUs + s.spanUs < t; };
+    int level = -1;
+    if (r.pyramid && !raw) {
+        // Samples in range, to level-0 resolution
+        const Span<BsSummary> &l0 = r.level[0];
+        size_t a = std::lower_bound(l0.begin(), l0.end(), t0Us, startsAfter) - l0.begin();
+        size_t b = std::upper_bound(l0.begin(), l0.end(), t1Us,
+            [](int64_t t, const BsSummary &s) { return t < s.tFirstUs; }) - l0.begin();
+        level = bsPyramidPickLevel(*r.pyramid, (uint64_t)(b > a ? b - a : 0) * r.pyramid->base,
+                                   pixels);
+    }
+    if (level < 0) {
+        fromSamples(r, t0Us, t1Us, pixels, acc);
+    } else {
+        // Buckets are binned by start time; one straddling a bin edge lands whole in the first
+        const Span<BsSummary> &l = r.level[level];
+        const BsSummary* s = std::lower_bound(l.begin(), l.end(), t0Us, startsAfter);
+        for (; s != l.end() && s->tFirstUs <= t1Us; s++) {
+            bsSummaryMerge(acc[binOf(s->tFirstUs, t0Us, t1Us, pixels)], *s);
+        }
+    }
+    bins.resize(pixels);
+    for (uint32_t i = 0; i < pixels; i++) bsSummaryFrom(bins[i], acc[i], level < 0 ? 0 : level);
+    return level;
+}
@@ -0,0 +1,97 @@
+/**
+ * Session file reader for host tools (mmap, zero copy)
+ *
+ * The whole file is mapped read-only; chunk pointers, raw columns and
+ * shots point straight into the mapping, so reading a raw-encoded
+ * session costs no copies at all and multi-GB files are paged in by the
+ * kernel as they are touched. Delta-encoded columns are decoded on
+ * demand into a per-reader scratch buffer.
+ *
+ * The chunk table comes from the index at the end of the file. Files
+ * without a valid trailer (capture interrupted, index partial) are
+ * recovered by walking the chunk headers from the start.
+ *
+ * sessionOverview() draws a time range at a given width from the summary
+ * pyramid when the file has one, touching about two summaries per pixel
+ * however long the range is, and from the samples otherwise.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include "bschunk.h"
+#include "bspyramid.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+template <typename T>
+struct Span {
+    const T* data = nullptr;
+    size_t   size = 0;
+
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    const T& operator[](size_t i) const { return data[i]; }
+    bool empty() const { return size == 0; }
+};
+
+struct SessionReader {
+    int                       fd = -1;
+    const uint8_t*            base = nullptr;
+    size_t                    size = 0;
+    const BsFileHeader*       header = nullptr;
+    const BsIndexEntry*       index = nullptr;   // into the mapping, or scanned
+    uint32_t                  chunks = 0;
+    uint64_t                  samples = 0;
+    uint32_t                  shots = 0;
+    bool                      recovered = false; // index rebuilt by scanning
+    const BsPyramidHeader*    pyramid = nullptr; // nullptr when the file has none
+    Span<BsSummary>           level[BS_PYRAMID_LEVELS];
+    const char*               error = nullptr;   // why sessionOpen failed
+    std::vector<BsIndexEntry> scanned;
+    std::vector<uint32_t>     shotChunks;        // chunks holding shots, by shot id
+    std::vector<uint64_t>     scratch;           // decoded delta columns
+};
+
+// One chunk's columns; spans are empty for columns the file lacks
+struct SessionChunk {
+    const uint8_t*   raw = nullptr;              // chunk start in the mapping
+    uint64_t         firstSample = 0;
+    Span<int64_t>    t;
+    Span<int16_t>    col[10];                    // ax, ay, az, gx, gy, gz, qw, qx, qy, qz
+    Span<uint16_t>   flags;
+    Span<BsShot>     shots;
+};
+
+// Maps path and loads the chunk table; false with r.error set on failure
+bool sessionOpen(SessionReader &r, const char* path);
+void sessionClose(SessionReader &r);
+
+// Hint the kernel that the file is about to be read front to back
+void sessionSequential(const SessionReader &r);
+
+static inline const uint8_t* sessionChunkAt(const SessionReader &r, uint32_t i) {
+    return r.base + r.index[i].offset;
+}
+
+// CRC and layout check of chunk i
+bool sessionVerifyChunk(const SessionReader &r, uint32_t i);
+
+// Column spans of chunk i for the columns in mask. Raw columns point
+// into the mapping; delta columns are decoded into r.scratch, which is
+// reused by the next call. False on a malformed chunk.
+bool sessionLoadChunk(SessionReader &r, uint32_t i, SessionChunk &c, uint16_t mask = BS_COLS_ALL);
+
+// First chunk whose time range ends at or after tUs (r.chunks if none)
+uint32_t sessionFindTime(const SessionReader &r, int64_t tUs);
+
+// Chunk holding shot id (r.chunks if none); *shot points at it in the mapping
+uint32_t sessionFindShot(const SessionReader &r, uint32_t id, const BsShot** shot = nullptr);
+
+// Summaries of [t0Us, t1Us] split into pixels equal time bins (count 0
+// for bins without samples). Uses the pyramid level picked for the range
+// or, below level 0 or without a pyramid (or with raw set), the samples.
+// Returns the level read, -1 for samples.
+int sessionOverview(SessionReader &r, int64_t t0Us, int64_t t1Us, uint32_t pixels,
+                    std::vector<BsSummary> &bins, bool raw = false);
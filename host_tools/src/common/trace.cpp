@@ -0,0 +1,226 @@
+/**
+ * Trace sources for host tools - see trace.h
+ */
+
+#include "trace.h"
+#include <ctype.h>
+#include <math.h>
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+uint16_t traceColumns(TraceLayout layout) {
+    switch (layout) {
+        case TRACE_IMU_LOGGER: return BS_COLS_IMU;
+        case TRACE_DASHBOARD:  return BS_COLS_ALL;
+        default:               return 0;
+    }
+}
+
+// Splits a CSV line in place; returns the field count
+static int splitCsv(char* line, char** fields, int maxFields) {
+    int n = 0;
+    char* p = line;
+    while (n < maxFields) {
+        fields[n++] = p;
+        char* comma = strchr(p, ',');
+        if (!comma) break;
+        *comma = '\0';
+        p = comma + 1;
+    }
+    return n;
+}
+
+static void chomp(char* line) {
+    size_t len = strlen(line);
+    while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+}
+
+// Dashboard exports list shots after all frames: collect them first so
+// they can be emitted in time order with the samples
+static void readDashboardShots(FILE* fp, std::vector<BsShot> &shots) {
+    char line[512];
+    char* f[16];
+    bool inShots = false;
+    while (fgets(line, sizeof(line), fp)) {
+        chomp(line);
+        if (!inShots) {
+            inShots = strcmp(line, "Shots") == 0;
+            continue;
+        }
+        if (splitCsv(line, f, 16) < 8 || !isdigit((unsigned char)f[0][0])) continue;
+        BsShot s = {};
+        s.id = strtoul(f[0], nullptr, 10);
+        s.tUs = (int64_t)strtoll(f[1], nullptr, 10) * 1000;
+        s.peakRpm = strtof(f[2], nullptr);
+        s.peakG = strtof(f[3], nullptr);
+        s.gx = strtof(f[4], nullptr);
+        s.gy = strtof(f[5], nullptr);
+        s.gz = strtof(f[6], nullptr);
+        strncpy(s.spinType, f[7], sizeof(s.spinType) - 1);
+        shots.push_back(s);
+    }
+}
+
+static TraceLayout layoutOf(const char* line, int fields) {
+    if (strncmp(line, "timestamp_ms,", 13) == 0) return TRACE_IMU_LOGGER;
+    if (strncmp(line, "timestamp,", 10) == 0) return TRACE_DASHBOARD;
+    if (!isdigit((unsigned char)line[0])) return TRACE_UNKNOWN;
+    return fields == 9 ? TRACE_IMU_LOGGER : fields == 12 ? TRACE_DASHBOARD : TRACE_UNKNOWN;
+}
+
+TraceLayout traceSniffCsv(FILE* fp) {
+    char line[512];
+    char* f[16];
+    TraceLayout layout = TRACE_UNKNOWN;
+    for (int i = 0; i < 64 && layout == TRACE_UNKNOWN && fgets(line, sizeof(line), fp); i++) {
+        chomp(line);
+        if (line[0] == '#' || line[0] == '\0') continue;
+        char copy[512];
+        strcpy(copy, line);
+        layout = layoutOf(line, splitCsv(copy, f, 16));
+    }
+    rewind(fp);
+    return layout;
+}
+
+bool traceReadCsv(FILE* fp, const BsFileHeader &h, const TraceCallbacks &cb, TraceStats &st) {
+    char line[512];
+    char* f[16];
+    std::vector<BsShot> shots;
+    size_t nextShot = 0;
+    memset(&st, 0, sizeof(st));
+
+    long start = ftell(fp);
+    readDashboardShots(fp, shots);
+    fseek(fp, start, SEEK_SET);
+
+    while (fgets(line, sizeof(line), fp)) {
+        st.bytes += strlen(line);
+        chomp(line);
+        if (line[0] == '#' || line[0] == '\0') continue;
+        if (strcmp(line, "Shots") == 0) break;
+        if (!isdigit((unsigned char)line[0])) {
+            TraceLayout l = layoutOf(line, 0);
+            if (l != TRACE_UNKNOWN) st.layout = l;
+            continue;
+        }
+        int n = splitCsv(line, f, 16);
+        if (st.layout == TRACE_UNKNOWN) st.layout = layoutOf(line, n);
+        bool dash = st.layout == TRACE_DASHBOARD;
+        if (n != (dash ? 12 : 9)) {
+            st.badLines++;
+            continue;
+        }
+
+        BsSample s = {};
+        s.tUs = (int64_t)strtoll(f[0], nullptr, 10) * 1000;
+        for (int k = 0; k < 3; k++) s.a[k] = traceFixed(strtod(f[1 + k], nullptr), bsAccelPerG(h));
+        for (int k = 0; k < 3; k++) s.g[k] = traceFixed(strtod(f[4 + k], nullptr), bsGyroPerDps(h));
+        if (dash) {
+            for (int k = 0; k < 4; k++) s.q[k] = traceFixed(strtod(f[7 + k], nullptr), h.quatOne);
+        } else if (atoi(f[8])) {
+            s.flags = BS_FLAG_IMPACT;
+        }
+        while (nextShot < shots.size() && shots[nextShot].tUs <= s.tUs) {
+            cb.shot(cb.ctx, shots[nextShot++]);
+            st.shots++;
+        }
+        cb.sample(cb.ctx, s);
+        st.samples++;
+    }
+    for (; nextShot < shots.size(); nextShot++, st.shots++) cb.shot(cb.ctx, shots[nextShot]);
+    return st.layout != TRACE_UNKNOWN;
+}
+
+// ==================== Synthetic ====================
+
+const char* traceSpinLabel(double gx, double gy, double gz, double rpm) {
+    double agx = fabs(gx), agy = fabs(gy), agz = fabs(gz), total = agx + agy + agz;
+    if (rpm < 5.0 || total < 1.0) return "FLAT";
+    if (agx / total > 0.5) return gx > 0 ? "TOPSPIN" : "BACKSPIN";
+    if (agy / total > 0.5) return gy > 0 ? "SIDE_R" : "SIDE_L";
+    if (agz / total > 0.5) return "SLICE";
+    return "MIXED";
+}
+
+void traceSynthetic(double seconds, uint16_t sampleHz, uint32_t seed, const BsFileHeader &h,
+                    const TraceCallbacks &cb, TraceStats &st) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    memset(&st, 0, sizeof(st));
+
+    const double dt = 1.0 / sampleHz;
+    const double shotEvery = 3.0;
+    double nextShot = shotEvery, impactUntil = -1;
+    double spin[3] = {0, 0, 0};                 // deg/s
+    double q[4] = {1, 0, 0, 0};
+    uint32_t shotId = 0;
+    uint64_t n = (uint64_t)(seconds * sampleHz);
+
+    for (uint64_t i = 0; i < n; i++) {
+        double t = i * dt;
+        BsSample s = {};
+        s.tUs = (int64_t)(t * 1e6);
+        if (t >= nextShot) {
+            nextShot = t + shotEvery * (0.6 + 0.8 * uni(rng));
+            impactUntil = t + 0.012;
+            double rpm = 80 + 250 * uni(rng);
+            double axis[3] = {3 * noise(rng), noise(rng), noise(rng)};
+            double len = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+            for (int k = 0; k < 3; k++) spin[k] = axis[k] / (len > 0 ? len : 1) * rpm * 6.0;
+
+            BsShot shot = {};
+            shot.id = shotId++;
+            shot.tUs = s.tUs;
+            shot.peakRpm = rpm;
+            shot.peakG = 6 + 6 * uni(rng);
+            shot.gx = spin[0]; shot.gy = spin[1]; shot.gz = spin[2];
+            strcpy(shot.spinType, traceSpinLabel(spin[0], spin[1], spin[2], rpm));
+            cb.shot(cb.ctx, shot);
+            st.shots++;
+        }
+        double a[3];
+        if (t < impactUntil) {
+            double g = 6 + 6 * uni(rng);
+            a[0] = g * 0.8 + 0.2 * noise(rng);
+            a[1] = g * 0.5 + 0.2 * noise(rng);
+            a[2] = 1.0;
+            s.flags = BS_FLAG_IMPACT;
+        } else {
+            a[0] = 0.01 * noise(rng);
+            a[1] = 0.01 * noise(rng);
+            a[2] = 1.0 + 0.01 * noise(rng);
+        }
+        double g[3];
+        for (int k = 0; k < 3; k++) {
+            g[k] = spin[k] + 0.8 * noise(rng);
+            spin[k] *= exp(-1.5 * dt);
+        }
+
+        // Orientation from the gyro (body rates, rad/s)
+        double wx = g[0] * M_PI / 180, wy = g[1] * M_PI / 180, wz = g[2] * M_PI / 180;
+        double dq[4] = {
+            -0.5 * (q[1] * wx + q[2] * wy + q[3] * wz),
+             0.5 * (q[0] * wx + q[2] * wz - q[3] * wy),
+             0.5 * (q[0] * wy - q[1] * wz + q[3] * wx),
+             0.5 * (q[0] * wz + q[1] * wy - q[2] * wx)
+        };
+        double norm = 0;
+        for (int k = 0; k < 4; k++) {
+            q[k] += dq[k] * dt;
+            norm += q[k] * q[k];
+        }
+        norm = 1.0 / sqrt(norm);
+        for (int k = 0; k < 4; k++) q[k] *= norm;
+
+        for (int k = 0; k < 3; k++) s.a[k] = traceFixed(a[k], bsAccelPerG(h));
+        for (int k = 0; k < 3; k++) s.g[k] = traceFixed(g[k], bsGyroPerDps(h));
+        for (int k = 0; k < 4; k++) s.q[k] = traceFixed(q[k], h.quatOne);
+        cb.sample(cb.ctx, s);
+        st.samples++;
+    }
+    st.layout = TRACE_DASHBOARD;
+}
@@ -0,0 +1,56 @@
+/**
+ * Trace sources for host tools: recorded CSV and a synthetic ball
+ *
+ * CSV layouts understood (detected from the header line):
+ *   imu_logger  timestamp_ms,accel_x_g,...,gyro_z_dps,accel_mag_g,impact
+ *   dashboard   timestamp,ax,ay,az,gx,gy,gz,qw,qx,qy,qz,rpm
+ *               followed by an optional "Shots" table (exportCSV())
+ * Lines starting with '#' (logger status) are skipped.
+ *
+ * Values are converted to the fixed-point scales of the file header.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include <stdio.h>
+#include <stdint.h>
+
+enum TraceLayout { TRACE_UNKNOWN, TRACE_IMU_LOGGER, TRACE_DASHBOARD };
+
+struct TraceCallbacks {
+    void (*sample)(void* ctx, const BsSample &s);
+    void (*shot)(void* ctx, const BsShot &s);
+    void* ctx;
+};
+
+struct TraceStats {
+    TraceLayout layout;
+    uint64_t    bytes;
+    uint64_t    samples;
+    uint64_t    shots;
+    uint64_t    badLines;
+};
+
+// Layout from the first lines of a CSV trace; rewinds fp
+TraceLayout traceSniffCsv(FILE* fp);
+
+// Reads a CSV trace from the current position; false if the layout is unknown
+bool traceReadCsv(FILE* fp, const BsFileHeader &h, const TraceCallbacks &cb, TraceStats &st);
+
+// Column mask a CSV layout provides
+uint16_t traceColumns(TraceLayout layout);
+
+// Synthetic rally (gravity + noise, impacts, decaying spin) like observer/emulator.py
+void traceSynthetic(double seconds, uint16_t sampleHz, uint32_t seed, const BsFileHeader &h,
+                    const TraceCallbacks &cb, TraceStats &st);
+
+// Spin label from the gyro vector (deg/s), same rules as classifySpin() on the ball
+const char* traceSpinLabel(double gx, double gy, double gz, double rpm);
+
+static inline int16_t traceFixed(double v, double scale) {
+    double x = v * scale;
+    if (x > 32767.0) return 32767;
+    if (x < -32768.0) return -32768;
+    return (int16_t)(x < 0 ? x - 0.5 : x + 0.5);
+}
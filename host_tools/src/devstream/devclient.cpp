@@ -0,0 +1,695 @@
+/**
+ * Live stream client - see devclient.h
+ */
+
+#include "devclient.h"
+#include "bspipeline.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+int64_t devNowUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// ==================== Queue ====================
+
+void devQueueInit(DevQueue &q, uint32_t capacity) {
+    uint32_t n = 1;
+    while (n < capacity) n <<= 1;
+    q.slots.reset(new DevEvent[n]);
+    q.mask = n - 1;
+    q.head.store(0, std::memory_order_relaxed);
+    q.tail.store(0, std::memory_order_relaxed);
+    q.dropped = 0;
+}
+
+bool devQueuePush(DevQueue &q, const DevEvent &e) {
+    uint32_t head = q.head.load(std::memory_order_relaxed);
+    if (head - q.tail.load(std::memory_order_acquire) > q.mask) {
+        q.dropped++;
+        return false;
+    }
+    // Frames and shots are much smaller than the union: copy what is used
+    DevEvent &slot = q.slots[head & q.mask];
+    size_t n = e.kind == DEV_FRAME ? offsetof(DevEvent, frame) + sizeof(DevFrame)
+             : e.kind == DEV_SHOT  ? offsetof(DevEvent, shot) + sizeof(DevShot)
+             : e.kind == DEV_EVENT ? offsetof(DevEvent, info) + offsetof(DevInfo, text) + e.info.len + 1
+             : offsetof(DevEvent, frame);
+    memcpy((void*)&slot, &e, n);
+    q.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool devQueuePop(DevQueue &q, DevEvent &e) {
+    uint32_t tail = q.tail.load(std::memory_order_relaxed);
+    if (tail == q.head.load(std::memory_order_acquire)) return false;
+    const DevEvent &slot = q.slots[tail & q.mask];
+    size_t n = slot.kind == DEV_FRAME ? offsetof(DevEvent, frame) + sizeof(DevFrame)
+             : slot.kind == DEV_SHOT  ? offsetof(DevEvent, shot) + sizeof(DevShot)
+             : slot.kind == DEV_EVENT ? offsetof(DevEvent, info) + offsetof(DevInfo, text) + slot.info.len + 1
+             : offsetof(DevEvent, frame);
+    memcpy((void*)&e, &slot, n);
+    q.tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+void devQueueSink(void* ctx, const DevEvent &e) {
+    devQueuePush(*(DevQueue*)ctx, e);
+}
+
+// ==================== JSON ====================
+
+// Flat objects as the device writes them: "key":value pairs, values
+// numbers or strings without escapes that matter here. Unknown keys and
+// nested values are skipped; only the keys below are converted.
+enum JsonKey {
+    K_T, K_SEQ, K_TS, K_TX, K_AX, K_AY, K_AZ, K_GX, K_GY, K_GZ, K_QW, K_QX, K_QY, K_QZ,
+    K_RPM, K_IMP, K_ID, K_PEAKG, K_MISSED, K_FRAMES, K_C, K_D, K_AFS, K_GFS,
+    K_NUM,
+    K_SPIN = K_NUM, K_TYPE, K_EVENT, K_STATE,
+    K_NONE
+};
+
+static int keyOf(const char* k, size_t n) {
+    switch (n) {
+        case 1:
+            return k[0] == 't' ? K_T : k[0] == 'c' ? K_C : k[0] == 'd' ? K_D : K_NONE;
+        case 2:
+            switch (k[0]) {
+                case 'a': return k[1] == 'x' ? K_AX : k[1] == 'y' ? K_AY : k[1] == 'z' ? K_AZ : K_NONE;
+                case 'g': return k[1] == 'x' ? K_GX : k[1] == 'y' ? K_GY : k[1] == 'z' ? K_GZ : K_NONE;
+                case 'q':
+                    return k[1] == 'w' ? K_QW : k[1] == 'x' ? K_QX : k[1] == 'y' ? K_QY : k[1] == 'z' ? K_QZ : K_NONE;
+                case 't': return k[1] == 's' ? K_TS : k[1] == 'x' ? K_TX : K_NONE;
+                case 'i': return k[1] == 'd' ? K_ID : K_NONE;
+            }
+            return K_NONE;
+        case 3:
+            if (!memcmp(k, "seq", 3)) return K_SEQ;
+            if (!memcmp(k, "rpm", 3)) return K_RPM;
+            if (!memcmp(k, "imp", 3)) return K_IMP;
+            return K_NONE;
+        case 4:
+            if (!memcmp(k, "spin", 4)) return K_SPIN;
+            if (!memcmp(k, "type", 4)) return K_TYPE;
+            return K_NONE;
+        case 5:
+            if (!memcmp(k, "event", 5)) return K_EVENT;
+            if (!memcmp(k, "peakG", 5)) return K_PEAKG;
+            if (!memcmp(k, "state", 5)) return K_STATE;
+            return K_NONE;
+        case 6:
+            if (!memcmp(k, "missed", 6)) return K_MISSED;
+            if (!memcmp(k, "frames", 6)) return K_FRAMES;
+            return K_NONE;
+        case 7:
+            return !memcmp(k, "gyro_fs", 7) ? K_GFS : K_NONE;
+        case 8:
+            return !memcmp(k, "accel_fs", 8) ? K_AFS : K_NONE;
+    }
+    return K_NONE;
+}
+
+static inline bool jsonSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                               1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+// Decimal number as the device prints it (%lu, %.Nf), scanned in one
+// pass; anything longer or with an exponent goes to strtod. p ends up
+// after the token.
+static double parseNumber(const char* &p, const char* e) {
+    const char* s = p;
+    bool neg = p < e && *p == '-';
+    if (neg) p++;
+    uint64_t m = 0;
+    int digits = 0, frac = 0;
+    for (; p < e && (unsigned)(*p - '0') < 10; p++, digits++) m = m * 10 + (*p - '0');
+    if (p < e && *p == '.') {
+        for (p++; p < e && (unsigned)(*p - '0') < 10; p++, digits++, frac++) m = m * 10 + (*p - '0');
+    }
+    if ((p == e || *p == ',' || *p == '}') && digits > 0 && digits <= 18) {
+        double v = (double)m / POW10[frac];
+        return neg ? -v : v;
+    }
+    while (p < e && *p != ',' && *p != '}' && !jsonSpace(*p)) p++;
+    char buf[64];
+    size_t n = (size_t)(p - s) < sizeof(buf) - 1 ? (size_t)(p - s) : sizeof(buf) - 1;
+    memcpy(buf, s, n);
+    buf[n] = '\0';
+    return strtod(buf, nullptr);
+}
+
+static void copyStr(char* dst, size_t size, const char* s, size_t n) {
+    if (n >= size) n = size - 1;
+    memcpy(dst, s, n);
+    dst[n] = '\0';
+}
+
+bool devDecodeJson(const char* p, size_t len, DevEvent &e) {
+    const char* const start = p;
+    const char* end = p + len;
+    while (p < end && jsonSpace(*p)) p++;
+    if (p >= end || *p != '{') return false;
+    p++;
+
+    double num[K_NUM];
+    uint32_t has = 0;
+    const char* str[4] = {nullptr, nullptr, nullptr, nullptr};
+    size_t strLen[4] = {0, 0, 0, 0};
+
+    for (;;) {
+        while (p < end && (jsonSpace(*p) || *p == ',')) p++;
+        if (p >= end) return false;
+        if (*p == '}') break;
+        if (*p != '"') return false;
+        const char* k = ++p;
+        while (p < end && *p != '"') p++;
+        if (p >= end) return false;
+        int key = keyOf(k, p - k);
+        p++;
+        while (p < end && jsonSpace(*p)) p++;
+        if (p >= end || *p != ':') return false;
+        p++;
+        while (p < end && jsonSpace(*p)) p++;
+        if (p >= end) return false;
+
+        if (*p == '"') {
+            const char* v = ++p;
+            while (p < end && *p != '"') p += *p == '\\' ? 2 : 1;
+            if (p >= end) return false;
+            if (key >= K_SPIN && key < K_NONE) {
+                str[key - K_SPIN] = v;
+                strLen[key - K_SPIN] = p - v;
+            }
+            p++;
+        } else if (*p == '{' || *p == '[') {
+            // Nested: skipped, strings inside may hold brackets
+            int depth = 0;
+            for (; p < end; p++) {
+                if (*p == '"') {
+                    for (p++; p < end && *p != '"'; p += *p == '\\' ? 2 : 1) {}
+                } else if (*p == '{' || *p == '[') {
+                    depth++;
+                } else if ((*p == '}' || *p == ']') && --depth == 0) {
+                    p++;
+                    break;
+                }
+            }
+        } else if (key < K_NUM && *p != 't' && *p != 'f' && *p != 'n') {
+            num[key] = parseNumber(p, end);
+            has |= 1u << key;
+        } else {
+            if (key < K_NUM) {
+                num[key] = *p == 't';
+                has |= 1u << key;
+            }
+            while (p < end && *p != ',' && *p != '}' && !jsonSpace(*p)) p++;
+        }
+    }
+
+    auto n = [&](int k, double def) { return (has >> k) & 1 ? num[k] : def; };
+    e.flags = 0;
+    if (!str[K_EVENT - K_SPIN]) {
+        // A frame: needs at least its seq and time
+        if (!((has >> K_SEQ) & 1) || !((has >> K_T) & 1)) return false;
+        DevFrame &f = e.frame;
+        e.kind = DEV_FRAME;
+        f.seq = (uint32_t)num[K_SEQ];
+        f.tMs = (uint32_t)num[K_T];
+        f.sampleUs = (uint32_t)n(K_TS, 0);
+        f.txUs = (uint32_t)n(K_TX, 0);
+        for (int i = 0; i < 3; i++) {
+            f.a[i] = (float)n(K_AX + i, 0);
+            f.g[i] = (float)n(K_GX + i, 0);
+        }
+        for (int i = 0; i < 4; i++) f.q[i] = (float)n(K_QW + i, i == 0 ? 1 : 0);
+        f.rpm = (float)n(K_RPM, 0);
+        f.impact = n(K_IMP, 0) != 0;
+        copyStr(f.spin, sizeof(f.spin), str[K_SPIN - K_SPIN], strLen[K_SPIN - K_SPIN]);
+        return true;
+    }
+    const char* ev = str[K_EVENT - K_SPIN];
+    size_t evLen = strLen[K_EVENT - K_SPIN];
+    if (evLen == 4 && !memcmp(ev, "shot", 4)) {
+        DevShot &s = e.shot;
+        e.kind = DEV_SHOT;
+        s.id = (uint32_t)n(K_ID, 0);
+        s.tMs = (uint32_t)n(K_T, 0);
+        s.rpm = (float)n(K_RPM, 0);
+        s.peakG = (float)n(K_PEAKG, 0);
+        for (int i = 0; i < 3; i++) s.g[i] = (float)n(K_GX + i, 0);
+        copyStr(s.type, sizeof(s.type), str[K_TYPE - K_SPIN], strLen[K_TYPE - K_SPIN]);
+        return true;
+    }
+    DevInfo &i = e.info;
+    e.kind = DEV_EVENT;
+    copyStr(i.name, sizeof(i.name), ev, evLen);
+    copyStr(i.state, sizeof(i.state), str[K_STATE - K_SPIN], strLen[K_STATE - K_SPIN]);
+    i.seq = (int64_t)n(K_SEQ, -1);
+    i.missed = (int64_t)n(K_MISSED, -1);
+    i.frames = (int64_t)n(K_FRAMES, -1);
+    i.c = (int64_t)n(K_C, -1);
+    i.d = (int64_t)n(K_D, -1);
+    i.accelFs = (int64_t)n(K_AFS, -1);
+    i.gyroFs = (int64_t)n(K_GFS, -1);
+    i.len = (uint16_t)(len < DEV_TEXT_MAX - 1 ? len : DEV_TEXT_MAX - 1);
+    memcpy(i.text, start, i.len);
+    i.text[i.len] = '\0';
+    return true;
+}
+
+// ==================== Messages ====================
+
+static void emit(DevClient &c) {
+    c.ev.rxUs = devNowUs();
+    if (c.sink) c.sink(c.ctx, c.ev);
+}
+
+// Frame seq bookkeeping: gaps in the live stream, the resume point
+static void trackSeq(DevClient &c, uint32_t seq) {
+    if (c.haveSeq && seq != c.nextSeq && (int32_t)(seq - c.nextSeq) > 0) {
+        c.st.gaps++;
+        c.st.lost += seq - c.nextSeq;
+    }
+    c.nextSeq = seq + 1;
+    c.haveSeq = true;
+}
+
+// A raw-count build streams the IMU's own counts and says so on "bin"
+// (BS_HEADER_FULL_SCALE); otherwise packets use the log's default scales
+static void setBinScales(DevClient &c, int64_t accelFs, int64_t gyroFs) {
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, 0, BS_COLS_ALL, "");
+    if (accelFs > 0 && gyroFs > 0) bsFileHeaderSetFullScale(h, (uint16_t)accelFs, (uint16_t)gyroFs);
+    c.perG = (float)(1.0 / bsAccelPerG(h));
+    c.perDps = (float)(1.0 / bsGyroPerDps(h));
+    c.perQ = 1.0f / h.quatOne;
+}
+
+static bool deliverText(DevClient &c, const uint8_t* p, size_t len) {
+    DevEvent &e = c.ev;
+    if (!devDecodeJson((const char*)p, len, e)) {
+        c.st.malformed++;
+        return false;
+    }
+    if (e.kind == DEV_FRAME) {
+        if (c.replaying) {
+            e.flags |= DEV_REPLAY;
+            c.st.replayed++;
+        } else {
+            if (c.resuming) {
+                e.flags |= DEV_RESUMED;
+                c.st.resumed++;
+            }
+            trackSeq(c, e.frame.seq);
+        }
+        c.st.frames++;
+    } else if (e.kind == DEV_SHOT) {
+        c.st.shots++;
+    } else {
+        const DevInfo &i = e.info;
+        c.st.events++;
+        if (!strcmp(i.name, "replay")) {
+            c.replaying = !strcmp(i.state, "start");
+        } else if (!strcmp(i.name, "resume")) {
+            c.resuming = !strcmp(i.state, "start");
+            if (!c.resuming && i.seq >= 0) {
+                if (i.missed > 0) c.st.missed += i.missed;
+                // Live again from seq; "bin" packets are numbered from it
+                // and start over at a keyframe
+                c.nextSeq = (uint32_t)i.seq;
+                c.haveSeq = true;
+                c.binNext = (uint32_t)i.seq;
+                c.binSeq = true;
+                bsStreamDecoderInit(c.dec);
+            }
+        } else if (!strcmp(i.name, "bin") && i.seq >= 0 && !c.resuming) {
+            c.binNext = (uint32_t)i.seq;
+            c.binSeq = true;
+            setBinScales(c, i.accelFs, i.gyroFs);
+        }
+    }
+    emit(c);
+    return true;
+}
+
+static bool deliverBinary(DevClient &c, const uint8_t* p, size_t len) {
+    BsSample s;
+    uint32_t seq = c.binNext++;
+    if (!bsStreamDecode(c.dec, p, len, s)) {
+        c.st.lost++;                     // before the first keyframe
+        return false;
+    }
+    DevEvent &e = c.ev;
+    DevFrame &f = e.frame;
+    e.kind = DEV_FRAME;
+    e.flags = DEV_BIN;
+    f.seq = c.binSeq ? seq : 0;
+    f.tMs = (uint32_t)(s.tUs / 1000);
+    f.sampleUs = (uint32_t)s.tUs;
+    f.txUs = 0;
+    for (int i = 0; i < 3; i++) {
+        f.a[i] = s.a[i] * c.perG;
+        f.g[i] = s.g[i] * c.perDps;
+    }
+    for (int i = 0; i < 4; i++) f.q[i] = s.q[i] * c.perQ;
+    // rpm and label from the filtered gyro, as the page does for "bin"
+    f.rpm = sqrtf(f.g[0] * f.g[0] + f.g[1] * f.g[1] + f.g[2] * f.g[2]) / 6.0f;
+    copyStr(f.spin, sizeof(f.spin), bsSpinLabel(f.g[0], f.g[1], f.g[2], f.rpm), 11);
+    f.impact = (s.flags & BS_FLAG_IMPACT) != 0;
+    if (c.binSeq) trackSeq(c, seq);
+    c.st.frames++;
+    c.st.binFrames++;
+    emit(c);
+    return true;
+}
+
+// ==================== WebSocket framing ====================
+
+static bool sendFrame(DevClient &c, uint8_t op, const uint8_t* p, size_t len) {
+    if (c.fd < 0 || len > 0xFFFF) return false;
+    uint8_t out[8 + 0xFFFF];
+    size_t h = 0;
+    out[h++] = 0x80 | op;
+    if (len < 126) {
+        out[h++] = 0x80 | (uint8_t)len;
+    } else {
+        out[h++] = 0x80 | 126;
+        out[h++] = (uint8_t)(len >> 8);
+        out[h++] = (uint8_t)len;
+    }
+    // Client frames are masked (RFC 6455 5.3); xorshift key
+    uint32_t x = c.maskState;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    c.maskState = x;
+    uint8_t key[4] = {(uint8_t)x, (uint8_t)(x >> 8), (uint8_t)(x >> 16), (uint8_t)(x >> 24)};
+    memcpy(out + h, key, 4);
+    h += 4;
+    for (size_t i = 0; i < len; i++) out[h + i] = p[i] ^ key[i & 3];
+    size_t total = h + len, sent = 0;
+    while (sent < total) {
+        ssize_t n = send(c.fd, out + sent, total - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool devClientSend(DevClient &c, const char* text) {
+    return sendFrame(c, 0x1, (const uint8_t*)text, strlen(text));
+}
+
+// Parses the complete frames in rx; -1 on a protocol error or close
+static int parseRx(DevClient &c) {
+    int events = 0;
+    size_t off = 0;
+    uint8_t* b = c.rx.get();
+    while (c.rxLen - off >= 2) {
+        uint8_t* f = b + off;
+        size_t avail = c.rxLen - off;
+        bool fin = f[0] & 0x80;
+        uint8_t op = f[0] & 0x0F;
+        bool masked = f[1] & 0x80;
+        uint64_t len = f[1] & 0x7F;
+        size_t h = 2;
+        if (len == 126) {
+            if (avail < 4) break;
+            len = (uint64_t)f[2] << 8 | f[3];
+            h = 4;
+        } else if (len == 127) {
+            if (avail < 10) break;
+            len = 0;
+            for (int i = 0; i < 8; i++) len = len << 8 | f[2 + i];
+            h = 10;
+        }
+        if (masked) h += 4;
+        if (len > DEV_RX_MAX - 14) return -1;     // would never fit
+        if (avail < h + len) break;
+        uint8_t* p = f + h;
+        if (masked) {
+            for (uint64_t i = 0; i < len; i++) p[i] ^= f[h - 4 + (i & 3)];
+        }
+        off += h + len;
+
+        switch (op) {
+            case 0x0:                             // continuation
+                if (!c.msgOp || c.msgLen + len > DEV_RX_MAX) return -1;
+                memcpy(c.msg.get() + c.msgLen, p, len);
+                c.msgLen += len;
+                if (fin) {
+                    events += c.msgOp == 0x1 ? deliverText(c, c.msg.get(), c.msgLen)
+                                             : deliverBinary(c, c.msg.get(), c.msgLen);
+                    c.msgOp = 0;
+                    c.msgLen = 0;
+                }
+                break;
+            case 0x1:
+            case 0x2:
+                if (!fin) {
+                    memcpy(c.msg.get(), p, len);
+                    c.msgLen = len;
+                    c.msgOp = op;
+                } else {
+                    events += op == 0x1 ? deliverText(c, p, len) : deliverBinary(c, p, len);
+                }
+                break;
+            case 0x8:                             // close
+                return -1;
+            case 0x9:                             // ping
+                sendFrame(c, 0xA, p, len);
+                break;
+            default:
+                break;
+        }
+    }
+    if (off) {
+        memmove(b, b + off, c.rxLen - off);
+        c.rxLen -= off;
+    }
+    return events;
+}
+
+int devClientFeed(DevClient &c, const uint8_t* p, size_t len) {
+    int events = 0;
+    while (len) {
+        size_t n = DEV_RX_MAX - c.rxLen < len ? DEV_RX_MAX - c.rxLen : len;
+        memcpy(c.rx.get() + c.rxLen, p, n);
+        c.rxLen += n;
+        c.st.bytes += n;
+        p += n;
+        len -= n;
+        int r = parseRx(c);
+        if (r < 0) {
+            c.rxLen = 0;
+            return -1;
+        }
+        events += r;
+    }
+    return events;
+}
+
+// ==================== Connection ====================
+
+static void linkEvent(DevClient &c, bool up) {
+    c.ev.kind = DEV_LINK;
+    c.ev.flags = up ? DEV_UP : 0;
+    emit(c);
+}
+
+static void resetStream(DevClient &c) {
+    c.rxLen = 0;
+    c.msgLen = 0;
+    c.msgOp = 0;
+    c.resuming = c.replaying = false;
+    c.binSeq = false;
+    bsStreamDecoderInit(c.dec);
+}
+
+void devClientInit(DevClient &c, const DevClientConfig &cfg, DevSink sink, void* ctx) {
+    c.cfg = cfg;
+    c.sink = sink;
+    c.ctx = ctx;
+    c.fd = -1;
+    c.rx.reset(new uint8_t[DEV_RX_MAX]);
+    c.msg.reset(new uint8_t[DEV_RX_MAX]);
+    setBinScales(c, -1, -1);
+    c.haveSeq = false;
+    c.retryUs = 0;
+    c.backoffMs = cfg.reconnectMinMs;
+    c.st = DevStats();
+    resetStream(c);
+}
+
+static int connectTcp(const DevClientConfig &cfg, int timeoutMs) {
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    char port[8];
+    snprintf(port, sizeof(port), "%u", cfg.port);
+    if (getaddrinfo(cfg.host.c_str(), port, &hints, &res) != 0) return -1;
+    int fd = -1;
+    for (addrinfo* a = res; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) continue;
+        int fl = fcntl(fd, F_GETFL);
+        fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+        int r = connect(fd, a->ai_addr, a->ai_addrlen);
+        if (r < 0 && errno == EINPROGRESS) {
+            pollfd pf = {fd, POLLOUT, 0};
+            int err = 0;
+            socklen_t el = sizeof(err);
+            if (poll(&pf, 1, timeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &el) == 0 && !err) r = 0;
+        }
+        if (r < 0) {
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        fcntl(fd, F_SETFL, fl);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+// HTTP upgrade; the bytes after the response headers stay in rx
+static bool handshake(DevClient &c) {
+    static const char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char key[25];
+    for (int i = 0; i < 22; i++) {
+        c.maskState ^= c.maskState << 13; c.maskState ^= c.maskState >> 17; c.maskState ^= c.maskState << 5;
+        key[i] = B64[c.maskState & 63];
+    }
+    key[22] = key[23] = '=';
+    key[24] = '\0';
+    char req[512];
+    int n = snprintf(req, sizeof(req),
+                     "GET %s HTTP/1.1\r\nHost: %s:%u\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n",
+                     c.cfg.path.c_str(), c.cfg.host.c_str(), c.cfg.port, key);
+    if (send(c.fd, req, n, MSG_NOSIGNAL) != n) return false;
+
+    int64_t deadline = devNowUs() + 3000000;
+    c.rxLen = 0;
+    for (;;) {
+        pollfd pf = {c.fd, POLLIN, 0};
+        int wait = (int)((deadline - devNowUs()) / 1000);
+        if (wait <= 0 || poll(&pf, 1, wait) != 1) return false;
+        ssize_t r = recv(c.fd, c.rx.get() + c.rxLen, DEV_RX_MAX - 1 - c.rxLen, 0);
+        if (r <= 0) return false;
+        c.rxLen += r;
+        c.rx[c.rxLen] = 0;
+        const char* hdr = (const char*)c.rx.get();
+        const char* endHdr = strstr(hdr, "\r\n\r\n");
+        if (!endHdr) continue;
+        if (strncmp(hdr, "HTTP/1.1 101", 12) != 0) return false;
+        size_t used = endHdr + 4 - hdr;
+        memmove(c.rx.get(), c.rx.get() + used, c.rxLen - used);
+        c.rxLen -= used;
+        return true;
+    }
+}
+
+static bool connectDevice(DevClient &c) {
+    c.fd = connectTcp(c.cfg, 2000);
+    if (c.fd < 0) return false;
+    resetStream(c);
+    if (!handshake(c)) {
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+    c.st.connects++;
+    c.backoffMs = c.cfg.reconnectMinMs;
+    linkEvent(c, true);
+    // Resume before "bin": live packets only start once caught up
+    char cmd[32];
+    if (c.cfg.resume && c.haveSeq) {
+        snprintf(cmd, sizeof(cmd), "resume %lu", (unsigned long)c.nextSeq);
+        devClientSend(c, cmd);
+    }
+    if (c.cfg.binary) devClientSend(c, "bin");
+    return true;
+}
+
+void devClientDrop(DevClient &c) {
+    if (c.fd < 0) return;
+    close(c.fd);
+    c.fd = -1;
+    c.st.drops++;
+    c.retryUs = devNowUs() + (int64_t)c.backoffMs * 1000;
+    c.backoffMs = c.backoffMs * 2 < c.cfg.reconnectMaxMs ? c.backoffMs * 2 : c.cfg.reconnectMaxMs;
+    linkEvent(c, false);
+}
+
+void devClientClose(DevClient &c) {
+    if (c.fd >= 0) {
+        sendFrame(c, 0x8, nullptr, 0);
+        close(c.fd);
+    }
+    c.fd = -1;
+}
+
+int devClientPoll(DevClient &c, int timeoutMs) {
+    int64_t now = devNowUs();
+    if (c.fd < 0) {
+        if (now < c.retryUs) {
+            int64_t waitMs = (c.retryUs - now) / 1000;
+            usleep((useconds_t)(waitMs < timeoutMs ? waitMs : timeoutMs) * 1000);
+            return 0;
+        }
+        if (!connectDevice(c)) {
+            c.retryUs = devNowUs() + (int64_t)c.backoffMs * 1000;
+            c.backoffMs = c.backoffMs * 2 < c.cfg.reconnectMaxMs ? c.backoffMs * 2 : c.cfg.reconnectMaxMs;
+            return 0;
+        }
+        // Bytes that came with the handshake response
+        int r = parseRx(c);
+        if (r < 0) devClientDrop(c);
+        return r < 0 ? 0 : r;
+    }
+    pollfd pf = {c.fd, POLLIN, 0};
+    if (poll(&pf, 1, timeoutMs) != 1) return 0;
+    ssize_t n = recv(c.fd, c.rx.get() + c.rxLen, DEV_RX_MAX - c.rxLen, 0);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return 0;
+    if (n <= 0) {
+        devClientDrop(c);
+        return 0;
+    }
+    c.rxLen += n;
+    c.st.bytes += n;
+    int r = parseRx(c);
+    if (r < 0) {
+        devClientDrop(c);
+        return 0;
+    }
+    return r;
+}
+
+bool devParseUrl(const char* url, DevClientConfig &cfg) {
+    if (strncmp(url, "ws://", 5) != 0) return false;
+    const char* h = url + 5;
+    const char* slash = strchr(h, '/');
+    const char* hostEnd = slash ? slash : h + strlen(h);
+    const char* colon = (const char*)memchr(h, ':', hostEnd - h);
+    cfg.host.assign(h, (colon ? colon : hostEnd) - h);
+    cfg.port = colon ? (uint16_t)atoi(colon + 1) : 80;
+    cfg.path = slash ? slash : "/";
+    return !cfg.host.empty() && cfg.port != 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * Live stream client for the ball (or observer/emulator.py)
+ *
+ * One WebSocket connection to the device, decoded into fixed structs:
+ *
+ *   DEV_FRAME   50Hz frame: JSON text or "bin" stream packet (bsstream.h),
+ *               both become a DevFrame
+ *   DEV_SHOT    shot event
+ *   DEV_EVENT   any other event (pong, replay, resume, ...), name, the
+ *               fields the client itself uses and the JSON text
+ *   DEV_LINK    connection up / down
+ *
+ * Nothing is allocated per message: socket bytes land in a fixed receive
+ * buffer, WebSocket frames are unmasked and parsed in place, JSON is
+ * scanned key by key straight into the event (no DOM, no strings), and
+ * the event is handed to a sink. The sink is either a callback or
+ * devQueueSink, which copies it into a single-producer single-consumer
+ * ring (DevQueue) for another thread to pop.
+ *
+ * When the connection drops the client reconnects with backoff and, once
+ * it has seen a frame, asks for the frames it missed ("resume <seq>"):
+ * the device resends them from its last 10 s, then continues live. Frames
+ * carry the device frame seq; "bin" packets only have an 8-bit stream seq,
+ * so the client numbers them from the seq the device announces on "bin"
+ * and at the end of a resume. Frames of a replay (between its start and
+ * end events) are flagged and leave the seq alone.
+ *
+ * devClientFeed() runs the receive path on bytes from anywhere, so the
+ * decoders can be tested and benchmarked without a socket.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include "bsstream.h"
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+struct DevFrame {
+    uint32_t seq;               // device frame seq
+    uint32_t tMs;               // device millis()
+    uint32_t sampleUs;          // "ts": micros() of the read the values describe (0 in resent frames)
+    uint32_t txUs;              // "tx": micros() before sending (0 when not sent)
+    float    a[3];              // g
+    float    g[3];              // filtered gyro, deg/s
+    float    q[4];              // w, x, y, z
+    float    rpm;
+    char     spin[12];
+    uint8_t  impact;
+};
+
+struct DevShot {
+    uint32_t id;
+    uint32_t tMs;
+    float    rpm, peakG;
+    float    g[3];              // filtered gyro at the peak, deg/s
+    char     type[12];
+};
+
+static const size_t DEV_TEXT_MAX = 320;
+
+struct DevInfo {
+    char     name[16];          // "event" value
+    char     state[12];         // "state" value, if any
+    int64_t  seq, missed, frames, c, d;  // fields of that name, -1 when absent
+    int64_t  accelFs, gyroFs;   // "accel_fs" / "gyro_fs", -1 when absent
+    uint16_t len;               // of text (truncated to DEV_TEXT_MAX - 1)
+    char     text[DEV_TEXT_MAX];
+};
+
+enum DevKind : uint8_t { DEV_FRAME, DEV_SHOT, DEV_EVENT, DEV_LINK };
+
+enum DevFlags : uint8_t {
+    DEV_BIN     = 0x01,         // frame came as a "bin" packet
+    DEV_RESUMED = 0x02,         // frame resent after a reconnect
+    DEV_REPLAY  = 0x04,         // frame of a stored-session replay
+    DEV_UP      = 0x08,         // DEV_LINK: connected (else: lost)
+};
+
+struct DevEvent {
+    uint8_t kind;
+    uint8_t flags;
+    int64_t rxUs;               // host monotonic time, us
+    union {
+        DevFrame frame;
+        DevShot  shot;
+        DevInfo  info;          // DEV_EVENT
+    };
+};
+
+typedef void (*DevSink)(void* ctx, const DevEvent &e);
+
+// ==================== Queue ====================
+
+// Single producer, single consumer; capacity a power of two
+struct DevQueue {
+    std::unique_ptr<DevEvent[]> slots;
+    uint32_t                    mask = 0;
+    alignas(64) std::atomic<uint32_t> head{0};   // written by the producer
+    alignas(64) std::atomic<uint32_t> tail{0};   // written by the consumer
+    alignas(64) uint64_t        dropped = 0;     // pushes refused while full
+};
+
+void devQueueInit(DevQueue &q, uint32_t capacity);
+bool devQueuePush(DevQueue &q, const DevEvent &e);
+bool devQueuePop(DevQueue &q, DevEvent &e);
+
+// DevSink pushing into the DevQueue ctx points to
+void devQueueSink(void* ctx, const DevEvent &e);
+
+// ==================== Client ====================
+
+struct DevClientConfig {
+    std::string host = "192.168.4.1";
+    uint16_t    port = 81;
+    std::string path = "/";
+    bool        binary = false;         // ask for "bin" packets
+    bool        resume = true;          // "resume <seq>" after reconnecting
+    uint32_t    reconnectMinMs = 200;   // backoff doubles up to reconnectMaxMs
+    uint32_t    reconnectMaxMs = 5000;
+};
+
+struct DevStats {
+    uint64_t bytes = 0;
+    uint64_t frames = 0, binFrames = 0, resumed = 0, replayed = 0;
+    uint64_t shots = 0, events = 0;
+    uint64_t gaps = 0, lost = 0;        // seq jumps forward, and frames they skipped
+    uint64_t missed = 0;                // reported by the device: too old to resend
+    uint64_t connects = 0, drops = 0;
+    uint64_t malformed = 0;             // messages that decoded to nothing
+};
+
+static const size_t DEV_RX_MAX = 64 * 1024;
+
+struct DevClient {
+    DevClientConfig            cfg;
+    DevSink                    sink = nullptr;
+    void*                      ctx = nullptr;
+    int                        fd = -1;
+    std::unique_ptr<uint8_t[]> rx;       // socket bytes not yet parsed
+    size_t                     rxLen = 0;
+    std::unique_ptr<uint8_t[]> msg;      // fragmented message being assembled
+    size_t                     msgLen = 0;
+    uint8_t                    msgOp = 0;
+    BsStreamDecoder            dec;
+    float                      perG, perDps, perQ;   // "bin" packet scales, set on "bin"
+    bool                       haveSeq = false;
+    uint32_t                   nextSeq = 0;     // frame seq expected next
+    bool                       binSeq = false;  // binNext known
+    uint32_t                   binNext = 0;
+    bool                       resuming = false, replaying = false;
+    int64_t                    retryUs = 0;     // next connect attempt
+    uint32_t                   backoffMs = 0;
+    uint32_t                   maskState = 0x9E3779B9;
+    DevStats                   st;
+    DevEvent                   ev;              // decoded into, then passed to the sink
+};
+
+void devClientInit(DevClient &c, const DevClientConfig &cfg, DevSink sink, void* ctx);
+
+// Connects when down and due, waits up to timeoutMs for bytes and
+// delivers every complete message. Returns the events delivered.
+int devClientPoll(DevClient &c, int timeoutMs);
+
+// Text command to the device; false when not connected
+bool devClientSend(DevClient &c, const char* text);
+
+// Drops the connection (it is made again on the next poll when due)
+void devClientDrop(DevClient &c);
+void devClientClose(DevClient &c);
+
+// Receive path on raw WebSocket bytes (server to client); returns the
+// events delivered. False-y framing errors drop the connection.
+int devClientFeed(DevClient &c, const uint8_t* p, size_t len);
+
+// One JSON message into e (DEV_FRAME, DEV_SHOT or DEV_EVENT); false if
+// it is not a JSON object or names no known message
+bool devDecodeJson(const char* p, size_t len, DevEvent &e);
+
+// "ws://host[:port][/path]"; false if it is not one
+bool devParseUrl(const char* url, DevClientConfig &cfg);
+
+// Host monotonic time, us
+int64_t devNowUs();
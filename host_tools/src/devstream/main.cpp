@@ -0,0 +1,434 @@
+/**
+ * devstream - live frames from the ball (or observer/emulator.py)
+ *
+ * Usage:
+ *   devstream [--bin] [--no-resume] [--queue] [--seconds S] [--drop-every S] [ws://host:port]
+ *   devstream --bench [--frames N]
+ *
+ * Connects with devclient.h (default ws://192.168.4.1:81), prints one line
+ * per second: frames/s, how many came as "bin" packets or were resent on
+ * resume, seq gaps, shots and connection state. Shots and other events are
+ * printed as they come. At the end: seq coverage of everything received
+ * (frames missing, duplicates, frames the device could no longer resend).
+ *
+ *   --bin          ask for "bin" stream packets instead of JSON frames
+ *   --no-resume    reconnect without "resume <seq>" (to see the gaps)
+ *   --queue        events go through the lock-free queue to a second thread
+ *                  instead of being handled in the receive callback
+ *   --drop-every S drop the connection every S seconds, to test reconnect
+ *                  and resume
+ *
+ * --bench measures the receive path without a socket: device-format JSON
+ * frames and "bin" packets from the synthetic rally, wrapped in WebSocket
+ * frames, fed through devClientFeed() in TCP-segment sized pieces on one
+ * core, then through the queue to a consumer thread. Counts heap
+ * allocations made while decoding (there should be none).
+ */
+
+#include "devclient.h"
+#include "sessionout.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: devstream [--bin] [--no-resume] [--queue] [--seconds S] [--drop-every S] [ws://host:port]\n"
+            "       devstream --bench [--frames N]\n");
+    exit(2);
+}
+
+// Heap allocations, to show the receive path makes none
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ==================== Live ====================
+
+// Frame seq coverage; a bit per seq from the first one seen
+struct Coverage {
+    bool                 started = false;
+    uint32_t             first = 0, last = 0;
+    std::vector<uint8_t> seen;
+    uint64_t             unique = 0, dups = 0;
+};
+
+static void coverageAdd(Coverage &cv, uint32_t seq) {
+    if (!cv.started) {
+        cv.started = true;
+        cv.first = cv.last = seq;
+    }
+    int64_t i = (int64_t)(seq - cv.first);
+    if (i < 0 || i > (1 << 28)) return;              // device reset
+    if ((size_t)i >= cv.seen.size() * 8) cv.seen.resize(cv.seen.size() * 2 + i / 8 + 1024);
+    uint8_t bit = 1 << (i & 7);
+    if (cv.seen[i >> 3] & bit) {
+        cv.dups++;
+    } else {
+        cv.seen[i >> 3] |= bit;
+        cv.unique++;
+    }
+    if ((int32_t)(seq - cv.last) > 0) cv.last = seq;
+}
+
+struct Live {
+    Coverage cv;
+    uint64_t frames = 0, bin = 0, resumed = 0, replay = 0, shots = 0;
+    uint64_t impacts = 0;
+    bool     up = false;
+};
+
+static void handle(Live &lv, const DevEvent &e) {
+    switch (e.kind) {
+        case DEV_FRAME:
+            if (e.flags & DEV_REPLAY) {
+                lv.replay++;
+                break;
+            }
+            lv.frames++;
+            if (e.flags & DEV_BIN) lv.bin++;
+            if (e.flags & DEV_RESUMED) lv.resumed++;
+            if (e.frame.impact) lv.impacts++;
+            // "bin" packets before the device announced a seq are not numbered
+            if (!(e.flags & DEV_BIN) || e.frame.seq) coverageAdd(lv.cv, e.frame.seq);
+            break;
+        case DEV_SHOT:
+            lv.shots++;
+            printf("  shot #%u  %.0f rpm  %.1f g  %s\n", e.shot.id, e.shot.rpm, e.shot.peakG, e.shot.type);
+            break;
+        case DEV_EVENT:
+            printf("  %s\n", e.info.text);
+            break;
+        case DEV_LINK:
+            lv.up = e.flags & DEV_UP;
+            printf("  link %s\n", lv.up ? "up" : "down");
+            break;
+    }
+}
+
+static void liveSink(void* ctx, const DevEvent &e) { handle(*(Live*)ctx, e); }
+
+static int runLive(const DevClientConfig &cfg, double seconds, double dropEvery, bool useQueue) {
+    Live lv;
+    DevQueue q;
+    std::atomic<bool> done{false};
+    std::thread consumer;
+    DevClient c;
+    if (useQueue) {
+        devQueueInit(q, 4096);
+        devClientInit(c, cfg, devQueueSink, &q);
+        consumer = std::thread([&] {
+            DevEvent e;
+            while (!done.load(std::memory_order_acquire)) {
+                if (devQueuePop(q, e)) handle(lv, e);
+                else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            while (devQueuePop(q, e)) handle(lv, e);
+        });
+    } else {
+        devClientInit(c, cfg, liveSink, &lv);
+    }
+
+    printf("%s ws://%s:%u%s%s%s\n", useQueue ? "queue" : "callback", cfg.host.c_str(), cfg.port,
+           cfg.path.c_str(), cfg.binary ? ", bin" : "", cfg.resume ? ", resume" : "");
+    double t0 = hostSeconds(), lastPrint = t0, lastDrop = t0;
+    uint64_t lastFrames = 0;
+    while (seconds <= 0 || hostSeconds() - t0 < seconds) {
+        devClientPoll(c, 50);
+        double now = hostSeconds();
+        if (dropEvery > 0 && now - lastDrop >= dropEvery) {
+            lastDrop = now;
+            devClientDrop(c);
+        }
+        if (now - lastPrint >= 1.0) {
+            // Counters from the client side, safe to read with the queue too
+            const DevStats &st = c.st;
+            printf("%6.0f s  %4.0f frames/s  bin %llu  resumed %llu  replay %llu  gaps %llu (%llu lost)  "
+                   "shots %llu  %s\n",
+                   now - t0, (st.frames - lastFrames) / (now - lastPrint), (unsigned long long)st.binFrames,
+                   (unsigned long long)st.resumed, (unsigned long long)st.replayed,
+                   (unsigned long long)st.gaps, (unsigned long long)st.lost, (unsigned long long)st.shots,
+                   c.fd >= 0 ? "up" : "down");
+            fflush(stdout);
+            lastFrames = st.frames;
+            lastPrint = now;
+        }
+    }
+    devClientClose(c);
+    if (useQueue) {
+        done.store(true, std::memory_order_release);
+        consumer.join();
+    }
+
+    const DevStats &st = c.st;
+    const Coverage &cv = lv.cv;
+    uint64_t span = cv.started ? (uint64_t)(cv.last - cv.first) + 1 : 0;
+    printf("%llu frames (%llu bin, %llu resent on resume), %llu replay frames, %llu shots, %llu events, "
+           "%.1f KB\n",
+           (unsigned long long)lv.frames, (unsigned long long)lv.bin, (unsigned long long)lv.resumed,
+           (unsigned long long)lv.replay, (unsigned long long)lv.shots, (unsigned long long)st.events,
+           st.bytes / 1024.0);
+    printf("seq %u..%u: %llu of %llu received (%.3f%%), %llu missing, %llu duplicates\n", cv.first, cv.last,
+           (unsigned long long)cv.unique, (unsigned long long)span, span ? 100.0 * cv.unique / span : 0.0,
+           (unsigned long long)(span - cv.unique), (unsigned long long)cv.dups);
+    printf("%llu connects, %llu drops, %llu gaps seen live (%llu frames), %llu too old to resend, "
+           "%llu malformed, %llu queue drops\n",
+           (unsigned long long)st.connects, (unsigned long long)st.drops, (unsigned long long)st.gaps,
+           (unsigned long long)st.lost, (unsigned long long)st.missed, (unsigned long long)st.malformed,
+           (unsigned long long)q.dropped);
+    return 0;
+}
+
+// ==================== Bench ====================
+
+static const double MIN_BENCH_SEC = 1.0;
+
+// Server-to-client frame header (unmasked)
+static void wsWrap(std::vector<uint8_t> &out, uint8_t op, const uint8_t* p, size_t len) {
+    out.push_back(0x80 | op);
+    if (len < 126) {
+        out.push_back((uint8_t)len);
+    } else {
+        out.push_back(126);
+        out.push_back((uint8_t)(len >> 8));
+        out.push_back((uint8_t)len);
+    }
+    out.insert(out.end(), p, p + len);
+}
+
+struct BenchInput {
+    BsFileHeader         h;
+    std::vector<BsSample> samples;
+};
+
+static void benchCollect(void* ctx, const BsSample &s) { ((BenchInput*)ctx)->samples.push_back(s); }
+static void benchShot(void*, const BsShot &) {}
+
+struct BenchCount {
+    uint64_t frames = 0;
+    double   sum = 0;                   // keeps the decode from being optimised away
+};
+
+static void benchSink(void* ctx, const DevEvent &e) {
+    BenchCount &b = *(BenchCount*)ctx;
+    if (e.kind == DEV_FRAME) {
+        b.frames++;
+        b.sum += e.frame.g[2] + e.frame.q[0];
+    }
+}
+
+struct BenchCheck {
+    const BenchInput* in;
+    size_t            next;
+    uint64_t          bad;
+};
+
+// Decoded frame against the sample it came from, within the printed precision
+static void benchCheck(void* ctx, const DevEvent &e) {
+    BenchCheck &b = *(BenchCheck*)ctx;
+    if (e.kind != DEV_FRAME) return;
+    const BsFileHeader &h = b.in->h;
+    const BsSample &s = b.in->samples[b.next];
+    bool ok = e.frame.seq == b.next && e.frame.sampleUs == (uint32_t)s.tUs &&
+              e.frame.impact == ((s.flags & BS_FLAG_IMPACT) != 0);
+    for (int k = 0; k < 3; k++) {
+        ok &= fabs(e.frame.a[k] - (double)s.a[k] / bsAccelPerG(h)) < 6e-4;
+        ok &= fabs(e.frame.g[k] - (double)s.g[k] / bsGyroPerDps(h)) < 0.06;
+    }
+    for (int k = 0; k < 4; k++) ok &= fabs(e.frame.q[k] - (double)s.q[k] / h.quatOne) < 6e-5;
+    b.bad += !ok;
+    b.next++;
+}
+
+// Feeds the stream in 1460-byte pieces (one TCP segment) until MIN_BENCH_SEC;
+// returns ns per frame
+static double benchFeed(const char* name, const std::vector<uint8_t> &ws, size_t messages, size_t jsonBytes) {
+    DevClientConfig cfg;
+    DevClient c;
+    BenchCount b;
+    devClientInit(c, cfg, benchSink, &b);
+    c.binSeq = true;
+    uint64_t allocBefore = allocations.load();
+    double t0 = hostSeconds(), sec = 0;
+    int reps = 0;
+    while (sec < MIN_BENCH_SEC) {
+        for (size_t off = 0; off < ws.size(); off += 1460) {
+            size_t n = ws.size() - off < 1460 ? ws.size() - off : 1460;
+            devClientFeed(c, ws.data() + off, n);
+        }
+        reps++;
+        sec = hostSeconds() - t0;
+    }
+    uint64_t allocs = allocations.load() - allocBefore;
+    double frames = (double)messages * reps;
+    printf("  %-22s %7.2f M frames/s  %6.0f MB/s  %5.0f ns/frame  %.1f bytes/frame  %llu allocations%s\n", name,
+           frames / sec / 1e6, (double)ws.size() * reps / sec / 1e6, sec / frames * 1e9,
+           (double)jsonBytes / messages, (unsigned long long)allocs,
+           b.frames == (uint64_t)frames && c.st.malformed == 0 ? "" : "  MISMATCH");
+    return sec / frames * 1e9;
+}
+
+static int runBench(uint32_t nFrames) {
+    BenchInput in;
+    bsFileHeaderInit(in.h, 0, 50, BS_COLS_ALL, "bench");
+    TraceCallbacks cb = {benchCollect, benchShot, &in};
+    TraceStats ts = {};
+    traceSynthetic(nFrames / 50.0 + 1, 50, 1, in.h, cb, ts);
+    if (in.samples.size() > nFrames) in.samples.resize(nFrames);
+    size_t n = in.samples.size();
+
+    // Device frames: FRAME_FMT of the firmware with the same values
+    std::vector<uint8_t> wsJson, wsBin;
+    std::vector<std::vector<char>> json;
+    size_t jsonBytes = 0, binBytes = 0;
+    BsStreamEncoder enc;
+    bsStreamInit(enc, BS_COLS_ALL, 2, 50);
+    uint8_t packet[BS_STREAM_MAX];
+    for (size_t i = 0; i < n; i++) {
+        const BsSample &s = in.samples[i];
+        double a[3], g[3], q[4];
+        for (int k = 0; k < 3; k++) {
+            a[k] = (double)s.a[k] / bsAccelPerG(in.h);
+            g[k] = (double)s.g[k] / bsGyroPerDps(in.h);
+        }
+        for (int k = 0; k < 4; k++) q[k] = (double)s.q[k] / in.h.quatOne;
+        double rpm = sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]) / 6.0;
+        char buf[400];
+        int len = snprintf(buf, sizeof(buf),
+                           "{\"t\":%lu,\"seq\":%lu,\"ts\":%lu,"
+                           "\"ax\":%.3f,\"ay\":%.3f,\"az\":%.3f,"
+                           "\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,"
+                           "\"qw\":%.4f,\"qx\":%.4f,\"qy\":%.4f,\"qz\":%.4f,"
+                           "\"rpm\":%.0f,\"spin\":\"%s\",\"imp\":%d,\"tx\":%010lu}",
+                           (unsigned long)(s.tUs / 1000), (unsigned long)i, (unsigned long)s.tUs,
+                           a[0], a[1], a[2], g[0], g[1], g[2], q[0], q[1], q[2], q[3], rpm,
+                           traceSpinLabel(g[0], g[1], g[2], rpm), (s.flags & BS_FLAG_IMPACT) ? 1 : 0,
+                           (unsigned long)(s.tUs + 900));
+        json.emplace_back(buf, buf + len);
+        wsWrap(wsJson, 0x1, (const uint8_t*)buf, len);
+        jsonBytes += len;
+        size_t plen = bsStreamEncode(enc, s, packet);
+        wsWrap(wsBin, 0x2, packet, plen);
+        binBytes += plen;
+    }
+    printf("%zu frames of the synthetic rally, JSON %.1f bytes/frame, bin %.1f bytes/frame\n", n,
+           (double)jsonBytes / n, (double)binBytes / n);
+
+    // Round trip: every frame back to the values it was printed from
+    {
+        BenchCheck chk = {&in, 0, 0};
+        DevClientConfig cfg;
+        DevClient c;
+        devClientInit(c, cfg, benchCheck, &chk);
+        devClientFeed(c, wsJson.data(), wsJson.size());
+        c.binSeq = true;
+        c.binNext = 0;
+        chk.next = 0;
+        devClientFeed(c, wsBin.data(), wsBin.size());
+        printf("round trip: %llu of %zu frames differ\n", (unsigned long long)chk.bad, 2 * n);
+    }
+
+    // JSON decode alone (message boundaries known)
+    {
+        DevEvent e;
+        double sum = 0;
+        uint64_t ok = 0, allocBefore = allocations.load();
+        double t0 = hostSeconds(), sec = 0;
+        int reps = 0;
+        while (sec < MIN_BENCH_SEC) {
+            for (const std::vector<char> &m : json) {
+                ok += devDecodeJson(m.data(), m.size(), e);
+                sum += e.frame.g[2];
+            }
+            reps++;
+            sec = hostSeconds() - t0;
+        }
+        double frames = (double)n * reps;
+        printf("  %-22s %7.2f M frames/s  %6.0f MB/s  %5.0f ns/frame  %.1f bytes/frame  %llu allocations%s\n",
+               "devDecodeJson", frames / sec / 1e6, (double)jsonBytes * reps / sec / 1e6, sec / frames * 1e9,
+               (double)jsonBytes / n, (unsigned long long)(allocations.load() - allocBefore),
+               ok == (uint64_t)frames && sum == sum ? "" : "  MISMATCH");
+    }
+
+    double jsonNs = benchFeed("feed JSON (WebSocket)", wsJson, n, jsonBytes);
+    benchFeed("feed bin (WebSocket)", wsBin, n, binBytes);
+
+    // Through the queue: the receive path on this thread, a consumer
+    // thread popping (with one core the two just take turns)
+    {
+        DevQueue q;
+        devQueueInit(q, 4096);
+        DevClientConfig cfg;
+        DevClient c;
+        devClientInit(c, cfg, devQueueSink, &q);
+        std::atomic<bool> done{false};
+        uint64_t popped = 0;
+        std::thread consumer([&] {
+            DevEvent e;
+            for (;;) {
+                if (devQueuePop(q, e)) popped++;
+                else if (done.load(std::memory_order_acquire)) break;
+                else std::this_thread::yield();
+            }
+            while (devQueuePop(q, e)) popped++;
+        });
+        uint64_t pushed = 0;
+        double t0 = hostSeconds(), sec = 0;
+        while (sec < MIN_BENCH_SEC) {
+            for (size_t off = 0; off < wsJson.size(); off += 1460) {
+                size_t m = wsJson.size() - off < 1460 ? wsJson.size() - off : 1460;
+                pushed += devClientFeed(c, wsJson.data() + off, m);
+                // Back-pressure instead of drops: wait for room
+                while (q.head.load(std::memory_order_relaxed) - q.tail.load(std::memory_order_acquire) > q.mask / 2)
+                    std::this_thread::yield();
+            }
+            sec = hostSeconds() - t0;
+        }
+        done.store(true, std::memory_order_release);
+        consumer.join();
+        sec = hostSeconds() - t0;
+        printf("  %-22s %7.2f M frames/s  %llu of %llu popped, %llu dropped (%u hardware threads)\n",
+               "feed JSON -> queue", popped / sec / 1e6, (unsigned long long)popped, (unsigned long long)pushed,
+               (unsigned long long)q.dropped, std::thread::hardware_concurrency());
+    }
+    printf("one ball at 50 frames/s: %.4f%% of a core for JSON\n", 50 * jsonNs * 1e-9 * 100);
+    return 0;
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+    DevClientConfig cfg;
+    double seconds = 0, dropEvery = 0;
+    bool useQueue = false, bench = false;
+    uint32_t benchFrames = 50000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bin")) cfg.binary = true;
+        else if (!strcmp(argv[i], "--no-resume")) cfg.resume = false;
+        else if (!strcmp(argv[i], "--queue")) useQueue = true;
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--drop-every") && i + 1 < argc) dropEvery = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--bench")) bench = true;
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) benchFrames = (uint32_t)atoi(argv[++i]);
+        else if (argv[i][0] == '-') usage();
+        else if (!devParseUrl(argv[i], cfg)) usage();
+    }
+    if (bench) return benchFrames ? runBench(benchFrames) : 2;
+    return runLive(cfg, seconds, dropEvery, useQueue);
+}
@@ -0,0 +1,208 @@
+/**
+ * filterbench - response and speed of the decimation filter bank
+ *
+ * Usage:
+ *   filterbench [--rate HZ] [--branch FACTOR:TAPS ...] [--seconds S]
+ *
+ * For every branch (default: the ball's 4:24 stream and 6:24 screen
+ * branches, plus 2:12) prints the output rate, the group delay, the
+ * worst passband deviation up to a quarter of the output rate and the
+ * weakest rejection of what would alias onto that band (input
+ * frequencies from 3/4 of the output rate up to half the input rate).
+ * The same figures are given for what the bank replaces: taking every
+ * FACTOR-th sample, and the 0.15 exponential average (bsFuse's display
+ * filter) run at the input rate then sampled.
+ *
+ * Then runs the bank over S seconds of the synthetic rally (trace.h) at
+ * the input rate, checks every output against a direct convolution and
+ * reports ns per input sample, for the whole bank and per branch.
+ */
+
+#include "bsdecimate.h"
+#include "sessionout.h"
+#include "trace.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static void usage() {
+    fprintf(stderr, "usage: filterbench [--rate HZ] [--branch FACTOR:TAPS ...] [--seconds S]\n");
+    exit(2);
+}
+
+static const double MIN_BENCH_SEC = 0.5;   // repeat runs until this long
+static const double EMA_ALPHA = 0.15;
+
+struct BranchSpec { int factor, taps; };
+
+static void onSample(void* ctx, const BsSample &s) {
+    ((std::vector<BsSample>*)ctx)->push_back(s);
+}
+static void onShot(void*, const BsShot &) {}
+
+// ==================== Response ====================
+
+// |H(f)| of the 0.15 exponential average, f in cycles per input sample
+static double emaGain(double f) {
+    double re = 1.0 - (1.0 - EMA_ALPHA) * cos(2.0 * M_PI * f);
+    double im = (1.0 - EMA_ALPHA) * sin(2.0 * M_PI * f);
+    return EMA_ALPHA / sqrt(re * re + im * im);
+}
+
+// Worst passband deviation (dB) and weakest alias rejection (dB) of a
+// response, factor being the decimation (pass: 0..1/4, alias: 3/4..factor/2
+// of the output rate; no alias band at factor 1: NAN)
+template <typename Gain>
+static void bands(Gain gain, int factor, double &passDb, double &rejectDb) {
+    double fo = 1.0 / factor;
+    passDb = 0.0;
+    for (int i = 0; i <= 100; i++) {
+        double db = 20.0 * log10(gain(0.25 * fo * i / 100));
+        if (fabs(db) > fabs(passDb)) passDb = db;
+    }
+    if (factor == 1) {
+        rejectDb = NAN;
+        return;
+    }
+    double worst = 0.0;
+    for (int i = 0; i <= 1000; i++) {
+        double f = 0.75 * fo + (0.5 - 0.75 * fo) * i / 1000;
+        if (gain(f) > worst) worst = gain(f);
+    }
+    rejectDb = worst > 0 ? -20.0 * log10(worst) : 999.0;
+}
+
+static void printRow(const char* name, double outHz, double delayMs, double passDb, double rejectDb) {
+    if (isnan(rejectDb)) {
+        printf("  %-16s %7.1f Hz  %6.1f ms  %+6.2f dB  %9s\n", name, outHz, delayMs, passDb, "-");
+        return;
+    }
+    printf("  %-16s %7.1f Hz  %6.1f ms  %+6.2f dB  %6.1f dB\n", name, outHz, delayMs, passDb, rejectDb);
+}
+
+// ==================== Speed and check ====================
+
+static void toInput(const BsSample &s, const BsFileHeader &h, float in[BS_DEC_CHANNELS]) {
+    for (int k = 0; k < 3; k++) in[k] = s.a[k] / (float)bsAccelPerG(h);
+    for (int k = 0; k < 3; k++) in[3 + k] = s.g[k] / (float)bsGyroPerDps(h);
+}
+
+// ns per input of pushing every sample through the bank
+static double benchPush(BsDecimator &d, const std::vector<float> &in, size_t n) {
+    int reps = 0;
+    double t0 = hostSeconds(), sec = 0;
+    volatile float sink = 0;
+    while (sec < MIN_BENCH_SEC) {
+        bsDecReset(d);
+        for (size_t i = 0; i < n; i++) {
+            if (bsDecPush(d, &in[i * BS_DEC_CHANNELS])) sink = sink + d.b[0].out[0];
+        }
+        reps++;
+        sec = hostSeconds() - t0;
+    }
+    return sec / ((double)reps * n) * 1e9;
+}
+
+// Every output of every branch against the plain convolution at that input
+static bool checkDirect(BsDecimator &d, const std::vector<float> &in, size_t n, double &maxErr) {
+    bsDecReset(d);
+    maxErr = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t ready = bsDecPush(d, &in[i * BS_DEC_CHANNELS]);
+        for (int k = 0; k < d.branches; k++) {
+            if (!((ready >> k) & 1)) continue;
+            const BsDecBranch &b = d.b[k];
+            if ((i + 1) % b.factor) return false;       // outputs on every factor-th input
+            for (int c = 0; c < BS_DEC_CHANNELS; c++) {
+                double y = 0.0;
+                for (int t = 0; t < b.taps; t++) {
+                    long j = (long)i - (b.taps - 1) + t;
+                    if (j >= 0) y += b.coef[t] * in[j * BS_DEC_CHANNELS + c];
+                }
+                double err = fabs(y - b.out[c]) / (1.0 + fabs(y));
+                if (err > maxErr) maxErr = err;
+            }
+        }
+    }
+    return maxErr < 1e-5;
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+    uint16_t rate = 200;
+    double seconds = 600;
+    std::vector<BranchSpec> specs;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--rate") && more)         rate = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--seconds") && more) seconds = atof(argv[++i]);
+        else if (!strcmp(a, "--branch") && more) {
+            BranchSpec s;
+            if (sscanf(argv[++i], "%d:%d", &s.factor, &s.taps) != 2) usage();
+            specs.push_back(s);
+        } else usage();
+    }
+    if (specs.empty()) specs = {{4, 24}, {6, 24}, {2, 12}};
+    if (rate == 0 || seconds <= 0) usage();
+
+    BsDecimator d;
+    bsDecInit(d);
+    for (const BranchSpec &s : specs) {
+        if (s.factor < 1 || s.factor > 255 || bsDecAddBranch(d, (uint8_t)s.factor, (uint16_t)s.taps) < 0) {
+            fprintf(stderr, "branch %d:%d: factor 1..255, taps 1..%d, at most %d branches\n",
+                    s.factor, s.taps, BS_DEC_MAX_TAPS, BS_DEC_MAX_BRANCHES);
+            return 2;
+        }
+    }
+
+    printf("Input %u Hz. Passband: up to 1/4 of the output rate; alias rejection: from 3/4 of it\n", rate);
+    printf("  %-16s %10s  %9s  %9s  %9s\n", "", "output", "delay", "passband", "alias");
+    for (int k = 0; k < d.branches; k++) {
+        const BsDecBranch &b = d.b[k];
+        double outHz = (double)rate / b.factor;
+        double passDb, rejectDb;
+        char name[32];
+        snprintf(name, sizeof(name), "fir %u:%u", b.factor, b.taps);
+        bands([&](double f) { return (double)bsDecGain(d, k, (float)f); }, b.factor, passDb, rejectDb);
+        printRow(name, outHz, bsDecDelay(d, k) * 1e3 / rate, passDb, rejectDb);
+        snprintf(name, sizeof(name), "every %u", b.factor);
+        printRow(name, outHz, 0.0, 0.0, b.factor == 1 ? NAN : 0.0);
+        snprintf(name, sizeof(name), "ema 0.15 + %u", b.factor);
+        bands(emaGain, b.factor, passDb, rejectDb);
+        printRow(name, outHz, (1.0 - EMA_ALPHA) / EMA_ALPHA * 1e3 / rate, passDb, rejectDb);
+    }
+
+    std::vector<BsSample> samples;
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, rate, BS_COLS_ALL, "synthetic");
+    TraceCallbacks cb = {onSample, onShot, &samples};
+    TraceStats st;
+    traceSynthetic(seconds, rate, 1, h, cb, st);
+    size_t n = samples.size();
+    if (n == 0) {
+        fprintf(stderr, "no samples\n");
+        return 1;
+    }
+    std::vector<float> in(n * BS_DEC_CHANNELS);
+    for (size_t i = 0; i < n; i++) toInput(samples[i], h, &in[i * BS_DEC_CHANNELS]);
+
+    double maxErr;
+    bool ok = checkDirect(d, in, n, maxErr);
+    printf("\n%zu samples, %d channels: outputs %s direct convolution (max rel. error %.1e)\n",
+           n, BS_DEC_CHANNELS, ok ? "match" : "DO NOT MATCH", maxErr);
+
+    printf("  %-16s %6.1f ns/input\n", "bank", benchPush(d, in, n));
+    for (const BranchSpec &s : specs) {
+        BsDecimator one;
+        bsDecInit(one);
+        bsDecAddBranch(one, (uint8_t)s.factor, (uint16_t)s.taps);
+        char name[32];
+        snprintf(name, sizeof(name), "fir %d:%d", s.factor, one.b[0].taps);
+        printf("  %-16s %6.1f ns/input\n", name, benchPush(one, in, n));
+    }
+    return ok ? 0 : 1;
+}
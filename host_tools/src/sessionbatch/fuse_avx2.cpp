@@ -0,0 +1,30 @@
+/**
+ * AVX2 fusion kernel: 8 lanes per __m256 - see fusekernel.h
+ *
+ * Only this file is compiled for AVX2; fuseKernelPick() calls it after
+ * checking the CPU, so the binary still runs on x86-64 without AVX2.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC target("avx2")
+
+#include <immintrin.h>
+#include "fusevec.h"
+
+namespace {
+
+struct Avx2 {
+    typedef float   F __attribute__((vector_size(32)));
+    typedef int32_t I __attribute__((vector_size(32)));
+    static const uint32_t W = 8;
+    static F sqrt(F v) { return (F)_mm256_sqrt_ps((__m256)v); }
+};
+
+}  // namespace
+
+void fuseLanesAvx2(FuseLanes &s, const float* in, float* out, uint32_t steps) {
+    FuseVec<Avx2>::run(s, in, out, steps);
+}
+
+#endif
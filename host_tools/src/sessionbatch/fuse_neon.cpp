@@ -0,0 +1,25 @@
+/**
+ * NEON fusion kernel: 8 lanes as two float32x4_t halves - see fusekernel.h
+ */
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+#include "fusevec.h"
+
+namespace {
+
+struct Neon {
+    typedef float   F __attribute__((vector_size(16)));
+    typedef int32_t I __attribute__((vector_size(16)));
+    static const uint32_t W = 4;
+    static F sqrt(F v) { return (F)vsqrtq_f32((float32x4_t)v); }
+};
+
+}  // namespace
+
+void fuseLanesNeon(FuseLanes &s, const float* in, float* out, uint32_t steps) {
+    FuseVec<Neon>::run(s, in, out, steps);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * Lane-parallel fusion kernels - see fusekernel.h
+ */
+
+#include "fusekernel.h"
+#include <string.h>
+
+void fuseLaneSet(FuseLanes &s, uint32_t lane, const BsPipeline &p) {
+    s.qw[lane] = p.orient.w;
+    s.qx[lane] = p.orient.x;
+    s.qy[lane] = p.orient.y;
+    s.qz[lane] = p.orient.z;
+    s.biasX[lane] = p.biasX;
+    s.biasY[lane] = p.biasY;
+    s.biasZ[lane] = p.biasZ;
+    s.filtGx[lane] = p.filtGx;
+    s.filtGy[lane] = p.filtGy;
+    s.filtGz[lane] = p.filtGz;
+    s.filtRpm[lane] = p.filtRpm;
+}
+
+void fuseLaneGet(const FuseLanes &s, uint32_t lane, BsPipeline &p) {
+    p.orient = {s.qw[lane], s.qx[lane], s.qy[lane], s.qz[lane]};
+    p.biasX = s.biasX[lane];
+    p.biasY = s.biasY[lane];
+    p.biasZ = s.biasZ[lane];
+    p.filtGx = s.filtGx[lane];
+    p.filtGy = s.filtGy[lane];
+    p.filtGz = s.filtGz[lane];
+    p.filtRpm = s.filtRpm[lane];
+}
+
+void fuseLanesScalar(FuseLanes &s, const float* in, float* out, uint32_t steps) {
+    const uint32_t L = FUSE_LANES;
+    for (uint32_t lane = 0; lane < L; lane++) {
+        BsPipeline p;
+        fuseLaneGet(s, lane, p);
+        const float* x = in + lane;
+        float* y = out + lane;
+        for (uint32_t i = 0; i < steps; i++, x += FUSE_IN * L, y += FUSE_OUT * L) {
+            bsFuse(p, x[0], x[L], x[2 * L], x[3 * L]);
+            y[0] = p.filtGx;
+            y[L] = p.filtGy;
+            y[2 * L] = p.filtGz;
+            y[3 * L] = p.filtRpm;
+            y[4 * L] = p.orient.w;
+            y[5 * L] = p.orient.x;
+            y[6 * L] = p.orient.y;
+            y[7 * L] = p.orient.z;
+        }
+        fuseLaneSet(s, lane, p);
+    }
+}
+
+static bool hasAvx2() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+FuseKernelInfo fuseKernelPick(const char* name) {
+    bool any = !strcmp(name, "auto");
+#if defined(__x86_64__) || defined(__i386__)
+    if ((any && hasAvx2()) || !strcmp(name, "avx2")) return {"avx2", hasAvx2() ? fuseLanesAvx2 : nullptr};
+#endif
+#if defined(__aarch64__)
+    if (any || !strcmp(name, "neon")) return {"neon", fuseLanesNeon};
+#endif
+    if (any || !strcmp(name, "scalar")) return {"scalar", fuseLanesScalar};
+    return {name, nullptr};
+}
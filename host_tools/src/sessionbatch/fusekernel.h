@@ -0,0 +1,70 @@
+/**
+ * Lane-parallel fusion kernels for batch re-analysis
+ *
+ * bsFuse integrates one sample of one session; a session is a strict
+ * chain of them, so its only parallelism is across sessions. These
+ * kernels run bsFuse for FUSE_LANES independent sessions in lockstep,
+ * one vector lane per session, over a block of steps. State and samples
+ * are kept lane-wise (structure of arrays):
+ *
+ *   in  [step][FUSE_IN][lane]    gx, gy, gz (deg/s), dt (s)
+ *   out [step][FUSE_OUT][lane]   filtGx, filtGy, filtGz, filtRpm, qw, qx, qy, qz
+ *
+ * Impact detection stays scalar per lane (bsDetect), reading the fused
+ * values of each step from out.
+ *
+ *   scalar  bsFuse lane by lane: the reference, bit-identical to the
+ *           per-session path
+ *   avx2    8 lanes per __m256 (x86-64 with AVX2, checked at run time)
+ *   neon    2 x 4 lanes (AArch64)
+ *
+ * The vector kernels evaluate both branches of bsFuse and blend them,
+ * and use a Cephes-style sincos instead of libm sinf/cosf; they agree
+ * with the reference to float rounding (sessionbatch --check).
+ */
+
+#pragma once
+
+#include "bspipeline.h"
+#include <stdint.h>
+
+static const uint32_t FUSE_LANES = 8;
+static const uint32_t FUSE_IN    = 4;
+static const uint32_t FUSE_OUT   = 8;
+
+struct FuseLanes {
+    alignas(32) float qw[FUSE_LANES];
+    alignas(32) float qx[FUSE_LANES];
+    alignas(32) float qy[FUSE_LANES];
+    alignas(32) float qz[FUSE_LANES];
+    alignas(32) float biasX[FUSE_LANES];
+    alignas(32) float biasY[FUSE_LANES];
+    alignas(32) float biasZ[FUSE_LANES];
+    alignas(32) float filtGx[FUSE_LANES];
+    alignas(32) float filtGy[FUSE_LANES];
+    alignas(32) float filtGz[FUSE_LANES];
+    alignas(32) float filtRpm[FUSE_LANES];
+};
+
+// in and out 32-byte aligned
+typedef void (*FuseKernel)(FuseLanes &s, const float* in, float* out, uint32_t steps);
+
+// Fusion state of one lane to / from a pipeline (detection fields untouched)
+void fuseLaneSet(FuseLanes &s, uint32_t lane, const BsPipeline &p);
+void fuseLaneGet(const FuseLanes &s, uint32_t lane, BsPipeline &p);
+
+void fuseLanesScalar(FuseLanes &s, const float* in, float* out, uint32_t steps);
+#if defined(__x86_64__) || defined(__i386__)
+void fuseLanesAvx2(FuseLanes &s, const float* in, float* out, uint32_t steps);
+#endif
+#if defined(__aarch64__)
+void fuseLanesNeon(FuseLanes &s, const float* in, float* out, uint32_t steps);
+#endif
+
+struct FuseKernelInfo {
+    const char* name;
+    FuseKernel  fn;             // nullptr if this CPU cannot run it
+};
+
+// "auto" (best this CPU runs), "scalar", "avx2" or "neon"
+FuseKernelInfo fuseKernelPick(const char* name);
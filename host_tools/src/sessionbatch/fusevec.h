@@ -0,0 +1,123 @@
+/**
+ * Vector fusion kernel body, shared by the AVX2 and NEON builds
+ *
+ * Written with GCC / Clang vector extensions, so the same code becomes
+ * 8-wide AVX2 or 4-wide NEON depending on the vector type V supplies:
+ *
+ *   V::F, V::I   float / int32 vectors of V::W lanes
+ *   V::sqrt      vector square root
+ *
+ * Included by exactly one translation unit per instruction set, which
+ * sets the target; everything here has internal linkage so no vector
+ * code can be picked for a function the rest of the program calls.
+ * The arithmetic follows bsFuse operation by operation.
+ */
+
+#pragma once
+
+#include "fusekernel.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+template <class V>
+struct FuseVec {
+    typedef typename V::F F;
+    typedef typename V::I I;
+
+    static F load(const float* p) { F v; memcpy(&v, p, sizeof(v)); return v; }
+    static void store(float* p, F v) { memcpy(p, &v, sizeof(v)); }
+
+    // Cephes sinf / cosf: reduction by pi/4 in three parts, degree 7 / 8
+    // polynomials on [-pi/4, pi/4], quadrant from the octant number
+    static void sincos(F x, F &s, F &c) {
+        const I signBit = I{} + INT32_MIN;
+        I xi = (I)x;
+        I signSin = xi & signBit;
+        x = (F)(xi & ~signBit);
+        I j = __builtin_convertvector(x * 1.27323954473516f, I);
+        j = (j + 1) & ~1;
+        F y = __builtin_convertvector(j, F);
+        signSin ^= ((j & 4) != 0) & signBit;
+        I signCos = ((~(j - 2) & 4) != 0) & signBit;
+        I sinPoly = (j & 2) == 0;
+        x = ((x - y * 0.78515625f) - y * 2.4187564849853515625e-4f) - y * 3.77489497744594108e-8f;
+        F z = x * x;
+        F pc = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z
+               - 0.5f * z + 1.0f;
+        F ps = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * x + x;
+        s = (F)((I)(sinPoly ? ps : pc) ^ signSin);
+        c = (F)((I)(sinPoly ? pc : ps) ^ signCos);
+    }
+
+    static void run(FuseLanes &st, const float* in, float* out, uint32_t steps) {
+        const uint32_t L = FUSE_LANES;
+        const float degToRad = (float)(M_PI / 180.0);
+        for (uint32_t b = 0; b < L; b += V::W) {
+            F qw = load(st.qw + b), qx = load(st.qx + b), qy = load(st.qy + b), qz = load(st.qz + b);
+            F bx = load(st.biasX + b), by = load(st.biasY + b), bz = load(st.biasZ + b);
+            F fgx = load(st.filtGx + b), fgy = load(st.filtGy + b), fgz = load(st.filtGz + b);
+            F frpm = load(st.filtRpm + b);
+            const float* x = in + b;
+            float* y = out + b;
+            for (uint32_t i = 0; i < steps; i++, x += FUSE_IN * L, y += FUSE_OUT * L) {
+                F gxDeg = load(x), gyDeg = load(x + L), gzDeg = load(x + 2 * L), dt = load(x + 3 * L);
+                F gxRaw = gxDeg * degToRad, gyRaw = gyDeg * degToRad, gzRaw = gzDeg * degToRad;
+
+                // Bias learning while still
+                I still = V::sqrt(gxRaw * gxRaw + gyRaw * gyRaw + gzRaw * gzRaw) < 0.2f;
+                bx = still ? bx + 0.01f * (gxRaw - bx) : bx;
+                by = still ? by + 0.01f * (gyRaw - by) : by;
+                bz = still ? bz + 0.01f * (gzRaw - bz) : bz;
+                F gx = gxRaw - bx, gy = gyRaw - by, gz = gzRaw - bz;
+
+                fgx += 0.15f * (gxDeg - fgx);
+                fgy += 0.15f * (gyDeg - fgy);
+                fgz += 0.15f * (gzDeg - fgz);
+                F rawRpm = V::sqrt(gxDeg * gxDeg + gyDeg * gyDeg + gzDeg * gzDeg) / 6.0f;
+                frpm += 0.08f * (rawRpm - frpm);
+
+                // Integration above the dead zone, decay toward identity below it
+                F wmag = V::sqrt(gx * gx + gy * gy + gz * gz);
+                I spin = wmag > 0.10f;
+                F sha, cha;
+                sincos(wmag * dt * 0.5f, sha, cha);
+                F invW = 1.0f / wmag;
+                F dx = gx * invW * sha, dy = gy * invW * sha, dz = gz * invW * sha;
+                F rw = qw * cha - qx * dx - qy * dy - qz * dz;
+                F rx = qw * dx + qx * cha + qy * dz - qz * dy;
+                F ry = qw * dy - qx * dz + qy * cha + qz * dx;
+                F rz = qw * dz + qx * dy - qy * dx + qz * cha;
+                qw = spin ? rw : qw + 0.005f * (1.0f - qw);
+                qx = spin ? rx : qx + 0.005f * (0.0f - qx);
+                qy = spin ? ry : qy + 0.005f * (0.0f - qy);
+                qz = spin ? rz : qz + 0.005f * (0.0f - qz);
+
+                F len = V::sqrt(qw * qw + qx * qx + qy * qy + qz * qz);
+                I norm = len > 0.0001f;
+                F inv = 1.0f / len;
+                qw = norm ? qw * inv : qw;
+                qx = norm ? qx * inv : qx;
+                qy = norm ? qy * inv : qy;
+                qz = norm ? qz * inv : qz;
+
+                store(y, fgx);
+                store(y + L, fgy);
+                store(y + 2 * L, fgz);
+                store(y + 3 * L, frpm);
+                store(y + 4 * L, qw);
+                store(y + 5 * L, qx);
+                store(y + 6 * L, qy);
+                store(y + 7 * L, qz);
+            }
+            store(st.qw + b, qw); store(st.qx + b, qx); store(st.qy + b, qy); store(st.qz + b, qz);
+            store(st.biasX + b, bx); store(st.biasY + b, by); store(st.biasZ + b, bz);
+            store(st.filtGx + b, fgx); store(st.filtGy + b, fgy); store(st.filtGz + b, fgz);
+            store(st.filtRpm + b, frpm);
+        }
+    }
+};
+
+}  // namespace
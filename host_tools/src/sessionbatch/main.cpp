@@ -0,0 +1,708 @@
+/**
+ * sessionbatch - re-run the ball pipeline over many sessions in parallel
+ *
+ * Usage:
+ *   sessionbatch [--threads N] [--kernel auto|scalar|avx2|neon|ref] [--scaling]
+ *                [--check] [--bench-kernels] out.ybf [in.ybs | in.csv | dir]...
+ *
+ * Every session file and CSV trace given (directories are searched for
+ * *.ybs and *.csv) is fed sample by sample through the ball's own
+ * pipeline (lib/ballsession bspipeline: bias learning, filters,
+ * quaternion integration, impact detection, peak tracking, spin
+ * classification), so a change there can be checked against a whole
+ * season. The shots it finds are written with their features to one
+ * column-wise file (shotfeat.h), sources in path order.
+ *
+ * The pipeline runs on the stored samples at their stored rate (200Hz
+ * from the flash log); the ball runs it on every loop iteration, so the
+ * filters settle slightly differently. The recorded column matches each
+ * shot to the one the source holds for the same impact (within 100 ms).
+ *
+ * Sessions are the unit of work, spread over --threads workers
+ * (default: all cores) by a work-stealing pool (workpool.h). Each worker
+ * reuses its pipeline buffers and keeps its shots in its own arena; the
+ * main thread only gathers them into columns at the end. Prints
+ * sessions/s and samples/s, and per worker the sessions run, steals and
+ * busy time. --scaling runs the batch at 1, 2, 4 ... threads (after one
+ * warm-up run) and prints the speedup of each.
+ *
+ * Fusion runs eight session files at a time in the lanes of a vector
+ * kernel (fusekernel.h), picked for the CPU at run time (--kernel auto:
+ * AVX2 or NEON, else the scalar lane loop); detection stays per lane.
+ * --kernel ref runs bsFuse per session as the ball does, and is always
+ * used for CSV traces. --check runs the batch again with ref and
+ * compares every shot; --bench-kernels times the kernels alone.
+ */
+
+#include "bspipeline.h"
+#include "fusekernel.h"
+#include "observer.h"
+#include "sessionout.h"
+#include "sessionread.h"
+#include "shotfeat.h"
+#include "trace.h"
+#include "workpool.h"
+#include <algorithm>
+#include <filesystem>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: sessionbatch [--threads N] [--kernel auto|scalar|avx2|neon|ref] [--scaling]\n"
+            "                    [--check] [--bench-kernels] out.ybf [in.ybs | in.csv | dir]...\n");
+    exit(2);
+}
+
+static const char* const SPIN_TYPES[] = {"FLAT", "TOPSPIN", "BACKSPIN", "SIDE_R", "SIDE_L", "SLICE", "MIXED"};
+static const size_t SPIN_TYPE_COUNT = sizeof(SPIN_TYPES) / sizeof(SPIN_TYPES[0]);
+static const int64_t RECORDED_MATCH_US = 100000;
+
+struct ShotFeature {
+    int64_t  tUs;
+    uint32_t recorded;
+    float    rpm, peakG;
+    float    gx, gy, gz;
+    BsQuat   q;
+    float    theta, phi;
+    uint8_t  type;
+};
+
+struct Source {
+    std::string path;
+    uint64_t    bytes = 0;
+    bool        csv = false;
+};
+
+struct SourceResult {
+    const ShotFeature* shots = nullptr;   // in the arena of the worker that ran it
+    uint32_t           count = 0;
+    uint32_t           recorded = 0;      // shots the source holds
+    uint32_t           matched = 0;
+    uint64_t           samples = 0;
+    bool               ok = false;
+};
+
+// Per-session buffers, reused by every session run in the same slot
+struct SessionBufs {
+    std::vector<ShotFeature> found;
+    std::vector<BsShot>      recorded;
+    std::vector<uint64_t>    scratch;     // delta-decoded columns (SessionReader::scratch)
+};
+
+// ==================== Pipeline ====================
+
+struct Run {
+    BsPipeline   p;
+    float        perG, perDps;
+    int64_t      lastUs;
+    uint64_t     samples;
+    SessionBufs* b;
+};
+
+static void runBegin(Run &r, SessionBufs &b, const BsFileHeader &h) {
+    bsPipelineInit(r.p);
+    r.perG = (float)(1.0 / bsAccelPerG(h));
+    r.perDps = (float)(1.0 / bsGyroPerDps(h));
+    r.lastUs = INT64_MIN;
+    r.samples = 0;
+    r.b = &b;
+    b.found.clear();
+    b.recorded.clear();
+}
+
+static uint8_t typeCode(const char* name) {
+    for (size_t i = 0; i < SPIN_TYPE_COUNT; i++) {
+        if (!strcmp(name, SPIN_TYPES[i])) return (uint8_t)i;
+    }
+    return SPIN_TYPE_COUNT - 1;
+}
+
+// Time since the previous sample, as the loop does it (0.033 s when it
+// is missing or implausible)
+static float runDt(Run &r, int64_t tUs) {
+    float dt = r.lastUs == INT64_MIN ? 1.0f : (tUs - r.lastUs) * 1e-6f;
+    if (dt > 0.1f || dt < 0) dt = 0.033f;
+    r.lastUs = tUs;
+    r.samples++;
+    return dt;
+}
+
+// Detection on a fused sample; a finished shot becomes a feature row
+static void runDetect(Run &r, int64_t tUs, const float a[3]) {
+    BsShot shot;
+    if (bsDetect(r.p, a[0], a[1], a[2], (uint32_t)(tUs / 1000), shot) != BS_DETECT_SHOT) return;
+    ShotFeature f;
+    f.tUs = shot.tUs;
+    f.recorded = SHOT_FEAT_NONE;
+    f.rpm = shot.peakRpm;
+    f.peakG = shot.peakG;
+    f.gx = shot.gx; f.gy = shot.gy; f.gz = shot.gz;
+    f.q = r.p.orient;
+    double theta, phi;
+    bool axis = observerSpinAxis(shot, theta, phi);
+    f.theta = axis ? (float)theta : NAN;
+    f.phi = axis ? (float)phi : NAN;
+    f.type = typeCode(shot.spinType);
+    r.b->found.push_back(f);
+}
+
+static void runSample(Run &r, int64_t tUs, const float a[3], const float g[3]) {
+    bsFuse(r.p, g[0], g[1], g[2], runDt(r, tUs));
+    runDetect(r, tUs, a);
+}
+
+static void traceSample(void* ctx, const BsSample &s) {
+    Run &r = *(Run*)ctx;
+    float a[3], g[3];
+    for (int k = 0; k < 3; k++) {
+        a[k] = s.a[k] * r.perG;
+        g[k] = s.g[k] * r.perDps;
+    }
+    runSample(r, s.tUs, a, g);
+}
+
+static void traceShot(void* ctx, const BsShot &s) {
+    ((Run*)ctx)->b->recorded.push_back(s);
+}
+
+// Chunk i of an open session; false (reported) if it is unreadable
+static bool loadChunk(SessionReader &sr, uint32_t i, SessionChunk &c, const char* path) {
+    if (sessionLoadChunk(sr, i, c, BS_COLS_IMU) && !c.col[0].empty() && !c.col[3].empty()) return true;
+    fprintf(stderr, "%s: chunk %u unreadable or without accel/gyro\n", path, i);
+    return false;
+}
+
+static bool runSession(Run &r, SessionBufs &b, const char* path) {
+    SessionReader sr;
+    if (!sessionOpen(sr, path)) {
+        fprintf(stderr, "%s: %s\n", path, sr.error);
+        return false;
+    }
+    sessionSequential(sr);
+    sr.scratch.swap(b.scratch);
+    runBegin(r, b, *sr.header);
+    bool ok = true;
+    SessionChunk c;
+    for (uint32_t i = 0; i < sr.chunks && ok; i++) {
+        ok = loadChunk(sr, i, c, path);
+        if (!ok) break;
+        for (size_t k = 0; k < c.t.size; k++) {
+            float a[3] = {c.col[0][k] * r.perG, c.col[1][k] * r.perG, c.col[2][k] * r.perG};
+            float g[3] = {c.col[3][k] * r.perDps, c.col[4][k] * r.perDps, c.col[5][k] * r.perDps};
+            runSample(r, c.t[k], a, g);
+        }
+        b.recorded.insert(b.recorded.end(), c.shots.begin(), c.shots.end());
+    }
+    sr.scratch.swap(b.scratch);
+    sessionClose(sr);
+    return ok;
+}
+
+static bool runTrace(Run &r, SessionBufs &b, const char* path) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+    TraceLayout layout = traceSniffCsv(fp);
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, 0, traceColumns(layout), "csv");
+    runBegin(r, b, h);
+    TraceCallbacks cb = {traceSample, traceShot, &r};
+    TraceStats st;
+    bool ok = traceReadCsv(fp, h, cb, st);
+    fclose(fp);
+    if (!ok) fprintf(stderr, "%s: not an imu_logger or dashboard CSV\n", path);
+    return ok;
+}
+
+// Pairs each detected shot with the nearest recorded one within
+// RECORDED_MATCH_US (both in time order), then copies them to the arena
+static void finish(SessionBufs &b, ThreadArena &arena, SourceResult &res) {
+    std::sort(b.recorded.begin(), b.recorded.end(),
+              [](const BsShot &x, const BsShot &y) { return x.tUs < y.tUs; });
+    size_t j = 0;
+    for (ShotFeature &f : b.found) {
+        while (j + 1 < b.recorded.size() && llabs(b.recorded[j + 1].tUs - f.tUs) <= llabs(b.recorded[j].tUs - f.tUs)) j++;
+        if (j < b.recorded.size() && llabs(b.recorded[j].tUs - f.tUs) <= RECORDED_MATCH_US) {
+            f.recorded = b.recorded[j].id;
+            res.matched++;
+        }
+    }
+    res.recorded = (uint32_t)b.recorded.size();
+    res.count = (uint32_t)b.found.size();
+    ShotFeature* out = arena.make<ShotFeature>(res.count);
+    std::copy(b.found.begin(), b.found.end(), out);
+    res.shots = out;
+}
+
+// ==================== Lanes ====================
+
+// Session files are run FUSE_LANES at a time through a fusion kernel,
+// BLOCK samples per call; a lane whose session ends takes the worker's
+// next item. CSV traces are run on their own as they come up.
+static const uint32_t BLOCK = 128;
+
+struct Lane {
+    bool          busy = false;
+    bool          done = false;       // no samples left (or a chunk failed)
+    uint32_t      item = 0;
+    SessionReader sr;
+    SessionChunk  c;
+    uint32_t      next = 0;           // chunk to load next
+    size_t        k = 0;              // next sample of c
+    Run           r;
+    SessionBufs   b;
+    uint32_t      n = 0;              // samples in this block
+    int64_t       t[BLOCK];
+    float         a[BLOCK][3];
+};
+
+struct alignas(32) LaneBlock {
+    float in[BLOCK * FUSE_IN * FUSE_LANES];
+    float out[BLOCK * FUSE_OUT * FUSE_LANES];
+};
+
+// Next chunk into the lane; false at the end or on a bad chunk
+static bool laneChunk(Lane &l, const char* path, SourceResult &res) {
+    if (l.next >= l.sr.chunks) return false;
+    if (!loadChunk(l.sr, l.next, l.c, path)) {
+        res.ok = false;
+        return false;
+    }
+    l.next++;
+    l.k = 0;
+    l.b.recorded.insert(l.b.recorded.end(), l.c.shots.begin(), l.c.shots.end());
+    return true;
+}
+
+// Samples of the lane's session for the next block, gyro and dt
+// written to its column of in; leftover steps get zeros
+static void laneFill(Lane &l, uint32_t lane, float* in, const char* path, SourceResult &res) {
+    const uint32_t L = FUSE_LANES;
+    l.n = 0;
+    while (l.n < BLOCK && !l.done) {
+        if (l.k == l.c.t.size) {
+            if (!laneChunk(l, path, res)) l.done = true;
+            continue;
+        }
+        const SessionChunk &c = l.c;
+        float* x = in + l.n * FUSE_IN * L + lane;
+        x[0] = c.col[3][l.k] * l.r.perDps;
+        x[L] = c.col[4][l.k] * l.r.perDps;
+        x[2 * L] = c.col[5][l.k] * l.r.perDps;
+        x[3 * L] = runDt(l.r, c.t[l.k]);
+        l.t[l.n] = c.t[l.k];
+        for (int j = 0; j < 3; j++) l.a[l.n][j] = c.col[j][l.k] * l.r.perG;
+        l.k++;
+        l.n++;
+    }
+    for (uint32_t s = l.n; s < BLOCK; s++) {
+        for (uint32_t j = 0; j < FUSE_IN; j++) in[(s * FUSE_IN + j) * L + lane] = 0;
+    }
+}
+
+static void laneClose(Lane &l, ThreadArena &arena, SourceResult &res) {
+    res.samples = l.r.samples;
+    if (res.ok) finish(l.b, arena, res);
+    l.sr.scratch.swap(l.b.scratch);
+    sessionClose(l.sr);
+    l.busy = false;
+}
+
+// Gives an idle lane the next session file; CSV traces met on the way
+// (and files that do not open) are run or failed right here
+static bool laneOpen(Lane &l, uint32_t lane, FuseLanes &fl, PoolQueue &q,
+                     const std::vector<Source> &sources, std::vector<SourceResult> &results,
+                     SessionBufs &csv, ThreadArena &arena) {
+    uint32_t item;
+    while (q.next(item)) {
+        const char* path = sources[item].path.c_str();
+        SourceResult &res = results[item];
+        if (sources[item].csv) {
+            Run r;
+            res.ok = runTrace(r, csv, path);
+            res.samples = r.samples;
+            if (res.ok) finish(csv, arena, res);
+            continue;
+        }
+        l.sr = SessionReader();
+        if (!sessionOpen(l.sr, path)) {
+            fprintf(stderr, "%s: %s\n", path, l.sr.error);
+            continue;
+        }
+        sessionSequential(l.sr);
+        l.sr.scratch.swap(l.b.scratch);
+        runBegin(l.r, l.b, *l.sr.header);
+        fuseLaneSet(fl, lane, l.r.p);
+        l.c = SessionChunk();
+        l.next = 0;
+        l.k = 0;
+        l.busy = true;
+        l.done = false;
+        l.item = item;
+        res.ok = true;
+        return true;
+    }
+    return false;
+}
+
+static void runLanes(FuseKernel kernel, PoolQueue &q, const std::vector<Source> &sources,
+                     std::vector<SourceResult> &results, ThreadArena &arena) {
+    const uint32_t L = FUSE_LANES;
+    std::unique_ptr<Lane[]> lanes(new Lane[L]);
+    std::unique_ptr<LaneBlock> blk(new LaneBlock);
+    SessionBufs csv;
+    FuseLanes fl;
+    BsPipeline idle;
+    bsPipelineInit(idle);
+    for (uint32_t i = 0; i < L; i++) fuseLaneSet(fl, i, idle);
+    bool more = true;                 // the queue may still have items
+
+    for (;;) {
+        uint32_t busy = 0;
+        for (uint32_t i = 0; i < L; i++) {
+            Lane &l = lanes[i];
+            for (;;) {
+                if (!l.busy && !(more = more && laneOpen(l, i, fl, q, sources, results, csv, arena))) break;
+                SourceResult &res = results[l.item];
+                laneFill(l, i, blk->in, sources[l.item].path.c_str(), res);
+                if (l.n || !l.done) break;
+                laneClose(l, arena, res);
+            }
+            busy += l.busy;
+        }
+        if (!busy) break;
+
+        kernel(fl, blk->in, blk->out, BLOCK);
+
+        for (uint32_t i = 0; i < L; i++) {
+            Lane &l = lanes[i];
+            if (!l.busy) continue;
+            const float* y = blk->out + i;
+            for (uint32_t s = 0; s < l.n; s++, y += FUSE_OUT * L) {
+                BsPipeline &p = l.r.p;
+                p.filtGx = y[0];
+                p.filtGy = y[L];
+                p.filtGz = y[2 * L];
+                p.filtRpm = y[3 * L];
+                p.orient = {y[4 * L], y[5 * L], y[6 * L], y[7 * L]};
+                runDetect(l.r, l.t[s], l.a[s]);
+            }
+            if (l.done) laneClose(l, arena, results[l.item]);
+        }
+    }
+}
+
+// ==================== Batch ====================
+
+// Reused by every session a worker runs
+struct Worker {
+    ThreadArena arena;
+    SessionBufs bufs;
+};
+
+struct Batch {
+    std::vector<Source>          sources;
+    std::vector<SourceResult>    results;
+    std::vector<Worker>          workers;
+    std::vector<PoolWorkerStats> stats;
+    FuseKernelInfo               kernel = {"ref", nullptr};   // nullptr: bsFuse per session
+    double                       secs = 0;
+};
+
+static void runBatch(Batch &b, uint32_t threads) {
+    b.results.assign(b.sources.size(), SourceResult());
+    b.workers.clear();
+    b.workers.resize(threads);
+    std::vector<uint64_t> cost;
+    for (const Source &s : b.sources) cost.push_back(s.bytes);
+
+    double t0 = hostSeconds();
+    poolRunWorkers(threads, cost, [&](uint32_t wk, PoolQueue &q) {
+        Worker &w = b.workers[wk];
+        if (b.kernel.fn) {
+            runLanes(b.kernel.fn, q, b.sources, b.results, w.arena);
+            return;
+        }
+        uint32_t i;
+        while (q.next(i)) {
+            Run r;
+            SourceResult &res = b.results[i];
+            const char* path = b.sources[i].path.c_str();
+            res.ok = b.sources[i].csv ? runTrace(r, w.bufs, path) : runSession(r, w.bufs, path);
+            res.samples = r.samples;
+            if (res.ok) finish(w.bufs, w.arena, res);
+        }
+    }, b.stats);
+    b.secs = hostSeconds() - t0;
+}
+
+static uint64_t totalSamples(const Batch &b) {
+    uint64_t n = 0;
+    for (const SourceResult &r : b.results) n += r.samples;
+    return n;
+}
+
+static uint64_t save(const Batch &b, const char* out) {
+    ShotFeatWriter w;
+    for (const Source &s : b.sources) w.sources.push_back(s.path);
+    for (const char* t : SPIN_TYPES) w.types.push_back(t);
+    for (const SourceResult &r : b.results) w.shots += r.count;
+
+    uint32_t* source = (uint32_t*)w.column("source", FEAT_U32);
+    uint32_t* shot = (uint32_t*)w.column("shot", FEAT_U32);
+    int64_t*  tUs = (int64_t*)w.column("t_us", FEAT_I64);
+    float*    f[12];
+    static const char* const F32[12] = {"rpm", "peak_g", "gx", "gy", "gz", "qw", "qx", "qy", "qz",
+                                        "theta", "phi", nullptr};
+    for (int k = 0; F32[k]; k++) f[k] = (float*)w.column(F32[k], FEAT_F32);
+    uint8_t*  type = (uint8_t*)w.column("type", FEAT_U8);
+    uint32_t* recorded = (uint32_t*)w.column("recorded", FEAT_U32);
+
+    size_t n = 0;
+    for (size_t s = 0; s < b.results.size(); s++) {
+        const SourceResult &r = b.results[s];
+        for (uint32_t i = 0; i < r.count; i++, n++) {
+            const ShotFeature &x = r.shots[i];
+            source[n] = (uint32_t)s;
+            shot[n] = i;
+            tUs[n] = x.tUs;
+            const float v[11] = {x.rpm, x.peakG, x.gx, x.gy, x.gz, x.q.w, x.q.x, x.q.y, x.q.z,
+                                 x.theta, x.phi};
+            for (int k = 0; k < 11; k++) f[k][n] = v[k];
+            type[n] = x.type;
+            recorded[n] = x.recorded;
+        }
+    }
+    return shotFeatSave(w, out);
+}
+
+static void report(const Batch &b, uint32_t threads) {
+    uint64_t samples = totalSamples(b), bytes = 0;
+    for (const Source &s : b.sources) bytes += s.bytes;
+    printf("  %u threads, %s fusion: %.3f s  %.1f sessions/s  %.2f M samples/s  %.1f MB/s\n", threads,
+           b.kernel.name, b.secs, b.sources.size() / b.secs, samples / b.secs / 1e6, bytes / b.secs / 1e6);
+    for (uint32_t w = 0; w < b.stats.size(); w++) {
+        const PoolWorkerStats &st = b.stats[w];
+        printf("    worker %u: %llu sessions (%llu stolen), busy %.0f%%, arena %.1f KB\n", w,
+               (unsigned long long)st.items, (unsigned long long)st.steals,
+               b.secs > 0 ? 100.0 * st.busySec / b.secs : 0.0, b.workers[w].arena.bytes / 1e3);
+    }
+}
+
+// ==================== Checks ====================
+
+// Compares every source's shots with the per-session bsFuse run; true
+// when both find the same shots at the same times with the same types
+// and the features agree to float rounding
+static bool check(const Batch &b, const Batch &ref) {
+    uint32_t countDiff = 0, timeDiff = 0, typeDiff = 0;
+    uint64_t compared = 0;
+    double rpm = 0, g = 0, gyro = 0, q = 0;
+    for (size_t s = 0; s < b.results.size(); s++) {
+        const SourceResult &x = b.results[s], &y = ref.results[s];
+        if (x.count != y.count) {
+            countDiff++;
+            continue;
+        }
+        for (uint32_t i = 0; i < x.count; i++, compared++) {
+            const ShotFeature &u = x.shots[i], &v = y.shots[i];
+            timeDiff += u.tUs != v.tUs;
+            typeDiff += u.type != v.type;
+            rpm = std::max(rpm, (double)fabsf(u.rpm - v.rpm));
+            g = std::max(g, (double)fabsf(u.peakG - v.peakG));
+            gyro = std::max(gyro, (double)std::max({fabsf(u.gx - v.gx), fabsf(u.gy - v.gy), fabsf(u.gz - v.gz)}));
+            q = std::max(q, (double)std::max({fabsf(u.q.w - v.q.w), fabsf(u.q.x - v.q.x),
+                                              fabsf(u.q.y - v.q.y), fabsf(u.q.z - v.q.z)}));
+        }
+    }
+    bool ok = !countDiff && !timeDiff && !typeDiff && rpm < 0.01 && g < 1e-4 && gyro < 0.01 && q < 1e-3;
+    printf("check %s vs ref: %llu shots compared, %u sources with another shot count, "
+           "%u times and %u types differ; max |d| rpm %.2g, peak G %.2g, gyro %.2g deg/s, "
+           "quaternion %.2g: %s\n", b.kernel.name, (unsigned long long)compared, countDiff, timeDiff,
+           typeDiff, rpm, g, gyro, q, ok ? "within tolerance" : "OUT OF TOLERANCE");
+    return ok;
+}
+
+// Fusion kernels alone over the gyro of the first FUSE_LANES session
+// files (one per lane, cut to the shortest), already in memory
+static void benchKernels(const Batch &b, const char* chosen) {
+    std::vector<std::vector<float>> lanes;
+    for (const Source &src : b.sources) {
+        if (src.csv || lanes.size() == FUSE_LANES) continue;
+        SessionReader sr;
+        if (!sessionOpen(sr, src.path.c_str())) continue;
+        Run r;
+        SessionBufs bufs;
+        runBegin(r, bufs, *sr.header);
+        std::vector<float> v;
+        SessionChunk c;
+        for (uint32_t i = 0; i < sr.chunks && loadChunk(sr, i, c, src.path.c_str()); i++) {
+            for (size_t k = 0; k < c.t.size; k++) {
+                v.push_back(c.col[3][k] * r.perDps);
+                v.push_back(c.col[4][k] * r.perDps);
+                v.push_back(c.col[5][k] * r.perDps);
+                v.push_back(runDt(r, c.t[k]));
+            }
+        }
+        sessionClose(sr);
+        if (!v.empty()) lanes.push_back(std::move(v));
+    }
+    if (lanes.empty()) return;
+    size_t steps = SIZE_MAX;
+    for (const std::vector<float> &v : lanes) steps = std::min(steps, v.size() / FUSE_IN);
+    steps -= steps % BLOCK;
+    const uint32_t L = FUSE_LANES;
+    std::vector<float> inBuf(steps * FUSE_IN * L + 8), outBuf(BLOCK * FUSE_OUT * L + 8);
+    float* in = (float*)(((uintptr_t)inBuf.data() + 31) & ~(uintptr_t)31);
+    float* out = (float*)(((uintptr_t)outBuf.data() + 31) & ~(uintptr_t)31);
+    for (size_t s = 0; s < steps; s++) {
+        for (uint32_t l = 0; l < L; l++) {
+            const std::vector<float> &v = lanes[l % lanes.size()];
+            for (uint32_t j = 0; j < FUSE_IN; j++) in[(s * FUSE_IN + j) * L + l] = v[s * FUSE_IN + j];
+        }
+    }
+
+    printf("fusion kernels, %u lanes x %zu steps, one thread:\n", L, steps);
+    printf("kernel,seconds,samples_per_s,speedup,max_quat_diff\n");
+    static const char* const NAMES[] = {"scalar", "avx2", "neon"};
+    double base = 0;
+    FuseLanes end[3];
+    for (int k = 0; k < 3; k++) {
+        FuseKernelInfo ki = fuseKernelPick(NAMES[k]);
+        if (!ki.fn) continue;
+        FuseLanes &fl = end[k];
+        double best = 1e30;
+        for (int rep = 0; rep < 3; rep++) {
+            BsPipeline p;
+            bsPipelineInit(p);
+            for (uint32_t l = 0; l < L; l++) fuseLaneSet(fl, l, p);
+            double t0 = hostSeconds();
+            for (size_t s = 0; s < steps; s += BLOCK) ki.fn(fl, in + s * FUSE_IN * L, out, BLOCK);
+            best = std::min(best, hostSeconds() - t0);
+        }
+        if (k == 0) base = best;
+        float dq = 0;
+        for (uint32_t l = 0; l < L; l++) {
+            dq = std::max({dq, fabsf(fl.qw[l] - end[0].qw[l]), fabsf(fl.qx[l] - end[0].qx[l]),
+                           fabsf(fl.qy[l] - end[0].qy[l]), fabsf(fl.qz[l] - end[0].qz[l])});
+        }
+        printf("%s%s,%.3f,%.0f,%.2f,%.2g\n", ki.name, strcmp(ki.name, chosen) ? "" : " (selected)", best,
+               steps * L / best, base / best, dq);
+    }
+}
+
+static bool isInput(const std::string &path, bool &csv) {
+    auto ends = [&](const char* ext) {
+        size_t n = strlen(ext);
+        return path.size() > n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    csv = ends(".csv");
+    return csv || ends(".ybs");
+}
+
+int main(int argc, char** argv) {
+    uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+    bool scaling = false, checkRef = false, bench = false;
+    const char* kernel = "auto";
+    std::vector<const char*> inputs;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--kernel") && i + 1 < argc) kernel = argv[++i];
+        else if (!strcmp(argv[i], "--scaling"))           scaling = true;
+        else if (!strcmp(argv[i], "--check"))             checkRef = true;
+        else if (!strcmp(argv[i], "--bench-kernels"))     bench = true;
+        else if (argv[i][0] == '-')                       usage();
+        else                                              inputs.push_back(argv[i]);
+    }
+    if (inputs.size() < 2) usage();
+    const char* out = inputs[0];
+    inputs.erase(inputs.begin());
+
+    // Expand directories, sorted so source numbers are stable between runs
+    std::vector<std::string> files;
+    bool csv;
+    for (const char* in : inputs) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(in, ec)) {
+            for (const auto &e : std::filesystem::recursive_directory_iterator(in, ec)) {
+                if (e.is_regular_file() && isInput(e.path().string(), csv)) files.push_back(e.path().string());
+            }
+        } else {
+            files.push_back(in);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    Batch b;
+    for (const std::string &f : files) {
+        Source s;
+        s.path = f;
+        std::error_code ec;
+        s.bytes = std::filesystem::file_size(f, ec);
+        isInput(f, s.csv);
+        b.sources.push_back(s);
+    }
+    if (b.sources.empty()) {
+        fprintf(stderr, "no session files or CSV traces found\n");
+        return 1;
+    }
+    if (strcmp(kernel, "ref")) {
+        b.kernel = fuseKernelPick(kernel);
+        if (!b.kernel.fn) {
+            fprintf(stderr, "fusion kernel %s: not available on this CPU\n", kernel);
+            return 2;
+        }
+    }
+    if (bench) benchKernels(b, b.kernel.name);
+
+    if (scaling) {
+        runBatch(b, threads);   // warm-up: page cache, allocator
+        printf("scaling over %zu sessions, %llu samples:\n", b.sources.size(),
+               (unsigned long long)totalSamples(b));
+        printf("threads,seconds,sessions_per_s,samples_per_s,speedup,efficiency,steals\n");
+        double base = 0;
+        for (uint32_t t = 1;; t = std::min(t * 2, threads)) {
+            runBatch(b, t);
+            uint64_t steals = 0;
+            for (const PoolWorkerStats &st : b.stats) steals += st.steals;
+            if (t == 1) base = b.secs;
+            printf("%u,%.3f,%.1f,%.0f,%.2f,%.2f,%llu\n", t, b.secs, b.sources.size() / b.secs,
+                   totalSamples(b) / b.secs, base / b.secs, base / b.secs / t, (unsigned long long)steals);
+            if (t == threads) break;
+        }
+    } else {
+        runBatch(b, threads);
+    }
+
+    uint32_t failed = 0, recorded = 0, matched = 0;
+    uint64_t shots = 0;
+    for (const SourceResult &r : b.results) {
+        failed += !r.ok;
+        shots += r.count;
+        recorded += r.recorded;
+        matched += r.matched;
+    }
+    uint64_t bytes = save(b, out);
+    if (!bytes) {
+        fprintf(stderr, "%s: write failed\n", out);
+        return 1;
+    }
+    printf("%s: %llu shots from %zu sources (%u failed), %llu bytes\n", out, (unsigned long long)shots,
+           b.sources.size(), failed, (unsigned long long)bytes);
+    printf("  sources held %u shots; %u detected shots match one of them\n", recorded, matched);
+    report(b, (uint32_t)b.stats.size());
+
+    if (checkRef) {
+        Batch ref;
+        ref.sources = b.sources;
+        runBatch(ref, threads);
+        if (!check(b, ref)) return 1;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * Per-shot feature table - see shotfeat.h
+ */
+
+#include "shotfeat.h"
+#include "ballsession.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const uint8_t FEAT_SIZE[] = {1, 4, 8, 4};
+
+static size_t padded(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+void* ShotFeatWriter::column(const char* name, uint8_t type) {
+    ShotFeatColumn c = {};
+    strncpy(c.name, name, sizeof(c.name) - 1);
+    c.type = type;
+    cols.push_back(c);
+    data.emplace_back(padded(shots * FEAT_SIZE[type]));
+    return data.back().data();
+}
+
+uint64_t shotFeatSave(ShotFeatWriter &w, const char* path) {
+    std::string paths;
+    for (const std::string &s : w.sources) paths.append(s.c_str(), s.size() + 1);
+
+    ShotFeatHeader h = {};
+    h.magic = SHOT_FEAT_MAGIC;
+    h.version = SHOT_FEAT_VERSION;
+    h.columns = (uint16_t)w.cols.size();
+    h.types = (uint16_t)w.types.size();
+    h.pathBytes = (uint32_t)paths.size();
+    h.sources = (uint32_t)w.sources.size();
+    h.shots = w.shots;
+    h.builtAt = time(nullptr);
+
+    std::vector<uint8_t> buf;
+    auto put = [&](const void* p, size_t n) {
+        const uint8_t* b = (const uint8_t*)p;
+        buf.insert(buf.end(), b, b + n);
+    };
+    put(&h, sizeof(h));
+    size_t colTable = buf.size();
+    put(w.cols.data(), w.cols.size() * sizeof(ShotFeatColumn));
+    for (const std::string &t : w.types) {
+        char name[SHOT_FEAT_NAME] = {};
+        strncpy(name, t.c_str(), sizeof(name) - 1);
+        put(name, sizeof(name));
+    }
+    put(paths.data(), paths.size());
+    for (size_t c = 0; c < w.cols.size(); c++) {
+        buf.resize(padded(buf.size()));
+        ShotFeatColumn col = w.cols[c];
+        col.offset = buf.size();
+        memcpy(&buf[colTable + c * sizeof(col)], &col, sizeof(col));
+        put(w.data[c].data(), w.data[c].size());
+    }
+    uint32_t crc = bsCrc32(0, buf.data(), buf.size());
+    put(&crc, sizeof(crc));
+
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp) return 0;
+    bool ok = fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), path) != 0) {
+        remove(tmp.c_str());
+        return 0;
+    }
+    return buf.size();
+}
@@ -0,0 +1,78 @@
+/**
+ * Per-shot feature table (.ybf)
+ *
+ * The shots a batch re-analysis detected, one column per feature, so a
+ * classifier or a notebook reads just the features it needs
+ * (numpy.frombuffer at the column's offset):
+ *
+ *   ShotFeatHeader
+ *   ShotFeatColumn[columns]     name, element type and file offset of each column
+ *   char[types][16]             spin type names, by type code
+ *   char[pathBytes]             source paths, NUL-terminated, by source number
+ *   columns, each at an 8-byte aligned offset, shots elements long
+ *   uint32_t crc                CRC32 of everything before it
+ *
+ * Columns written by sessionbatch:
+ *   source u32, shot u32        source number, shot number within the source
+ *   t_us i64                    impact time in the source's device clock
+ *   rpm f32, peak_g f32         peaks over the tracking window
+ *   gx gy gz f32                filtered gyro at the peak, deg/s
+ *   qw qx qy qz f32             orientation when the shot was recorded
+ *   theta phi f32               spin axis in degrees, NaN if not spinning
+ *   type u8                     spin type code
+ *   recorded u32                id of the shot the source itself holds for
+ *                               this impact, SHOT_FEAT_NONE if none
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+static const uint32_t SHOT_FEAT_MAGIC   = 0x54464259;  // "YBFT"
+static const uint16_t SHOT_FEAT_VERSION = 1;
+static const uint32_t SHOT_FEAT_NONE    = 0xFFFFFFFF;
+static const size_t   SHOT_FEAT_NAME    = 16;
+
+enum ShotFeatType : uint8_t {
+    FEAT_U8 = 0,
+    FEAT_U32,
+    FEAT_I64,
+    FEAT_F32,
+};
+
+struct ShotFeatHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t columns;
+    uint16_t types;
+    uint16_t reserved;
+    uint32_t pathBytes;
+    uint32_t sources;
+    uint32_t reserved2;
+    uint64_t shots;
+    int64_t  builtAt;           // time() of the run
+};
+
+struct ShotFeatColumn {
+    char     name[SHOT_FEAT_NAME];
+    uint8_t  type;              // ShotFeatType
+    uint8_t  reserved[7];
+    uint64_t offset;            // from the start of the file
+};
+
+// Assembled in memory, column by column, then written at once
+struct ShotFeatWriter {
+    std::vector<std::string>    sources;
+    std::vector<std::string>    types;
+    uint64_t                    shots = 0;
+    std::vector<ShotFeatColumn> cols;
+    std::vector<std::vector<uint8_t>> data;
+
+    // Column of shots elements of type; fill it through the returned pointer
+    void* column(const char* name, uint8_t type);
+};
+
+// Written to a temporary file and renamed over path; returns bytes written, 0 on error
+uint64_t shotFeatSave(ShotFeatWriter &w, const char* path);
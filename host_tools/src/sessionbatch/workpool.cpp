@@ -0,0 +1,95 @@
+/**
+ * Work-stealing thread pool - see workpool.h
+ */
+
+#include "workpool.h"
+#include "sessionout.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+void* ThreadArena::alloc(size_t n, size_t align) {
+    size_t pad = cur ? (align - (uintptr_t)cur % align) % align : 0;
+    if (!cur || pad + n > left) {
+        size_t size = std::max(blockSize, n + align);
+        blocks.emplace_back(new uint8_t[size]);
+        cur = blocks.back().get();
+        left = size;
+        pad = (align - (uintptr_t)cur % align) % align;
+    }
+    void* p = cur + pad;
+    cur += pad + n;
+    left -= pad + n;
+    bytes += n;
+    return p;
+}
+
+struct alignas(64) WorkDeque {
+    std::mutex           lock;
+    std::deque<uint32_t> items;
+};
+
+// Own items from the back, then the front of the others, starting after self
+bool PoolQueue::next(uint32_t &item) {
+    std::vector<WorkDeque> &q = *dq;
+    {
+        std::lock_guard<std::mutex> g(q[self].lock);
+        if (!q[self].items.empty()) {
+            item = q[self].items.back();
+            q[self].items.pop_back();
+            st->items++;
+            return true;
+        }
+    }
+    uint32_t n = (uint32_t)q.size();
+    for (uint32_t k = 1; k < n; k++) {
+        WorkDeque &v = q[(self + k) % n];
+        std::lock_guard<std::mutex> g(v.lock);
+        if (!v.items.empty()) {
+            item = v.items.front();
+            v.items.pop_front();
+            st->items++;
+            st->steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void poolRunWorkers(uint32_t threads, const std::vector<uint64_t> &cost,
+                    const std::function<void(uint32_t worker, PoolQueue &q)> &worker,
+                    std::vector<PoolWorkerStats> &stats) {
+    if (threads < 1) threads = 1;
+    std::vector<uint32_t> order(cost.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return cost[a] > cost[b]; });
+
+    // Dealt largest first and pushed to the front: the back ends up largest
+    std::vector<WorkDeque> dq(threads);
+    for (size_t i = 0; i < order.size(); i++) dq[i % threads].items.push_front(order[i]);
+
+    stats.assign(threads, PoolWorkerStats());
+    auto work = [&](uint32_t self) {
+        PoolWorkerStats st;             // local: no false sharing between workers
+        PoolQueue q = {&dq, self, &st};
+        double t0 = hostSeconds();
+        worker(self, q);
+        st.busySec = hostSeconds() - t0;
+        stats[self] = st;
+    };
+    std::vector<std::thread> pool;
+    for (uint32_t w = 1; w < threads; w++) pool.emplace_back(work, w);
+    work(0);
+    for (std::thread &t : pool) t.join();
+}
+
+void poolRun(uint32_t threads, const std::vector<uint64_t> &cost,
+             const std::function<void(uint32_t worker, uint32_t item)> &job,
+             std::vector<PoolWorkerStats> &stats) {
+    poolRunWorkers(threads, cost, [&](uint32_t w, PoolQueue &q) {
+        uint32_t item;
+        while (q.next(item)) job(w, item);
+    }, stats);
+}
@@ -0,0 +1,71 @@
+/**
+ * Work-stealing thread pool and per-thread arenas
+ *
+ * Every worker owns a deque of item numbers. Items are dealt round-robin
+ * by decreasing cost, so each deque holds a similar load with its
+ * largest items at the back. A worker pops from the back of its own
+ * deque; when that is empty it steals from the front of the others',
+ * taking the small items left at the end of a run and so evening out the
+ * finish. Items never create items, so a worker that finds every deque
+ * empty is done. Each deque has its own lock, taken once per item (a
+ * session takes milliseconds), and sits on its own cache line.
+ *
+ * ThreadArena is a bump allocator a worker keeps results in: blocks are
+ * never moved or freed until the arena goes, so results stay valid for
+ * the main thread to collect after the run, and workers never meet in
+ * the allocator.
+ *
+ * A worker either runs one item at a time (poolRun) or pulls items
+ * itself (poolRunWorkers), e.g. to keep several sessions in flight in
+ * the lanes of a vector kernel.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct ThreadArena {
+    std::vector<std::unique_ptr<uint8_t[]>> blocks;
+    size_t   blockSize = 1 << 20;
+    uint8_t* cur = nullptr;
+    size_t   left = 0;
+    uint64_t bytes = 0;             // handed out
+
+    void* alloc(size_t n, size_t align = 8);
+
+    template <typename T>
+    T* make(size_t n) { return (T*)alloc(n * sizeof(T), alignof(T)); }
+};
+
+struct PoolWorkerStats {
+    uint64_t items = 0;
+    uint64_t steals = 0;            // items taken from another worker's deque
+    double   busySec = 0;           // until the worker found no more work
+};
+
+struct WorkDeque;
+
+// A worker's view of the pool: its next item, own deque first
+struct PoolQueue {
+    std::vector<WorkDeque>* dq;
+    uint32_t                self;
+    PoolWorkerStats*        st;
+
+    bool next(uint32_t &item);
+};
+
+// Runs worker(w, queue) on threads workers (worker 0 is the calling
+// thread); each takes items < cost.size() from its queue until it is
+// empty. cost orders the initial deal.
+void poolRunWorkers(uint32_t threads, const std::vector<uint64_t> &cost,
+                    const std::function<void(uint32_t worker, PoolQueue &q)> &worker,
+                    std::vector<PoolWorkerStats> &stats);
+
+// Runs job(worker, item) once for every item
+void poolRun(uint32_t threads, const std::vector<uint64_t> &cost,
+             const std::function<void(uint32_t worker, uint32_t item)> &job,
+             std::vector<PoolWorkerStats> &stats);
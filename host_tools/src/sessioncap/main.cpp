@@ -0,0 +1,653 @@
+/**
+ * sessioncap - capture imu_logger serial output into rotating session files
+ *
+ * Usage:
+ *   sessioncap [--out DIR] [--rotate SECONDS] [--rotate-mb N] [--rate HZ]
+ *              [--encoding E] [--chunk N] [--baud N] [--seconds S] DEVICE
+ *   sessioncap --emulate HZ [--binary] [--trigger PRE:POST] [--noise PPM] [--seconds S]
+ *
+ * Reads the serial port (or a pty) and accepts both imu_logger formats on
+ * the same line, switching as the logger announces them:
+ *
+ *   CSV     timestamp_ms,accel_x_g,...,impact lines; '#' lines are status
+ *   binary  after a "# BINARY ..." line: framed stream packets (bsstream.h)
+ *           until "# CSV"; status lines come between frames, each
+ *           after a newline
+ *
+ * In the logger's trigger mode (bstrigger.h) only windows around impacts
+ * arrive at full rate: the time gap before a "# WINDOW" line is not
+ * counted as lost, and the "# HB" heartbeats in between are totalled
+ * into how much of the session the link carried.
+ *
+ * Corrupted bytes are skipped (frame CRC / malformed lines) and parsing
+ * resynchronises on the next frame or line. Lost samples are counted from
+ * the packet sequence numbers in binary mode and from timestamp gaps in
+ * CSV mode. Samples go into DIR/cap-<date>-<time>-<n>.ybs, a new file
+ * every --rotate seconds of device time (default 600), every --rotate-mb
+ * MB, and whenever the device clock jumps back (logger reset). Files are
+ * flushed every second; a file cut short by a crash is still readable
+ * (sessionread recovers the chunks without the index).
+ *
+ * A reader thread only moves bytes from the port into a 16 MB ring, so
+ * disk stalls in the writer do not back up into the UART/USB buffers.
+ * Prints throughput, loss and ring usage once per second.
+ *
+ * --emulate creates a pty, prints its path and plays synthetic imu_logger
+ * output into it at HZ samples/s (CSV, or framed binary with --binary;
+ * --trigger sends trigger mode windows of PRE / POST ms as the logger
+ * does), flipping random bytes at --noise parts per million, to test the
+ * capture end without hardware:
+ *
+ *   sessioncap --emulate 2000 --binary --seconds 30 &      # prints /dev/pts/N
+ *   sessioncap --seconds 30 /dev/pts/N
+ */
+
+#include "bsstream.h"
+#include "bstrigger.h"
+#include "sessionout.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <random>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: sessioncap [--out DIR] [--rotate SECONDS] [--rotate-mb N] [--rate HZ]\n"
+            "                  [--encoding E] [--chunk N] [--baud N] [--seconds S] DEVICE\n"
+            "       sessioncap --emulate HZ [--binary] [--trigger PRE:POST] [--noise PPM] [--seconds S]\n");
+    exit(2);
+}
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int) { stopRequested = true; }
+
+static const size_t RING_BYTES = 16 << 20;
+static const size_t MAX_LINE   = 256;
+
+// ==================== Serial port ====================
+
+static speed_t baudConstant(int baud) {
+    switch (baud) {
+        case 9600:    return B9600;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 921600:  return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        default:      return 0;
+    }
+}
+
+// Opens the port raw (no echo, no line editing, no CR/LF translation)
+static int openPort(const char* path, int baud) {
+    int fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        speed_t speed = baudConstant(baud);
+        if (speed) cfsetspeed(&tio, speed);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+// ==================== Reader thread ====================
+
+// Single-producer single-consumer byte ring between the reader and the parser
+struct ByteRing {
+    std::vector<uint8_t>  buf;
+    std::atomic<uint64_t> head{0};        // written by the reader
+    std::atomic<uint64_t> tail{0};        // consumed by the parser
+    std::atomic<uint64_t> overflow{0};    // bytes dropped because the ring was full
+    std::atomic<uint64_t> peak{0};
+    std::atomic<uint32_t> reconnects{0};
+};
+
+static void readerThread(const char* path, int baud, ByteRing* ring) {
+    uint8_t tmp[65536];
+    int fd = -1;
+    while (!stopRequested) {
+        if (fd < 0) {
+            fd = openPort(path, baud);
+            if (fd < 0) {
+                usleep(500000);
+                continue;
+            }
+        }
+        struct pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, 100) <= 0) continue;
+        ssize_t n = read(fd, tmp, sizeof(tmp));
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            // Unplugged / logger reset / pty closed: reopen when it is back
+            close(fd);
+            fd = -1;
+            ring->reconnects++;
+            usleep(200000);
+            continue;
+        }
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t used = head - ring->tail.load(std::memory_order_acquire);
+        size_t room = ring->buf.size() - used;
+        size_t take = (size_t)n < room ? (size_t)n : room;
+        for (size_t i = 0; i < take;) {
+            size_t at = (head + i) % ring->buf.size();
+            size_t k = std::min(take - i, ring->buf.size() - at);
+            memcpy(&ring->buf[at], tmp + i, k);
+            i += k;
+        }
+        ring->overflow += n - take;
+        ring->head.store(head + take, std::memory_order_release);
+        if (used + take > ring->peak) ring->peak = used + take;
+    }
+    if (fd >= 0) close(fd);
+}
+
+// ==================== Capture ====================
+
+struct Capture {
+    // Options
+    const char* outDir = ".";
+    double      rotateSec = 600;
+    double      rotateMb = 0;
+    uint8_t     encoding = BS_ENC_AUTO;
+    uint16_t    chunkSamples = 1024;
+    uint16_t    rateHz = 200;             // until the logger tells
+
+    // Parser
+    bool            binary = false;
+    char            line[MAX_LINE];
+    size_t          lineLen = 0;
+    bool            lineTooLong = false;
+    BsFrameParser   frames;
+    BsStreamDecoder stream;
+    char            marker[4] = {};       // last bytes seen in binary mode
+    bool            binText = false;      // binary mode: inside a status line
+    bool            gapOk = false;        // a trigger window starts: no loss before it
+    BsFileHeader    header;
+
+    // Output
+    SessionOut* out = nullptr;
+    char        path[512];
+    uint32_t    fileSeq = 0;
+    int64_t     fileFirstUs = 0;
+    int64_t     lastUs = INT64_MIN;
+
+    // Totals
+    uint64_t samples = 0;
+    uint64_t lostCsv = 0;                 // from timestamp gaps
+    uint64_t badLines = 0;
+    uint64_t bytes = 0;
+    uint32_t files = 0;
+
+    // Trigger mode heartbeats: samples the logger took and sent
+    uint64_t hbTaken = 0;
+    uint64_t hbSent = 0;
+    uint32_t hbLines = 0;
+    uint32_t windows = 0;
+};
+
+static bool closeFile(Capture &c) {
+    if (!c.out) return true;
+    bool ok = sessionOutClose(*c.out);
+    if (!ok) fprintf(stderr, "%s: write failed\n", c.path);
+    delete c.out;
+    c.out = nullptr;
+    return ok;
+}
+
+static bool openFile(Capture &c, int64_t firstUs) {
+    time_t now = time(nullptr);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    snprintf(c.path, sizeof(c.path), "%s/cap-%s-%03u.ybs", c.outDir, stamp, c.fileSeq++);
+
+    BsFileHeader h = c.header;
+    h.session = c.fileSeq - 1;
+    h.sampleHz = c.rateHz;
+    h.startUs = firstUs;
+    c.out = new SessionOut();
+    if (!sessionOutOpen(*c.out, c.path, h, c.encoding, c.chunkSamples)) {
+        perror(c.path);
+        delete c.out;
+        c.out = nullptr;
+        return false;
+    }
+    c.fileFirstUs = firstUs;
+    c.files++;
+    fprintf(stderr, "writing %s\n", c.path);
+    return true;
+}
+
+static void addSample(Capture &c, const BsSample &s) {
+    bool reset = c.lastUs != INT64_MIN && s.tUs < c.lastUs;
+    bool full = c.out && ((c.rotateSec > 0 && s.tUs - c.fileFirstUs >= c.rotateSec * 1e6) ||
+                          (c.rotateMb > 0 && c.out->writer.offset >= c.rotateMb * 1e6));
+    if (reset) fprintf(stderr, "device clock went back: logger reset, new file\n");
+    if (reset || full) closeFile(c);
+    if (!c.out && !openFile(c, s.tUs)) {
+        stopRequested = true;
+        return;
+    }
+    sessionOutSample(*c.out, s);
+    c.lastUs = s.tUs;
+    c.samples++;
+}
+
+// "# BINARY columns=0x087f accel_per_g=1000 gyro_per_dps=10 rate=200"
+static void parseBinaryHeader(Capture &c, const char* line) {
+    const char* p;
+    if ((p = strstr(line, "accel_per_g=")))  c.header.accelPerG = (uint16_t)atoi(p + 12);
+    if ((p = strstr(line, "gyro_per_dps="))) c.header.gyroPerDps = (uint16_t)atoi(p + 13);
+    if ((p = strstr(line, "rate=")))         c.rateHz = (uint16_t)atoi(p + 5);
+    if ((p = strstr(line, "columns=")))      c.header.columns = (uint16_t)strtol(p + 8, nullptr, 16);
+}
+
+static void csvSample(Capture &c, char* line) {
+    char* f[10];
+    int n = 0;
+    for (char* p = line; n < 10;) {
+        f[n++] = p;
+        p = strchr(p, ',');
+        if (!p) break;
+        *p++ = '\0';
+    }
+    if (n != 9) {
+        c.badLines++;
+        return;
+    }
+    char* end;
+    BsSample s = {};
+    s.tUs = strtoll(f[0], &end, 10) * 1000;
+    if (*end) {
+        c.badLines++;
+        return;
+    }
+    for (int k = 0; k < 3; k++) s.a[k] = traceFixed(strtod(f[1 + k], nullptr), c.header.accelPerG);
+    for (int k = 0; k < 3; k++) s.g[k] = traceFixed(strtod(f[4 + k], nullptr), c.header.gyroPerDps);
+    if (f[8][0] == '1') s.flags = BS_FLAG_IMPACT;
+
+    // Timestamps are whole ms: allow one ms of rounding on top of 1.5 periods
+    int64_t periodUs = 1000000 / c.rateHz;
+    if (c.lastUs != INT64_MIN && s.tUs > c.lastUs + periodUs * 3 / 2 + 1000 && !c.gapOk) {
+        c.lostCsv += (s.tUs - c.lastUs + periodUs / 2) / periodUs - 1;
+    }
+    c.gapOk = false;
+    addSample(c, s);
+}
+
+static void textLine(Capture &c, char* line) {
+    size_t n = strlen(line);
+    if (n && line[n - 1] == '\r') line[--n] = '\0';
+    if (n == 0) return;
+    if (line[0] == '#') {
+        const char* p = strstr(line, "Sample rate:");
+        if (p) c.rateHz = (uint16_t)atoi(p + 12);
+        if (strncmp(line, "# HB ", 5) == 0) {
+            // Trigger mode heartbeat: totals only, once a second is too chatty
+            if ((p = strstr(line, " n=")))    c.hbTaken += strtoull(p + 3, nullptr, 10);
+            if ((p = strstr(line, " sent="))) c.hbSent += strtoull(p + 6, nullptr, 10);
+            c.hbLines++;
+            return;
+        }
+        if (strncmp(line, "# WINDOW", 8) == 0) {
+            c.gapOk = true;
+            c.windows++;
+            return;
+        }
+        if (strncmp(line, "# BINARY", 8) == 0) {
+            parseBinaryHeader(c, line);
+            c.binary = true;
+            bsFrameInit(c.frames);
+            bsStreamDecoderInit(c.stream);
+            memset(c.marker, 0, sizeof(c.marker));
+        } else if (strncmp(line, "# CSV", 5) == 0) {
+            c.binary = false;
+        }
+        fprintf(stderr, "logger: %s\n", line);
+        return;
+    }
+    if (line[0] < '0' || line[0] > '9') return;   // CSV header
+    csvSample(c, line);
+}
+
+static void feedByte(Capture &c, uint8_t b) {
+    if (c.binary && c.binText) {
+        // Rest of a status line; "# CSV" ends binary mode
+        if (b == '\n' || c.lineLen == MAX_LINE - 1) {
+            c.line[c.lineLen] = '\0';
+            c.binText = false;
+            c.lineLen = 0;
+            textLine(c, c.line);
+        } else {
+            c.line[c.lineLen++] = (char)b;
+        }
+        return;
+    }
+    if (c.binary) {
+        // A status line: newline, "# ", capital letter
+        memmove(c.marker, c.marker + 1, sizeof(c.marker) - 1);
+        c.marker[sizeof(c.marker) - 1] = (char)b;
+        if (memcmp(c.marker, "\n# ", 3) == 0 && b >= 'A' && b <= 'Z') {
+            memcpy(c.line, c.marker + 1, 3);
+            c.lineLen = 3;
+            c.binText = true;
+            return;
+        }
+        const uint8_t* payload;
+        int len = bsFrameFeed(c.frames, b, &payload);
+        BsSample s;
+        if (len && bsStreamDecode(c.stream, payload, len, s)) addSample(c, s);
+        return;
+    }
+    if (b == '\n') {
+        if (c.lineTooLong) c.badLines++;
+        else {
+            c.line[c.lineLen] = '\0';
+            textLine(c, c.line);
+        }
+        c.lineLen = 0;
+        c.lineTooLong = false;
+    } else if (c.lineLen < MAX_LINE - 1) {
+        c.line[c.lineLen++] = (char)b;
+    } else {
+        c.lineTooLong = true;
+    }
+}
+
+// A malformed CSV line is a lost sample too; CSV has no checksum, so a
+// corrupted digit that still parses is not caught
+static uint64_t lostSamples(const Capture &c) {
+    return c.lostCsv + c.badLines + c.stream.lost + c.stream.discarded;
+}
+
+static int capture(Capture &c, const char* device, int baud, double seconds) {
+    mkdir(c.outDir, 0755);
+    bsFileHeaderInit(c.header, 0, c.rateHz, BS_COLS_IMU, "imu_logger");
+    bsFrameInit(c.frames);
+    bsStreamDecoderInit(c.stream);
+
+    ByteRing ring;
+    ring.buf.resize(RING_BYTES);
+    std::thread reader(readerThread, device, baud, &ring);
+
+    double t0 = hostSeconds(), lastReport = t0;
+    uint64_t lastSamples = 0, lastBytes = 0;
+    for (;;) {
+        bool stopping = stopRequested || (seconds > 0 && hostSeconds() - t0 >= seconds);
+        if (stopping) stopRequested = true;
+
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; i++) feedByte(c, ring.buf[i % ring.buf.size()]);
+        c.bytes += head - tail;
+        ring.tail.store(head, std::memory_order_release);
+        if (stopping) {
+            reader.join();
+            // Whatever the reader added before it stopped
+            head = ring.head.load(std::memory_order_acquire);
+            for (uint64_t i = ring.tail; i < head; i++) feedByte(c, ring.buf[i % ring.buf.size()]);
+            c.bytes += head - ring.tail;
+            break;
+        }
+        if (head == tail) usleep(2000);
+
+        double now = hostSeconds();
+        if (now - lastReport >= 1.0) {
+            double dt = now - lastReport;
+            uint64_t lost = lostSamples(c);
+            fprintf(stderr,
+                    "[%6.0fs] %7.0f samples/s  %7.1f KB/s  %s  lost %llu (%.3f%%)  crc %u  "
+                    "bad lines %llu  ring peak %llu KB  overflow %llu\n",
+                    now - t0, (c.samples - lastSamples) / dt, (c.bytes - lastBytes) / dt / 1e3,
+                    c.binary ? "bin" : "csv", (unsigned long long)lost,
+                    100.0 * lost / std::max<uint64_t>(1, lost + c.samples), c.frames.badCrc,
+                    (unsigned long long)c.badLines, (unsigned long long)(ring.peak / 1024),
+                    (unsigned long long)ring.overflow.load());
+            if (c.out) fflush(c.out->fp);
+            lastReport = now;
+            lastSamples = c.samples;
+            lastBytes = c.bytes;
+        }
+    }
+    bool ok = closeFile(c);
+
+    double secs = hostSeconds() - t0;
+    uint64_t lost = lostSamples(c);
+    printf("%llu samples in %u files, %llu bytes in %.1f s (%.0f samples/s, %.1f KB/s)\n",
+           (unsigned long long)c.samples, c.files, (unsigned long long)c.bytes, secs,
+           c.samples / secs, c.bytes / secs / 1e3);
+    printf("lost %llu samples (%llu seq gaps, %llu waiting for a keyframe, %llu csv time gaps, "
+           "%llu bad lines), %u bad frames, %u reconnects, ring peak %llu KB, overflow %llu bytes\n",
+           (unsigned long long)lost, (unsigned long long)c.stream.lost,
+           (unsigned long long)c.stream.discarded, (unsigned long long)c.lostCsv,
+           (unsigned long long)c.badLines, c.frames.badCrc + c.stream.malformed,
+           ring.reconnects.load(), (unsigned long long)(ring.peak / 1024),
+           (unsigned long long)ring.overflow.load());
+    if (c.hbLines) {
+        printf("trigger mode: %u windows; over %u heartbeats the logger took %llu samples and sent %llu "
+               "(%.1f%%)\n", c.windows, c.hbLines, (unsigned long long)c.hbTaken,
+               (unsigned long long)c.hbSent, 100.0 * c.hbSent / std::max<uint64_t>(1, c.hbTaken));
+    }
+    return ok ? 0 : 1;
+}
+
+// ==================== Emulator ====================
+
+static void collect(void* ctx, const BsSample &s) { ((std::vector<BsSample>*)ctx)->push_back(s); }
+static void ignoreShot(void*, const BsShot &) {}
+
+// fd is non-blocking: waits for room in slices so a pty nobody reads
+// still sees stopRequested and the deadline (<= 0: none)
+static bool writeAll(int fd, const uint8_t* p, size_t n, double deadline) {
+    while (n) {
+        if (stopRequested || (deadline > 0 && hostSeconds() >= deadline)) return false;
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            struct pollfd q = {fd, POLLOUT, 0};
+            poll(&q, 1, 100);
+            continue;
+        }
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+// Emulator output as the logger writes it (trigger mode: via bstrigger.h)
+struct EmuOut {
+    std::vector<uint8_t>* out;
+    BsStreamEncoder*      enc;
+    bool                  binary;
+};
+
+static void emuSample(void* ctx, const BsSample &s, bool first) {
+    EmuOut &e = *(EmuOut*)ctx;
+    if (e.binary) {
+        if (first) bsStreamKey(*e.enc);
+        uint8_t packet[BS_STREAM_MAX];
+        uint8_t frame[BS_STREAM_MAX + 3];
+        size_t len = bsFramePut(frame, packet, (uint8_t)bsStreamEncode(*e.enc, s, packet));
+        e.out->insert(e.out->end(), frame, frame + len);
+        return;
+    }
+    char text[256];
+    double ax = s.a[0] / 1000.0, ay = s.a[1] / 1000.0, az = s.a[2] / 1000.0;
+    int n = snprintf(text, sizeof(text), "%lld,%.4f,%.4f,%.4f,%.2f,%.2f,%.2f,%.4f,%d\n",
+                     (long long)(s.tUs / 1000), ax, ay, az, s.g[0] / 10.0,
+                     s.g[1] / 10.0, s.g[2] / 10.0, sqrt(ax * ax + ay * ay + az * az),
+                     s.flags & BS_FLAG_IMPACT ? 1 : 0);
+    e.out->insert(e.out->end(), text, text + n);
+}
+
+static void emuText(void* ctx, const char* line, size_t len) {
+    EmuOut &e = *(EmuOut*)ctx;
+    if (e.binary) e.out->push_back('\n');
+    e.out->insert(e.out->end(), line, line + len);
+}
+
+static int emulate(uint16_t rateHz, bool binary, int preMs, int postMs, double noisePpm, double seconds) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pty");
+        return 1;
+    }
+    // Keep the slave open and raw so early output is not line-edited
+    int slave = openPort(ptsname(master), 0);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    printf("%s\n", ptsname(master));
+    fflush(stdout);
+
+    std::vector<BsSample> samples;
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, rateHz, BS_COLS_IMU, "emulator");
+    TraceCallbacks cb = {collect, ignoreShot, &samples};
+    TraceStats st;
+    traceSynthetic(seconds > 0 ? seconds : 60, rateHz, 1, h, cb, st);
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    BsStreamEncoder enc;
+    bsStreamInit(enc, BS_COLS_IMU, 2, std::max(1, rateHz / 4));   // keyframe every 0.25 s, as imu_logger
+
+    std::vector<uint8_t> out;
+    EmuOut eo = {&out, &enc, binary};
+    BsTrigOutput trigOut = {emuSample, emuText, &eo};
+    BsTrigger* trig = nullptr;
+    if (preMs >= 0) {
+        trig = new BsTrigger;
+        bsTrigInit(*trig, (uint16_t)(preMs * rateHz / 1000), (uint16_t)(postMs * rateHz / 1000), rateHz, h);
+    }
+    char text[256];
+    if (binary) {
+        snprintf(text, sizeof(text),
+                 "# BINARY columns=0x%04x accel_per_g=%d gyro_per_dps=%d rate=%u\n",
+                 BS_COLS_IMU, h.accelPerG, h.gyroPerDps, rateHz);
+    } else {
+        snprintf(text, sizeof(text),
+                 "timestamp_ms,accel_x_g,accel_y_g,accel_z_g,gyro_x_dps,gyro_y_dps,gyro_z_dps,"
+                 "accel_mag_g,impact\n# Sample rate: %u Hz\n", rateHz);
+    }
+    out.insert(out.end(), text, text + strlen(text));
+
+    uint64_t corrupted = 0, bytes = 0;
+    double t0 = hostSeconds();
+    double deadline = seconds > 0 ? t0 + seconds + 1 : 0;   // a second for the last writes
+    size_t next = 0;
+    while (next < samples.size() && !stopRequested) {
+        // Everything due by now, in one write
+        double due = (hostSeconds() - t0) * rateHz;
+        for (; next < samples.size() && next <= due; next++) {
+            const BsSample &s = samples[next];
+            if (trig) bsTrigPush(*trig, s, s.flags & BS_FLAG_IMPACT, trigOut);
+            else emuSample(&eo, s, false);
+        }
+        if (noisePpm > 0) {
+            for (uint8_t &b : out) {
+                if (uni(rng) * 1e6 < noisePpm) {
+                    b ^= 0x5A;
+                    corrupted++;
+                }
+            }
+        }
+        if (!out.empty() && !writeAll(master, out.data(), out.size(), deadline)) break;
+        bytes += out.size();
+        out.clear();
+        usleep(1000);
+    }
+    double secs = hostSeconds() - t0;
+    fprintf(stderr, "emulator: sent %zu samples, %llu bytes in %.1f s (%.0f samples/s), "
+                    "corrupted %llu bytes\n", next, (unsigned long long)bytes, secs, next / secs,
+            (unsigned long long)corrupted);
+    if (trig) {
+        fprintf(stderr, "emulator: trigger mode, %u windows, %llu of %llu samples sent\n", trig->windows,
+                (unsigned long long)trig->sent, (unsigned long long)trig->taken);
+        delete trig;
+    }
+    sleep(1);   // let the reader drain the pty before it goes away
+    close(slave);
+    close(master);
+    return 0;
+}
+
+// ==================== Main ====================
+
+static uint8_t parseEncoding(const char* name) {
+    if (!strcmp(name, "auto")) return BS_ENC_AUTO;
+    for (uint8_t e = 0; e < BS_ENC_COUNT; e++) {
+        if (!strcmp(name, bsEncodingName(e))) return e;
+    }
+    usage();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Capture c;
+    int baud = 115200;
+    double seconds = 0;
+    int emulateHz = 0;
+    bool binary = false;
+    double noisePpm = 0;
+    int preMs = -1, postMs = -1;
+    const char* device = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--out") && more)             c.outDir = argv[++i];
+        else if (!strcmp(a, "--rotate") && more)     c.rotateSec = atof(argv[++i]);
+        else if (!strcmp(a, "--rotate-mb") && more)  c.rotateMb = atof(argv[++i]);
+        else if (!strcmp(a, "--rate") && more)       c.rateHz = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--encoding") && more)   c.encoding = parseEncoding(argv[++i]);
+        else if (!strcmp(a, "--chunk") && more)      c.chunkSamples = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--baud") && more)       baud = atoi(argv[++i]);
+        else if (!strcmp(a, "--seconds") && more)    seconds = atof(argv[++i]);
+        else if (!strcmp(a, "--emulate") && more)    emulateHz = atoi(argv[++i]);
+        else if (!strcmp(a, "--binary"))             binary = true;
+        else if (!strcmp(a, "--trigger") && more) {
+            if (sscanf(argv[++i], "%d:%d", &preMs, &postMs) != 2 || preMs < 0 || postMs < 0) usage();
+        }
+        else if (!strcmp(a, "--noise") && more)      noisePpm = atof(argv[++i]);
+        else if (a[0] == '-' || device)              usage();
+        else                                         device = a;
+    }
+
+    // No SA_RESTART: a blocked read / write / poll returns EINTR and the
+    // loops recheck stopRequested
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    if (emulateHz > 0) {
+        if (device || emulateHz > 65535) usage();
+        return emulate((uint16_t)emulateHz, binary, preMs, postMs, noisePpm, seconds);
+    }
+    if (!device || c.rateHz == 0 || c.chunkSamples == 0) usage();
+    return capture(c, device, baud, seconds);
+}
@@ -0,0 +1,399 @@
+/**
+ * sessionconv - convert a ball session file to CSV or SQL, or benchmark reading it
+ *
+ * Usage:
+ *   sessionconv [--from MS] [--to MS] [--shot ID [--window MS]] in.ybs out.csv
+ *   sessionconv [--from MS] [--to MS] [--shot ID [--window MS]] in.ybs out.sql
+ *   sessionconv --bench in.ybs
+ *
+ * .csv is the imu_logger serial layout (timestamp_ms,accel_x_g,...,impact)
+ * so existing analysis scripts read it unchanged. .sql is a script for the
+ * observer database (observer/db.py schema): it creates the tables if
+ * needed and adds the file as a new session in one transaction:
+ *
+ *   sqlite3 tennis_data.db < session.sql
+ *
+ * --from/--to select a device-time range in ms, --shot the samples
+ * around one shot; both seek through the file index instead of scanning.
+ * --bench reads every column of every chunk (zero copy for raw chunks)
+ * and reports MB/s for the read and for CRC verification.
+ */
+
+#include "observer.h"
+#include "sessionread.h"
+#include "sessionout.h"
+#include "trace.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: sessionconv [--from MS] [--to MS] [--shot ID [--window MS]] in.ybs out.csv|out.sql\n"
+            "       sessionconv --bench in.ybs\n");
+    exit(2);
+}
+
+// ==================== Buffered text output ====================
+
+struct TextOut {
+    FILE*    fp;
+    char     buf[1 << 20];
+    size_t   len;
+    uint64_t bytes;
+};
+
+static void flushOut(TextOut &o) {
+    fwrite(o.buf, 1, o.len, o.fp);
+    o.bytes += o.len;
+    o.len = 0;
+}
+
+// Room for one more row
+static char* reserve(TextOut &o) {
+    if (o.len > sizeof(o.buf) - 1024) flushOut(o);
+    return o.buf + o.len;
+}
+
+static void commit(TextOut &o, char* p) { o.len = p - o.buf; }
+
+static void putStr(TextOut &o, const char* s) {
+    size_t n = strlen(s);
+    if (o.len + n > sizeof(o.buf)) flushOut(o);
+    if (n > sizeof(o.buf)) {
+        fwrite(s, 1, n, o.fp);
+        o.bytes += n;
+        return;
+    }
+    memcpy(o.buf + o.len, s, n);
+    o.len += n;
+}
+
+static char* putInt(char* p, int64_t v) {
+    char tmp[24];
+    int n = 0;
+    uint64_t u = v < 0 ? -(uint64_t)v : v;
+    if (v < 0) *p++ = '-';
+    do { tmp[n++] = '0' + u % 10; u /= 10; } while (u);
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+static const int64_t POW10[] = {1, 10, 100, 1000, 10000};
+
+// v / scale with dec decimals, rounded half away from zero (like printf %.Nf)
+static char* putFixed(char* p, int64_t v, int64_t scale, int dec) {
+    int64_t num = v * POW10[dec] * 2;
+    int64_t x = (num + (num < 0 ? -scale : scale)) / (2 * scale);
+    if (x < 0) {
+        *p++ = '-';
+        x = -x;
+    }
+    p = putInt(p, x / POW10[dec]);
+    if (dec) {
+        *p++ = '.';
+        int64_t frac = x % POW10[dec];
+        for (int d = dec - 1; d >= 0; d--) {
+            *p++ = '0' + (frac / POW10[d]) % 10;
+        }
+    }
+    return p;
+}
+
+static char* putDouble(char* p, double v, int dec) {
+    return putFixed(p, llround(v * POW10[dec]), POW10[dec], dec);
+}
+
+// ==================== Rows ====================
+
+struct Range {
+    int64_t fromUs = INT64_MIN;
+    int64_t toUs = INT64_MAX;
+};
+
+struct Convert {
+    SessionReader* r;
+    TextOut*       out;
+    bool           sql;
+    double         accelPerG, gyroPerDps;
+    int32_t        accelNum, accelDen, gyroNum, gyroDen;   // exact: value = count * num / den
+    uint64_t       rows = 0;
+    double         rpmSum = 0, rpmMax = 0;
+    int64_t        tFirstUs = 0, tLastUs = 0;
+    ObserverClock  clock;
+};
+
+static const int SQL_ROWS_PER_INSERT = 500;
+
+static void csvRow(Convert &c, const SessionChunk &ch, size_t i) {
+    char* p = reserve(*c.out);
+    double ax = ch.col[0][i] / c.accelPerG, ay = ch.col[1][i] / c.accelPerG,
+           az = ch.col[2][i] / c.accelPerG;
+    p = putInt(p, ch.t[i] / 1000);
+    for (int k = 0; k < 3; k++) { *p++ = ','; p = putFixed(p, ch.col[k][i] * (int64_t)c.accelNum, c.accelDen, 4); }
+    for (int k = 3; k < 6; k++) { *p++ = ','; p = putFixed(p, ch.col[k][i] * (int64_t)c.gyroNum, c.gyroDen, 2); }
+    *p++ = ',';
+    p = putDouble(p, sqrt(ax * ax + ay * ay + az * az), 4);
+    *p++ = ',';
+    *p++ = !ch.flags.empty() && (ch.flags[i] & BS_FLAG_IMPACT) ? '1' : '0';
+    *p++ = '\n';
+    commit(*c.out, p);
+}
+
+static void sqlRow(Convert &c, const SessionChunk &ch, size_t i) {
+    const BsFileHeader &h = *c.r->header;
+    if (c.rows % SQL_ROWS_PER_INSERT == 0) {
+        if (c.rows) putStr(*c.out, ";\n");
+        putStr(*c.out, "INSERT INTO imu_data (session_id, device_ts, local_ts, ax, ay, az, "
+                       "gx, gy, gz, qw, qx, qy, qz, rpm, spin, impact) VALUES\n");
+    } else {
+        putStr(*c.out, ",\n");
+    }
+
+    // rpm / spin as the ball computes them, from the unfiltered gyro
+    double gx = ch.col[3][i] / c.gyroPerDps, gy = ch.col[4][i] / c.gyroPerDps,
+           gz = ch.col[5][i] / c.gyroPerDps;
+    double rpm = observerRpm(gx, gy, gz);
+    c.rpmSum += rpm;
+    if (rpm > c.rpmMax) c.rpmMax = rpm;
+
+    char* p = reserve(*c.out);
+    memcpy(p, "((SELECT id FROM _import),", 26);
+    p = putInt(p + 26, ch.t[i] / 1000);
+    *p++ = ',';
+    *p++ = '\'';
+    const char* iso = observerLocalTime(c.clock, ch.t[i]);
+    size_t n = strlen(iso);
+    memcpy(p, iso, n);
+    p += n;
+    *p++ = '\'';
+    for (int k = 0; k < 3; k++) { *p++ = ','; p = putFixed(p, ch.col[k][i] * (int64_t)c.accelNum, c.accelDen, 4); }
+    for (int k = 3; k < 6; k++) { *p++ = ','; p = putFixed(p, ch.col[k][i] * (int64_t)c.gyroNum, c.gyroDen, 2); }
+    for (int k = 6; k < 10; k++) {
+        *p++ = ',';
+        if (ch.col[k].empty()) *p++ = '0';
+        else p = putFixed(p, ch.col[k][i], h.quatOne, 4);
+    }
+    *p++ = ',';
+    p = putDouble(p, rpm, 1);
+    *p++ = ',';
+    *p++ = '\'';
+    const char* spin = traceSpinLabel(gx, gy, gz, rpm);
+    n = strlen(spin);
+    memcpy(p, spin, n);
+    p += n;
+    *p++ = '\'';
+    *p++ = ',';
+    *p++ = !ch.flags.empty() && (ch.flags[i] & BS_FLAG_IMPACT) ? '1' : '0';
+    *p++ = ')';
+    commit(*c.out, p);
+}
+
+static void sqlShot(Convert &c, const BsShot &s) {
+    char spin[sizeof(s.spinType) + 1];
+    observerSpinType(s, spin, sizeof(spin));
+
+    char line[512];
+    double theta, phi;
+    char axis[64] = "NULL,NULL";
+    if (observerSpinAxis(s, theta, phi)) snprintf(axis, sizeof(axis), "%.6f,%.6f", theta, phi);
+    snprintf(line, sizeof(line),
+             "INSERT INTO shots (session_id, shot_id, device_ts, local_ts, rpm, peak_g, "
+             "gx, gy, gz, spin_type, spin_axis_theta, spin_axis_phi) VALUES "
+             "((SELECT id FROM _import),%u,%lld,'%s',%.1f,%.2f,%.2f,%.2f,%.2f,'%s',%s);\n",
+             s.id, (long long)(s.tUs / 1000), observerLocalTime(c.clock, s.tUs), s.peakRpm, s.peakG,
+             s.gx, s.gy, s.gz, spin, axis);
+    putStr(*c.out, line);
+}
+
+// Writes the rows of [range]; returns false on a malformed chunk
+static bool convertRange(Convert &c, const Range &range) {
+    SessionReader &r = *c.r;
+    std::vector<BsShot> shots;
+    SessionChunk ch;
+    bool first = true;
+
+    for (uint32_t i = sessionFindTime(r, range.fromUs); i < r.chunks; i++) {
+        if (r.index[i].tFirstUs > range.toUs) break;
+        if (!sessionVerifyChunk(r, i) || !sessionLoadChunk(r, i, ch)) {
+            fprintf(stderr, "chunk %u at offset %llu is corrupt\n", i,
+                    (unsigned long long)r.index[i].offset);
+            return false;
+        }
+        for (const BsShot &s : ch.shots) {
+            if (s.tUs >= range.fromUs && s.tUs <= range.toUs) shots.push_back(s);
+        }
+        for (size_t k = 0; k < ch.t.size; k++) {
+            int64_t t = ch.t[k];
+            if (t < range.fromUs || t > range.toUs) continue;
+            if (first) {
+                c.tFirstUs = t;
+                first = false;
+            }
+            c.tLastUs = t;
+            if (c.sql) sqlRow(c, ch, k);
+            else       csvRow(c, ch, k);
+            c.rows++;
+        }
+    }
+    if (!c.sql) return true;
+
+    if (c.rows) putStr(*c.out, ";\n");
+    for (const BsShot &s : shots) sqlShot(c, s);
+    char line[512];
+    snprintf(line, sizeof(line),
+             "UPDATE sessions SET end_time = '%s', duration_sec = %.3f, total_samples = %llu, "
+             "total_shots = %zu, avg_rpm = %.2f, max_rpm = %.2f WHERE id = (SELECT id FROM _import);\n",
+             observerLocalTime(c.clock, c.tLastUs), (c.tLastUs - c.tFirstUs) / 1e6, (unsigned long long)c.rows,
+             shots.size(), c.rows ? c.rpmSum / c.rows : 0.0, c.rpmMax);
+    putStr(*c.out, line);
+    return true;
+}
+
+// ==================== Benchmark ====================
+
+static int bench(SessionReader &r) {
+    sessionSequential(r);
+    SessionChunk ch;
+    int64_t sum = 0;
+    double t0 = hostSeconds();
+    for (uint32_t i = 0; i < r.chunks; i++) {
+        if (!sessionLoadChunk(r, i, ch)) {
+            fprintf(stderr, "chunk %u is corrupt\n", i);
+            return 1;
+        }
+        for (int64_t t : ch.t) sum += t;
+        for (const Span<int16_t> &col : ch.col) {
+            for (int16_t v : col) sum += v;
+        }
+        for (uint16_t f : ch.flags) sum += f;
+    }
+    double readSec = hostSeconds() - t0;
+
+    t0 = hostSeconds();
+    uint32_t bad = 0;
+    for (uint32_t i = 0; i < r.chunks; i++) bad += !sessionVerifyChunk(r, i);
+    double crcSec = hostSeconds() - t0;
+
+    printf("%llu bytes, %u chunks, %llu samples, %u shots%s\n", (unsigned long long)r.size,
+           r.chunks, (unsigned long long)r.samples, r.shots,
+           r.recovered ? " (no index, chunks scanned)" : "");
+    printf("  read     %.3f s  %.0f MB/s  %.1f Msamples/s  (checksum %lld)\n", readSec,
+           r.size / readSec / 1e6, r.samples / readSec / 1e6, (long long)sum);
+    printf("  verify   %.3f s  %.0f MB/s  %u bad chunks\n", crcSec, r.size / crcSec / 1e6, bad);
+    return bad ? 1 : 0;
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+    Range range;
+    bool benchOnly = false;
+    long long shotId = -1;
+    int64_t windowMs = 1000;
+    const char* paths[2];
+    int npaths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--from") && more)        range.fromUs = atoll(argv[++i]) * 1000;
+        else if (!strcmp(a, "--to") && more)     range.toUs = atoll(argv[++i]) * 1000;
+        else if (!strcmp(a, "--shot") && more)   shotId = atoll(argv[++i]);
+        else if (!strcmp(a, "--window") && more) windowMs = atoll(argv[++i]);
+        else if (!strcmp(a, "--bench"))          benchOnly = true;
+        else if (a[0] == '-' || npaths == 2)     usage();
+        else                                     paths[npaths++] = a;
+    }
+    if (npaths != (benchOnly ? 1 : 2)) usage();
+
+    SessionReader r;
+    if (!sessionOpen(r, paths[0])) {
+        fprintf(stderr, "%s: %s\n", paths[0], r.error);
+        return 1;
+    }
+    if (r.recovered) {
+        fprintf(stderr, "%s: no valid index, recovered %u chunks by scanning\n", paths[0],
+                r.chunks);
+    }
+    if (benchOnly) {
+        int rc = bench(r);
+        sessionClose(r);
+        return rc;
+    }
+
+    if (shotId >= 0) {
+        const BsShot* s = nullptr;
+        if (sessionFindShot(r, (uint32_t)shotId, &s) == r.chunks) {
+            fprintf(stderr, "%s: no shot %lld\n", paths[0], shotId);
+            return 1;
+        }
+        range.fromUs = s->tUs - windowMs * 1000;
+        range.toUs = s->tUs + windowMs * 1000;
+    }
+
+    const char* outPath = paths[1];
+    size_t n = strlen(outPath);
+    bool sql = n > 4 && !strcmp(outPath + n - 4, ".sql");
+    TextOut* out = new TextOut();
+    out->fp = fopen(outPath, "wb");
+    if (!out->fp) {
+        perror(outPath);
+        return 1;
+    }
+
+    Convert c;
+    c.r = &r;
+    c.out = out;
+    c.sql = sql;
+    c.accelPerG = bsAccelPerG(*r.header);
+    c.gyroPerDps = bsGyroPerDps(*r.header);
+    bsAccelRatio(*r.header, c.accelNum, c.accelDen);
+    bsGyroRatio(*r.header, c.gyroNum, c.gyroDen);
+
+    if (sql) {
+        // The file has device time only: anchor the session so that it
+        // ends at the file's modification time
+        struct stat st;
+        stat(paths[0], &st);
+        int64_t lastUs = r.chunks ? r.index[r.chunks - 1].tLastUs : 0;
+        observerClockAnchor(c.clock, lastUs, st.st_mtime);
+        int64_t startUs = r.chunks ? std::max(r.index[0].tFirstUs, range.fromUs) : 0;
+
+        const char* base = strrchr(paths[0], '/') ? strrchr(paths[0], '/') + 1 : paths[0];
+        char note[96];
+        snprintf(note, sizeof(note), "imported from %.40s (%.16s, session %u)", base,
+                 r.header->source, r.header->session);
+        for (char* q = note; *q; q++) if (*q == '\'') *q = '_';
+
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "INSERT INTO sessions (start_time, notes) VALUES ('%s', '%s');\n"
+                 "CREATE TEMP TABLE _import AS SELECT last_insert_rowid() AS id;\n",
+                 observerLocalTime(c.clock, startUs), note);
+        putStr(*out, OBSERVER_SCHEMA);
+        putStr(*out, "BEGIN;\n");
+        putStr(*out, line);
+    } else {
+        putStr(*out, "timestamp_ms,accel_x_g,accel_y_g,accel_z_g,gyro_x_dps,gyro_y_dps,"
+                     "gyro_z_dps,accel_mag_g,impact\n");
+    }
+
+    sessionSequential(r);
+    double t0 = hostSeconds();
+    bool ok = convertRange(c, range);
+    if (sql) putStr(*out, "DROP TABLE _import;\nCOMMIT;\n");
+    flushOut(*out);
+    ok = fclose(out->fp) == 0 && ok;
+    double secs = hostSeconds() - t0;
+
+    printf("%s: %llu rows, %llu bytes in %.3f s  (%.0f MB/s written, %.1f Mrows/s)\n", outPath,
+           (unsigned long long)c.rows, (unsigned long long)out->bytes, secs,
+           out->bytes / secs / 1e6, c.rows / secs / 1e6);
+    delete out;
+    sessionClose(r);
+    return ok ? 0 : 1;
+}
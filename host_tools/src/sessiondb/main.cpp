@@ -0,0 +1,452 @@
+/**
+ * sessiondb - bulk load session files into the observer database
+ *
+ * Usage:
+ *   sessiondb [--rows N] [--defer-index] tennis_data.db in.ybs|in.csv ...
+ *
+ * Each input (ball session file, or imu_logger / dashboard CSV) becomes
+ * one new session in the observer schema (observer/db.py), so
+ * dashboard.py lists and plots it like a recorded one. Unlike the
+ * observer's per-batch executemany + commit, the load
+ *
+ *   - binds values into one prepared multi-row INSERT (--rows rows per
+ *     statement, default 256) instead of formatting SQL text,
+ *   - runs each input in a single transaction, WAL with synchronous=NORMAL.
+ *
+ * --defer-index drops idx_imu_session_ts for the load and rebuilds it
+ * once at the end. It is off by default: every loaded session gets the
+ * highest session_id and rows arrive in device_ts order, so the index
+ * only ever grows at its right edge and keeping it up to date is cheaper
+ * than the rebuild (see host_tools/README.md).
+ *
+ * rpm / spin come from the gyro with the ball's rules, local_ts is
+ * anchored so the session ends at the input file's modification time.
+ * Prints rows/s for the inserts and for the index build.
+ */
+
+#include "observer.h"
+#include "sessionout.h"
+#include "sessionread.h"
+#include "trace.h"
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: sessiondb [--rows N] [--defer-index] db in.ybs|in.csv ...\n");
+    exit(2);
+}
+
+static const int COLS_PER_ROW = 16;    // imu_data columns bound per row
+
+static const char* IMU_INSERT =
+    "INSERT INTO imu_data (session_id, device_ts, local_ts, ax, ay, az, gx, gy, gz, "
+    "qw, qx, qy, qz, rpm, spin, impact) VALUES ";
+
+static const char* SHOT_INSERT =
+    "INSERT INTO shots (session_id, shot_id, device_ts, local_ts, rpm, peak_g, gx, gy, gz, "
+    "spin_type, spin_axis_theta, spin_axis_phi) VALUES (?,?,?,?,?,?,?,?,?,?,?,?)";
+
+// ==================== Loader ====================
+
+struct Row {
+    int64_t     deviceTs;
+    double      v[10];            // ax..gz in g and deg/s, qw..qz
+    double      rpm;
+    const char* spin;
+    int         impact;
+    char        localTs[32];
+};
+
+struct Loader {
+    sqlite3*          db = nullptr;
+    sqlite3_stmt*     insertMany = nullptr;   // rowsPerInsert rows
+    sqlite3_stmt*     insertOne = nullptr;    // the tail of a session
+    sqlite3_stmt*     insertShot = nullptr;
+    int               rowsPerInsert = 256;
+    std::vector<Row>  pending;
+    size_t            npending = 0;
+
+    // Current session
+    int64_t           sessionId = 0;
+    ObserverClock     clock;
+    double            unit[10];               // fixed-point LSB per g, deg/s, 1.0
+    uint64_t          rows = 0;
+    double            rpmSum = 0, rpmMax = 0;
+    int64_t           tFirstUs = 0, tLastUs = 0;
+    std::vector<BsShot> shots;
+    bool              failed = false;
+};
+
+static bool check(Loader &l, int rc, const char* what) {
+    if (rc == SQLITE_OK || rc == SQLITE_DONE || rc == SQLITE_ROW) return true;
+    fprintf(stderr, "sqlite: %s: %s\n", what, sqlite3_errmsg(l.db));
+    l.failed = true;
+    return false;
+}
+
+static bool exec(Loader &l, const char* sql) {
+    return check(l, sqlite3_exec(l.db, sql, nullptr, nullptr, nullptr), sql);
+}
+
+static int64_t queryInt(Loader &l, const char* sql) {
+    sqlite3_stmt* st;
+    int64_t v = 0;
+    if (!check(l, sqlite3_prepare_v2(l.db, sql, -1, &st, nullptr), sql)) return 0;
+    if (sqlite3_step(st) == SQLITE_ROW) v = sqlite3_column_int64(st, 0);
+    sqlite3_finalize(st);
+    return v;
+}
+
+static sqlite3_stmt* prepareInsert(Loader &l, int rows) {
+    std::string sql = IMU_INSERT;
+    for (int i = 0; i < rows; i++) {
+        sql += i ? ",(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)" : "(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)";
+    }
+    sqlite3_stmt* st = nullptr;
+    check(l, sqlite3_prepare_v3(l.db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &st, nullptr),
+          "prepare insert");
+    return st;
+}
+
+static bool loaderOpen(Loader &l, const char* path) {
+    if (sqlite3_open(path, &l.db) != SQLITE_OK) {
+        fprintf(stderr, "%s: %s\n", path, sqlite3_errmsg(l.db));
+        return false;
+    }
+    // WAL like the observer; NORMAL only syncs at checkpoints, which is
+    // still crash-consistent in WAL mode
+    exec(l, "PRAGMA journal_mode=WAL");
+    exec(l, "PRAGMA synchronous=NORMAL");
+    exec(l, "PRAGMA cache_size=-131072");     // 128 MB page cache
+    exec(l, "PRAGMA temp_store=MEMORY");      // index build sorts in memory
+    exec(l, OBSERVER_SCHEMA);
+
+    int maxVars = sqlite3_limit(l.db, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+    if (l.rowsPerInsert * COLS_PER_ROW > maxVars) l.rowsPerInsert = maxVars / COLS_PER_ROW;
+    l.pending.resize(l.rowsPerInsert);
+    l.insertMany = prepareInsert(l, l.rowsPerInsert);
+    l.insertOne = prepareInsert(l, 1);
+    check(l, sqlite3_prepare_v3(l.db, SHOT_INSERT, -1, SQLITE_PREPARE_PERSISTENT,
+                                &l.insertShot, nullptr), "prepare shot insert");
+    return !l.failed;
+}
+
+static void loaderClose(Loader &l) {
+    sqlite3_finalize(l.insertMany);
+    sqlite3_finalize(l.insertOne);
+    sqlite3_finalize(l.insertShot);
+    sqlite3_close(l.db);
+}
+
+// Binds rows [0, n) to st (n rows' worth of parameters) and runs it
+static void insertRows(Loader &l, sqlite3_stmt* st, const Row* rows, size_t n) {
+    int p = 1;
+    for (size_t i = 0; i < n; i++) {
+        const Row &r = rows[i];
+        sqlite3_bind_int64(st, p++, l.sessionId);
+        sqlite3_bind_int64(st, p++, r.deviceTs);
+        sqlite3_bind_text(st, p++, r.localTs, -1, SQLITE_STATIC);
+        for (int k = 0; k < 10; k++) sqlite3_bind_double(st, p++, r.v[k]);
+        sqlite3_bind_double(st, p++, r.rpm);
+        sqlite3_bind_text(st, p++, r.spin, -1, SQLITE_STATIC);
+        sqlite3_bind_int(st, p++, r.impact);
+    }
+    check(l, sqlite3_step(st), "insert imu_data");
+    sqlite3_reset(st);
+}
+
+static void flushRows(Loader &l) {
+    if (l.npending == (size_t)l.rowsPerInsert) {
+        insertRows(l, l.insertMany, l.pending.data(), l.npending);
+    } else {
+        for (size_t i = 0; i < l.npending; i++) insertRows(l, l.insertOne, &l.pending[i], 1);
+    }
+    l.npending = 0;
+}
+
+// v rounded to dec decimals, as the observer's JSON values are
+static double roundTo(double v, int dec) {
+    static const double POW10[] = {1, 10, 100, 1000, 10000};
+    return nearbyint(v * POW10[dec]) / POW10[dec];
+}
+
+static void addRow(Loader &l, int64_t tUs, const int16_t* v, uint16_t flags) {
+    if (l.failed) return;
+    Row &r = l.pending[l.npending];
+    r.deviceTs = tUs / 1000;
+    for (int k = 0; k < 10; k++) r.v[k] = v[k] / l.unit[k];
+    // rpm / spin as the ball computes them, from the unfiltered gyro
+    r.rpm = observerRpm(r.v[3], r.v[4], r.v[5]);
+    r.spin = traceSpinLabel(r.v[3], r.v[4], r.v[5], r.rpm);
+    r.rpm = roundTo(r.rpm, 1);
+    r.impact = (flags & BS_FLAG_IMPACT) ? 1 : 0;
+    const char* iso = observerLocalTime(l.clock, tUs);
+    memcpy(r.localTs, iso, strlen(iso) + 1);
+
+    l.rpmSum += r.rpm;
+    if (r.rpm > l.rpmMax) l.rpmMax = r.rpm;
+    if (l.rows == 0) l.tFirstUs = tUs;
+    l.tLastUs = tUs;
+    l.rows++;
+    if (++l.npending == (size_t)l.rowsPerInsert) flushRows(l);
+}
+
+static void beginSession(Loader &l, const BsFileHeader &h, const char* path, int64_t tFirstUs) {
+    for (int k = 0; k < 3; k++) l.unit[k] = bsAccelPerG(h);
+    for (int k = 3; k < 6; k++) l.unit[k] = bsGyroPerDps(h);
+    for (int k = 6; k < 10; k++) l.unit[k] = h.quatOne;
+    l.rows = 0;
+    l.rpmSum = l.rpmMax = 0;
+    l.tFirstUs = l.tLastUs = 0;
+    l.shots.clear();
+
+    const char* base = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    char note[96];
+    snprintf(note, sizeof(note), "imported from %.40s (%.16s, session %u)", base, h.source,
+             h.session);
+
+    exec(l, "BEGIN");
+    sqlite3_stmt* st;
+    check(l, sqlite3_prepare_v2(l.db, "INSERT INTO sessions (start_time, notes) VALUES (?, ?)",
+                                -1, &st, nullptr), "prepare session");
+    sqlite3_bind_text(st, 1, observerLocalTime(l.clock, tFirstUs), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(st, 2, note, -1, SQLITE_TRANSIENT);
+    check(l, sqlite3_step(st), "insert session");
+    sqlite3_finalize(st);
+    l.sessionId = sqlite3_last_insert_rowid(l.db);
+}
+
+static void insertShot(Loader &l, const BsShot &s) {
+    sqlite3_stmt* st = l.insertShot;
+    char spin[sizeof(s.spinType) + 1];
+    observerSpinType(s, spin, sizeof(spin));
+    double theta, phi;
+    bool axis = observerSpinAxis(s, theta, phi);
+    sqlite3_bind_int64(st, 1, l.sessionId);
+    sqlite3_bind_int64(st, 2, s.id);
+    sqlite3_bind_int64(st, 3, s.tUs / 1000);
+    sqlite3_bind_text(st, 4, observerLocalTime(l.clock, s.tUs), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_double(st, 5, roundTo(s.peakRpm, 1));
+    sqlite3_bind_double(st, 6, roundTo(s.peakG, 2));
+    sqlite3_bind_double(st, 7, roundTo(s.gx, 2));
+    sqlite3_bind_double(st, 8, roundTo(s.gy, 2));
+    sqlite3_bind_double(st, 9, roundTo(s.gz, 2));
+    sqlite3_bind_text(st, 10, spin, -1, SQLITE_TRANSIENT);
+    if (axis) {
+        sqlite3_bind_double(st, 11, theta);
+        sqlite3_bind_double(st, 12, phi);
+    } else {
+        sqlite3_bind_null(st, 11);
+        sqlite3_bind_null(st, 12);
+    }
+    check(l, sqlite3_step(st), "insert shot");
+    sqlite3_reset(st);
+}
+
+// Session totals, then commit (or roll back after an error)
+static bool endSession(Loader &l) {
+    flushRows(l);
+    for (const BsShot &s : l.shots) insertShot(l, s);
+
+    sqlite3_stmt* st;
+    check(l, sqlite3_prepare_v2(l.db,
+        "UPDATE sessions SET end_time = ?, duration_sec = ?, total_samples = ?, "
+        "total_shots = ?, avg_rpm = ?, max_rpm = ? WHERE id = ?", -1, &st, nullptr),
+        "prepare session update");
+    sqlite3_bind_text(st, 1, observerLocalTime(l.clock, l.tLastUs), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_double(st, 2, (l.tLastUs - l.tFirstUs) / 1e6);
+    sqlite3_bind_int64(st, 3, l.rows);
+    sqlite3_bind_int64(st, 4, l.shots.size());
+    sqlite3_bind_double(st, 5, l.rows ? roundTo(l.rpmSum / l.rows, 2) : 0.0);
+    sqlite3_bind_double(st, 6, roundTo(l.rpmMax, 2));
+    sqlite3_bind_int64(st, 7, l.sessionId);
+    check(l, sqlite3_step(st), "update session");
+    sqlite3_finalize(st);
+
+    if (l.failed) {
+        sqlite3_exec(l.db, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+    return exec(l, "COMMIT");
+}
+
+// ==================== Inputs ====================
+
+static bool isSessionFile(const char* path) {
+    size_t n = strlen(path);
+    return n > 4 && !strcmp(path + n - 4, ".ybs");
+}
+
+static time_t fileMtime(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_mtime : time(nullptr);
+}
+
+static bool loadSessionFile(Loader &l, const char* path) {
+    SessionReader r;
+    if (!sessionOpen(r, path)) {
+        fprintf(stderr, "%s: %s\n", path, r.error);
+        return false;
+    }
+    if (r.recovered) {
+        fprintf(stderr, "%s: no valid index, recovered %u chunks by scanning\n", path, r.chunks);
+    }
+    int64_t firstUs = r.chunks ? r.index[0].tFirstUs : 0;
+    int64_t lastUs = r.chunks ? r.index[r.chunks - 1].tLastUs : 0;
+    observerClockAnchor(l.clock, lastUs, fileMtime(path));
+    beginSession(l, *r.header, path, firstUs);
+    sessionSequential(r);
+
+    SessionChunk ch;
+    bool ok = true;
+    for (uint32_t i = 0; i < r.chunks && ok && !l.failed; i++) {
+        if (!sessionVerifyChunk(r, i) || !sessionLoadChunk(r, i, ch)) {
+            fprintf(stderr, "%s: chunk %u is corrupt\n", path, i);
+            ok = false;
+            break;
+        }
+        for (const BsShot &s : ch.shots) l.shots.push_back(s);
+        int16_t v[10] = {};
+        for (size_t k = 0; k < ch.t.size; k++) {
+            for (int c = 0; c < 10; c++) v[c] = ch.col[c].empty() ? 0 : ch.col[c][k];
+            addRow(l, ch.t[k], v, ch.flags.empty() ? 0 : ch.flags[k]);
+        }
+    }
+    sessionClose(r);
+    if (!ok) l.failed = true;
+    return endSession(l) && ok;
+}
+
+static void onCsvSample(void* ctx, const BsSample &s) {
+    int16_t v[10] = {s.a[0], s.a[1], s.a[2], s.g[0], s.g[1], s.g[2], s.q[0], s.q[1], s.q[2], s.q[3]};
+    addRow(*(Loader*)ctx, s.tUs, v, s.flags);
+}
+
+static void onCsvShot(void* ctx, const BsShot &s) { ((Loader*)ctx)->shots.push_back(s); }
+
+// Device time (ms) of the last sample line, from the tail of a CSV trace;
+// a dashboard export's "Shots" table is skipped
+static int64_t csvLastMs(FILE* fp) {
+    char tail[65536 + 1];
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    long start = size > 65536 ? size - 65536 : 0;
+    fseek(fp, start, SEEK_SET);
+    size_t n = fread(tail, 1, size - start, fp);
+    tail[n] = '\0';
+    char* shots = strstr(tail, "\nShots\n");
+    if (shots) *shots = '\0';
+
+    int64_t last = 0;
+    for (char* line = strtok(tail, "\r\n"); line; line = strtok(nullptr, "\r\n")) {
+        if (line[0] >= '0' && line[0] <= '9' && strchr(line, ',')) last = strtoll(line, nullptr, 10);
+    }
+    return last;
+}
+
+static bool loadCsv(Loader &l, const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+    int64_t lastMs = csvLastMs(fp);
+    rewind(fp);
+    TraceLayout layout = traceSniffCsv(fp);
+    if (layout == TRACE_UNKNOWN) {
+        fprintf(stderr, "%s: not a session file, imu_logger or dashboard CSV\n", path);
+        fclose(fp);
+        return false;
+    }
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, 0, traceColumns(layout), "csv");
+    observerClockAnchor(l.clock, lastMs * 1000, fileMtime(path));
+    // start_time is rewritten once the first sample is known
+    beginSession(l, h, path, 0);
+
+    TraceCallbacks cb = {onCsvSample, onCsvShot, &l};
+    TraceStats st;
+    traceReadCsv(fp, h, cb, st);
+    fclose(fp);
+    if (l.rows && !l.failed) {
+        sqlite3_stmt* s;
+        check(l, sqlite3_prepare_v2(l.db, "UPDATE sessions SET start_time = ? WHERE id = ?", -1,
+                                    &s, nullptr), "prepare start time");
+        sqlite3_bind_text(s, 1, observerLocalTime(l.clock, l.tFirstUs), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(s, 2, l.sessionId);
+        check(l, sqlite3_step(s), "update start time");
+        sqlite3_finalize(s);
+    }
+    return endSession(l);
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+    bool defer = false;
+    int rowsPerInsert = 256;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (!strcmp(a, "--rows") && i + 1 < argc) rowsPerInsert = atoi(argv[++i]);
+        else if (!strcmp(a, "--defer-index"))     defer = true;
+        else if (a[0] == '-')                     usage();
+        else                                      paths.push_back(a);
+    }
+    if (paths.size() < 2 || rowsPerInsert < 1) usage();
+
+    Loader l;
+    l.rowsPerInsert = rowsPerInsert;
+    if (!loaderOpen(l, paths[0])) return 1;
+
+    uint64_t existing = queryInt(l, "SELECT coalesce(max(id), 0) FROM imu_data");
+    if (defer) exec(l, "DROP INDEX IF EXISTS idx_imu_session_ts");
+    printf("%s: ~%llu rows in the table, %d rows/insert, index %s\n", paths[0],
+           (unsigned long long)existing, l.rowsPerInsert,
+           defer ? "rebuilt after the load" : "kept up to date");
+
+    bool ok = true;
+    uint64_t totalRows = 0;
+    double t0 = hostSeconds();
+    for (size_t i = 1; i < paths.size() && !l.failed; i++) {
+        double f0 = hostSeconds();
+        bool fileOk = isSessionFile(paths[i]) ? loadSessionFile(l, paths[i]) : loadCsv(l, paths[i]);
+        double secs = hostSeconds() - f0;
+        if (!fileOk) {
+            fprintf(stderr, "%s: not loaded\n", paths[i]);
+            l.failed = false;   // the transaction was rolled back; go on with the rest
+            ok = false;
+            continue;
+        }
+        printf("  %s: session %lld, %llu rows, %zu shots in %.3f s  (%.0f rows/s)\n", paths[i],
+               (long long)l.sessionId, (unsigned long long)l.rows, l.shots.size(), secs,
+               l.rows / secs);
+        totalRows += l.rows;
+    }
+    double loadSec = hostSeconds() - t0;
+
+    double indexSec = 0;
+    if (defer) {
+        t0 = hostSeconds();
+        ok &= exec(l, OBSERVER_IMU_INDEX);
+        indexSec = hostSeconds() - t0;
+    }
+    uint64_t tableRows = queryInt(l, "SELECT coalesce(max(id), 0) FROM imu_data");
+    exec(l, "PRAGMA wal_checkpoint(TRUNCATE)");
+    loaderClose(l);
+
+    printf("inserted %llu rows in %.3f s  (%.0f rows/s)\n", (unsigned long long)totalRows,
+           loadSec, totalRows / loadSec);
+    if (defer) {
+        printf("index over %llu rows in %.3f s  (%.0f rows/s); %.0f rows/s overall\n",
+               (unsigned long long)tableRows, indexSec, tableRows / indexSec,
+               totalRows / (loadSec + indexSec));
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/**
+ * sessionpack - convert a recorded CSV trace into a ball session file
+ *
+ * Usage:
+ *   sessionpack [--encoding raw|delta|delta2|pack|pack2|auto] [--chunk N] in.csv out.ybs
+ *   sessionpack --synthetic SECONDS [--rate HZ] [--seed N] out.ybs
+ *
+ * Prints parse and encode throughput and the size against the CSV and
+ * the raw fixed-point samples, i.e. the compression ratio of the chosen
+ * column encoding. raw columns can be read in place (sessionread);
+ * delta/delta2 are first/second-order prediction with varint residuals,
+ * pack/pack2 the same residuals bit-packed, auto the smallest per column
+ * (what the device writes to flash).
+ */
+
+#include "sessionout.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: sessionpack [--encoding raw|delta|delta2|pack|pack2|auto] [--chunk N] in.csv out.ybs\n"
+            "       sessionpack --synthetic SECONDS [--rate HZ] [--seed N] out.ybs\n");
+    exit(2);
+}
+
+static uint8_t parseEncoding(const char* name) {
+    if (!strcmp(name, "auto")) return BS_ENC_AUTO;
+    for (uint8_t e = 0; e < BS_ENC_COUNT; e++) {
+        if (!strcmp(name, bsEncodingName(e))) return e;
+    }
+    usage();
+    return 0;
+}
+
+static void onSample(void* ctx, const BsSample &s) { sessionOutSample(*(SessionOut*)ctx, s); }
+static void onShot(void* ctx, const BsShot &s)     { sessionOutShot(*(SessionOut*)ctx, s); }
+
+static uint64_t fileSize(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return 0;
+    fseek(fp, 0, SEEK_END);
+    uint64_t n = ftell(fp);
+    fclose(fp);
+    return n;
+}
+
+// Bytes per sample of the columns as fixed-width values
+static uint32_t rawSampleBytes(uint16_t columns) {
+    uint32_t n = 0;
+    for (int id = 0; id < BS_COL_COUNT; id++) {
+        if ((columns >> id) & 1) n += bsColumnWidth(id);
+    }
+    return n;
+}
+
+int main(int argc, char** argv) {
+    uint8_t encoding = BS_ENC_RAW;
+    uint16_t chunkSamples = SESSION_OUT_CHUNK;
+    double synthSeconds = 0;
+    uint16_t rate = 200;
+    uint32_t seed = 1;
+    const char* paths[2];
+    int npaths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--encoding") && more) {
+            encoding = parseEncoding(argv[++i]);
+        } else if (!strcmp(a, "--chunk") && more) {
+            chunkSamples = (uint16_t)atoi(argv[++i]);
+        } else if (!strcmp(a, "--synthetic") && more) {
+            synthSeconds = atof(argv[++i]);
+        } else if (!strcmp(a, "--rate") && more) {
+            rate = (uint16_t)atoi(argv[++i]);
+        } else if (!strcmp(a, "--seed") && more) {
+            seed = (uint32_t)atoi(argv[++i]);
+        } else if (a[0] == '-' || npaths == 2) {
+            usage();
+        } else {
+            paths[npaths++] = a;
+        }
+    }
+    if (chunkSamples == 0 || npaths != (synthSeconds > 0 ? 1 : 2)) usage();
+    const char* outPath = paths[npaths - 1];
+
+    FILE* in = nullptr;
+    uint16_t columns = BS_COLS_ALL;
+    if (!synthSeconds) {
+        in = fopen(paths[0], "rb");
+        if (!in) {
+            perror(paths[0]);
+            return 1;
+        }
+        // Sniff the layout so the header lists the right columns
+        TraceLayout layout = traceSniffCsv(in);
+        columns = traceColumns(layout);
+        if (layout == TRACE_UNKNOWN) {
+            fprintf(stderr, "%s: not an imu_logger or dashboard CSV\n", paths[0]);
+            return 1;
+        }
+    }
+
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, rate, columns, synthSeconds ? "synthetic" : "csv");
+    SessionOut out;
+    if (!sessionOutOpen(out, outPath, h, encoding, chunkSamples)) {
+        perror(outPath);
+        return 1;
+    }
+
+    TraceCallbacks cb = {onSample, onShot, &out};
+    TraceStats st;
+    double t0 = hostSeconds();
+    if (synthSeconds) traceSynthetic(synthSeconds, rate, seed, h, cb, st);
+    else traceReadCsv(in, h, cb, st);
+    bool ok = sessionOutClose(out);
+    double secs = hostSeconds() - t0;
+    if (in) fclose(in);
+    if (!ok) {
+        fprintf(stderr, "%s: write failed\n", outPath);
+        return 1;
+    }
+
+    uint64_t outBytes = fileSize(outPath);
+    uint64_t csvBytes = synthSeconds ? 0 : fileSize(paths[0]);
+    uint64_t rawBytes = st.samples * rawSampleBytes(columns);
+    printf("%s: %llu samples, %llu shots, %u chunks (%s, %u samples/chunk)\n", outPath,
+           (unsigned long long)st.samples, (unsigned long long)st.shots, out.writer.chunks,
+           bsEncodingName(encoding), chunkSamples);
+    if (csvBytes) {
+        printf("  csv      %10llu bytes  %.2fx smaller, %.1f MB/s parse+write\n",
+               (unsigned long long)csvBytes, (double)csvBytes / outBytes, csvBytes / secs / 1e6);
+    }
+    printf("  raw      %10llu bytes  (%u bytes/sample fixed point)\n",
+           (unsigned long long)rawBytes, rawSampleBytes(columns));
+    printf("  file     %10llu bytes  ratio %.2f vs raw, %.2f bytes/sample\n",
+           (unsigned long long)outBytes, (double)rawBytes / outBytes,
+           st.samples ? (double)outBytes / st.samples : 0.0);
+    printf("  encode   %.1f Msamples/s, %.0f MB/s of raw columns\n",
+           out.encodeSec > 0 ? st.samples / out.encodeSec / 1e6 : 0.0,
+           out.encodeSec > 0 ? rawBytes / out.encodeSec / 1e6 : 0.0);
+    if (st.badLines) printf("  skipped  %llu malformed lines\n", (unsigned long long)st.badLines);
+    return 0;
+}
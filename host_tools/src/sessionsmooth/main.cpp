@@ -0,0 +1,537 @@
+/**
+ * sessionsmooth - drift-free orientation and spin-axis history of a session
+ *
+ * Usage:
+ *   sessionsmooth [--lag S] [--every N] in.ybs|in.csv [out.ybs|out.csv]
+ *   sessionsmooth --simulate S [--seed N] [--lag S] [--every N] [out.ybs|out.csv]
+ *
+ * Runs the forward filter and RTS backward pass of smoother.h over a
+ * recorded session (or CSV trace), streaming: memory is 2 x --lag
+ * seconds of samples (default 20 s) whatever the length of the session.
+ *
+ *   out.ybs  the session again, every column as recorded except the
+ *            orientation (QW..QZ), which is the smoothed one; shots kept
+ *   out.csv  every N-th sample: time, smoothed orientation, gyro bias,
+ *            spin axis in the world frame (z up) and rpm, and which
+ *            updates were applied
+ *
+ * --simulate runs a physically consistent ball instead of a file: rest
+ * on the court, handling, rallies of spinning flights (free fall, so
+ * the accelerometer sees only centripetal acceleration) with bounces,
+ * rolling to a stop; gyro bias offset and random walk, sensor noise,
+ * fixed-point quantisation as in a session file. The ball's own bsFuse
+ * orientation is recorded as it would be, and with the true orientation
+ * known the report gives tilt, heading and world spin-axis errors of the
+ * ball, the forward filter alone and the smoother.
+ *
+ * Prints samples/s of the smoother alone and end to end.
+ */
+
+#include "bspipeline.h"
+#include "sessionout.h"
+#include "sessionread.h"
+#include "smoother.h"
+#include "trace.h"
+#include <deque>
+#include <math.h>
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: sessionsmooth [--lag S] [--every N] in.ybs|in.csv [out.ybs|out.csv]\n"
+            "       sessionsmooth --simulate S [--seed N] [--lag S] [--every N] [out.ybs|out.csv]\n");
+    exit(2);
+}
+
+static const double RAD = M_PI / 180.0;
+static const double UP[3] = {0, 0, 1};
+
+static bool endsWith(const char* s, const char* suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && !strcmp(s + n - m, suffix);
+}
+
+// ==================== Errors against the truth ====================
+
+struct SimTruth {
+    double q[4];                    // body to world
+    double w[3];                    // body rate, rad/s
+    double bias[3];                 // gyro bias, rad/s
+};
+
+struct ErrStat {
+    double   sum2 = 0, max = 0;
+    uint64_t n = 0;
+
+    void add(double rad) {
+        double d = rad / RAD;
+        sum2 += d * d;
+        if (d > max) max = d;
+        n++;
+    }
+    double rms() const { return n ? sqrt(sum2 / n) : 0; }
+};
+
+// Angle between the gravity directions two orientations put in the body
+static double tiltError(const double a[4], const double b[4]) {
+    double ai[4] = {a[0], -a[1], -a[2], -a[3]}, bi[4] = {b[0], -b[1], -b[2], -b[3]};
+    double va[3], vb[3];
+    smoothRotate(ai, UP, va);
+    smoothRotate(bi, UP, vb);
+    double d = va[0] * vb[0] + va[1] * vb[1] + va[2] * vb[2];
+    return acos(d > 1 ? 1 : d < -1 ? -1 : d);
+}
+
+// World direction of body rate w under q; false when too slow to have one
+static bool worldAxis(const double q[4], const double w[3], double out[3]) {
+    double n = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+    if (n < 1.0) return false;
+    double u[3] = {w[0] / n, w[1] / n, w[2] / n};
+    smoothRotate(q, u, out);
+    return true;
+}
+
+struct Compare {
+    std::deque<SimTruth> truth;     // one per sample not yet emitted
+    bool     anchored = false;
+    double   offset[4];             // heading offset of the estimate's world frame
+    ErrStat  tiltBall, tiltFwd, tiltSmooth;
+    ErrStat  headFwd, headSmooth;
+    ErrStat  axisFwd, axisSmooth;   // world spin axis
+    ErrStat  elevFwd, elevSmooth;   // its angle above the court, which heading does not affect
+    ErrStat  bias;                  // smoothed gyro bias, deg/s
+    double   quatPerLsb = 0;
+};
+
+static void compare(Compare &c, const SmoothSample &o) {
+    SimTruth t = c.truth.front();
+    c.truth.pop_front();
+    if (!c.anchored) {
+        // The filter starts at heading 0; the truth at any heading
+        double ti[4] = {t.q[0], -t.q[1], -t.q[2], -t.q[3]};
+        smoothQuatMul(o.q, ti, c.offset);
+        c.anchored = true;
+    }
+    double ref[4];
+    smoothQuatMul(c.offset, t.q, ref);
+
+    double ball[4] = {o.s.q[0] * c.quatPerLsb, o.s.q[1] * c.quatPerLsb, o.s.q[2] * c.quatPerLsb,
+                      o.s.q[3] * c.quatPerLsb};
+    c.tiltBall.add(tiltError(ball, ref));
+    c.tiltFwd.add(tiltError(o.qf, ref));
+    c.tiltSmooth.add(tiltError(o.q, ref));
+    c.headFwd.add(smoothAngle(o.qf, ref));
+    c.headSmooth.add(smoothAngle(o.q, ref));
+
+    double at[3], af[3], as[3];
+    if (worldAxis(ref, t.w, at) && sqrt(t.w[0] * t.w[0] + t.w[1] * t.w[1] + t.w[2] * t.w[2]) > 5) {
+        worldAxis(o.qf, o.w, af);
+        worldAxis(o.q, o.w, as);
+        c.axisFwd.add(acos(fmin(1, af[0] * at[0] + af[1] * at[1] + af[2] * at[2])));
+        c.axisSmooth.add(acos(fmin(1, as[0] * at[0] + as[1] * at[1] + as[2] * at[2])));
+        c.elevFwd.add(fabs(asin(fmin(1, fmax(-1, af[2]))) - asin(fmin(1, fmax(-1, at[2])))));
+        c.elevSmooth.add(fabs(asin(fmin(1, fmax(-1, as[2]))) - asin(fmin(1, fmax(-1, at[2])))));
+    }
+    double db[3] = {o.bias[0] - t.bias[0], o.bias[1] - t.bias[1], o.bias[2] - t.bias[2]};
+    c.bias.add(sqrt(db[0] * db[0] + db[1] * db[1] + db[2] * db[2]));
+}
+
+// ==================== Output ====================
+
+struct Output {
+    const char*        path = nullptr;
+    bool               csv = false;
+    SessionOut         ybs;
+    FILE*              fp = nullptr;
+    uint32_t           every = 1;
+    uint64_t           n = 0;
+    double             quatOne = 0;
+    std::deque<BsShot> shots;       // waiting for their samples to be written
+    bool               ok = true;
+};
+
+static bool outOpen(Output &o, const char* path, BsFileHeader h) {
+    o.path = path;
+    o.csv = endsWith(path, ".csv");
+    o.quatOne = h.quatOne;
+    if (o.csv) {
+        o.fp = fopen(path, "w");
+        if (!o.fp) return false;
+        setvbuf(o.fp, nullptr, _IOFBF, 1 << 20);
+        fprintf(o.fp, "timestamp_ms,qw,qx,qy,qz,bias_x_dps,bias_y_dps,bias_z_dps,"
+                      "axis_x,axis_y,axis_z,rpm,rest,gravity\n");
+        return true;
+    }
+    h.columns |= BS_COLS_ALL;
+    return sessionOutOpen(o.ybs, path, h, BS_ENC_AUTO);
+}
+
+static void outSample(Output &o, const SmoothSample &s) {
+    if (o.csv) {
+        if (o.n++ % o.every) return;
+        double axis[3] = {0, 0, 0};
+        worldAxis(s.q, s.w, axis);
+        double rpm = sqrt(s.w[0] * s.w[0] + s.w[1] * s.w[1] + s.w[2] * s.w[2]) * 60 / (2 * M_PI);
+        fprintf(o.fp, "%.3f,%.5f,%.5f,%.5f,%.5f,%.3f,%.3f,%.3f,%.4f,%.4f,%.4f,%.1f,%d,%d\n",
+                s.s.tUs * 1e-3, s.q[0], s.q[1], s.q[2], s.q[3],
+                s.bias[0] / RAD, s.bias[1] / RAD, s.bias[2] / RAD, axis[0], axis[1], axis[2], rpm,
+                s.flags & SMOOTH_REST ? 1 : 0, s.flags & SMOOTH_GRAVITY ? 1 : 0);
+        return;
+    }
+    while (!o.shots.empty() && o.shots.front().tUs <= s.s.tUs) {
+        o.ok &= sessionOutShot(o.ybs, o.shots.front());
+        o.shots.pop_front();
+    }
+    BsSample r = s.s;
+    for (int k = 0; k < 4; k++) r.q[k] = traceFixed(s.q[k], o.quatOne);
+    o.ok &= sessionOutSample(o.ybs, r);
+}
+
+static bool outClose(Output &o) {
+    if (o.csv) return fclose(o.fp) == 0 && o.ok;
+    for (const BsShot &s : o.shots) o.ok &= sessionOutShot(o.ybs, s);
+    return sessionOutClose(o.ybs) && o.ok;
+}
+
+// ==================== Pipeline ====================
+
+struct Run {
+    Smoother  sm;
+    double    perG, perDps;
+    Output*   out = nullptr;
+    Compare*  cmp = nullptr;
+    double    smoothSec = 0, emitSec = 0;
+    double    maxFix = 0, sumFix = 0;   // how far the backward pass moved the forward tilt
+};
+
+static void onSmoothed(void* ctx, const SmoothSample &s) {
+    Run &r = *(Run*)ctx;
+    double t0 = hostSeconds();
+    double fix = tiltError(s.q, s.qf) / RAD;
+    r.sumFix += fix;
+    if (fix > r.maxFix) r.maxFix = fix;
+    if (r.cmp) compare(*r.cmp, s);
+    if (r.out) outSample(*r.out, s);
+    r.emitSec += hostSeconds() - t0;
+}
+
+static void feed(Run &r, const BsSample &s) {
+    double a[3], g[3];
+    for (int k = 0; k < 3; k++) {
+        a[k] = s.a[k] * r.perG;
+        g[k] = s.g[k] * r.perDps * RAD;
+    }
+    double t0 = hostSeconds();
+    smootherAdd(r.sm, s, a, g);
+    r.smoothSec += hostSeconds() - t0;
+}
+
+static void traceSample(void* ctx, const BsSample &s) { feed(*(Run*)ctx, s); }
+
+static void traceShot(void* ctx, const BsShot &s) {
+    Run &r = *(Run*)ctx;
+    if (r.out) r.out->shots.push_back(s);
+}
+
+// ==================== Simulated ball ====================
+
+struct Sim {
+    std::mt19937 rng;
+    double       q[4] = {1, 0, 0, 0};
+    double       w[3] = {0, 0, 0};
+    double       bias[3];
+    BsPipeline   ball;
+
+    double uni(double a, double b) { return std::uniform_real_distribution<double>(a, b)(rng); }
+    double gauss(double s) { return std::normal_distribution<double>(0, s)(rng); }
+    void   randomAxis(double v[3]) {
+        double n;
+        do {
+            for (int k = 0; k < 3; k++) v[k] = gauss(1);
+            n = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        } while (n < 1e-6);
+        for (int k = 0; k < 3; k++) v[k] /= n;
+    }
+};
+
+enum SimPhase { SIM_REST, SIM_HANDLE, SIM_FLIGHT, SIM_ROLL };
+
+static void simulate(Run &r, double seconds, uint32_t seed, const BsFileHeader &h) {
+    const double dt = 1.0 / h.sampleHz;
+    const double sensor[3] = {0.012, 0.004, -0.008};  // m from the centre
+    Sim s;
+    s.rng.seed(seed);
+    for (int k = 0; k < 3; k++) s.bias[k] = s.uni(-1.5, 1.5) * RAD;
+    bsPipelineInit(s.ball);
+    double axis[3];
+    s.randomAxis(axis);
+    double ang = s.uni(0, M_PI), rv[3] = {axis[0] * ang, axis[1] * ang, axis[2] * ang};
+    double n = sqrt(rv[0] * rv[0] + rv[1] * rv[1] + rv[2] * rv[2]);
+    s.q[0] = cos(n / 2);
+    for (int k = 0; k < 3; k++) s.q[k + 1] = rv[k] / n * sin(n / 2);
+
+    SimPhase phase = SIM_REST;
+    double phaseLeft = s.uni(2, 8), handW[3] = {0, 0, 0};
+    int shotsLeft = 0, impactLeft = 0;
+    double impact[3] = {0, 0, 0};
+    uint64_t total = (uint64_t)(seconds * h.sampleHz);
+
+    for (uint64_t i = 0; i < total; i++) {
+        // Phase changes
+        phaseLeft -= dt;
+        if (phaseLeft <= 0) {
+            if (phase == SIM_REST) {
+                phase = SIM_HANDLE;
+                phaseLeft = s.uni(1, 3);
+            } else if (phase == SIM_HANDLE || (phase == SIM_FLIGHT && shotsLeft > 0)) {
+                if (phase == SIM_HANDLE) shotsLeft = (int)s.uni(1, 7);
+                shotsLeft--;
+                phase = SIM_FLIGHT;
+                phaseLeft = s.uni(0.7, 1.5);
+                // Racket or bounce: new spin, a short hard push
+                double ax[3], rpm = s.uni(80, 330);
+                s.randomAxis(ax);
+                for (int k = 0; k < 3; k++) s.w[k] = ax[k] * rpm * 2 * M_PI / 60;
+                s.randomAxis(impact);
+                double g = s.uni(15, 60);
+                for (int k = 0; k < 3; k++) impact[k] *= g;
+                impactLeft = (int)(0.012 * h.sampleHz);
+            } else if (phase == SIM_FLIGHT) {
+                phase = SIM_ROLL;
+                phaseLeft = s.uni(0.5, 2);
+                // Rolls about a horizontal world axis
+                double c = s.uni(0, 2 * M_PI), wa[3] = {cos(c), sin(c), 0}, qi[4] = {s.q[0], -s.q[1], -s.q[2], -s.q[3]};
+                smoothRotate(qi, wa, s.w);
+                for (int k = 0; k < 3; k++) s.w[k] *= s.uni(3, 8);
+            } else {
+                phase = SIM_REST;
+                phaseLeft = s.uni(2, 8);
+                memset(s.w, 0, sizeof(s.w));
+            }
+        }
+
+        // Motion of this step
+        double world[3] = {0, 0, 1};        // specific force, g, world frame
+        if (phase == SIM_HANDLE) {
+            for (int k = 0; k < 3; k++) {
+                handW[k] += 0.02 * (s.gauss(1.2) - handW[k]);
+                s.w[k] = handW[k];
+                world[k] += s.gauss(0.03);
+            }
+        } else if (phase == SIM_FLIGHT) {
+            world[0] = world[1] = world[2] = 0;  // free fall
+            for (int k = 0; k < 3; k++) s.w[k] *= exp(-dt / 4);
+        } else if (phase == SIM_ROLL) {
+            for (int k = 0; k < 3; k++) s.w[k] *= exp(-dt / 0.4);
+        }
+        double dq[4], wn = sqrt(s.w[0] * s.w[0] + s.w[1] * s.w[1] + s.w[2] * s.w[2]);
+        double sh = wn > 1e-12 ? sin(wn * dt / 2) / wn : dt / 2;
+        dq[0] = cos(wn * dt / 2);
+        for (int k = 0; k < 3; k++) dq[k + 1] = s.w[k] * sh;
+        double q[4];
+        smoothQuatMul(s.q, dq, q);
+        double qn = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (int k = 0; k < 4; k++) s.q[k] = q[k] / qn;
+
+        // Sensors
+        double qi[4] = {s.q[0], -s.q[1], -s.q[2], -s.q[3]}, a[3];
+        smoothRotate(qi, world, a);
+        const double* w = s.w;
+        double wr[3] = {w[1] * sensor[2] - w[2] * sensor[1], w[2] * sensor[0] - w[0] * sensor[2],
+                        w[0] * sensor[1] - w[1] * sensor[0]};
+        double cen[3] = {w[1] * wr[2] - w[2] * wr[1], w[2] * wr[0] - w[0] * wr[2], w[0] * wr[1] - w[1] * wr[0]};
+        BsSample out;
+        memset(&out, 0, sizeof(out));
+        out.tUs = (int64_t)(i * 1e6 / h.sampleHz);
+        for (int k = 0; k < 3; k++) {
+            s.bias[k] += s.gauss(0.01 * RAD * sqrt(dt));
+            double ak = a[k] + cen[k] / 9.81 + (impactLeft > 0 ? impact[k] : 0) + s.gauss(0.01);
+            double gk = (w[k] + s.bias[k]) / RAD + s.gauss(0.8);
+            out.a[k] = traceFixed(ak, bsAccelPerG(h));
+            out.g[k] = traceFixed(gk, bsGyroPerDps(h));
+        }
+        if (impactLeft > 0) {
+            out.flags |= BS_FLAG_IMPACT;
+            impactLeft--;
+        }
+        // The ball's own orientation, as recorded
+        float perDps = (float)(1.0 / bsGyroPerDps(h));
+        bsFuse(s.ball, out.g[0] * perDps, out.g[1] * perDps, out.g[2] * perDps, (float)dt);
+        out.q[0] = traceFixed(s.ball.orient.w, h.quatOne);
+        out.q[1] = traceFixed(s.ball.orient.x, h.quatOne);
+        out.q[2] = traceFixed(s.ball.orient.y, h.quatOne);
+        out.q[3] = traceFixed(s.ball.orient.z, h.quatOne);
+
+        SimTruth t;
+        memcpy(t.q, s.q, sizeof(t.q));
+        memcpy(t.w, s.w, sizeof(t.w));
+        memcpy(t.bias, s.bias, sizeof(t.bias));
+        r.cmp->truth.push_back(t);
+        feed(r, out);
+    }
+    printf("simulated: %.0f s at %u Hz, final gyro bias %.2f %.2f %.2f deg/s\n", seconds, h.sampleHz,
+           s.bias[0] / RAD, s.bias[1] / RAD, s.bias[2] / RAD);
+}
+
+// ==================== Sources ====================
+
+static bool runSession(Run &r, const char* path) {
+    SessionReader sr;
+    if (!sessionOpen(sr, path)) {
+        fprintf(stderr, "%s: %s\n", path, sr.error);
+        return false;
+    }
+    sessionSequential(sr);
+    SessionChunk c;
+    bool ok = true;
+    for (uint32_t i = 0; i < sr.chunks && ok; i++) {
+        if (!sessionLoadChunk(sr, i, c, BS_COLS_ALL) || c.col[0].empty() || c.col[3].empty()) {
+            fprintf(stderr, "%s: chunk %u unreadable or without accel/gyro\n", path, i);
+            ok = false;
+            break;
+        }
+        if (r.out) r.out->shots.insert(r.out->shots.end(), c.shots.begin(), c.shots.end());
+        BsSample s;
+        for (size_t k = 0; k < c.t.size; k++) {
+            s.tUs = c.t[k];
+            for (int j = 0; j < 3; j++) {
+                s.a[j] = c.col[j][k];
+                s.g[j] = c.col[3 + j][k];
+            }
+            for (int j = 0; j < 4; j++) s.q[j] = c.col[6 + j].empty() ? 0 : c.col[6 + j][k];
+            s.flags = c.flags.empty() ? 0 : c.flags[k];
+            feed(r, s);
+        }
+    }
+    sessionClose(sr);
+    return ok;
+}
+
+static bool openHeader(const char* path, BsFileHeader &h) {
+    if (endsWith(path, ".csv")) {
+        FILE* fp = fopen(path, "r");
+        if (!fp) {
+            perror(path);
+            return false;
+        }
+        TraceLayout layout = traceSniffCsv(fp);
+        fclose(fp);
+        bsFileHeaderInit(h, 0, 200, traceColumns(layout), "csv");
+        return layout != TRACE_UNKNOWN;
+    }
+    SessionReader sr;
+    if (!sessionOpen(sr, path)) {
+        fprintf(stderr, "%s: %s\n", path, sr.error);
+        return false;
+    }
+    h = *sr.header;
+    sessionClose(sr);
+    return true;
+}
+
+static bool runTrace(Run &r, const char* path, const BsFileHeader &h) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+    traceSniffCsv(fp);
+    TraceCallbacks cb = {traceSample, traceShot, &r};
+    TraceStats st;
+    bool ok = traceReadCsv(fp, h, cb, st);
+    fclose(fp);
+    if (!ok) fprintf(stderr, "%s: not an imu_logger or dashboard CSV\n", path);
+    return ok;
+}
+
+// ==================== Main ====================
+
+static void report(const Run &r, double secs) {
+    const Smoother &sm = r.sm;
+    double n = (double)sm.samples;
+    double core = r.smoothSec - r.emitSec;
+    printf("samples %llu, gravity updates %.1f%%, rest %.1f%%, %llu blocks of %u, memory %.1f MB\n",
+           (unsigned long long)sm.samples, 100 * sm.gravity / fmax(n, 1), 100 * sm.rest / fmax(n, 1),
+           (unsigned long long)sm.blocks, sm.cfg.lag, smootherMemory(sm) / 1e6);
+    printf("gyro bias at end: %.2f %.2f %.2f deg/s\n", sm.b[0] / RAD, sm.b[1] / RAD, sm.b[2] / RAD);
+    printf("backward pass moved tilt by %.2f deg mean, %.2f max\n", r.sumFix / fmax(n, 1), r.maxFix);
+    printf("smoother %.2f s, %.2f M samples/s; end to end %.2f s, %.2f M samples/s\n",
+           core, n / fmax(core, 1e-9) / 1e6, secs, n / fmax(secs, 1e-9) / 1e6);
+}
+
+static void reportErrors(const Compare &c) {
+    printf("error vs truth, deg     rms      max\n");
+    printf("  tilt   ball (bsFuse)  %7.2f  %7.2f\n", c.tiltBall.rms(), c.tiltBall.max);
+    printf("  tilt   forward        %7.2f  %7.2f\n", c.tiltFwd.rms(), c.tiltFwd.max);
+    printf("  tilt   smoothed       %7.2f  %7.2f\n", c.tiltSmooth.rms(), c.tiltSmooth.max);
+    printf("  attitude forward      %7.2f  %7.2f\n", c.headFwd.rms(), c.headFwd.max);
+    printf("  attitude smoothed     %7.2f  %7.2f\n", c.headSmooth.rms(), c.headSmooth.max);
+    printf("  spin axis forward     %7.2f  %7.2f   (%llu samples > 5 rad/s)\n", c.axisFwd.rms(), c.axisFwd.max,
+           (unsigned long long)c.axisFwd.n);
+    printf("  spin axis smoothed    %7.2f  %7.2f\n", c.axisSmooth.rms(), c.axisSmooth.max);
+    printf("  axis elevation fwd    %7.2f  %7.2f\n", c.elevFwd.rms(), c.elevFwd.max);
+    printf("  axis elevation smooth %7.2f  %7.2f\n", c.elevSmooth.rms(), c.elevSmooth.max);
+    printf("  gyro bias, deg/s      %7.3f  %7.3f\n", c.bias.rms(), c.bias.max);
+}
+
+int main(int argc, char** argv) {
+    double lagSec = 20, simSeconds = 0;
+    uint32_t every = 1, seed = 1;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--lag") && i + 1 < argc) lagSec = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--every") && i + 1 < argc) every = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--simulate") && i + 1 < argc) simSeconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = (uint32_t)atoi(argv[++i]);
+        else if (argv[i][0] == '-') usage();
+        else paths.push_back(argv[i]);
+    }
+    bool sim = simSeconds > 0;
+    if (paths.size() > (sim ? 1u : 2u) || (!sim && paths.empty()) || lagSec <= 0 || every < 1) usage();
+    const char* in = sim ? nullptr : paths[0];
+    const char* outPath = paths.size() > (sim ? 0u : 1u) ? paths.back() : nullptr;
+
+    BsFileHeader h;
+    if (sim) bsFileHeaderInit(h, 0, 200, BS_COLS_ALL, "simulated");
+    else if (!openHeader(in, h)) return 1;
+
+    Run r;
+    r.perG = 1.0 / bsAccelPerG(h);
+    r.perDps = 1.0 / bsGyroPerDps(h);
+    SmootherConfig cfg;
+    cfg.lag = (uint32_t)(lagSec * (h.sampleHz ? h.sampleHz : 200));
+    smootherInit(r.sm, cfg, onSmoothed, &r);
+
+    Output out;
+    out.every = every;
+    if (outPath) {
+        if (!outOpen(out, outPath, h)) {
+            perror(outPath);
+            return 1;
+        }
+        r.out = &out;
+    }
+    Compare cmp;
+    cmp.quatPerLsb = 1.0 / h.quatOne;
+    if (sim) r.cmp = &cmp;
+
+    double t0 = hostSeconds();
+    bool ok = true;
+    if (sim) simulate(r, simSeconds, seed, h);
+    else if (endsWith(in, ".csv")) ok = runTrace(r, in, h);
+    else ok = runSession(r, in);
+    double t1 = hostSeconds();
+    smootherFinish(r.sm);
+    r.smoothSec += hostSeconds() - t1;
+    if (outPath && !outClose(out)) {
+        fprintf(stderr, "%s: write failed\n", outPath);
+        ok = false;
+    }
+    double secs = hostSeconds() - t0;
+
+    report(r, secs);
+    if (sim) reportErrors(cmp);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,357 @@
+/**
+ * Offline orientation smoother - see smoother.h
+ *
+ * Error state x = [dtheta (body frame, rad), dbias (rad/s)], nominal
+ * state q (body to world), b. Per sample k, with w = gyro_k - b and
+ * D = exp(w dt):
+ *
+ *   q_k|k-1 = q_k-1 (x) D          F = | D^T  -I dt |
+ *   b_k|k-1 = b_k-1                    | 0     I   |
+ *   P_k|k-1 = F P F^T + Q
+ *
+ * then the measurement updates, each injected into (q, b) straight away.
+ * The smoother gain of the previous sample, C_k-1 = P_k-1|k-1 F^T
+ * P_k|k-1^-1, is computed here and kept with it; the backward pass needs
+ * nothing else from the forward one but the filtered and predicted
+ * nominal states.
+ */
+
+#include "smoother.h"
+#include <math.h>
+#include <string.h>
+
+// ==== Small linear algebra ====
+
+void smoothQuatMul(const double a[4], const double b[4], double out[4]) {
+    double w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    double x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    double y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    double z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+    out[0] = w; out[1] = x; out[2] = y; out[3] = z;
+}
+
+void smoothRotate(const double q[4], const double v[3], double out[3]) {
+    // v + 2 u x (u x v + w v), u = (x, y, z)
+    double tx = q[2] * v[2] - q[3] * v[1] + q[0] * v[0];
+    double ty = q[3] * v[0] - q[1] * v[2] + q[0] * v[1];
+    double tz = q[1] * v[1] - q[2] * v[0] + q[0] * v[2];
+    out[0] = v[0] + 2 * (q[2] * tz - q[3] * ty);
+    out[1] = v[1] + 2 * (q[3] * tx - q[1] * tz);
+    out[2] = v[2] + 2 * (q[1] * ty - q[2] * tx);
+}
+
+double smoothAngle(const double a[4], const double b[4]) {
+    double d = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+    return 2 * acos(d > 1 ? 1 : d);
+}
+
+static void quatExp(const double v[3], double out[4]) {
+    double a = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    double s = a > 1e-9 ? sin(a * 0.5) / a : 0.5;
+    out[0] = cos(a * 0.5);
+    out[1] = v[0] * s; out[2] = v[1] * s; out[3] = v[2] * s;
+}
+
+// Rotation vector of q^-1 (x) p
+static void quatLogDiff(const double q[4], const double p[4], double out[3]) {
+    double qi[4] = {q[0], -q[1], -q[2], -q[3]}, d[4];
+    smoothQuatMul(qi, p, d);
+    if (d[0] < 0) for (int i = 0; i < 4; i++) d[i] = -d[i];
+    double n = sqrt(d[1] * d[1] + d[2] * d[2] + d[3] * d[3]);
+    double s = n > 1e-9 ? 2 * atan2(n, d[0]) / n : 2;
+    out[0] = d[1] * s; out[1] = d[2] * s; out[2] = d[3] * s;
+}
+
+static void quatNorm(double q[4]) {
+    double n = 1 / sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    for (int i = 0; i < 4; i++) q[i] *= n;
+}
+
+// Rotation matrix of a unit quaternion
+static void quatMatrix(const double q[4], double R[3][3]) {
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+    R[0][0] = 1 - 2 * (y * y + z * z); R[0][1] = 2 * (x * y - w * z); R[0][2] = 2 * (x * z + w * y);
+    R[1][0] = 2 * (x * y + w * z); R[1][1] = 1 - 2 * (x * x + z * z); R[1][2] = 2 * (y * z - w * x);
+    R[2][0] = 2 * (x * z - w * y); R[2][1] = 2 * (y * z + w * x); R[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+// In-place Cholesky of a symmetric positive definite 6x6 (lower), then
+// A^-1 B for n right-hand sides in B[6][n]
+static bool cholSolve(double A[6][6], double B[6][6], int n) {
+    for (int j = 0; j < 6; j++) {
+        double d = A[j][j];
+        for (int k = 0; k < j; k++) d -= A[j][k] * A[j][k];
+        if (d <= 0) return false;
+        A[j][j] = sqrt(d);
+        for (int i = j + 1; i < 6; i++) {
+            double s = A[i][j];
+            for (int k = 0; k < j; k++) s -= A[i][k] * A[j][k];
+            A[i][j] = s / A[j][j];
+        }
+    }
+    for (int c = 0; c < n; c++) {
+        for (int i = 0; i < 6; i++) {
+            double s = B[i][c];
+            for (int k = 0; k < i; k++) s -= A[i][k] * B[k][c];
+            B[i][c] = s / A[i][i];
+        }
+        for (int i = 5; i >= 0; i--) {
+            double s = B[i][c];
+            for (int k = i + 1; k < 6; k++) s -= A[k][i] * B[k][c];
+            B[i][c] = s / A[i][i];
+        }
+    }
+    return true;
+}
+
+// ==== Forward filter ====
+
+// Measurement y = H x + v, v ~ N(0, r I), m rows; K and the state
+// correction applied to (q, b) and P
+static void update(Smoother &sm, const double H[3][6], const double y[3], int m, double r) {
+    double (*P)[6] = sm.P;
+    double PHt[6][3], S[3][3];
+    for (int i = 0; i < 6; i++)
+        for (int j = 0; j < m; j++) {
+            double s = 0;
+            for (int k = 0; k < 6; k++) s += P[i][k] * H[j][k];
+            PHt[i][j] = s;
+        }
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < m; j++) {
+            double s = i == j ? r : 0;
+            for (int k = 0; k < 6; k++) s += H[i][k] * PHt[k][j];
+            S[i][j] = s;
+        }
+    // S^-1 for m = 3 by cofactors (S is well conditioned: r > 0)
+    double Si[3][3];
+    double det = S[0][0] * (S[1][1] * S[2][2] - S[1][2] * S[2][1])
+               - S[0][1] * (S[1][0] * S[2][2] - S[1][2] * S[2][0])
+               + S[0][2] * (S[1][0] * S[2][1] - S[1][1] * S[2][0]);
+    double id = 1 / det;
+    Si[0][0] = (S[1][1] * S[2][2] - S[1][2] * S[2][1]) * id;
+    Si[0][1] = (S[0][2] * S[2][1] - S[0][1] * S[2][2]) * id;
+    Si[0][2] = (S[0][1] * S[1][2] - S[0][2] * S[1][1]) * id;
+    Si[1][0] = (S[1][2] * S[2][0] - S[1][0] * S[2][2]) * id;
+    Si[1][1] = (S[0][0] * S[2][2] - S[0][2] * S[2][0]) * id;
+    Si[1][2] = (S[0][2] * S[1][0] - S[0][0] * S[1][2]) * id;
+    Si[2][0] = (S[1][0] * S[2][1] - S[1][1] * S[2][0]) * id;
+    Si[2][1] = (S[0][1] * S[2][0] - S[0][0] * S[2][1]) * id;
+    Si[2][2] = (S[0][0] * S[1][1] - S[0][1] * S[1][0]) * id;
+
+    double K[6][3], dx[6];
+    for (int i = 0; i < 6; i++) {
+        for (int j = 0; j < 3; j++) {
+            double s = 0;
+            for (int k = 0; k < 3; k++) s += PHt[i][k] * Si[k][j];
+            K[i][j] = s;
+        }
+        dx[i] = K[i][0] * y[0] + K[i][1] * y[1] + K[i][2] * y[2];
+    }
+    // P -= K (H P) = K PHt^T, kept symmetric
+    double NP[6][6];
+    for (int i = 0; i < 6; i++)
+        for (int j = i; j < 6; j++) {
+            double s = P[i][j] - (K[i][0] * PHt[j][0] + K[i][1] * PHt[j][1] + K[i][2] * PHt[j][2]);
+            NP[i][j] = NP[j][i] = s;
+        }
+    memcpy(P, NP, sizeof(NP));
+
+    double dq[4], q[4];
+    quatExp(dx, dq);
+    smoothQuatMul(sm.q, dq, q);
+    quatNorm(q);
+    memcpy(sm.q, q, sizeof(q));
+    for (int i = 0; i < 3; i++) sm.b[i] += dx[3 + i];
+}
+
+static void start(Smoother &sm, const double a[3]) {
+    // Tilt from the first accel reading: the rotation taking body a onto
+    // world up; heading 0
+    double n = sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    double u[3] = {0, 0, 1};
+    if (n > 0.5) for (int i = 0; i < 3; i++) u[i] = a[i] / n;
+    // q = rotation from u to (0, 0, 1): axis u x z, half-angle form
+    double q[4] = {1 + u[2], u[1], -u[0], 0};
+    if (q[0] < 1e-6) { q[0] = 0; q[1] = 1; q[2] = 0; }
+    quatNorm(q);
+    memcpy(sm.q, q, sizeof(q));
+    memset(sm.b, 0, sizeof(sm.b));
+    memset(sm.P, 0, sizeof(sm.P));
+    for (int i = 0; i < 3; i++) {
+        sm.P[i][i] = 0.1 * 0.1;
+        sm.P[3 + i][3 + i] = 0.02 * 0.02;       // ~1 deg/s of initial bias
+    }
+    sm.P[2][2] = 1e-6;                          // heading: defined as 0
+}
+
+static void forward(Smoother &sm, SmoothRecord &r, const double a[3], double dt) {
+    const SmootherConfig &c = sm.cfg;
+    SmoothRecord* prev = sm.ring.size() > 1 ? &sm.ring[sm.ring.size() - 2] : nullptr;
+
+    // Predict
+    double w[3] = {r.g[0] - sm.b[0], r.g[1] - sm.b[1], r.g[2] - sm.b[2]};
+    double wdt[3] = {w[0] * dt, w[1] * dt, w[2] * dt};
+    double dq[4], D[3][3];
+    quatExp(wdt, dq);
+    quatMatrix(dq, D);
+    double q[4];
+    smoothQuatMul(sm.q, dq, q);
+    quatNorm(q);
+    memcpy(sm.q, q, sizeof(q));
+    memcpy(r.qp, q, sizeof(q));
+
+    // F = [D^T, -dt I; 0, I]; FP = F P, Pp = FP F^T + Q
+    double (*P)[6] = sm.P;
+    double FP[6][6], Pp[6][6];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 6; j++) {
+            FP[i][j] = D[0][i] * P[0][j] + D[1][i] * P[1][j] + D[2][i] * P[2][j] - dt * P[3 + i][j];
+            FP[3 + i][j] = P[3 + i][j];
+        }
+    for (int i = 0; i < 6; i++)
+        for (int j = i; j < 6; j++) {
+            double s;
+            if (j < 3) s = FP[i][0] * D[0][j] + FP[i][1] * D[1][j] + FP[i][2] * D[2][j] - dt * FP[i][3 + j];
+            else       s = FP[i][j];
+            Pp[i][j] = Pp[j][i] = s;
+        }
+    double wn = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+    double qa = c.gyroNoise * dt, qs = c.gyroScale * wn * dt;
+    for (int i = 0; i < 3; i++) {
+        Pp[i][i] += qa * qa + qs * qs;
+        Pp[3 + i][3 + i] += c.biasWalk * c.biasWalk * dt;
+    }
+
+    // Smoother gain of the previous sample: C = P F^T Pp^-1, i.e.
+    // C^T = Pp^-1 (F P)
+    if (prev) {
+        double L[6][6], Ct[6][6];
+        memcpy(L, Pp, sizeof(L));
+        memcpy(Ct, FP, sizeof(Ct));
+        if (cholSolve(L, Ct, 6)) {
+            for (int i = 0; i < 6; i++)
+                for (int j = 0; j < 6; j++) prev->C[i][j] = (float)Ct[j][i];
+        } else {
+            memset(prev->C, 0, sizeof(prev->C));
+        }
+    }
+    memcpy(P, Pp, sizeof(Pp));
+
+    // Gravity: accel direction against R^T up
+    r.flags = 0;
+    double an = sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    if (fabs(an - 1) < c.gravityAccel && wn < c.gravityGyro) {
+        double qi[4] = {sm.q[0], -sm.q[1], -sm.q[2], -sm.q[3]};
+        double up[3] = {0, 0, 1}, v[3];
+        smoothRotate(qi, up, v);
+        // d(R^T up) / dtheta = [v x]
+        double H[3][6] = {{0, -v[2], v[1], 0, 0, 0},
+                          {v[2], 0, -v[0], 0, 0, 0},
+                          {-v[1], v[0], 0, 0, 0, 0}};
+        double y[3] = {a[0] / an - v[0], a[1] / an - v[1], a[2] / an - v[2]};
+        double e = an - 1, s = 0.2 * wn;
+        update(sm, H, y, 3, c.accelNoise * c.accelNoise + e * e + s * s * 0.01);
+        r.flags |= SMOOTH_GRAVITY;
+        sm.gravity++;
+    }
+    // Zero rate: at rest the gyro reads its bias
+    double rn = sqrt((r.g[0] - sm.b[0]) * (r.g[0] - sm.b[0]) + (r.g[1] - sm.b[1]) * (r.g[1] - sm.b[1]) +
+                     (r.g[2] - sm.b[2]) * (r.g[2] - sm.b[2]));
+    sm.still = fabs(an - 1) < c.restAccel && rn < c.restGyro ? sm.still + 1 : 0;
+    if (sm.still >= c.restSamples) {
+        double H[3][6] = {{0, 0, 0, 1, 0, 0}, {0, 0, 0, 0, 1, 0}, {0, 0, 0, 0, 0, 1}};
+        double y[3] = {r.g[0] - sm.b[0], r.g[1] - sm.b[1], r.g[2] - sm.b[2]};
+        update(sm, H, y, 3, c.gyroNoise * c.gyroNoise);
+        r.flags |= SMOOTH_REST;
+        sm.rest++;
+    }
+    memcpy(r.qf, sm.q, sizeof(sm.q));
+    memcpy(r.bf, sm.b, sizeof(sm.b));
+}
+
+// ==== Backward pass ====
+
+// RTS over the held records, newest first, then emits the oldest n
+static void backward(Smoother &sm, size_t n) {
+    std::vector<SmoothRecord> &R = sm.ring;
+    size_t last = R.size() - 1;
+    memcpy(R[last].qs, R[last].qf, sizeof(R[last].qs));
+    memcpy(R[last].bs, R[last].bf, sizeof(R[last].bs));
+    for (size_t k = last; k-- > 0;) {
+        SmoothRecord &r = R[k], &nx = R[k + 1];
+        double d1[6], d0[6];
+        quatLogDiff(nx.qp, nx.qs, d1);
+        for (int i = 0; i < 3; i++) d1[3 + i] = nx.bs[i] - r.bf[i];
+        for (int i = 0; i < 6; i++) {
+            double s = 0;
+            for (int j = 0; j < 6; j++) s += r.C[i][j] * d1[j];
+            d0[i] = s;
+        }
+        double dq[4];
+        quatExp(d0, dq);
+        smoothQuatMul(r.qf, dq, r.qs);
+        quatNorm(r.qs);
+        for (int i = 0; i < 3; i++) r.bs[i] = r.bf[i] + d0[3 + i];
+    }
+    sm.blocks++;
+
+    if (sm.emit) {
+        SmoothSample out;
+        for (size_t k = 0; k < n; k++) {
+            const SmoothRecord &r = R[k];
+            out.s = r.s;
+            memcpy(out.q, r.qs, sizeof(out.q));
+            memcpy(out.bias, r.bs, sizeof(out.bias));
+            memcpy(out.qf, r.qf, sizeof(out.qf));
+            for (int i = 0; i < 3; i++) out.w[i] = r.g[i] - r.bs[i];
+            out.flags = r.flags;
+            sm.emit(sm.ctx, out);
+        }
+    }
+    R.erase(R.begin(), R.begin() + n);
+}
+
+// ==== Public ====
+
+void smootherInit(Smoother &sm, const SmootherConfig &cfg, SmoothEmit emit, void* ctx) {
+    sm.cfg = cfg;
+    if (sm.cfg.lag < 16) sm.cfg.lag = 16;
+    sm.emit = emit;
+    sm.ctx = ctx;
+    sm.ring.clear();
+    sm.ring.reserve(2 * (size_t)sm.cfg.lag);
+    sm.started = false;
+    sm.still = 0;
+    sm.samples = sm.gravity = sm.rest = sm.blocks = 0;
+}
+
+void smootherAdd(Smoother &sm, const BsSample &s, const double a[3], const double g[3]) {
+    if (!sm.started) {
+        start(sm, a);
+        sm.started = true;
+        sm.lastUs = s.tUs;
+    }
+    // Step as the loop takes it: 0.033 s when the gap is implausible
+    double dt = (s.tUs - sm.lastUs) * 1e-6;
+    if (dt > 0.1 || dt < 0) dt = 0.033;
+    sm.lastUs = s.tUs;
+
+    sm.ring.emplace_back();
+    SmoothRecord &r = sm.ring.back();
+    r.s = s;
+    memcpy(r.g, g, sizeof(r.g));
+    memset(r.C, 0, sizeof(r.C));
+    forward(sm, r, a, dt);
+    sm.samples++;
+
+    if (sm.ring.size() >= 2 * (size_t)sm.cfg.lag) backward(sm, sm.cfg.lag);
+}
+
+void smootherFinish(Smoother &sm) {
+    if (!sm.ring.empty()) backward(sm, sm.ring.size());
+}
+
+size_t smootherMemory(const Smoother &sm) {
+    return 2 * (size_t)sm.cfg.lag * sizeof(SmoothRecord);
+}
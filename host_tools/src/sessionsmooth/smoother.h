@@ -0,0 +1,110 @@
+/**
+ * Offline orientation smoother: error-state Kalman filter + RTS pass
+ *
+ * The ball's own orientation (bsFuse) is a causal gyro integration that
+ * only knows "decay toward identity while still"; it drifts with every
+ * unremoved bias and never learns which way is down. With the whole
+ * recording at hand both can be fixed:
+ *
+ *   forward   error-state EKF over [attitude error (body frame), gyro
+ *             bias]. Gyro drives the prediction; two measurements:
+ *               gravity    accel direction vs R^T (0, 0, 1), taken only
+ *                          when |a| is near 1 g and the spin is slow
+ *                          enough for centripetal acceleration not to
+ *                          matter
+ *               zero rate  at rest the gyro reads its own bias; rest is
+ *                          a quarter second of stillness, so a ball
+ *                          turned slowly in the hand is not taken for
+ *                          one lying on the court
+ *   backward  Rauch-Tung-Striebel: each step's correction is pulled
+ *             back through the smoother gain C_k = P_k|k F^T P_k+1|k^-1,
+ *             so a rest period corrects the flight before it as well
+ *             as the one after it
+ *
+ * Tilt is observable through gravity and becomes drift-free; heading
+ * (rotation about the vertical) is not, and is only as good as the
+ * gyro after bias removal.
+ *
+ * Streaming in bounded memory: the backward pass runs over blocks.
+ * Once 2 x lag samples are held, the newest lag of them serve as
+ * look-ahead, the oldest lag are smoothed and handed out and dropped.
+ * Memory is 2 x lag records whatever the session length; a sample is
+ * smoothed with at least lag samples of future data (all of it near
+ * the end of the session).
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include <stdint.h>
+#include <vector>
+
+struct SmootherConfig {
+    double   gyroNoise    = 0.015;  // rad/s per sample, white
+    double   gyroScale    = 0.01;   // fraction of the rate: scale / axis misalignment
+    double   biasWalk     = 2e-4;   // rad/s per sqrt(s)
+    double   accelNoise   = 0.03;   // g
+    double   gravityAccel = 0.15;   // ||a| - 1 g| below which gravity is measured
+    double   gravityGyro  = 3.0;    // rad/s above which it is not (centripetal)
+    double   restAccel    = 0.05;   // ||a| - 1 g| and
+    double   restGyro     = 0.06;   // |gyro - bias| (rad/s) below which the ball is still,
+    uint32_t restSamples  = 50;     // for this many samples in a row: at rest
+    uint32_t lag          = 4000;   // samples of look-ahead, and samples per block
+};
+
+enum SmoothFlags : uint8_t {
+    SMOOTH_GRAVITY = 0x01,          // gravity update applied
+    SMOOTH_REST    = 0x02,          // zero-rate update applied
+};
+
+struct SmoothSample {
+    BsSample s;                     // the sample as given
+    double   q[4];                  // smoothed orientation, body to world (w, x, y, z)
+    double   bias[3];               // smoothed gyro bias, rad/s
+    double   qf[4];                 // forward filter alone
+    double   w[3];                  // body rate, gyro - smoothed bias, rad/s
+    uint8_t  flags;
+};
+
+typedef void (*SmoothEmit)(void* ctx, const SmoothSample &s);
+
+// One held sample: what the backward pass needs of the forward one
+struct SmoothRecord {
+    BsSample s;
+    double   g[3];              // gyro, rad/s
+    double   qf[4], bf[3];      // filtered
+    double   qp[4];             // predicted from the previous sample (its bias is the previous bf)
+    double   qs[4], bs[3];      // smoothed
+    float    C[6][6];           // smoother gain to the next sample
+    uint8_t  flags;
+};
+
+struct Smoother {
+    SmootherConfig            cfg;
+    SmoothEmit                emit = nullptr;
+    void*                     ctx = nullptr;
+    std::vector<SmoothRecord> ring;     // oldest first, at most 2 x lag
+    bool                      started = false;
+    int64_t                   lastUs = 0;
+    uint32_t                  still = 0;        // samples in a row below the rest thresholds
+    double                    q[4], b[3], P[6][6];   // filtered state of the newest sample
+    // Stats
+    uint64_t                  samples = 0, gravity = 0, rest = 0, blocks = 0;
+};
+
+void smootherInit(Smoother &sm, const SmootherConfig &cfg, SmoothEmit emit, void* ctx);
+
+// One sample: accel in g, gyro in rad/s. Smoothed samples are emitted
+// in order, a block at a time
+void smootherAdd(Smoother &sm, const BsSample &s, const double a[3], const double g[3]);
+
+// Smooths and emits everything still held
+void smootherFinish(Smoother &sm);
+
+// Bytes held at most
+size_t smootherMemory(const Smoother &sm);
+
+// Quaternion helpers (w, x, y, z), body to world
+void smoothQuatMul(const double a[4], const double b[4], double out[4]);
+void smoothRotate(const double q[4], const double v[3], double out[3]);    // R v
+double smoothAngle(const double a[4], const double b[4]);                 // radians between
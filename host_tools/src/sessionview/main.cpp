@@ -0,0 +1,187 @@
+/**
+ * sessionview - overview of a ball session (G and RPM envelope) at a given width
+ *
+ * Usage:
+ *   sessionview [--px N] [--from MS] [--to MS] [--raw] in.ybs [out.csv]
+ *   sessionview --bench [--px N] in.ybs
+ *
+ * Splits the device-time range (whole session by default) into N bins
+ * (default 1000) and prints one CSV row per bin:
+ *
+ *   t_ms,samples,g_min,g_max,g_mean,rpm_min,rpm_max,rpm_mean,impacts
+ *
+ * with G = |accel| and RPM = |gyro| / 6, i.e. what a chart needs for a
+ * min/max band plus mean line. The bins come from the file's summary
+ * pyramid (written by sessionout, see bspyramid.h), so a whole-session
+ * view reads about 2N summaries however long the session is; --raw
+ * computes the same bins from every sample instead.
+ *
+ * --bench times the whole-session view and zoomed views (each 1/4 of the
+ * previous, at random positions) from the pyramid and from the samples,
+ * and checks that both agree on the session extremes.
+ */
+
+#include "sessionread.h"
+#include "sessionout.h"
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: sessionview [--px N] [--from MS] [--to MS] [--raw] in.ybs [out.csv]\n"
+            "       sessionview --bench [--px N] in.ybs\n");
+    exit(2);
+}
+
+static void sessionRange(const SessionReader &r, int64_t &t0, int64_t &t1) {
+    t0 = r.chunks ? r.index[0].tFirstUs : 0;
+    t1 = r.chunks ? r.index[r.chunks - 1].tLastUs : 0;
+}
+
+static void writeCsv(const SessionReader &r, const std::vector<BsSummary> &bins, FILE* fp) {
+    double g = 1.0 / bsAccelPerG(*r.header);
+    double rpm = 1.0 / (bsGyroPerDps(*r.header) * 6.0);
+    fprintf(fp, "t_ms,samples,g_min,g_max,g_mean,rpm_min,rpm_max,rpm_mean,impacts\n");
+    for (const BsSummary &b : bins) {
+        if (!b.count) continue;
+        fprintf(fp, "%.3f,%u,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%u\n", b.tFirstUs / 1e3, b.count,
+                b.min[BS_SUM_ACCEL] * g, b.max[BS_SUM_ACCEL] * g, b.mean[BS_SUM_ACCEL] * g,
+                b.min[BS_SUM_GYRO] * rpm, b.max[BS_SUM_GYRO] * rpm, b.mean[BS_SUM_GYRO] * rpm,
+                b.impacts);
+    }
+}
+
+// ==================== Benchmark ====================
+
+// Median seconds of reps overview calls over the given ranges
+static double timeViews(SessionReader &r, const std::vector<std::pair<int64_t, int64_t>> &ranges,
+                        uint32_t px, bool raw, int &level) {
+    std::vector<BsSummary> bins;
+    std::vector<double> t;
+    for (const auto &rg : ranges) {
+        double t0 = hostSeconds();
+        level = sessionOverview(r, rg.first, rg.second, px, bins, raw);
+        t.push_back(hostSeconds() - t0);
+    }
+    std::sort(t.begin(), t.end());
+    return t[t.size() / 2];
+}
+
+static void extremes(const std::vector<BsSummary> &bins, BsPyramidPartial &all) {
+    memset(&all, 0, sizeof(all));
+    for (int c = 0; c < BS_SUM_COUNT; c++) all.min[c] = 0xFFFF;
+    for (const BsSummary &b : bins) bsSummaryMerge(all, b);
+}
+
+static int bench(SessionReader &r, uint32_t px) {
+    if (!r.pyramid) {
+        fprintf(stderr, "no summary pyramid in this file (rewrite it with sessionpack)\n");
+        return 1;
+    }
+    uint64_t entries = 0;
+    for (uint8_t k = 0; k < r.pyramid->levels; k++) entries += r.level[k].size;
+    printf("%llu samples, %.1f MB; pyramid base %u, %u levels, %llu summaries, %.1f KB (%.2f%% of file)\n",
+           (unsigned long long)r.samples, r.size / 1e6, r.pyramid->base, r.pyramid->levels,
+           (unsigned long long)entries, entries * sizeof(BsSummary) / 1e3,
+           100.0 * entries * sizeof(BsSummary) / r.size);
+
+    int64_t t0, t1;
+    sessionRange(r, t0, t1);
+    std::vector<BsSummary> fast, slow;
+    double c0 = hostSeconds();
+    int level = sessionOverview(r, t0, t1, px, fast);
+    double first = hostSeconds() - c0;
+    sessionOverview(r, t0, t1, px, slow, true);
+
+    BsPyramidPartial a, b;
+    extremes(fast, a);
+    extremes(slow, b);
+    bool same = a.count == b.count && a.impacts == b.impacts;
+    for (int c = 0; c < BS_SUM_COUNT; c++) {
+        same = same && a.min[c] == b.min[c] && a.max[c] == b.max[c] &&
+               (a.sum[c] + a.count / 2) / a.count == (b.sum[c] + b.count / 2) / b.count;
+    }
+    printf("whole session at %u px: level %d, first call %.3f ms; pyramid and samples %s\n", px,
+           level, first * 1e3, same ? "agree" : "DISAGREE");
+
+    printf("%14s %8s %6s %12s %12s %8s\n", "range", "samples", "level", "pyramid ms",
+           "samples ms", "speedup");
+    std::mt19937 rng(1);
+    int64_t width = t1 - t0;
+    for (int zoom = 0; width > 0 && zoom < 10; zoom++, width /= 4) {
+        std::vector<std::pair<int64_t, int64_t>> ranges;
+        for (int i = 0; i < (zoom ? 21 : 11); i++) {
+            int64_t start = t0 + (t1 - t0 > width ? (int64_t)(rng() % (uint64_t)(t1 - t0 - width)) : 0);
+            ranges.push_back({start, start + width});
+        }
+        int lf, ls;
+        double tf = timeViews(r, ranges, px, false, lf);
+        double ts = timeViews(r, ranges, px, true, ls);
+        uint64_t n = r.samples * width / std::max<int64_t>(1, t1 - t0);
+        printf("%12.1f s %8llu %6d %12.3f %12.3f %7.0fx\n", width / 1e6, (unsigned long long)n, lf,
+               tf * 1e3, ts * 1e3, ts / tf);
+        if (n < px) break;
+    }
+    return same ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    uint32_t px = 1000;
+    int64_t fromUs = INT64_MIN, toUs = INT64_MAX;
+    bool raw = false, benchOnly = false;
+    const char* paths[2];
+    int npaths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--px") && more)          px = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--from") && more)   fromUs = atoll(argv[++i]) * 1000;
+        else if (!strcmp(a, "--to") && more)     toUs = atoll(argv[++i]) * 1000;
+        else if (!strcmp(a, "--raw"))            raw = true;
+        else if (!strcmp(a, "--bench"))          benchOnly = true;
+        else if (a[0] == '-' || npaths == 2)     usage();
+        else                                     paths[npaths++] = a;
+    }
+    if (npaths < 1 || (benchOnly && npaths != 1) || px == 0) usage();
+
+    SessionReader r;
+    if (!sessionOpen(r, paths[0])) {
+        fprintf(stderr, "%s: %s\n", paths[0], r.error);
+        return 1;
+    }
+    if (r.recovered) {
+        fprintf(stderr, "%s: no valid index, recovered %u chunks by scanning\n", paths[0],
+                r.chunks);
+    }
+    if (benchOnly) {
+        int rc = bench(r, px);
+        sessionClose(r);
+        return rc;
+    }
+
+    int64_t t0, t1;
+    sessionRange(r, t0, t1);
+    t0 = std::max(t0, fromUs);
+    t1 = std::min(t1, toUs);
+    std::vector<BsSummary> bins;
+    double c0 = hostSeconds();
+    int level = sessionOverview(r, t0, t1, px, bins, raw);
+    double sec = hostSeconds() - c0;
+
+    FILE* fp = npaths == 2 ? fopen(paths[1], "w") : stdout;
+    if (!fp) {
+        perror(paths[1]);
+        return 1;
+    }
+    writeCsv(r, bins, fp);
+    if (fp != stdout) fclose(fp);
+    fprintf(stderr, "%u bins from %s in %.3f ms\n", px,
+            level < 0 ? "samples" : "the pyramid", sec * 1e3);
+    if (level >= 0) fprintf(stderr, "pyramid level %d (%u samples per summary)\n", level,
+                            (unsigned)r.pyramid->base << level);
+    sessionClose(r);
+    return 0;
+}
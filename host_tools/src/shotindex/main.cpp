@@ -0,0 +1,577 @@
+/**
+ * shotindex - cross-session shot index and queries
+ *
+ * Usage:
+ *   shotindex build [--db tennis_data.db]... shots.ysx [in.ybs | dir]...
+ *   shotindex query shots.ysx [filters] [--group type|source|day|month|rpm]
+ *                   [--limit N] [--bench N]
+ *
+ * build collects every shot (time, RPM, peak G, spin type, spin axis and
+ * where it came from) of the session files given, directories searched
+ * for *.ybs, and of every session of the observer databases into one
+ * column-wise file (shotindex.h). An existing index is updated: sources
+ * that have not changed are copied from it without being opened, so a
+ * nightly rebuild only reads the new sessions. Prints shots/s and MB/s.
+ *
+ * Session files carry device time only; their shots are placed on the
+ * wall clock as sessiondb does it (the session ends at the file's
+ * modification time). Database shots use their local_ts.
+ *
+ * Filters (all optional, combined with AND):
+ *   --type TOPSPIN[,BACKSPIN...]   spin types (case-insensitive)
+ *   --rpm MIN[:MAX]  --g MIN[:MAX] peak RPM / peak G, either end optional
+ *   --theta MIN:MAX  --phi MIN:MAX spin axis in degrees
+ *   --since DATE  --until DATE     local "YYYY-mm-dd[THH:MM[:SS]]", until exclusive
+ *   --last N[d|h]                  the last N days / hours
+ *   --source TEXT                  sources whose path contains TEXT
+ *
+ * Without --group the matching shots are printed as CSV, oldest first
+ * (--limit rows, default 20, 0 = all), with the source path and shot id
+ * for sessionconv --shot. --group prints count, mean and max RPM and
+ * peak G per spin type, source, local day, month or 100-RPM band.
+ * --bench N runs the query N times and reports the median time.
+ */
+
+#include "shotindex.h"
+#include "observer.h"
+#include "sessionout.h"
+#include "sessionread.h"
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: shotindex build [--db tennis_data.db]... shots.ysx [in.ybs | dir]...\n"
+            "       shotindex query shots.ysx [--type T[,T]] [--rpm MIN[:MAX]] [--g MIN[:MAX]]\n"
+            "                 [--theta MIN:MAX] [--phi MIN:MAX] [--since DATE] [--until DATE]\n"
+            "                 [--last N[d|h]] [--source TEXT]\n"
+            "                 [--group type|source|day|month|rpm] [--limit N] [--bench N]\n");
+    exit(2);
+}
+
+// ==================== Build ====================
+
+struct Build {
+    ShotIndex old;
+    std::vector<std::vector<uint32_t>> oldShots;  // shots of each old source
+    std::map<std::string, int> oldSources;        // by sourceKey
+    ShotIndex ix;
+    uint32_t  read = 0, reused = 0, failed = 0;
+    uint64_t  readShots = 0, readBytes = 0;
+};
+
+// A file by its path, a database session by path and session id
+static std::string sourceKey(const ShotSource &s) {
+    if (s.kind == SHOT_SOURCE_FILE) return "f:" + s.path;
+    return "d:" + s.path + "#" + std::to_string(s.session);
+}
+
+// Old source s has not changed since (same stamp, and for a file the
+// same mtime, for a database session the same shot count), or -1
+static int findOld(const Build &b, const ShotSource &s) {
+    auto it = b.oldSources.find(sourceKey(s));
+    if (it == b.oldSources.end()) return -1;
+    const ShotSource &o = b.old.sources[it->second];
+    bool same = o.stamp == s.stamp && (s.kind == SHOT_SOURCE_FILE ? o.mtime == s.mtime
+                                                                  : o.shots == s.shots);
+    return same ? it->second : -1;
+}
+
+static uint32_t addSource(Build &b, const ShotSource &s) {
+    b.ix.sources.push_back(s);
+    return (uint32_t)(b.ix.sources.size() - 1);
+}
+
+// Copies the old source's shots; false if there is none to reuse
+static bool reuse(Build &b, ShotSource s) {
+    int o = findOld(b, s);
+    if (o < 0) return false;
+    s.shots = b.old.sources[o].shots;
+    s.session = b.old.sources[o].session;
+    uint32_t id = addSource(b, s);
+    for (uint32_t i : b.oldShots[o]) shotCopy(b.ix, b.old, i, id);
+    b.reused++;
+    return true;
+}
+
+static void addFile(Build &b, const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        perror(path.c_str());
+        b.failed++;
+        return;
+    }
+    ShotSource s;
+    s.kind = SHOT_SOURCE_FILE;
+    s.path = path;
+    s.mtime = st.st_mtime;
+    s.stamp = st.st_size;
+    if (reuse(b, s)) return;
+
+    SessionReader r;
+    if (!sessionOpen(r, path.c_str())) {
+        fprintf(stderr, "%s: %s\n", path.c_str(), r.error);
+        b.failed++;
+        return;
+    }
+    s.session = r.header->session;
+    uint32_t id = addSource(b, s);
+    ObserverClock clock;
+    observerClockAnchor(clock, r.chunks ? r.index[r.chunks - 1].tLastUs : 0, st.st_mtime);
+    int64_t wallBaseMs = (int64_t)clock.wallBase * 1000;
+
+    // Only chunks holding shots are touched, and of those only the shot table
+    uint32_t n = 0;
+    for (uint32_t c = 0; c < r.chunks; c++) {
+        if (!r.index[c].shotCount) continue;
+        const uint8_t* chunk = sessionChunkAt(r, c);
+        const BsChunkHeader* h = bsChunkHeader(chunk);
+        if (h->magic != BS_CHUNK_MAGIC || r.index[c].offset + h->bytes > r.size) continue;
+        const BsShot* shots = bsChunkShots(chunk);
+        for (uint16_t k = 0; k < h->shotCount; k++) {
+            const BsShot &sh = shots[k];
+            char type[sizeof(sh.spinType) + 1];
+            observerSpinType(sh, type, sizeof(type));
+            double theta = -1, phi = 0;
+            observerSpinAxis(sh, theta, phi);
+            shotAppend(b.ix, wallBaseMs + sh.tUs / 1000, sh.tUs, sh.id, id, sh.peakRpm, sh.peakG,
+                       theta, phi, shotTypeCode(b.ix, type));
+            n++;
+        }
+    }
+    b.ix.sources[id].shots = n;
+    b.read++;
+    b.readShots += n;
+    b.readBytes += r.size;
+    sessionClose(r);
+}
+
+// local_ts ("YYYY-mm-ddTHH:MM:SS.mmm", local time) -> ms since the epoch;
+// mktime runs once per minute of shots
+struct LocalTsParser {
+    char    minute[17] = "";
+    int64_t minuteMs = 0;
+};
+
+static bool parseLocalTs(LocalTsParser &p, const char* ts, int64_t &ms) {
+    if (!ts || strlen(ts) < 19) return false;
+    if (strncmp(ts, p.minute, 16) != 0) {
+        struct tm tm = {};
+        if (sscanf(ts, "%4d-%2d-%2d%*c%2d:%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour,
+                   &tm.tm_min) != 5) {
+            return false;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        tm.tm_isdst = -1;
+        memcpy(p.minute, ts, 16);
+        p.minute[16] = '\0';
+        p.minuteMs = (int64_t)mktime(&tm) * 1000;
+    }
+    double sec = atof(ts + 17);
+    ms = p.minuteMs + (int64_t)(sec * 1000.0 + 0.5);
+    return true;
+}
+
+static bool addDatabase(Build &b, const char* path) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        fprintf(stderr, "%s: %s\n", path, sqlite3_errmsg(db));
+        sqlite3_close(db);
+        b.failed++;
+        return false;
+    }
+    // Per session: shot count and highest row id tell whether it changed
+    sqlite3_stmt* st = nullptr;
+    std::map<int64_t, uint32_t> fresh;   // session id -> new source
+    const char* sql = "SELECT session_id, count(*), max(id) FROM shots GROUP BY session_id";
+    bool ok = sqlite3_prepare_v2(db, sql, -1, &st, nullptr) == SQLITE_OK;
+    while (ok && sqlite3_step(st) == SQLITE_ROW) {
+        ShotSource s;
+        s.kind = SHOT_SOURCE_DB;
+        s.path = path;
+        s.session = (uint32_t)sqlite3_column_int64(st, 0);
+        s.shots = (uint32_t)sqlite3_column_int64(st, 1);
+        s.stamp = (uint64_t)sqlite3_column_int64(st, 2);
+        if (!reuse(b, s)) fresh[s.session] = addSource(b, s);
+    }
+    sqlite3_finalize(st);
+
+    // One pass over the table for every new or changed session
+    sql = "SELECT session_id, shot_id, device_ts, local_ts, rpm, peak_g, gx, gy, gz, spin_type, "
+          "spin_axis_theta, spin_axis_phi FROM shots ORDER BY session_id, id";
+    st = nullptr;
+    if (ok && !fresh.empty()) ok = sqlite3_prepare_v2(db, sql, -1, &st, nullptr) == SQLITE_OK;
+    LocalTsParser parser;
+    auto it = fresh.end();
+    while (st && ok && sqlite3_step(st) == SQLITE_ROW) {
+        int64_t session = sqlite3_column_int64(st, 0);
+        if (it == fresh.end() || it->first != session) it = fresh.find(session);
+        if (it == fresh.end()) continue;
+        int64_t wallMs = 0;
+        parseLocalTs(parser, (const char*)sqlite3_column_text(st, 3), wallMs);
+        double theta = -1, phi = 0;
+        if (sqlite3_column_type(st, 10) != SQLITE_NULL) {
+            theta = sqlite3_column_double(st, 10);
+            phi = sqlite3_column_double(st, 11);
+        } else {
+            BsShot s = {};
+            s.gx = (float)sqlite3_column_double(st, 6);
+            s.gy = (float)sqlite3_column_double(st, 7);
+            s.gz = (float)sqlite3_column_double(st, 8);
+            observerSpinAxis(s, theta, phi);
+        }
+        const char* type = (const char*)sqlite3_column_text(st, 9);
+        shotAppend(b.ix, wallMs, sqlite3_column_int64(st, 2) * 1000,
+                   (uint32_t)sqlite3_column_int64(st, 1), it->second,
+                   (float)sqlite3_column_double(st, 4), (float)sqlite3_column_double(st, 5), theta,
+                   phi, shotTypeCode(b.ix, type ? type : ""));
+        b.readShots++;
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: %s\n", path, sqlite3_errmsg(db));
+        b.failed++;
+    }
+    sqlite3_finalize(st);
+    b.read += (uint32_t)fresh.size();
+    struct stat fs;
+    if (!fresh.empty() && stat(path, &fs) == 0) b.readBytes += fs.st_size;
+    sqlite3_close(db);
+    return ok;
+}
+
+static bool isSessionFile(const std::string &path) {
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".ybs") == 0;
+}
+
+static int build(int argc, char** argv) {
+    std::vector<const char*> dbs, inputs;
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--db") && i + 1 < argc) dbs.push_back(argv[++i]);
+        else if (argv[i][0] == '-')                   usage();
+        else                                          inputs.push_back(argv[i]);
+    }
+    if (inputs.empty()) usage();
+    const char* out = inputs[0];
+    inputs.erase(inputs.begin());
+
+    Build b;
+    std::string error;
+    struct stat st;
+    if (stat(out, &st) == 0 && !shotIndexLoad(b.old, out, error)) {
+        fprintf(stderr, "%s: %s, rebuilding from scratch\n", out, error.c_str());
+    }
+    b.oldShots.resize(b.old.sources.size());
+    for (size_t i = 0; i < b.old.size(); i++) b.oldShots[b.old.source[i]].push_back((uint32_t)i);
+    for (size_t i = 0; i < b.old.sources.size(); i++) b.oldSources[sourceKey(b.old.sources[i])] = (int)i;
+
+    // Expand directories, sorted so the source order is stable between builds
+    std::vector<std::string> files;
+    for (const char* in : inputs) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(in, ec)) {
+            for (const auto &e : std::filesystem::recursive_directory_iterator(in, ec)) {
+                if (e.is_regular_file() && isSessionFile(e.path().string())) {
+                    files.push_back(e.path().string());
+                }
+            }
+        } else {
+            files.push_back(in);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    double t0 = hostSeconds();
+    for (const std::string &f : files) addFile(b, f);
+    for (const char* db : dbs) addDatabase(b, db);
+    shotSort(b.ix);
+    b.ix.builtAt = time(nullptr);
+    uint64_t bytes = shotIndexSave(b.ix, out);
+    double secs = hostSeconds() - t0;
+    if (!bytes) {
+        fprintf(stderr, "%s: write failed\n", out);
+        return 1;
+    }
+
+    printf("%s: %zu shots from %zu sources, %llu bytes (%.1f B/shot)\n", out, b.ix.size(),
+           b.ix.sources.size(), (unsigned long long)bytes, b.ix.size() ? (double)bytes / b.ix.size() : 0.0);
+    printf("  read %u sources (%llu shots; %.1f MB, of which only the shot tables are touched), "
+           "reused %u unchanged, %u failed\n", b.read, (unsigned long long)b.readShots,
+           b.readBytes / 1e6, b.reused, b.failed);
+    printf("  built in %.3f s  (%.0f shots/s indexed, %.0f shots/s read from sources)\n", secs,
+           b.ix.size() / secs, b.readShots / secs);
+    return b.failed ? 1 : 0;
+}
+
+// ==================== Query ====================
+
+static bool parseRange(const char* s, float &lo, float &hi) {
+    const char* colon = strchr(s, ':');
+    if (s[0] && s[0] != ':') lo = (float)atof(s);
+    if (colon && colon[1]) hi = (float)atof(colon + 1);
+    return s[0] != '\0';
+}
+
+static bool parseRange(const char* s, double &lo, double &hi) {
+    float l = (float)lo, h = (float)hi;
+    if (!parseRange(s, l, h)) return false;
+    lo = l;
+    hi = h;
+    return true;
+}
+
+// Local "YYYY-mm-dd[THH:MM[:SS]]" -> ms since the epoch
+static bool parseDate(const char* s, int64_t &ms) {
+    struct tm tm = {};
+    int n = sscanf(s, "%4d-%2d-%2d%*c%2d:%2d:%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                   &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    if (n < 3) return false;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    ms = (int64_t)mktime(&tm) * 1000;
+    return true;
+}
+
+enum GroupBy { GROUP_NONE, GROUP_TYPE, GROUP_SOURCE, GROUP_DAY, GROUP_MONTH, GROUP_RPM };
+
+struct Agg {
+    uint64_t count = 0;
+    double   rpmSum = 0, gSum = 0;
+    float    rpmMax = 0, gMax = 0;
+};
+
+// Local calendar period holding ms; shots come in time order, so mktime
+// runs once per period
+struct Period {
+    int64_t startMs = 1, endMs = 0;
+    char    label[16];
+};
+
+static void periodOf(Period &p, int64_t ms, bool month) {
+    if (ms >= p.startMs && ms < p.endMs) return;
+    time_t t = (time_t)(ms / 1000 - (ms % 1000 < 0));
+    struct tm tm;
+    localtime_r(&t, &tm);
+    tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+    if (month) tm.tm_mday = 1;
+    tm.tm_isdst = -1;
+    strftime(p.label, sizeof(p.label), month ? "%Y-%m" : "%Y-%m-%d", &tm);
+    p.startMs = (int64_t)mktime(&tm) * 1000;
+    if (month) tm.tm_mon++;
+    else       tm.tm_mday++;
+    tm.tm_isdst = -1;
+    p.endMs = (int64_t)mktime(&tm) * 1000;
+}
+
+static void localTime(int64_t ms, char* out, size_t size) {
+    time_t t = (time_t)(ms / 1000);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    size_t n = strftime(out, size, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(out + n, size - n, ".%03d", (int)(ms % 1000));
+}
+
+static void printShots(const ShotIndex &ix, const std::vector<uint32_t> &hits, size_t limit) {
+    printf("local_time,rpm,peak_g,type,theta,phi,source,session,shot_id,device_ms\n");
+    size_t n = limit && limit < hits.size() ? limit : hits.size();
+    for (size_t k = 0; k < n; k++) {
+        uint32_t i = hits[k];
+        char when[40];
+        localTime(ix.wallMs[i], when, sizeof(when));
+        const ShotSource &s = ix.sources[ix.source[i]];
+        printf("%s,%.1f,%.2f,%s,", when, ix.rpm[i], ix.peakG[i], ix.types[ix.type[i]].c_str());
+        if (ix.theta[i] == SHOT_NO_AXIS) printf(",,");
+        else                             printf("%.2f,%.2f,", ix.theta[i] / 100.0, ix.phi[i] / 100.0);
+        printf("%s,%u,%u,%lld\n", s.path.c_str(), s.session, ix.shotId[i],
+               (long long)(ix.deviceUs[i] / 1000));
+    }
+}
+
+struct Groups {
+    std::map<int64_t, Agg>         aggs;
+    std::map<int64_t, std::string> labels;   // day / month names
+};
+
+static void addToGroup(Agg &a, const ShotIndex &ix, uint32_t i) {
+    a.count++;
+    a.rpmSum += ix.rpm[i];
+    a.gSum += ix.peakG[i];
+    a.rpmMax = std::max(a.rpmMax, ix.rpm[i]);
+    a.gMax = std::max(a.gMax, ix.peakG[i]);
+}
+
+static void groupShots(const ShotIndex &ix, const std::vector<uint32_t> &hits, GroupBy by,
+                       Groups &g) {
+    g.aggs.clear();
+    g.labels.clear();
+    if (by == GROUP_DAY || by == GROUP_MONTH) {
+        // Shots are in time order: one map lookup per period
+        Period period;
+        Agg* a = nullptr;
+        for (uint32_t i : hits) {
+            if (!a || ix.wallMs[i] < period.startMs || ix.wallMs[i] >= period.endMs) {
+                periodOf(period, ix.wallMs[i], by == GROUP_MONTH);
+                a = &g.aggs[period.startMs];
+                g.labels[period.startMs] = period.label;
+            }
+            addToGroup(*a, ix, i);
+        }
+        return;
+    }
+    // Small dense keys: accumulate in a table
+    std::vector<Agg> table(by == GROUP_TYPE ? ix.types.size() : by == GROUP_SOURCE ? ix.sources.size() : 1);
+    for (uint32_t i : hits) {
+        size_t key = by == GROUP_TYPE   ? ix.type[i]
+                   : by == GROUP_SOURCE ? ix.source[i]
+                   :                      (size_t)std::max(0.0f, ix.rpm[i] / 100.0f);
+        if (key >= table.size()) table.resize(key + 1);
+        addToGroup(table[key], ix, i);
+    }
+    for (size_t k = 0; k < table.size(); k++) {
+        if (table[k].count) g.aggs[(int64_t)k] = table[k];
+    }
+}
+
+static void printGroups(const ShotIndex &ix, const Groups &g, GroupBy by) {
+    static const char* HEAD[] = {"", "type", "source", "day", "month", "rpm"};
+    printf("%s,shots,rpm_mean,rpm_max,peak_g_mean,peak_g_max\n", HEAD[by]);
+    for (const auto &e : g.aggs) {
+        const Agg &a = e.second;
+        switch (by) {
+        case GROUP_TYPE:   printf("%s", ix.types[e.first].c_str()); break;
+        case GROUP_SOURCE: {
+            const ShotSource &s = ix.sources[e.first];
+            printf(s.kind == SHOT_SOURCE_DB ? "%s#%u" : "%s", s.path.c_str(), s.session);
+            break;
+        }
+        case GROUP_RPM:    printf("%lld-%lld", (long long)e.first * 100, (long long)e.first * 100 + 100); break;
+        default:           printf("%s", g.labels.at(e.first).c_str()); break;
+        }
+        printf(",%llu,%.1f,%.1f,%.2f,%.2f\n", (unsigned long long)a.count, a.rpmSum / a.count,
+               a.rpmMax, a.gSum / a.count, a.gMax);
+    }
+}
+
+static void parseTypes(const ShotIndex &ix, const char* list, uint64_t &mask) {
+    mask = 0;
+    std::string all = list;
+    size_t pos = 0;
+    while (pos <= all.size()) {
+        size_t comma = all.find(',', pos);
+        std::string name = all.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        bool found = false;
+        for (size_t t = 0; t < ix.types.size(); t++) {
+            if (!strcasecmp(ix.types[t].c_str(), name.c_str())) {
+                mask |= 1ULL << t;
+                found = true;
+            }
+        }
+        if (!found) fprintf(stderr, "no %s shots in the index\n", name.c_str());
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+}
+
+static int query(int argc, char** argv) {
+    if (argc < 1) usage();
+    const char* path = argv[0];
+    ShotIndex ix;
+    std::string error;
+    double t0 = hostSeconds();
+    if (!shotIndexLoad(ix, path, error)) {
+        fprintf(stderr, "%s: %s\n", path, error.c_str());
+        return 1;
+    }
+    double loadSec = hostSeconds() - t0;
+
+    ShotQuery q;
+    GroupBy by = GROUP_NONE;
+    size_t limit = 20;
+    int reps = 0;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) usage();
+        i++;
+        if (!strcmp(a, "--type"))        parseTypes(ix, v, q.typeMask);
+        else if (!strcmp(a, "--rpm"))    parseRange(v, q.rpmMin, q.rpmMax);
+        else if (!strcmp(a, "--g"))      parseRange(v, q.gMin, q.gMax);
+        else if (!strcmp(a, "--theta"))  parseRange(v, q.thetaMin, q.thetaMax);
+        else if (!strcmp(a, "--phi"))    parseRange(v, q.phiMin, q.phiMax);
+        else if (!strcmp(a, "--since"))  { if (!parseDate(v, q.fromMs)) usage(); }
+        else if (!strcmp(a, "--until"))  { if (!parseDate(v, q.toMs)) usage(); q.toMs--; }
+        else if (!strcmp(a, "--last")) {
+            char* unit;
+            double n = strtod(v, &unit);
+            double hours = *unit == 'h' ? n : n * 24;
+            q.fromMs = (int64_t)time(nullptr) * 1000 - (int64_t)(hours * 3600e3);
+        } else if (!strcmp(a, "--source")) {
+            q.sourceMask.assign(ix.sources.size(), 0);
+            for (size_t s = 0; s < ix.sources.size(); s++) {
+                q.sourceMask[s] = strstr(ix.sources[s].path.c_str(), v) != nullptr;
+            }
+        } else if (!strcmp(a, "--group")) {
+            if      (!strcmp(v, "type"))   by = GROUP_TYPE;
+            else if (!strcmp(v, "source")) by = GROUP_SOURCE;
+            else if (!strcmp(v, "day"))    by = GROUP_DAY;
+            else if (!strcmp(v, "month"))  by = GROUP_MONTH;
+            else if (!strcmp(v, "rpm"))    by = GROUP_RPM;
+            else                           usage();
+        }
+        else if (!strcmp(a, "--limit"))  limit = strtoul(v, nullptr, 10);
+        else if (!strcmp(a, "--bench"))  reps = atoi(v);
+        else                             usage();
+    }
+
+    // The answer: matching shots, and their aggregates when grouped
+    std::vector<uint32_t> hits;
+    Groups groups;
+    t0 = hostSeconds();
+    shotQuery(ix, q, hits);
+    if (by != GROUP_NONE) groupShots(ix, hits, by, groups);
+    double querySec = hostSeconds() - t0;
+
+    double benchSec = 0;
+    if (reps > 0) {
+        std::vector<double> t;
+        std::vector<uint32_t> again;
+        for (int r = 0; r < reps; r++) {
+            double s0 = hostSeconds();
+            shotQuery(ix, q, again);
+            if (by != GROUP_NONE) groupShots(ix, again, by, groups);
+            t.push_back(hostSeconds() - s0);
+        }
+        std::sort(t.begin(), t.end());
+        benchSec = t[t.size() / 2];
+    }
+
+    if (by == GROUP_NONE) printShots(ix, hits, limit);
+    else                  printGroups(ix, groups, by);
+
+    fprintf(stderr, "# %zu of %zu shots (%zu sources) match; load %.2f ms, query %.3f ms", hits.size(),
+            ix.size(), ix.sources.size(), loadSec * 1e3, querySec * 1e3);
+    if (reps > 0) {
+        fprintf(stderr, "; median of %d runs %.3f ms (%.0f M shots/s scanned)", reps, benchSec * 1e3,
+                ix.size() / benchSec / 1e6);
+    }
+    fprintf(stderr, "\n");
+    return 0;
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+    if (argc < 3) usage();
+    if (!strcmp(argv[1], "build")) return build(argc - 2, argv + 2);
+    if (!strcmp(argv[1], "query")) return query(argc - 2, argv + 2);
+    usage();
+    return 2;
+}
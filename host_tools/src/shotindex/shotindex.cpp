@@ -0,0 +1,278 @@
+/**
+ * Cross-session shot index - see shotindex.h
+ */
+
+#include "shotindex.h"
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <numeric>
+#include <stdio.h>
+#include <string.h>
+
+uint8_t shotTypeCode(ShotIndex &ix, const char* name) {
+    for (size_t i = 0; i < ix.types.size(); i++) {
+        if (ix.types[i] == name) return (uint8_t)i;
+    }
+    if (ix.types.size() == SHOT_TYPES_MAX - 1) ix.types.push_back("OTHER");
+    if (ix.types.size() == SHOT_TYPES_MAX) return SHOT_TYPES_MAX - 1;
+    ix.types.push_back(std::string(name).substr(0, SHOT_TYPE_NAME - 1));
+    return (uint8_t)(ix.types.size() - 1);
+}
+
+static int16_t centiDegrees(double deg) { return (int16_t)lround(deg * 100.0); }
+
+void shotAppend(ShotIndex &ix, int64_t wallMs, int64_t deviceUs, uint32_t id, uint32_t source,
+                float rpm, float peakG, double theta, double phi, uint8_t type) {
+    ix.wallMs.push_back(wallMs);
+    ix.deviceUs.push_back(deviceUs);
+    ix.shotId.push_back(id);
+    ix.source.push_back(source);
+    ix.rpm.push_back(rpm);
+    ix.peakG.push_back(peakG);
+    ix.theta.push_back(theta < 0 ? SHOT_NO_AXIS : centiDegrees(theta));
+    ix.phi.push_back(theta < 0 ? 0 : (uint16_t)lround(phi * 100.0) % 36000);
+    ix.type.push_back(type);
+}
+
+void shotCopy(ShotIndex &to, const ShotIndex &from, size_t i, uint32_t source) {
+    to.wallMs.push_back(from.wallMs[i]);
+    to.deviceUs.push_back(from.deviceUs[i]);
+    to.shotId.push_back(from.shotId[i]);
+    to.source.push_back(source);
+    to.rpm.push_back(from.rpm[i]);
+    to.peakG.push_back(from.peakG[i]);
+    to.theta.push_back(from.theta[i]);
+    to.phi.push_back(from.phi[i]);
+    to.type.push_back(shotTypeCode(to, from.types[from.type[i]].c_str()));
+}
+
+template <typename T>
+static void permute(std::vector<T> &v, const std::vector<uint32_t> &order) {
+    std::vector<T> out(v.size());
+    for (size_t i = 0; i < order.size(); i++) out[i] = v[order[i]];
+    v.swap(out);
+}
+
+void shotSort(ShotIndex &ix) {
+    std::vector<uint32_t> order(ix.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (ix.wallMs[a] != ix.wallMs[b]) return ix.wallMs[a] < ix.wallMs[b];
+        if (ix.source[a] != ix.source[b]) return ix.source[a] < ix.source[b];
+        return ix.shotId[a] < ix.shotId[b];
+    });
+    permute(ix.wallMs, order);
+    permute(ix.deviceUs, order);
+    permute(ix.shotId, order);
+    permute(ix.source, order);
+    permute(ix.rpm, order);
+    permute(ix.peakG, order);
+    permute(ix.theta, order);
+    permute(ix.phi, order);
+    permute(ix.type, order);
+}
+
+// ==================== File ====================
+
+static size_t padded(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+// The whole file is assembled in memory (37 bytes per shot) and written at once
+struct Out {
+    std::vector<uint8_t> buf;
+
+    void put(const void* p, size_t n) {
+        const uint8_t* b = (const uint8_t*)p;
+        buf.insert(buf.end(), b, b + n);
+    }
+    template <typename T>
+    void column(const std::vector<T> &v) {
+        put(v.data(), v.size() * sizeof(T));
+        buf.resize(padded(buf.size()));
+    }
+};
+
+uint64_t shotIndexSave(const ShotIndex &ix, const char* path) {
+    Out o;
+    std::string paths;
+    std::vector<ShotSourceRecord> recs;
+    for (const ShotSource &s : ix.sources) {
+        ShotSourceRecord r = {};
+        r.kind = s.kind;
+        r.path = (uint32_t)paths.size();
+        r.session = s.session;
+        r.shots = s.shots;
+        r.mtime = s.mtime;
+        r.stamp = s.stamp;
+        recs.push_back(r);
+        paths.append(s.path.c_str(), s.path.size() + 1);
+    }
+    ShotIndexHeader h = {};
+    h.magic = SHOT_INDEX_MAGIC;
+    h.version = SHOT_INDEX_VERSION;
+    h.types = (uint16_t)ix.types.size();
+    h.sources = (uint32_t)recs.size();
+    h.pathBytes = (uint32_t)paths.size();
+    h.shots = ix.size();
+    h.builtAt = ix.builtAt;
+    o.put(&h, sizeof(h));
+    o.put(recs.data(), recs.size() * sizeof(ShotSourceRecord));
+    for (const std::string &t : ix.types) {
+        char name[SHOT_TYPE_NAME] = {};
+        strncpy(name, t.c_str(), sizeof(name) - 1);
+        o.put(name, sizeof(name));
+    }
+    o.put(paths.data(), paths.size());
+    o.buf.resize(padded(o.buf.size()));
+    o.column(ix.wallMs);
+    o.column(ix.deviceUs);
+    o.column(ix.shotId);
+    o.column(ix.source);
+    o.column(ix.rpm);
+    o.column(ix.peakG);
+    o.column(ix.theta);
+    o.column(ix.phi);
+    o.column(ix.type);
+    uint32_t crc = bsCrc32(0, o.buf.data(), o.buf.size());
+    o.put(&crc, sizeof(crc));
+
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp) return 0;
+    bool ok = fwrite(o.buf.data(), 1, o.buf.size(), fp) == o.buf.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), path) != 0) {
+        remove(tmp.c_str());
+        return 0;
+    }
+    return o.buf.size();
+}
+
+// Reads from a loaded file, failing once past the end
+struct In {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool           ok = true;
+
+    const uint8_t* take(size_t n) {
+        if (!ok || (size_t)(end - p) < n) {
+            ok = false;
+            return nullptr;
+        }
+        const uint8_t* at = p;
+        p += n;
+        return at;
+    }
+    template <typename T>
+    void column(std::vector<T> &v, size_t n, const uint8_t* base) {
+        const uint8_t* at = take(n * sizeof(T));
+        if (at) v.assign((const T*)at, (const T*)at + n);
+        if (ok) p = base + padded(p - base);
+    }
+};
+
+bool shotIndexLoad(ShotIndex &ix, const char* path, std::string &error) {
+    ix = ShotIndex();
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        error = strerror(errno);
+        return false;
+    }
+    std::vector<uint8_t> buf;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf.resize(size > 0 ? size : 0);
+    bool read = fread(buf.data(), 1, buf.size(), fp) == buf.size();
+    fclose(fp);
+    uint32_t crc;
+    if (!read || buf.size() < sizeof(ShotIndexHeader) + sizeof(crc)) {
+        error = "too short";
+        return false;
+    }
+    memcpy(&crc, buf.data() + buf.size() - sizeof(crc), sizeof(crc));
+    const ShotIndexHeader* h = (const ShotIndexHeader*)buf.data();
+    if (h->magic != SHOT_INDEX_MAGIC || h->version != SHOT_INDEX_VERSION) {
+        error = "not a shot index of this version";
+        return false;
+    }
+    if (bsCrc32(0, buf.data(), buf.size() - sizeof(crc)) != crc) {
+        error = "CRC mismatch";
+        return false;
+    }
+
+    const uint8_t* base = buf.data();
+    In in = {base + sizeof(ShotIndexHeader), base + buf.size() - sizeof(crc)};
+    const ShotSourceRecord* recs = (const ShotSourceRecord*)in.take(h->sources * sizeof(ShotSourceRecord));
+    const char* names = (const char*)in.take(h->types * SHOT_TYPE_NAME);
+    const char* paths = (const char*)in.take(h->pathBytes);
+    if (!in.ok || (h->pathBytes && paths[h->pathBytes - 1] != '\0')) {
+        error = "truncated";
+        return false;
+    }
+    in.p = base + padded(in.p - base);
+    for (uint32_t i = 0; i < h->sources; i++) {
+        ShotSource s;
+        s.kind = recs[i].kind;
+        s.path = recs[i].path < h->pathBytes ? paths + recs[i].path : "";
+        s.session = recs[i].session;
+        s.shots = recs[i].shots;
+        s.mtime = recs[i].mtime;
+        s.stamp = recs[i].stamp;
+        ix.sources.push_back(s);
+    }
+    for (uint16_t t = 0; t < h->types; t++) {
+        ix.types.push_back(std::string(names + t * SHOT_TYPE_NAME,
+                                       strnlen(names + t * SHOT_TYPE_NAME, SHOT_TYPE_NAME)));
+    }
+    ix.builtAt = h->builtAt;
+    size_t n = h->shots;
+    in.column(ix.wallMs, n, base);
+    in.column(ix.deviceUs, n, base);
+    in.column(ix.shotId, n, base);
+    in.column(ix.source, n, base);
+    in.column(ix.rpm, n, base);
+    in.column(ix.peakG, n, base);
+    in.column(ix.theta, n, base);
+    in.column(ix.phi, n, base);
+    in.column(ix.type, n, base);
+    if (!in.ok) {
+        error = "truncated";
+        ix = ShotIndex();
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (ix.source[i] >= ix.sources.size() || ix.type[i] >= ix.types.size()) {
+            error = "shot refers to a missing source or type";
+            ix = ShotIndex();
+            return false;
+        }
+    }
+    return true;
+}
+
+// ==================== Queries ====================
+
+void shotQuery(const ShotIndex &ix, const ShotQuery &q, std::vector<uint32_t> &out) {
+    out.clear();
+    size_t lo = std::lower_bound(ix.wallMs.begin(), ix.wallMs.end(), q.fromMs) - ix.wallMs.begin();
+    size_t hi = std::upper_bound(ix.wallMs.begin(), ix.wallMs.end(), q.toMs) - ix.wallMs.begin();
+    bool axis = q.thetaMin > 0 || q.thetaMax < 180 || q.phiMin > 0 || q.phiMax < 360;
+    int32_t t0 = (int32_t)lround(q.thetaMin * 100), t1 = (int32_t)lround(q.thetaMax * 100);
+    int32_t p0 = (int32_t)lround(q.phiMin * 100), p1 = (int32_t)lround(q.phiMax * 100);
+    bool sources = !q.sourceMask.empty();
+
+    const float* rpm = ix.rpm.data();
+    const float* g = ix.peakG.data();
+    const uint8_t* type = ix.type.data();
+    for (size_t i = lo; i < hi; i++) {
+        if (!((q.typeMask >> type[i]) & 1)) continue;
+        if (rpm[i] < q.rpmMin || rpm[i] > q.rpmMax || g[i] < q.gMin || g[i] > q.gMax) continue;
+        if (sources && !q.sourceMask[ix.source[i]]) continue;
+        if (axis && (ix.theta[i] == SHOT_NO_AXIS || ix.theta[i] < t0 || ix.theta[i] > t1 ||
+                     ix.phi[i] < p0 || ix.phi[i] > p1)) {
+            continue;
+        }
+        out.push_back((uint32_t)i);
+    }
+}
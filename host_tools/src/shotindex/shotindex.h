@@ -0,0 +1,132 @@
+/**
+ * Cross-session shot index (.ysx)
+ *
+ * One small file listing every shot of a set of session files and
+ * observer database sessions, so a query over a season never opens the
+ * sessions themselves. Shots are stored column by column and sorted by
+ * wall-clock time:
+ *
+ *   ShotIndexHeader
+ *   ShotSourceRecord[sources]   where each shot came from
+ *   char[types][16]             spin type names, by type code
+ *   char[pathBytes]             source paths, NUL-terminated
+ *   columns, each padded to 8 bytes:
+ *     int64_t  wallMs[n]        wall clock, ms since the epoch
+ *     int64_t  deviceUs[n]      shot time in the source's device clock
+ *     uint32_t shotId[n]        shot id within the source session
+ *     uint32_t source[n]
+ *     float    rpm[n], peakG[n]
+ *     int16_t  theta[n]         spin axis from +Z, 0.01 deg; SHOT_NO_AXIS if not spinning
+ *     uint16_t phi[n]           azimuth, 0.01 deg
+ *     uint8_t  type[n]
+ *   uint32_t crc                CRC32 of everything before it
+ *
+ * 37 bytes per shot. A query binary-searches wallMs for its time range
+ * and scans only that slice of the columns it filters on.
+ *
+ * A rebuild reuses the shots of sources that have not changed: files by
+ * size and modification time, database sessions by shot count and the
+ * highest shots.id.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+static const uint32_t SHOT_INDEX_MAGIC   = 0x58534259;  // "YBSX"
+static const uint16_t SHOT_INDEX_VERSION = 1;
+static const int16_t  SHOT_NO_AXIS       = -1;
+static const size_t   SHOT_TYPE_NAME     = 16;
+static const size_t   SHOT_TYPES_MAX     = 64;          // type filters are a 64-bit mask
+
+enum ShotSourceKind : uint8_t {
+    SHOT_SOURCE_FILE = 0,       // .ybs session file
+    SHOT_SOURCE_DB,             // one session of an observer database
+};
+
+struct ShotIndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t types;
+    uint32_t sources;
+    uint32_t pathBytes;
+    uint64_t shots;
+    int64_t  builtAt;           // time() of the build
+};
+
+struct ShotSourceRecord {
+    uint8_t  kind;              // ShotSourceKind
+    uint8_t  reserved[3];
+    uint32_t path;              // offset into the path table
+    uint32_t session;           // file header session / observer session id
+    uint32_t shots;
+    int64_t  mtime;             // file modification time (0 for a database session)
+    uint64_t stamp;             // file size / highest shots.id of the session
+};
+
+struct ShotSource {
+    uint8_t     kind = SHOT_SOURCE_FILE;
+    std::string path;
+    uint32_t    session = 0;
+    uint32_t    shots = 0;
+    int64_t     mtime = 0;
+    uint64_t    stamp = 0;
+};
+
+struct ShotIndex {
+    std::vector<ShotSource>  sources;
+    std::vector<std::string> types;
+    int64_t                  builtAt = 0;
+
+    // Columns, shot i across all of them
+    std::vector<int64_t>     wallMs;
+    std::vector<int64_t>     deviceUs;
+    std::vector<uint32_t>    shotId;
+    std::vector<uint32_t>    source;
+    std::vector<float>       rpm;
+    std::vector<float>       peakG;
+    std::vector<int16_t>     theta;
+    std::vector<uint16_t>    phi;
+    std::vector<uint8_t>     type;
+
+    size_t size() const { return wallMs.size(); }
+};
+
+// Type code for a spin type name, added on first use; SHOT_TYPES_MAX - 1
+// collects every name beyond the table
+uint8_t shotTypeCode(ShotIndex &ix, const char* name);
+
+// Appends one shot; theta / phi in degrees, negative theta for no axis
+void shotAppend(ShotIndex &ix, int64_t wallMs, int64_t deviceUs, uint32_t id, uint32_t source,
+                float rpm, float peakG, double theta, double phi, uint8_t type);
+
+// Copies shot i of from (its source renumbered to source)
+void shotCopy(ShotIndex &to, const ShotIndex &from, size_t i, uint32_t source);
+
+// Orders all columns by wall time (then source and shot id)
+void shotSort(ShotIndex &ix);
+
+// False with error set if the file is missing, damaged or of another version
+bool shotIndexLoad(ShotIndex &ix, const char* path, std::string &error);
+
+// Written to a temporary file and renamed over path; returns bytes written, 0 on error
+uint64_t shotIndexSave(const ShotIndex &ix, const char* path);
+
+// ==================== Queries ====================
+
+struct ShotQuery {
+    int64_t  fromMs = INT64_MIN;          // wall time range, inclusive
+    int64_t  toMs = INT64_MAX;
+    float    rpmMin = -1e30f, rpmMax = 1e30f;
+    float    gMin = -1e30f, gMax = 1e30f;
+    double   thetaMin = 0, thetaMax = 180;  // degrees; a narrower range drops shots without axis
+    double   phiMin = 0, phiMax = 360;
+    uint64_t typeMask = ~0ULL;            // bit per type code
+    std::vector<uint8_t> sourceMask;      // per source, empty = all
+};
+
+// Matching shots in time order
+void shotQuery(const ShotIndex &ix, const ShotQuery &q, std::vector<uint32_t> &out);
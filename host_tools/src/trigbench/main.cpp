@@ -0,0 +1,280 @@
+/**
+ * trigbench - serial link load of imu_logger's trigger mode
+ *
+ * Usage:
+ *   trigbench [--pre MS] [--post MS] [--heartbeat MS] [--threshold G | --flags]
+ *             [--baud N] in.ybs|in.csv ...
+ *   trigbench [options] --synthetic SECONDS
+ *
+ * Plays every session through what imu_logger would write for it: every
+ * sample (CSV rows, framed binary packets), and trigger mode (bstrigger.h,
+ * the logger's own code) with the same two formats. Prints the bytes per
+ * second of each, the reduction, the share of a --baud serial link
+ * (default 115200, 10 bits a byte) and how much of the session the
+ * windows covered.
+ *
+ * The trigger is the logger's: |accel| above --threshold (default 8 g);
+ * --flags uses the impact flags stored in the session instead. Samples
+ * are converted to the logger's fixed point (mg, 0.1 deg/s) first, so
+ * files from the ball (any scale) count as the logger would send them.
+ */
+
+#include "bsstream.h"
+#include "bstrigger.h"
+#include "sessionread.h"
+#include "trace.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: trigbench [--pre MS] [--post MS] [--heartbeat MS] [--threshold G | --flags]\n"
+            "                 [--baud N] in.ybs|in.csv ...\n"
+            "       trigbench [options] --synthetic SECONDS\n");
+    exit(2);
+}
+
+// imu_logger's output settings
+static const int      LOGGER_ACCEL_PER_G  = 1000;
+static const int      LOGGER_GYRO_PER_DPS = 10;
+static const uint16_t LOGGER_KEY_INTERVAL = 50;
+
+struct Options {
+    int    preMs = 300;
+    int    postMs = 700;
+    int    heartbeatMs = 1000;
+    double thresholdG = 8.0;
+    bool   flags = false;
+    int    baud = 115200;
+};
+
+struct Session {
+    std::vector<BsSample> samples;   // logger fixed point
+    uint16_t              rateHz = 200;
+};
+
+// ==================== Loading ====================
+
+static void onSample(void* ctx, const BsSample &s) {
+    ((std::vector<BsSample>*)ctx)->push_back(s);
+}
+static void onShot(void*, const BsShot &) {}
+
+// Header scales -> the logger's
+static void toLogger(std::vector<BsSample> &v, const BsFileHeader &h) {
+    double ka = LOGGER_ACCEL_PER_G / bsAccelPerG(h), kg = LOGGER_GYRO_PER_DPS / bsGyroPerDps(h);
+    for (BsSample &s : v) {
+        for (int k = 0; k < 3; k++) s.a[k] = traceFixed(s.a[k] * ka, 1.0);
+        for (int k = 0; k < 3; k++) s.g[k] = traceFixed(s.g[k] * kg, 1.0);
+    }
+}
+
+static bool loadYbs(const char* path, Session &out) {
+    SessionReader r;
+    if (!sessionOpen(r, path)) {
+        fprintf(stderr, "%s: %s\n", path, r.error);
+        return false;
+    }
+    SessionChunk c;
+    for (uint32_t i = 0; i < r.chunks; i++) {
+        if (!sessionLoadChunk(r, i, c)) {
+            fprintf(stderr, "%s: chunk %u is corrupt\n", path, i);
+            sessionClose(r);
+            return false;
+        }
+        for (size_t k = 0; k < c.t.size; k++) {
+            BsSample s = {};
+            s.tUs = c.t[k];
+            for (int a = 0; a < 3; a++) if (!c.col[a].empty()) s.a[a] = c.col[a][k];
+            for (int a = 0; a < 3; a++) if (!c.col[3 + a].empty()) s.g[a] = c.col[3 + a][k];
+            if (!c.flags.empty()) s.flags = c.flags[k];
+            out.samples.push_back(s);
+        }
+    }
+    if (r.header->sampleHz) out.rateHz = r.header->sampleHz;
+    toLogger(out.samples, *r.header);
+    sessionClose(r);
+    return true;
+}
+
+static bool loadCsv(const char* path, Session &out) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+    TraceLayout layout = traceSniffCsv(fp);
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, 0, traceColumns(layout), "csv");
+    TraceCallbacks cb = {onSample, onShot, &out.samples};
+    TraceStats st;
+    bool ok = traceReadCsv(fp, h, cb, st);
+    fclose(fp);
+    if (!ok) {
+        fprintf(stderr, "%s: not an imu_logger or dashboard CSV\n", path);
+        return false;
+    }
+    // Rate from the median sample spacing (CSV has no header for it)
+    size_t n = out.samples.size();
+    if (n > 2) {
+        std::vector<int64_t> d;
+        for (size_t i = 1; i < n; i++) d.push_back(out.samples[i].tUs - out.samples[i - 1].tUs);
+        std::nth_element(d.begin(), d.begin() + d.size() / 2, d.end());
+        if (d[d.size() / 2] > 0) out.rateHz = (uint16_t)llround(1e6 / d[d.size() / 2]);
+    }
+    toLogger(out.samples, h);
+    return true;
+}
+
+// ==================== Logger output ====================
+
+// Bytes imu_logger writes, one counter per format
+struct LinkBytes {
+    uint64_t        csv = 0;
+    uint64_t        bin = 0;
+    BsStreamEncoder enc;
+};
+
+static void countSample(void* ctx, const BsSample &s, bool first) {
+    LinkBytes &b = *(LinkBytes*)ctx;
+    // CSV row as imu_logger prints it
+    char row[160];
+    double ax = (double)s.a[0] / LOGGER_ACCEL_PER_G, ay = (double)s.a[1] / LOGGER_ACCEL_PER_G,
+           az = (double)s.a[2] / LOGGER_ACCEL_PER_G;
+    b.csv += snprintf(row, sizeof(row), "%lld,%.4f,%.4f,%.4f,%.2f,%.2f,%.2f,%.4f,%d\n",
+                      (long long)(s.tUs / 1000), ax, ay, az, (double)s.g[0] / LOGGER_GYRO_PER_DPS,
+                      (double)s.g[1] / LOGGER_GYRO_PER_DPS, (double)s.g[2] / LOGGER_GYRO_PER_DPS,
+                      sqrt(ax * ax + ay * ay + az * az), s.flags & BS_FLAG_IMPACT ? 1 : 0);
+    // Framed stream packet; a window starts with a keyframe
+    if (first) bsStreamKey(b.enc);
+    uint8_t packet[BS_STREAM_MAX];
+    b.bin += bsStreamEncode(b.enc, s, packet) + 3;
+}
+
+static void countText(void* ctx, const char*, size_t len) {
+    LinkBytes &b = *(LinkBytes*)ctx;
+    b.csv += len;
+    b.bin += len + 1;   // binary mode: the line starts after a newline
+}
+
+struct Result {
+    LinkBytes full, trig;
+    uint64_t  samples = 0, sent = 0, triggers = 0;
+    uint32_t  windows = 0;
+    double    seconds = 0;
+};
+
+static bool isTrigger(const Options &o, const BsSample &s) {
+    if (o.flags) return s.flags & BS_FLAG_IMPACT;
+    double a2 = 0;
+    for (int k = 0; k < 3; k++) a2 += (double)s.a[k] * s.a[k];
+    return sqrt(a2) / LOGGER_ACCEL_PER_G > o.thresholdG;
+}
+
+static Result run(const Options &o, const Session &ses) {
+    Result r;
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, ses.rateHz, BS_COLS_IMU, "imu_logger");
+    h.accelPerG = LOGGER_ACCEL_PER_G;
+    h.gyroPerDps = LOGGER_GYRO_PER_DPS;
+    bsStreamInit(r.full.enc, BS_COLS_IMU, 2, LOGGER_KEY_INTERVAL);
+    bsStreamInit(r.trig.enc, BS_COLS_IMU, 2, LOGGER_KEY_INTERVAL);
+
+    BsTrigger* t = new BsTrigger;
+    bsTrigInit(*t, (uint16_t)(o.preMs * ses.rateHz / 1000), (uint16_t)(o.postMs * ses.rateHz / 1000),
+               (uint16_t)(o.heartbeatMs * ses.rateHz / 1000), h);
+    BsTrigOutput out = {countSample, countText, &r.trig};
+    for (const BsSample &s : ses.samples) {
+        // The logger marks impacts with its own threshold in both modes
+        BsSample m = s;
+        bool trig = isTrigger(o, s);
+        m.flags = trig ? BS_FLAG_IMPACT : 0;
+        countSample(&r.full, m, false);
+        bsTrigPush(*t, m, trig, out);
+        r.triggers += trig;
+    }
+    r.samples = t->taken;
+    r.sent = t->sent;
+    r.windows = t->windows;
+    delete t;
+    if (ses.samples.size() > 1) {
+        r.seconds = (ses.samples.back().tUs - ses.samples.front().tUs) / 1e6 + 1.0 / ses.rateHz;
+    }
+    return r;
+}
+
+// ==================== Report ====================
+
+static void printRow(const char* name, uint64_t fullBytes, uint64_t trigBytes, double seconds, int baud) {
+    double link = baud / 10.0;
+    double full = fullBytes / seconds, trig = trigBytes / seconds;
+    printf("  %-8s %9.0f B/s (%5.1f%% of link)  %9.0f B/s (%5.1f%% of link)  %6.1fx less\n", name, full,
+           100.0 * full / link, trig, 100.0 * trig / link, trig > 0 ? full / trig : 0.0);
+}
+
+static void report(const char* name, const Options &o, const Result &r) {
+    if (r.seconds <= 0) {
+        printf("%s: no samples\n", name);
+        return;
+    }
+    printf("%s: %.1f s, %llu samples, %llu trigger samples, %u windows; sent %llu samples (%.1f%%)\n", name,
+           r.seconds, (unsigned long long)r.samples, (unsigned long long)r.triggers, r.windows,
+           (unsigned long long)r.sent, 100.0 * r.sent / (r.samples ? r.samples : 1));
+    printf("  %-8s %32s  %32s\n", "", "every sample", "trigger mode");
+    printRow("csv", r.full.csv, r.trig.csv, r.seconds, o.baud);
+    printRow("binary", r.full.bin, r.trig.bin, r.seconds, o.baud);
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+    Options o;
+    double synthSeconds = 0;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--pre") && more)              o.preMs = atoi(argv[++i]);
+        else if (!strcmp(a, "--post") && more)        o.postMs = atoi(argv[++i]);
+        else if (!strcmp(a, "--heartbeat") && more)   o.heartbeatMs = atoi(argv[++i]);
+        else if (!strcmp(a, "--threshold") && more)   o.thresholdG = atof(argv[++i]);
+        else if (!strcmp(a, "--flags"))               o.flags = true;
+        else if (!strcmp(a, "--baud") && more)        o.baud = atoi(argv[++i]);
+        else if (!strcmp(a, "--synthetic") && more)   synthSeconds = atof(argv[++i]);
+        else if (a[0] == '-')                         usage();
+        else                                          paths.push_back(a);
+    }
+    if (paths.empty() == !(synthSeconds > 0) || o.preMs < 0 || o.postMs < 0 || o.heartbeatMs < 0 ||
+        o.baud <= 0) {
+        usage();
+    }
+    printf("Trigger: %s, %d ms before, %d ms after, heartbeat every %d ms; link %d baud\n",
+           o.flags ? "stored impact flags" : "|accel| above threshold", o.preMs, o.postMs,
+           o.heartbeatMs, o.baud);
+
+    int status = 0;
+    if (synthSeconds > 0) {
+        Session ses;
+        BsFileHeader h;
+        bsFileHeaderInit(h, 0, ses.rateHz, BS_COLS_IMU, "synthetic");
+        TraceCallbacks cb = {onSample, onShot, &ses.samples};
+        TraceStats st;
+        traceSynthetic(synthSeconds, ses.rateHz, 1, h, cb, st);
+        report("synthetic", o, run(o, ses));
+    }
+    for (const char* path : paths) {
+        Session ses;
+        size_t n = strlen(path);
+        bool ybs = n > 4 && !strcmp(path + n - 4, ".ybs");
+        if (!(ybs ? loadYbs(path, ses) : loadCsv(path, ses))) {
+            status = 1;
+            continue;
+        }
+        report(path, o, run(o, ses));
+    }
+    return status;
+}
@@ -6,10 +6,27 @@
  *
  * Output format (CSV via Serial):
  *   timestamp_ms, accel_x, accel_y, accel_z, gyro_x, gyro_y, gyro_z, impact_flag
+ *
+ * Serial commands:
+ *   'b' - binary mode: one framed stream packet per sample (bsstream.h,
+ *         ~12 bytes instead of ~60), announced by a "# BINARY" line with
+ *         the fixed-point scales. Keyframe every 0.25 s.
+ *   'c' - back to CSV
+ *   't' - trigger mode (bstrigger.h): only windows around impacts are
+ *         sent at full rate, from PRE ms before the impact to POST ms
+ *         after the last one, each after a "# WINDOW" line; in between a
+ *         "# HB" heartbeat line once a second summarises what was held
+ *         back. Works with CSV and binary output.
+ *   'f' - full rate again (every sample)
+ *   <ms>p, <ms>a - pre-trigger / post-trigger window, e.g. "500p" "1000a"
+ *         (pre at most 1 s, post at most 327 s)
  */
 
 #include <M5Unified.h>
 #include <math.h>
+#include "esp_timer.h"
+#include "bsstream.h"
+#include "bstrigger.h"
 
 // --- Configuration ---
 static const uint32_t SAMPLE_INTERVAL_MS = 5;    // 200Hz sampling rate
@@ -22,6 +39,119 @@ static uint32_t sampleCount    = 0;
 static float    peakAccelG     = 0.0f;
 static bool     recording      = true;
 
+// --- Binary output ---
+static const int      BIN_ACCEL_PER_G  = 1000;  // mg, as the session files
+static const int      BIN_GYRO_PER_DPS = 10;    // 0.1 deg/s
+static const uint16_t BIN_KEY_INTERVAL = 50;    // 0.25s at 200Hz: a corrupted frame costs at most this
+static bool            binaryMode = false;
+static BsStreamEncoder binStream;
+
+// --- Trigger mode ---
+static const uint32_t TRIG_HEARTBEAT_MS  = 1000;
+static const uint32_t TRIG_WINDOW_MAX_MS = 0xFFFF * SAMPLE_INTERVAL_MS;  // bsTrigInit takes 16-bit sample counts
+static uint32_t  trigPreMs   = 300;
+static uint32_t  trigPostMs  = 700;
+static bool      triggerMode = false;
+static BsTrigger trigger;
+static uint32_t  cmdArg      = 0;    // digits typed before a command letter
+
+static int16_t toFixed(float v, float scale) {
+    float x = v * scale;
+    if (x > 32767.0f) return 32767;
+    if (x < -32768.0f) return -32768;
+    return (int16_t)lroundf(x);
+}
+
+static void startTrigger() {
+    BsFileHeader h;
+    bsFileHeaderInit(h, 0, 1000 / SAMPLE_INTERVAL_MS, BS_COLS_IMU, "imu_logger");
+    h.accelPerG = BIN_ACCEL_PER_G;
+    h.gyroPerDps = BIN_GYRO_PER_DPS;
+    bsTrigInit(trigger, trigPreMs / SAMPLE_INTERVAL_MS, trigPostMs / SAMPLE_INTERVAL_MS,
+               TRIG_HEARTBEAT_MS / SAMPLE_INTERVAL_MS, h);
+    triggerMode = true;
+    Serial.printf("%s# TRIGGER pre_ms=%lu post_ms=%lu heartbeat_ms=%lu threshold_g=%.1f\n",
+                  binaryMode ? "\n" : "", (unsigned long)(trigger.pre * SAMPLE_INTERVAL_MS),
+                  (unsigned long)(trigger.post * SAMPLE_INTERVAL_MS),
+                  (unsigned long)TRIG_HEARTBEAT_MS, IMPACT_THRESHOLD_G);
+}
+
+static void handleSerialCommand(int c) {
+    if (c >= '0' && c <= '9') {
+        if (cmdArg < 100000000) cmdArg = cmdArg * 10 + (c - '0');   // saturate rather than wrap
+        return;
+    }
+    uint32_t arg = cmdArg;
+    cmdArg = 0;
+    if (c == 'p' || c == 'a') {
+        // Clamped, not wrapped, into bsTrigInit's 16-bit counts (which cap pre further)
+        (c == 'p' ? trigPreMs : trigPostMs) = arg < TRIG_WINDOW_MAX_MS ? arg : TRIG_WINDOW_MAX_MS;
+        if (triggerMode) startTrigger();   // new window lengths from the next sample
+    } else if (c == 't') {
+        startTrigger();
+    } else if (c == 'f' && triggerMode) {
+        triggerMode = false;
+        Serial.printf("%s# FULL RATE\n", binaryMode ? "\n" : "");
+    } else if (c == 'b' && !binaryMode) {
+        Serial.printf("# BINARY columns=0x%04x accel_per_g=%d gyro_per_dps=%d rate=%lu\n",
+                      BS_COLS_IMU, BIN_ACCEL_PER_G, BIN_GYRO_PER_DPS,
+                      (unsigned long)(1000 / SAMPLE_INTERVAL_MS));
+        bsStreamInit(binStream, BS_COLS_IMU, 2, BIN_KEY_INTERVAL);
+        binaryMode = true;
+    } else if (c == 'c' && binaryMode) {
+        binaryMode = false;
+        Serial.println();
+        Serial.println("# CSV");
+    }
+}
+
+static BsSample fixedSample(int64_t tUs, float ax, float ay, float az,
+                            float gx, float gy, float gz, bool impact) {
+    BsSample s = {};
+    s.tUs = tUs;
+    s.a[0] = toFixed(ax, BIN_ACCEL_PER_G);
+    s.a[1] = toFixed(ay, BIN_ACCEL_PER_G);
+    s.a[2] = toFixed(az, BIN_ACCEL_PER_G);
+    s.g[0] = toFixed(gx, BIN_GYRO_PER_DPS);
+    s.g[1] = toFixed(gy, BIN_GYRO_PER_DPS);
+    s.g[2] = toFixed(gz, BIN_GYRO_PER_DPS);
+    s.flags = impact ? BS_FLAG_IMPACT : 0;
+    return s;
+}
+
+static void writeBinarySample(const BsSample &s) {
+    uint8_t packet[BS_STREAM_MAX];
+    uint8_t frame[BS_STREAM_MAX + 3];
+    size_t len = bsStreamEncode(binStream, s, packet);
+    Serial.write(frame, bsFramePut(frame, packet, (uint8_t)len));
+}
+
+static void writeCsvRow(uint32_t tMs, float ax, float ay, float az,
+                        float gx, float gy, float gz, float mag, bool impact) {
+    Serial.printf("%lu,%.4f,%.4f,%.4f,%.2f,%.2f,%.2f,%.4f,%d\n",
+                  tMs, ax, ay, az, gx, gy, gz, mag, impact ? 1 : 0);
+}
+
+// Trigger mode output: held samples come back in fixed point
+static void trigSample(void*, const BsSample &s, bool first) {
+    if (binaryMode) {
+        if (first) bsStreamKey(binStream);   // a receiver can join at any window
+        writeBinarySample(s);
+        return;
+    }
+    float ax = s.a[0] / (float)BIN_ACCEL_PER_G, ay = s.a[1] / (float)BIN_ACCEL_PER_G,
+          az = s.a[2] / (float)BIN_ACCEL_PER_G;
+    writeCsvRow((uint32_t)(s.tUs / 1000), ax, ay, az, s.g[0] / (float)BIN_GYRO_PER_DPS,
+                s.g[1] / (float)BIN_GYRO_PER_DPS, s.g[2] / (float)BIN_GYRO_PER_DPS,
+                sqrtf(ax * ax + ay * ay + az * az), s.flags & BS_FLAG_IMPACT);
+}
+
+static void trigText(void*, const char* line, size_t len) {
+    // Between binary frames a status line starts on a line of its own
+    if (binaryMode) Serial.write('\n');
+    Serial.write((const uint8_t*)line, len);
+}
+
 // Compute total acceleration magnitude in g
 static float accelMagnitudeG(float ax, float ay, float az) {
     return sqrtf(ax * ax + ay * ay + az * az);
@@ -66,6 +196,7 @@ void setup() {
 
 void loop() {
     M5.update();
+    while (Serial.available()) handleSerialCommand(Serial.read());
 
     // Button press toggles recording on/off
     if (M5.BtnA.wasPressed()) {
@@ -86,6 +217,7 @@ void loop() {
     m5::imu_data_t imuData;
     M5.Imu.update();
     M5.Imu.getImuData(&imuData);
+    int64_t sampleUs = esp_timer_get_time();
 
     float ax = imuData.accel.x;  // g
     float ay = imuData.accel.y;
@@ -99,9 +231,15 @@ void loop() {
 
     if (mag > peakAccelG) peakAccelG = mag;
 
-    // CSV output
-    Serial.printf("%lu,%.4f,%.4f,%.4f,%.2f,%.2f,%.2f,%.4f,%d\n",
-                  now, ax, ay, az, gx, gy, gz, mag, impact ? 1 : 0);
+    if (triggerMode) {
+        static const BsTrigOutput out = {trigSample, trigText, nullptr};
+        bsTrigPush(trigger, fixedSample(sampleUs, ax, ay, az, gx, gy, gz, impact), impact, out);
+    } else if (binaryMode) {
+        writeBinarySample(fixedSample(sampleUs, ax, ay, az, gx, gy, gz, impact));
+    } else {
+        // CSV output
+        writeCsvRow(now, ax, ay, az, gx, gy, gz, mag, impact);
+    }
 
     sampleCount++;
 
@@ -116,5 +254,6 @@ void loop() {
         M5.Display.printf("Gx:%.0f\n", gx);
         M5.Display.printf("Gy:%.0f\n", gy);
         M5.Display.printf("N:%lu", sampleCount);
+        if (triggerMode) M5.Display.printf("\nWin:%lu", (unsigned long)trigger.windows);
     }
 }
@@ -0,0 +1,295 @@
+/**
+ * Ball session file format - chunked, columnar, indexed
+ *
+ * Shared by the firmware (flash session log, export) and the host tools,
+ * so it only uses fixed-width little-endian structs and no allocation.
+ *
+ *   file    = BsFileHeader, chunk*, [pyramid], BsIndexEntry[chunks], BsTrailer
+ *   chunk   = BsChunkHeader, BsColumnDesc[ncols], column data,
+ *             BsShot[shotCount], BsChunkFooter
+ *   pyramid = BsPyramidHeader, BsSummary[level 0], BsSummary[level 1], ...,
+ *             BsPyramidFooter
+ *
+ * Each chunk holds up to 65535 samples as one array per column (time,
+ * accel x/y/z, gyro x/y/z, quaternion w/x/y/z, flags), either raw
+ * fixed-width (8-byte aligned, usable in place) or delta + zigzag
+ * varint. The footer carries the chunk's time range and shot ids; the
+ * index at the end of the file repeats them for every chunk, so readers
+ * can binary-search by time or shot id without touching sample data.
+ * Files without a trailer (capture still running, power loss) remain
+ * readable by walking the chunk headers.
+ *
+ * The optional pyramid holds min/max/mean summaries of |accel| and
+ * |gyro| over buckets of base << level samples (bspyramid.h), so an
+ * overview of any time range is drawn from about one summary per pixel.
+ *
+ * Sample values are fixed point; the scales live in the file header.
+ * Either the writer chose them (accelPerG LSB per g, ...), or, with
+ * BS_HEADER_FULL_SCALE set, the samples are the sensor's own counts and
+ * the header holds its full-scale range (32768 counts = accelPerG g):
+ * the device stores what the IMU gave it and nothing converts until a
+ * reader needs physical units (bsAccelRatio / bsAccelPerG below).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const uint32_t BS_FILE_MAGIC    = 0x46534259;  // "YBSF"
+static const uint32_t BS_CHUNK_MAGIC   = 0x4B434259;  // "YBCK"
+static const uint32_t BS_INDEX_MAGIC   = 0x49534259;  // "YBSI"
+static const uint32_t BS_PYRAMID_MAGIC = 0x50534259;  // "YBSP"
+static const uint16_t BS_VERSION       = 1;
+static const uint16_t BS_VERSION_FULL_SCALE = 2;  // BS_HEADER_FULL_SCALE set
+static const uint32_t BS_NO_SHOT       = 0xFFFFFFFF;
+
+// Column ids; a column mask has bit (1 << id) set per present column
+enum BsColumn : uint8_t {
+    BS_COL_T = 0,                         // int64 us
+    BS_COL_AX, BS_COL_AY, BS_COL_AZ,      // int16, accelPerG
+    BS_COL_GX, BS_COL_GY, BS_COL_GZ,      // int16, gyroPerDps
+    BS_COL_QW, BS_COL_QX, BS_COL_QY, BS_COL_QZ,  // int16, quatOne
+    BS_COL_FLAGS,                         // uint16, BS_FLAG_*
+    BS_COL_COUNT
+};
+
+static const uint16_t BS_COLS_IMU  = 0x087F;  // t, accel, gyro, flags
+static const uint16_t BS_COLS_ALL  = 0x0FFF;
+
+// Predictive encodings store the zigzagged residual r[i] = v[i] - p[i]:
+//   DELTA   p[i] = v[i-1]                          (v[-1] = 0)
+//   DELTA2  p[i] = 2 v[i-1] - v[i-2], DELTA for i < 2 (bsPredict)
+// VARINT writes each residual as a LEB128 varint; BITPACK packs blocks
+// of BS_PACK_BLOCK residuals at the width of the largest one (a width
+// byte, then the bits LSB first).
+enum BsEncoding : uint8_t {
+    BS_ENC_RAW            = 0,  // little-endian fixed width
+    BS_ENC_DELTA_VARINT   = 1,
+    BS_ENC_DELTA2_VARINT  = 2,
+    BS_ENC_DELTA_BITPACK  = 3,
+    BS_ENC_DELTA2_BITPACK = 4,
+    BS_ENC_COUNT,
+    BS_ENC_AUTO           = 0xFF,  // bsChunkEncode: smallest encoding per column
+};
+
+static const int BS_PACK_BLOCK = 16;
+
+static inline const char* bsEncodingName(uint8_t e) {
+    static const char* const NAMES[BS_ENC_COUNT] = {"raw", "delta", "delta2", "pack", "pack2"};
+    return e < BS_ENC_COUNT ? NAMES[e] : e == BS_ENC_AUTO ? "auto" : "?";
+}
+
+static const uint16_t BS_FLAG_IMPACT = 0x0001;
+
+struct BsFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerBytes;   // sizeof(BsFileHeader)
+    uint32_t session;
+    uint16_t sampleHz;      // nominal
+    uint16_t columns;       // mask of columns present in every chunk
+    uint16_t accelPerG;     // LSB per g (BS_HEADER_FULL_SCALE: full scale, g)
+    uint16_t gyroPerDps;    // LSB per deg/s (BS_HEADER_FULL_SCALE: full scale, deg/s)
+    uint16_t quatOne;       // LSB for 1.0
+    uint16_t flags;         // BS_HEADER_*
+    int64_t  startUs;       // device clock at session start
+    char     source[16];    // "ball_spin_webapp", "imu_logger", ...
+    uint32_t reserved;
+    uint32_t crc;           // CRC32 of the fields above
+};
+
+// Header flags
+static const uint16_t BS_HEADER_FULL_SCALE = 0x0001;  // accel / gyro are raw sensor counts
+static const int32_t  BS_FULL_SCALE_COUNTS = 32768;
+
+// Accel / gyro column scale as an exact ratio: g (deg/s) = count * num / den
+static inline void bsAccelRatio(const BsFileHeader &h, int32_t &num, int32_t &den) {
+    bool fs = h.flags & BS_HEADER_FULL_SCALE;
+    num = fs ? h.accelPerG : 1;
+    den = fs ? BS_FULL_SCALE_COUNTS : h.accelPerG;
+}
+static inline void bsGyroRatio(const BsFileHeader &h, int32_t &num, int32_t &den) {
+    bool fs = h.flags & BS_HEADER_FULL_SCALE;
+    num = fs ? h.gyroPerDps : 1;
+    den = fs ? BS_FULL_SCALE_COUNTS : h.gyroPerDps;
+}
+
+// Counts per g and per deg/s, whichever way the header states them
+static inline double bsAccelPerG(const BsFileHeader &h) {
+    int32_t num, den;
+    bsAccelRatio(h, num, den);
+    return (double)den / num;
+}
+static inline double bsGyroPerDps(const BsFileHeader &h) {
+    int32_t num, den;
+    bsGyroRatio(h, num, den);
+    return (double)den / num;
+}
+
+struct BsChunkHeader {
+    uint32_t magic;
+    uint32_t bytes;         // whole chunk including footer
+    uint16_t count;         // samples
+    uint16_t shotCount;
+    uint16_t columns;
+    uint8_t  ncols;
+    uint8_t  reserved;
+};
+
+struct BsColumnDesc {
+    uint8_t  id;            // BsColumn
+    uint8_t  encoding;      // BsEncoding
+    uint16_t reserved;
+    uint32_t offset;        // from chunk start
+    uint32_t bytes;
+};
+
+struct BsShot {
+    uint32_t id;            // per session, as in the WebSocket "shot" event
+    uint32_t reserved;
+    int64_t  tUs;           // impact time
+    float    peakRpm;
+    float    peakG;
+    float    gx, gy, gz;    // filtered gyro at peak, deg/s
+    char     spinType[12];
+};
+
+struct BsChunkFooter {
+    int64_t  tFirstUs;
+    int64_t  tLastUs;
+    uint64_t firstSample;   // session sample number of the first sample
+    uint32_t shotFirst;     // BS_NO_SHOT when the chunk holds no shot
+    uint32_t shotLast;
+    uint32_t count;
+    uint32_t crc;           // CRC32 of the chunk up to this field
+};
+
+struct BsIndexEntry {
+    uint64_t offset;        // chunk start in the file
+    int64_t  tFirstUs;
+    int64_t  tLastUs;
+    uint64_t firstSample;
+    uint32_t shotFirst;
+    uint32_t shotCount;
+};
+
+struct BsTrailer {
+    uint64_t indexOffset;
+    uint64_t samples;
+    uint32_t chunks;
+    uint32_t shots;
+    uint32_t flags;         // BS_TRAILER_*
+    uint32_t magic;         // BS_INDEX_MAGIC
+    uint32_t crc;           // CRC32 of the index entries and the fields above
+    uint32_t pyramidBytes;  // section right before the index (own CRC), 0 if none
+};
+
+static const uint32_t BS_TRAILER_INDEX_PARTIAL = 0x0001;  // index ran out of room
+static const uint32_t BS_TRAILER_PYRAMID       = 0x0002;  // pyramidBytes is valid
+
+// Summary channels: vector magnitudes in the file's fixed-point scales
+enum BsSummaryChannel : uint8_t {
+    BS_SUM_ACCEL = 0,       // |a|, accelPerG
+    BS_SUM_GYRO,            // |g|, gyroPerDps (rpm = |g| / 6 deg/s)
+    BS_SUM_COUNT
+};
+
+static const int BS_PYRAMID_LEVELS = 24;
+
+// One bucket of base << level consecutive samples
+struct BsSummary {
+    int64_t  tFirstUs;
+    uint32_t spanUs;        // last sample time - tFirstUs
+    uint32_t count;         // samples; short only in the last bucket of a level
+    uint16_t min[BS_SUM_COUNT];
+    uint16_t max[BS_SUM_COUNT];
+    uint16_t mean[BS_SUM_COUNT];
+    uint16_t impacts;       // samples flagged BS_FLAG_IMPACT
+    uint8_t  level;
+    uint8_t  reserved;
+};
+
+struct BsPyramidHeader {
+    uint32_t magic;
+    uint16_t base;          // samples per level-0 bucket, a power of two
+    uint8_t  levels;        // the last level has a single bucket
+    uint8_t  reserved;
+    uint64_t samples;
+    uint32_t counts[BS_PYRAMID_LEVELS];  // summaries per level
+};
+
+struct BsPyramidFooter {
+    uint32_t crc;           // CRC32 of the header and all summaries
+    uint32_t bytes;         // whole section
+};
+
+// One sample in builder form (all columns, unused ones ignored)
+struct BsSample {
+    int64_t  tUs;
+    int16_t  a[3];
+    int16_t  g[3];
+    int16_t  q[4];
+    uint16_t flags;
+};
+
+// ==================== Helpers ====================
+
+// CRC32 (IEEE, reflected); crc = 0 to start
+uint32_t bsCrc32(uint32_t crc, const void* data, size_t len);
+
+static inline uint32_t bsAlign8(uint32_t n) { return (n + 7) & ~7u; }
+static inline uint8_t  bsColumnWidth(uint8_t id) {
+    return id == BS_COL_T ? 8 : 2;
+}
+
+static inline uint64_t bsZigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t  bsUnzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static inline uint8_t bsPredictOrder(uint8_t encoding) {
+    return encoding == BS_ENC_DELTA2_VARINT || encoding == BS_ENC_DELTA2_BITPACK ? 2 : 1;
+}
+
+// Prediction of sample i from the previous two values (wrapping arithmetic)
+static inline int64_t bsPredict(uint8_t order, int64_t p1, int64_t p2, uint32_t i) {
+    if (i == 0) return 0;
+    if (order == 1 || i == 1) return p1;
+    return (int64_t)(2 * (uint64_t)p1 - (uint64_t)p2);
+}
+
+static inline uint8_t* bsPutVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+// Returns nullptr on a varint running past end
+static inline const uint8_t* bsGetVarint(const uint8_t* p, const uint8_t* end, uint64_t &v) {
+    // Most residuals fit one or two bytes
+    if (end - p >= 2 && !(p[0] & 0x80)) {
+        v = p[0];
+        return p + 1;
+    }
+    if (end - p >= 2 && !(p[1] & 0x80)) {
+        v = (p[0] & 0x7F) | ((uint64_t)p[1] << 7);
+        return p + 2;
+    }
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return p;
+    }
+    return nullptr;
+}
+
+void bsFileHeaderInit(BsFileHeader &h, uint32_t session, uint16_t sampleHz, uint16_t columns,
+                      const char* source);
+bool bsFileHeaderValid(const BsFileHeader &h);
+
+// Accel / gyro columns hold raw counts of a sensor set to +-accelFsG g and
+// +-gyroFsDps deg/s (sets BS_HEADER_FULL_SCALE and the version it needs)
+void bsFileHeaderSetFullScale(BsFileHeader &h, uint16_t accelFsG, uint16_t gyroFsDps);
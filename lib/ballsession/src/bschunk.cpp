@@ -0,0 +1,333 @@
+/**
+ * Chunk building, encoding and decoding - see bschunk.h
+ */
+
+#include "bschunk.h"
+#include <string.h>
+
+static const int BS_AXES = 10;  // int16 columns ax..qz
+
+size_t bsChunkStorageBytes(uint16_t capacity, uint16_t shotCapacity) {
+    return bsAlign8(capacity * 8) + BS_AXES * bsAlign8(capacity * 2) +
+           bsAlign8(capacity * 2) + shotCapacity * sizeof(BsShot);
+}
+
+void bsChunkInit(BsChunkBuilder &b, void* storage, uint16_t capacity, uint16_t shotCapacity,
+                 uint16_t columns) {
+    uint8_t* p = (uint8_t*)storage;
+    b.t = (int64_t*)p;
+    p += bsAlign8(capacity * 8);
+    for (int k = 0; k < BS_AXES; k++) {
+        b.col[k] = (int16_t*)p;
+        p += bsAlign8(capacity * 2);
+    }
+    b.flags = (uint16_t*)p;
+    p += bsAlign8(capacity * 2);
+    b.shots = (BsShot*)p;
+    b.capacity = capacity;
+    b.shotCapacity = shotCapacity;
+    b.columns = columns | (1u << BS_COL_T);
+    bsChunkReset(b, 0);
+}
+
+void bsChunkReset(BsChunkBuilder &b, uint64_t firstSample) {
+    b.count = 0;
+    b.shotCount = 0;
+    b.firstSample = firstSample;
+}
+
+bool bsChunkAdd(BsChunkBuilder &b, const BsSample &s) {
+    if (b.count >= b.capacity) return false;
+    uint16_t i = b.count++;
+    b.t[i] = s.tUs;
+    for (int k = 0; k < 3; k++) b.col[k][i] = s.a[k];
+    for (int k = 0; k < 3; k++) b.col[3 + k][i] = s.g[k];
+    for (int k = 0; k < 4; k++) b.col[6 + k][i] = s.q[k];
+    b.flags[i] = s.flags;
+    return true;
+}
+
+bool bsChunkAddShot(BsChunkBuilder &b, const BsShot &s) {
+    if (b.shotCount >= b.shotCapacity) return false;
+    b.shots[b.shotCount++] = s;
+    return true;
+}
+
+static int columnCount(uint16_t columns) {
+    int n = 0;
+    for (int id = 0; id < BS_COL_COUNT; id++) n += (columns >> id) & 1;
+    return n;
+}
+
+static uint32_t tableBytes(uint16_t columns) {
+    return bsAlign8(sizeof(BsChunkHeader) + columnCount(columns) * sizeof(BsColumnDesc));
+}
+
+size_t bsChunkMaxBytes(uint16_t count, uint16_t shotCount, uint16_t columns, uint8_t encoding) {
+    size_t n = tableBytes(columns);
+    for (int id = 0; id < BS_COL_COUNT; id++) {
+        if (!((columns >> id) & 1)) continue;
+        // varint of a 64-bit residual: 10 bytes; of a 19-bit int16 residual: 3.
+        // Bit-packed blocks stay below that plus one width byte.
+        size_t per = encoding == BS_ENC_RAW ? bsColumnWidth(id) : (id == BS_COL_T ? 10 : 3);
+        n += bsAlign8(count * per + (encoding == BS_ENC_RAW ? 0 : 1));
+    }
+    return n + shotCount * sizeof(BsShot) + sizeof(BsChunkFooter);
+}
+
+// Zigzagged prediction residuals of v[i, i + n)
+template <typename T>
+static void residualsOf(const T* v, uint8_t order, uint16_t i, int n, uint64_t* z) {
+    int64_t p1 = i > 0 ? v[i - 1] : 0;
+    int64_t p2 = i > 1 ? v[i - 2] : 0;
+    for (int k = 0; k < n; k++) {
+        int64_t x = v[i + k];
+        z[k] = bsZigzag((int64_t)((uint64_t)x - (uint64_t)bsPredict(order, p1, p2, i + k)));
+        p2 = p1;
+        p1 = x;
+    }
+}
+
+static void residuals(const BsChunkBuilder &b, uint8_t id, uint8_t order, uint16_t i, int n,
+                      uint64_t* z) {
+    if (id == BS_COL_T)          residualsOf(b.t, order, i, n, z);
+    else if (id == BS_COL_FLAGS) residualsOf(b.flags, order, i, n, z);
+    else                         residualsOf(b.col[id - BS_COL_AX], order, i, n, z);
+}
+
+static uint8_t* packBlock(const uint64_t* z, int n, uint8_t* p) {
+    uint64_t any = 0;
+    for (int k = 0; k < n; k++) any |= z[k];
+    int w = any ? 64 - __builtin_clzll(any) : 0;
+    *p++ = (uint8_t)w;
+    uint64_t acc = 0;
+    int bits = 0;
+    for (int k = 0; k < n; k++) {
+        uint64_t v = z[k];
+        for (int left = w; left > 0;) {
+            int take = left < 56 ? left : 56;    // acc holds < 8 bits here
+            acc |= (v & ((1ull << take) - 1)) << bits;
+            bits += take;
+            left -= take;
+            v >>= take;
+            for (; bits >= 8; bits -= 8, acc >>= 8) *p++ = (uint8_t)acc;
+        }
+    }
+    if (bits) *p++ = (uint8_t)acc;
+    return p;
+}
+
+static uint8_t* encodeColumn(const BsChunkBuilder &b, uint8_t id, uint8_t encoding, uint8_t* p) {
+    if (encoding == BS_ENC_RAW) {
+        const void* src = id == BS_COL_T ? (const void*)b.t
+                        : id == BS_COL_FLAGS ? (const void*)b.flags
+                        : (const void*)b.col[id - BS_COL_AX];
+        size_t bytes = (size_t)b.count * bsColumnWidth(id);
+        memcpy(p, src, bytes);
+        return p + bytes;
+    }
+    uint8_t order = bsPredictOrder(encoding);
+    bool pack = encoding == BS_ENC_DELTA_BITPACK || encoding == BS_ENC_DELTA2_BITPACK;
+    uint64_t z[BS_PACK_BLOCK];
+    for (uint16_t i = 0; i < b.count; i += BS_PACK_BLOCK) {
+        int n = b.count - i < BS_PACK_BLOCK ? b.count - i : BS_PACK_BLOCK;
+        residuals(b, id, order, i, n, z);
+        if (pack) {
+            p = packBlock(z, n, p);
+        } else {
+            for (int k = 0; k < n; k++) p = bsPutVarint(p, z[k]);
+        }
+    }
+    return p;
+}
+
+// Smallest encoding for a column (raw only wins for noise). Sizes come
+// from one residual pass per predictor; nothing is written.
+static uint8_t bestEncoding(const BsChunkBuilder &b, uint8_t id) {
+    uint8_t best = BS_ENC_RAW;
+    size_t bestBytes = (size_t)b.count * bsColumnWidth(id);
+    uint64_t z[BS_PACK_BLOCK];
+    for (uint8_t order = 1; order <= 2; order++) {
+        size_t varint = 0, packed = 0;
+        for (uint16_t i = 0; i < b.count; i += BS_PACK_BLOCK) {
+            int n = b.count - i < BS_PACK_BLOCK ? b.count - i : BS_PACK_BLOCK;
+            residuals(b, id, order, i, n, z);
+            uint64_t any = 0;
+            for (int k = 0; k < n; k++) {
+                int bits = z[k] ? 64 - __builtin_clzll(z[k]) : 1;
+                varint += (bits + 6) / 7;
+                any |= z[k];
+            }
+            int w = any ? 64 - __builtin_clzll(any) : 0;
+            packed += 1 + (n * w + 7) / 8;
+        }
+        uint8_t ev = order == 2 ? BS_ENC_DELTA2_VARINT : BS_ENC_DELTA_VARINT;
+        uint8_t ep = order == 2 ? BS_ENC_DELTA2_BITPACK : BS_ENC_DELTA_BITPACK;
+        if (varint < bestBytes) { best = ev; bestBytes = varint; }
+        if (packed < bestBytes) { best = ep; bestBytes = packed; }
+    }
+    return best;
+}
+
+size_t bsChunkEncode(const BsChunkBuilder &b, uint8_t encoding, uint8_t* out, size_t cap) {
+    uint8_t bound = encoding == BS_ENC_AUTO ? (uint8_t)BS_ENC_DELTA_VARINT : encoding;
+    if (cap < bsChunkMaxBytes(b.count, b.shotCount, b.columns, bound)) return 0;
+
+    BsChunkHeader h = {BS_CHUNK_MAGIC, 0, b.count, b.shotCount, b.columns,
+                       (uint8_t)columnCount(b.columns), 0};
+    BsColumnDesc* desc = (BsColumnDesc*)(out + sizeof(BsChunkHeader));
+    uint32_t off = tableBytes(b.columns);
+    memset(out, 0, off);
+
+    int n = 0;
+    for (uint8_t id = 0; id < BS_COL_COUNT; id++) {
+        if (!((b.columns >> id) & 1)) continue;
+        uint8_t e = encoding == BS_ENC_AUTO ? bestEncoding(b, id) : encoding;
+        uint8_t* end = encodeColumn(b, id, e, out + off);
+        uint32_t bytes = end - (out + off);
+        BsColumnDesc d = {id, e, 0, off, bytes};
+        memcpy(&desc[n++], &d, sizeof(d));
+        uint32_t next = bsAlign8(off + bytes);
+        memset(end, 0, next - (off + bytes));
+        off = next;
+    }
+
+    BsChunkFooter f = {};
+    f.count = b.count;
+    f.firstSample = b.firstSample;
+    f.tFirstUs = b.count ? b.t[0] : 0;
+    f.tLastUs = b.count ? b.t[b.count - 1] : 0;
+    f.shotFirst = f.shotLast = BS_NO_SHOT;
+    if (b.shotCount) {
+        memcpy(out + off, b.shots, b.shotCount * sizeof(BsShot));
+        off += b.shotCount * sizeof(BsShot);
+        f.shotFirst = b.shots[0].id;
+        f.shotLast = b.shots[b.shotCount - 1].id;
+    }
+
+    h.bytes = off + sizeof(BsChunkFooter);
+    memcpy(out, &h, sizeof(h));
+    memcpy(out + off, &f, sizeof(f));
+    f.crc = bsCrc32(0, out, h.bytes - sizeof(uint32_t));
+    memcpy(out + h.bytes - sizeof(uint32_t), &f.crc, sizeof(uint32_t));
+    return h.bytes;
+}
+
+// ==================== Reading ====================
+
+bool bsChunkValid(const uint8_t* chunk, size_t len) {
+    if (len < sizeof(BsChunkHeader) + sizeof(BsChunkFooter)) return false;
+    const BsChunkHeader* h = bsChunkHeader(chunk);
+    if (h->magic != BS_CHUNK_MAGIC || h->bytes > len || h->ncols > BS_COL_COUNT) return false;
+    uint32_t table = bsAlign8(sizeof(BsChunkHeader) + h->ncols * sizeof(BsColumnDesc));
+    uint32_t shotsAt = h->bytes - sizeof(BsChunkFooter) - h->shotCount * sizeof(BsShot);
+    if (h->bytes < table + sizeof(BsChunkFooter) + h->shotCount * sizeof(BsShot)) return false;
+
+    const BsColumnDesc* d = bsChunkColumns(chunk);
+    for (int i = 0; i < h->ncols; i++) {
+        if (d[i].id >= BS_COL_COUNT || d[i].offset < table ||
+            d[i].offset + d[i].bytes > shotsAt) return false;
+        if (d[i].encoding == BS_ENC_RAW &&
+            d[i].bytes != (uint32_t)h->count * bsColumnWidth(d[i].id)) return false;
+    }
+    const BsChunkFooter* f = bsChunkFooter(chunk);
+    return f->count == h->count && f->crc == bsCrc32(0, chunk, h->bytes - sizeof(uint32_t));
+}
+
+const BsColumnDesc* bsChunkFind(const uint8_t* chunk, uint8_t id) {
+    const BsChunkHeader* h = bsChunkHeader(chunk);
+    const BsColumnDesc* d = bsChunkColumns(chunk);
+    for (int i = 0; i < h->ncols; i++) {
+        if (d[i].id == id) return &d[i];
+    }
+    return nullptr;
+}
+
+// limit is the end of readable memory (the chunk), used by the fast path
+// that loads 8 bytes per value
+static const uint8_t* unpackBlock(const uint8_t* p, const uint8_t* end, const uint8_t* limit,
+                                  int n, uint64_t* z) {
+    if (p >= end || *p > 64) return nullptr;
+    int w = *p++;
+    size_t bytes = ((size_t)n * w + 7) / 8;
+    if ((size_t)(end - p) < bytes) return nullptr;
+    if (w <= 56 && (size_t)(limit - p) >= bytes + 8) {
+        uint64_t mask = (1ull << w) - 1;
+        for (int k = 0, pos = 0; k < n; k++, pos += w) {
+            uint64_t word;
+            memcpy(&word, p + (pos >> 3), 8);
+            z[k] = (word >> (pos & 7)) & mask;
+        }
+        return p + bytes;
+    }
+    uint64_t acc = 0;
+    int bits = 0;
+    for (int k = 0; k < n; k++) {
+        uint64_t v = 0;
+        for (int got = 0; got < w;) {
+            if (bits == 0) {
+                acc = *p++;
+                bits = 8;
+            }
+            int take = w - got < bits ? w - got : bits;
+            v |= (acc & ((1ull << take) - 1)) << got;
+            acc >>= take;
+            bits -= take;
+            got += take;
+        }
+        z[k] = v;
+    }
+    return p;
+}
+
+// Inverse of residuals(): out[i, i + n) from the residuals and the
+// previous two values
+template <typename T>
+static void reconstruct(const uint64_t* z, int n, uint32_t i, uint8_t order, int64_t &p1,
+                        int64_t &p2, T* out) {
+    int k = 0;
+    for (; k < n && (i + k < 2 || order == 1); k++) {
+        int64_t v = (int64_t)((uint64_t)bsPredict(1, p1, p2, i + k) + (uint64_t)bsUnzigzag(z[k]));
+        p2 = p1;
+        p1 = v;
+        out[i + k] = (T)v;
+    }
+    for (; k < n; k++) {
+        int64_t v = (int64_t)(2 * (uint64_t)p1 - (uint64_t)p2 + (uint64_t)bsUnzigzag(z[k]));
+        p2 = p1;
+        p1 = v;
+        out[i + k] = (T)v;
+    }
+}
+
+bool bsChunkDecode(const uint8_t* chunk, const BsColumnDesc &c, void* out) {
+    uint16_t count = bsChunkHeader(chunk)->count;
+    const uint8_t* p = chunk + c.offset;
+    if (c.encoding == BS_ENC_RAW) {
+        memcpy(out, p, (size_t)count * bsColumnWidth(c.id));
+        return true;
+    }
+    if (c.encoding >= BS_ENC_COUNT) return false;
+
+    const uint8_t* end = p + c.bytes;
+    const uint8_t* limit = chunk + bsChunkHeader(chunk)->bytes;
+    uint8_t order = bsPredictOrder(c.encoding);
+    bool pack = c.encoding == BS_ENC_DELTA_BITPACK || c.encoding == BS_ENC_DELTA2_BITPACK;
+    int64_t p1 = 0, p2 = 0;
+    uint64_t z[BS_PACK_BLOCK];
+    for (uint16_t i = 0; i < count; i += BS_PACK_BLOCK) {
+        int n = count - i < BS_PACK_BLOCK ? count - i : BS_PACK_BLOCK;
+        if (pack) {
+            p = unpackBlock(p, end, limit, n, z);
+            if (!p) return false;
+        } else {
+            for (int k = 0; k < n; k++) {
+                p = bsGetVarint(p, end, z[k]);
+                if (!p) return false;
+            }
+        }
+        if (c.id == BS_COL_T) reconstruct(z, n, i, order, p1, p2, (int64_t*)out);
+        else                  reconstruct(z, n, i, order, p1, p2, (int16_t*)out);
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+/**
+ * Chunk building, encoding and decoding - see ballsession.h for the layout
+ *
+ * The builder keeps samples column-wise in caller-provided storage
+ * (a static buffer on the device, a vector on the host), so adding a
+ * sample is a handful of stores and encoding walks each column once.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+
+struct BsChunkBuilder {
+    int64_t*  t;
+    int16_t*  col[10];       // ax, ay, az, gx, gy, gz, qw, qx, qy, qz
+    uint16_t* flags;
+    BsShot*   shots;
+    uint16_t  capacity;
+    uint16_t  shotCapacity;
+    uint16_t  count;
+    uint16_t  shotCount;
+    uint16_t  columns;       // mask written by bsChunkEncode
+    uint64_t  firstSample;   // session sample number of sample 0
+};
+
+// Storage bytes bsChunkInit needs for the given capacities
+size_t bsChunkStorageBytes(uint16_t capacity, uint16_t shotCapacity);
+
+// Carves the column arrays from storage (8-byte aligned, storageBytes above)
+void bsChunkInit(BsChunkBuilder &b, void* storage, uint16_t capacity, uint16_t shotCapacity,
+                 uint16_t columns);
+
+// Starts the next chunk; firstSample continues the session numbering
+void bsChunkReset(BsChunkBuilder &b, uint64_t firstSample);
+
+// False when full (flush and reset first)
+bool bsChunkAdd(BsChunkBuilder &b, const BsSample &s);
+bool bsChunkAddShot(BsChunkBuilder &b, const BsShot &s);
+
+static inline bool bsChunkFull(const BsChunkBuilder &b) { return b.count >= b.capacity; }
+
+// Upper bound of the encoded size for count samples / shots
+size_t bsChunkMaxBytes(uint16_t count, uint16_t shotCount, uint16_t columns, uint8_t encoding);
+
+// Encodes the chunk into out; returns bytes written, 0 if cap is too small
+size_t bsChunkEncode(const BsChunkBuilder &b, uint8_t encoding, uint8_t* out, size_t cap);
+
+// ==================== Reading ====================
+
+// Magic, size, column table and CRC check of a chunk of at most len bytes
+bool bsChunkValid(const uint8_t* chunk, size_t len);
+
+static inline const BsChunkHeader* bsChunkHeader(const uint8_t* chunk) {
+    return (const BsChunkHeader*)chunk;
+}
+static inline const BsColumnDesc* bsChunkColumns(const uint8_t* chunk) {
+    return (const BsColumnDesc*)(chunk + sizeof(BsChunkHeader));
+}
+static inline const BsChunkFooter* bsChunkFooter(const uint8_t* chunk) {
+    return (const BsChunkFooter*)(chunk + bsChunkHeader(chunk)->bytes - sizeof(BsChunkFooter));
+}
+static inline const BsShot* bsChunkShots(const uint8_t* chunk) {
+    return (const BsShot*)((const uint8_t*)bsChunkFooter(chunk) -
+                           bsChunkHeader(chunk)->shotCount * sizeof(BsShot));
+}
+
+// Column descriptor for id, nullptr when the column is absent
+const BsColumnDesc* bsChunkFind(const uint8_t* chunk, uint8_t id);
+
+// Decodes a column into out (count values of bsColumnWidth(id) bytes);
+// false on a malformed column
+bool bsChunkDecode(const uint8_t* chunk, const BsColumnDesc &c, void* out);
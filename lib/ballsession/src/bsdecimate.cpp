@@ -0,0 +1,167 @@
+/**
+ * Decimation filter bank - see bsdecimate.h
+ */
+
+#include "bsdecimate.h"
+#include <math.h>
+#include <string.h>
+
+// bsDecPush runs on every 200Hz tick on the ball; same placement as bspipeline
+#if defined(ARDUINO) && (!defined(HOT_IRAM) || HOT_IRAM)
+#include <esp_attr.h>
+#define BS_HOT IRAM_ATTR
+#else
+#define BS_HOT
+#endif
+
+// ==================== Design ====================
+
+// Hamming-windowed sinc, cutoff at half the output rate, unity DC gain
+static void designLowpass(BsDecBranch &b) {
+    if (b.taps == 1) {
+        b.coef[0] = 1.0f;
+        return;
+    }
+    double fc = 0.5 / b.factor;
+    double mid = (b.taps - 1) / 2.0;
+    double sum = 0.0;
+    double c[BS_DEC_MAX_TAPS];
+    for (int k = 0; k < b.taps; k++) {
+        double m = k - mid;
+        double h = m == 0.0 ? 2.0 * fc : sin(2.0 * M_PI * fc * m) / (M_PI * m);
+        double w = 0.54 - 0.46 * cos(2.0 * M_PI * k / (b.taps - 1));
+        c[k] = h * w;
+        sum += c[k];
+    }
+    for (int k = 0; k < b.taps; k++) b.coef[k] = (float)(c[k] / sum);
+}
+
+void bsDecInit(BsDecimator &d) {
+    memset(&d, 0, sizeof(d));
+}
+
+int bsDecAddBranch(BsDecimator &d, uint8_t factor, uint16_t taps) {
+    if (d.branches >= BS_DEC_MAX_BRANCHES || factor == 0) return -1;
+    if (factor == 1) taps = 1;
+    if (taps == 0 || taps > BS_DEC_MAX_TAPS) return -1;
+    BsDecBranch &b = d.b[d.branches];
+    memset(&b, 0, sizeof(b));
+    b.factor = factor;
+    b.taps = taps;
+    designLowpass(b);
+    if (taps > d.span) d.span = taps;
+    bsDecReset(d);
+    return d.branches++;
+}
+
+void bsDecReset(BsDecimator &d) {
+    memset(d.hist, 0, sizeof(d.hist));
+    memset(d.tags, 0, sizeof(d.tags));
+    d.head = 0;
+    d.tagHead = 0;
+    d.inputs = 0;
+    for (int k = 0; k < d.branches; k++) {
+        d.b[k].phase = 0;
+        d.b[k].pendingFlags = 0;
+        d.b[k].outputs = 0;
+        memset(d.b[k].out, 0, sizeof(d.b[k].out));
+        memset(&d.b[k].outTag, 0, sizeof(d.b[k].outTag));
+    }
+}
+
+// ==================== Filtering ====================
+
+// Symmetric taps: fold the two halves of the window, taps / 2 multiplies
+static inline BS_HOT float firFolded(const float* x, const float* c, int n) {
+    float acc = 0.0f;
+    int i = 0, j = n - 1;
+    for (; i < j; i++, j--) acc += c[i] * (x[i] + x[j]);
+    if (i == j) acc += c[i] * x[i];
+    return acc;
+}
+
+// Tag of the input `lag` inputs before the newest; the oldest seen while
+// the ring is still filling
+static inline BS_HOT const BsDecTag &tagAt(const BsDecimator &d, uint32_t lag) {
+    if (lag >= d.inputs) lag = d.inputs - 1;
+    int i = (int)d.tagHead - 1 - (int)lag;
+    if (i < 0) i += BS_DEC_TAG_RING;
+    return d.tags[i];
+}
+
+// Centre of the branch's window: mean time, normalised mean quaternion
+static BS_HOT void centreTag(const BsDecimator &d, BsDecBranch &b) {
+    const BsDecTag &newer = tagAt(d, (b.taps - 1) / 2);
+    const BsDecTag &older = tagAt(d, b.taps / 2);
+    b.outTag.tUs = newer.tUs - (newer.tUs - older.tUs) / 2;
+    float dot = 0.0f;
+    for (int i = 0; i < 4; i++) dot += newer.q[i] * older.q[i];
+    float sign = dot < 0.0f ? -1.0f : 1.0f;   // same hemisphere before averaging
+    float n = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        b.outTag.q[i] = newer.q[i] + sign * older.q[i];
+        n += b.outTag.q[i] * b.outTag.q[i];
+    }
+    n = n > 0.0f ? 1.0f / sqrtf(n) : 0.0f;
+    for (int i = 0; i < 4; i++) b.outTag.q[i] *= n;
+}
+
+BS_HOT uint32_t bsDecPush(BsDecimator &d, const float in[BS_DEC_CHANNELS], const BsDecTag* tag) {
+    if (d.span == 0) return 0;
+    for (int c = 0; c < BS_DEC_CHANNELS; c++) {
+        d.hist[c][d.head] = in[c];
+        d.hist[c][d.head + d.span] = in[c];
+    }
+    if (++d.head == d.span) d.head = 0;
+    if (tag) {
+        d.tags[d.tagHead] = *tag;
+        if (++d.tagHead == BS_DEC_TAG_RING) d.tagHead = 0;
+    }
+    d.inputs++;
+
+    uint32_t ready = 0;
+    for (int k = 0; k < d.branches; k++) {
+        BsDecBranch &b = d.b[k];
+        // The input that just came within half an output period of the
+        // centre: its flags go to the output nearest to it
+        int near = (b.taps - b.factor + 1) / 2;
+        uint32_t crossed = near > 0 ? near : 0;
+        if (tag && crossed < d.inputs) b.pendingFlags |= tagAt(d, crossed).flags;
+        if (++b.phase < b.factor) continue;
+        b.phase = 0;
+        // Newest b.taps samples end at head + span
+        int start = d.head + d.span - b.taps;
+        for (int c = 0; c < BS_DEC_CHANNELS; c++) {
+            b.out[c] = firFolded(&d.hist[c][start], b.coef, b.taps);
+        }
+        if (tag) {
+            centreTag(d, b);
+            b.outTag.flags = b.pendingFlags;
+            b.pendingFlags = 0;
+        }
+        b.outputs++;
+        ready |= 1u << k;
+    }
+    return ready;
+}
+
+// ==================== Queries ====================
+
+float bsDecDelay(const BsDecimator &d, int branch) {
+    return (d.b[branch].taps - 1) * 0.5f;
+}
+
+float bsDecGain(const BsDecimator &d, int branch, float f) {
+    const BsDecBranch &b = d.b[branch];
+    double re = 0.0, im = 0.0;
+    for (int k = 0; k < b.taps; k++) {
+        re += b.coef[k] * cos(2.0 * M_PI * f * k);
+        im -= b.coef[k] * sin(2.0 * M_PI * f * k);
+    }
+    return (float)sqrt(re * re + im * im);
+}
+
+float bsDecRpm(const BsDecimator &d, int branch) {
+    const float* o = d.b[branch].out;
+    return sqrtf(o[3] * o[3] + o[4] * o[4] + o[5] * o[5]) / 6.0f;
+}
@@ -0,0 +1,94 @@
+/**
+ * Decimation filter bank - several output rates from one sample stream
+ *
+ * Consumers that run slower than the 200Hz sample tick (the 50Hz stream,
+ * the ~30Hz screen) used to take the latest sample, or an exponential
+ * average of it, at their own tick; whatever the signal held above half
+ * their rate folded back into the band they show. Here every branch is a
+ * linear-phase FIR low-pass with its cutoff at half its output rate
+ * (Hamming-windowed sinc, unity DC gain), evaluated only once per
+ * `factor` inputs (polyphase: no output is computed that is thrown
+ * away), so a branch costs taps / factor multiply-adds per input and
+ * channel. All branches read one shared delay line.
+ *
+ * Channels: ax, ay, az (g) and gx, gy, gz (deg/s). The quaternion is a
+ * state, not a signal, and is not filtered.
+ *
+ * A branch's output lags its newest input by (taps - 1) / 2 samples (the
+ * group delay, the same at every frequency). Inputs can carry a tag (time,
+ * quaternion, flags); each output then gets the tag of the instant it
+ * describes - the time and quaternion at the window's centre (the mean
+ * of the two middle inputs for even taps), and the flags of the inputs
+ * it is the nearest output to (the factor inputs around the centre) - so a
+ * consumer stamping an output with its newest input would be
+ * (taps - 1) / 2 samples early against its own values. At taps = 6 * factor the
+ * response is flat within 0.2 dB up to a quarter of the output rate and
+ * everything that would alias onto that band is at least 36 dB down;
+ * fewer taps trade rejection for delay (filterbench prints the table).
+ *
+ * No allocation, no platform calls: the firmware and the host tools
+ * (replaying stored 200Hz samples) run the same bank.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+static const int BS_DEC_CHANNELS     = 6;    // ax ay az gx gy gz
+static const int BS_DEC_MAX_TAPS     = 48;
+static const int BS_DEC_MAX_BRANCHES = 4;
+static const int BS_DEC_TAG_RING     = BS_DEC_MAX_TAPS / 2 + 1;   // inputs back to the centre
+
+// What an input was read at; filtered outputs get the centre's
+struct BsDecTag {
+    int64_t  tUs;
+    float    q[4];                     // w x y z
+    uint16_t flags;                    // BsSample flags
+};
+
+struct BsDecBranch {
+    float    coef[BS_DEC_MAX_TAPS];
+    float    out[BS_DEC_CHANNELS];     // latest output
+    uint16_t taps;
+    uint8_t  factor;
+    uint8_t  phase;                    // inputs since the last output
+    uint16_t pendingFlags;             // for the next output
+    uint32_t outputs;
+    BsDecTag outTag;                   // latest output's (tagged inputs only)
+};
+
+struct BsDecimator {
+    // Each input is stored twice, span apart, so the newest span samples
+    // are always contiguous (oldest first) at hist[c][head..head+span)
+    float       hist[BS_DEC_CHANNELS][2 * BS_DEC_MAX_TAPS];
+    uint16_t    head;
+    uint16_t    span;                  // longest branch's taps
+    uint8_t     branches;
+    uint8_t     tagHead;               // next tags slot
+    uint32_t    inputs;
+    BsDecTag    tags[BS_DEC_TAG_RING]; // newest inputs' tags
+    BsDecBranch b[BS_DEC_MAX_BRANCHES];
+};
+
+void bsDecInit(BsDecimator &d);
+
+// Adds a branch giving one output per `factor` inputs (factor 1: taps is
+// forced to 1, the input passes through). Clears the history. Returns
+// the branch index, or -1 if the bank is full or taps out of range.
+int bsDecAddBranch(BsDecimator &d, uint8_t factor, uint16_t taps);
+
+// Zero history and output phases, branches kept (a new stream starts)
+void bsDecReset(BsDecimator &d);
+
+// One input sample; returns the branches with a new output, bit k = branch k.
+// Pass a tag with every input or with none (outTag then stays zero).
+uint32_t bsDecPush(BsDecimator &d, const float in[BS_DEC_CHANNELS], const BsDecTag* tag = nullptr);
+
+// Group delay of a branch in input samples
+float bsDecDelay(const BsDecimator &d, int branch);
+
+// Magnitude response of a branch at f (cycles per input sample, 0..0.5)
+float bsDecGain(const BsDecimator &d, int branch, float f);
+
+// |gyro| of a branch's latest output / 6: RPM as bsFuse computes it
+float bsDecRpm(const BsDecimator &d, int branch);
@@ -0,0 +1,196 @@
+/**
+ * Session file writer and shared helpers - see bsfile.h
+ */
+
+#include "bsfile.h"
+#include "bschunk.h"
+#include <string.h>
+
+#ifdef ARDUINO
+// Device: 64-byte nibble table, a few KB per chunk is all it checksums
+uint32_t bsCrc32(uint32_t crc, const void* data, size_t len) {
+    static const uint32_t NIBBLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+        0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ NIBBLE[crc & 0x0F];
+        crc = (crc >> 4) ^ NIBBLE[crc & 0x0F];
+    }
+    return ~crc;
+}
+#else
+// Host: slicing-by-8 so checksumming keeps up with multi-GB files
+static uint32_t crcTable[8][256];
+
+static bool crcTableInit() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320 & -(c & 1));
+        crcTable[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            crcTable[t][i] = (crcTable[t - 1][i] >> 8) ^ crcTable[0][crcTable[t - 1][i] & 0xFF];
+        }
+    }
+    return true;
+}
+
+uint32_t bsCrc32(uint32_t crc, const void* data, size_t len) {
+    static const bool ready = crcTableInit();
+    (void)ready;
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = crcTable[7][lo & 0xFF] ^ crcTable[6][(lo >> 8) & 0xFF] ^
+              crcTable[5][(lo >> 16) & 0xFF] ^ crcTable[4][lo >> 24] ^
+              crcTable[3][hi & 0xFF] ^ crcTable[2][(hi >> 8) & 0xFF] ^
+              crcTable[1][(hi >> 16) & 0xFF] ^ crcTable[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = (crc >> 8) ^ crcTable[0][(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+#endif
+
+void bsFileHeaderInit(BsFileHeader &h, uint32_t session, uint16_t sampleHz, uint16_t columns,
+                      const char* source) {
+    memset(&h, 0, sizeof(h));
+    h.magic = BS_FILE_MAGIC;
+    h.version = BS_VERSION;
+    h.headerBytes = sizeof(BsFileHeader);
+    h.session = session;
+    h.sampleHz = sampleHz;
+    h.columns = columns | (1u << BS_COL_T);
+    h.accelPerG = 1000;
+    h.gyroPerDps = 10;
+    h.quatOne = 16384;
+    strncpy(h.source, source, sizeof(h.source) - 1);
+}
+
+void bsFileHeaderSetFullScale(BsFileHeader &h, uint16_t accelFsG, uint16_t gyroFsDps) {
+    // Version 2 so that readers predating the flag refuse the file rather
+    // than read counts as mg
+    h.version = BS_VERSION_FULL_SCALE;
+    h.flags |= BS_HEADER_FULL_SCALE;
+    h.accelPerG = accelFsG;
+    h.gyroPerDps = gyroFsDps;
+}
+
+bool bsFileHeaderValid(const BsFileHeader &h) {
+    bool fs = h.flags & BS_HEADER_FULL_SCALE;
+    return h.magic == BS_FILE_MAGIC && h.version == (fs ? BS_VERSION_FULL_SCALE : BS_VERSION) &&
+           h.accelPerG && h.gyroPerDps &&
+           h.headerBytes == sizeof(BsFileHeader) &&
+           h.crc == bsCrc32(0, &h, offsetof(BsFileHeader, crc));
+}
+
+// ==================== Writer ====================
+
+static void put(BsFileWriter &w, const void* data, size_t len) {
+    if (w.failed) return;
+    if (w.write(w.ctx, data, len) != len) w.failed = true;
+    w.offset += len;
+}
+
+void bsFileBegin(BsFileWriter &w, const BsFileHeader &h, BsWriteFn write, void* ctx,
+                 BsIndexEntry* index, uint32_t indexCapacity) {
+    memset(&w, 0, sizeof(w));
+    w.write = write;
+    w.ctx = ctx;
+    w.index = index;
+    w.indexCapacity = indexCapacity;
+    BsFileHeader hc = h;
+    hc.crc = bsCrc32(0, &hc, offsetof(BsFileHeader, crc));
+    put(w, &hc, sizeof(hc));
+}
+
+bool bsFileAddChunk(BsFileWriter &w, const uint8_t* chunk) {
+    const BsChunkHeader* h = bsChunkHeader(chunk);
+    const BsChunkFooter* f = bsChunkFooter(chunk);
+    if (w.chunks < w.indexCapacity) {
+        BsIndexEntry &e = w.index[w.chunks];
+        e.offset = w.offset;
+        e.tFirstUs = f->tFirstUs;
+        e.tLastUs = f->tLastUs;
+        e.firstSample = f->firstSample;
+        e.shotFirst = f->shotFirst;
+        e.shotCount = h->shotCount;
+    } else {
+        w.indexPartial = true;
+    }
+    put(w, chunk, h->bytes);
+    w.chunks++;
+    w.shots += h->shotCount;
+    w.samples += h->count;
+    return !w.failed;
+}
+
+void bsFilePyramidBegin(BsFileWriter &w, const BsPyramidHeader &h) {
+    w.pyramidStart = w.offset;
+    w.pyramidCrc = bsCrc32(0, &h, sizeof(h));
+    put(w, &h, sizeof(h));
+}
+
+void bsFilePyramidAdd(BsFileWriter &w, const BsSummary* s, uint32_t n) {
+    w.pyramidCrc = bsCrc32(w.pyramidCrc, s, n * sizeof(BsSummary));
+    put(w, s, n * sizeof(BsSummary));
+}
+
+bool bsFilePyramidEnd(BsFileWriter &w) {
+    BsPyramidFooter f = {w.pyramidCrc, 0};
+    f.bytes = (uint32_t)(w.offset + sizeof(f) - w.pyramidStart);
+    put(w, &f, sizeof(f));
+    w.pyramidBytes = f.bytes;
+    return !w.failed;
+}
+
+void bsFileIndexBegin(BsFileWriter &w) {
+    w.indexStreaming = true;
+    w.indexStart = w.offset;
+    w.indexCrc = 0;
+    w.indexStreamed = 0;
+}
+
+void bsFileIndexAdd(BsFileWriter &w, const BsIndexEntry &e) {
+    w.indexCrc = bsCrc32(w.indexCrc, &e, sizeof(e));
+    put(w, &e, sizeof(e));
+    w.indexStreamed++;
+}
+
+bool bsFileEnd(BsFileWriter &w) {
+    BsTrailer t = {};
+    uint32_t crc;
+    bool partial;
+    if (w.indexStreaming) {
+        partial = w.indexStreamed != w.chunks;
+        t.indexOffset = w.indexStart;
+        crc = w.indexCrc;
+    } else {
+        uint32_t entries = w.indexPartial ? w.indexCapacity : w.chunks;
+        partial = w.indexPartial;
+        t.indexOffset = w.offset;
+        crc = bsCrc32(0, w.index, entries * sizeof(BsIndexEntry));
+        put(w, w.index, entries * sizeof(BsIndexEntry));
+    }
+    t.samples = w.samples;
+    t.chunks = w.chunks;
+    t.shots = w.shots;
+    t.flags = (partial ? BS_TRAILER_INDEX_PARTIAL : 0) |
+              (w.pyramidBytes ? BS_TRAILER_PYRAMID : 0);
+    t.magic = BS_INDEX_MAGIC;
+    t.crc = bsCrc32(crc, &t, offsetof(BsTrailer, crc));
+    t.pyramidBytes = w.pyramidBytes;
+    put(w, &t, sizeof(t));
+    return !w.failed;
+}
@@ -0,0 +1,64 @@
+/**
+ * Session file writer - see ballsession.h for the layout
+ *
+ * Output goes through a write callback (FILE*, HTTP chunk, ...) and is
+ * strictly sequential, so a file can be streamed without seeking back.
+ * Index entries are kept in caller-provided storage; if it runs out,
+ * the trailer is marked BS_TRAILER_INDEX_PARTIAL and readers fall back
+ * to walking the chunk headers.
+ *
+ * A summary pyramid (bspyramid.h) goes after the last chunk: the header
+ * (bsPyramidHeaderInit), every level's summaries in level order, then
+ * bsFilePyramidEnd. The levels can come from memory or be streamed.
+ *
+ * A writer that cannot hold the index (a long session exported from the
+ * device flash) passes no index storage and streams it instead: after
+ * the chunks and pyramid, bsFileIndexBegin and one bsFileIndexAdd per
+ * chunk, in order, then bsFileEnd.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+
+// Returns bytes accepted; anything short of len is a write error
+typedef size_t (*BsWriteFn)(void* ctx, const void* data, size_t len);
+
+struct BsFileWriter {
+    BsWriteFn     write;
+    void*         ctx;
+    uint64_t      offset;
+    BsIndexEntry* index;
+    uint32_t      indexCapacity;
+    uint32_t      chunks;
+    uint32_t      shots;
+    uint64_t      samples;
+    uint64_t      pyramidStart;
+    uint32_t      pyramidCrc;
+    uint32_t      pyramidBytes;
+    uint64_t      indexStart;     // streamed index: offset, CRC and entries so far
+    uint32_t      indexCrc;
+    uint32_t      indexStreamed;
+    bool          indexStreaming;
+    bool          indexPartial;
+    bool          failed;
+};
+
+void bsFileBegin(BsFileWriter &w, const BsFileHeader &h, BsWriteFn write, void* ctx,
+                 BsIndexEntry* index, uint32_t indexCapacity);
+
+// Appends one encoded chunk (as produced by bsChunkEncode)
+bool bsFileAddChunk(BsFileWriter &w, const uint8_t* chunk);
+
+void bsFilePyramidBegin(BsFileWriter &w, const BsPyramidHeader &h);
+void bsFilePyramidAdd(BsFileWriter &w, const BsSummary* s, uint32_t n);
+bool bsFilePyramidEnd(BsFileWriter &w);
+
+// Streamed index; e.offset is the chunk's file offset (the caller adds
+// up chunk sizes from sizeof(BsFileHeader)). Fewer entries than chunks
+// mark the index partial.
+void bsFileIndexBegin(BsFileWriter &w);
+void bsFileIndexAdd(BsFileWriter &w, const BsIndexEntry &e);
+
+// Writes the index (unless streamed) and trailer; false if any write failed
+bool bsFileEnd(BsFileWriter &w);
@@ -0,0 +1,168 @@
+/**
+ * Ball pipeline - see bspipeline.h
+ */
+
+#include "bspipeline.h"
+#include <math.h>
+#include <string.h>
+
+// On the ball these run on every loop iteration; they follow the
+// firmware's HOT_IRAM placement (profile.h)
+#if defined(ARDUINO) && (!defined(HOT_IRAM) || HOT_IRAM)
+#include <esp_attr.h>
+#define BS_HOT      IRAM_ATTR
+#define BS_HOT_DATA DRAM_ATTR
+#else
+#define BS_HOT
+#define BS_HOT_DATA
+#endif
+
+// ==================== Quaternion math ====================
+
+static BS_HOT BsQuat qmul(BsQuat a, BsQuat b) {
+    return {
+        a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
+        a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+        a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+        a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w
+    };
+}
+
+static BS_HOT void qnorm(BsQuat &q) {
+    float len = sqrtf(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z);
+    if (len > 0.0001f) {
+        float inv = 1.0f / len;
+        q.w *= inv; q.x *= inv; q.y *= inv; q.z *= inv;
+    }
+}
+
+// ==================== Spin classification ====================
+
+// Labels live in DRAM so classification never touches flash rodata
+static const char SPIN_LABELS[BS_SPIN_TYPES][12] BS_HOT_DATA = {
+    "FLAT", "TOPSPIN", "BACKSPIN", "SIDE_R", "SIDE_L", "SLICE", "MIXED"
+};
+
+BS_HOT uint8_t bsSpinType(float gx, float gy, float gz, float rpm) {
+    if (rpm < 5.0f) return BS_SPIN_FLAT;
+    float agx = fabsf(gx), agy = fabsf(gy), agz = fabsf(gz);
+    float total = agx + agy + agz;
+    if (total < 1.0f) return BS_SPIN_FLAT;
+    float rx = agx / total, ry = agy / total, rz = agz / total;
+    if (rx > 0.5f) return gx > 0 ? BS_SPIN_TOPSPIN : BS_SPIN_BACKSPIN;
+    if (ry > 0.5f) return gy > 0 ? BS_SPIN_SIDE_R : BS_SPIN_SIDE_L;
+    if (rz > 0.5f) return BS_SPIN_SLICE;
+    return BS_SPIN_MIXED;
+}
+
+BS_HOT const char* bsSpinName(uint8_t type) {
+    return SPIN_LABELS[type < BS_SPIN_TYPES ? type : (uint8_t)BS_SPIN_MIXED];
+}
+
+BS_HOT const char* bsSpinLabel(float gx, float gy, float gz, float rpm) {
+    return SPIN_LABELS[bsSpinType(gx, gy, gz, rpm)];
+}
+
+// ==================== Pipeline stages ====================
+
+void bsPipelineInit(BsPipeline &p) {
+    memset(&p, 0, sizeof(p));
+    p.orient = {1, 0, 0, 0};
+}
+
+BS_HOT void bsFuse(BsPipeline &p, float gxDeg, float gyDeg, float gzDeg, float dt) {
+    // Gyro in rad/s for quaternion integration
+    float gxRaw = gxDeg * (float)(M_PI / 180.0);
+    float gyRaw = gyDeg * (float)(M_PI / 180.0);
+    float gzRaw = gzDeg * (float)(M_PI / 180.0);
+
+    // Adaptive gyro bias estimation: when angular velocity is low
+    // (ball likely stationary), learn the zero-rate offset.
+    float rawMag = sqrtf(gxRaw * gxRaw + gyRaw * gyRaw + gzRaw * gzRaw);
+    if (rawMag < 0.2f) {  // < ~11.5 deg/s → likely stationary
+        const float biasAlpha = 0.01f;  // faster adaptation to track temp drift
+        p.biasX += biasAlpha * (gxRaw - p.biasX);
+        p.biasY += biasAlpha * (gyRaw - p.biasY);
+        p.biasZ += biasAlpha * (gzRaw - p.biasZ);
+    }
+
+    // Subtract estimated bias
+    float gx = gxRaw - p.biasX;
+    float gy = gyRaw - p.biasY;
+    float gz = gzRaw - p.biasZ;
+
+    // Filtered gyro (deg/s) for the shot peak search
+    p.filtGx += 0.15f * (gxDeg - p.filtGx);
+    p.filtGy += 0.15f * (gyDeg - p.filtGy);
+    p.filtGz += 0.15f * (gzDeg - p.filtGz);
+
+    // RPM (heavily smoothed)
+    float rawRPM = sqrtf(gxDeg * gxDeg + gyDeg * gyDeg + gzDeg * gzDeg) / 6.0f;
+    p.filtRpm += 0.08f * (rawRPM - p.filtRpm);
+
+    // Integrate quaternion from angular velocity
+    // Dead zone 0.1 rad/s (~5.7 deg/s) to reject residual gyro drift after bias removal
+    float wmag = sqrtf(gx * gx + gy * gy + gz * gz);
+    if (wmag > 0.10f) {
+        float angle = wmag * dt;
+        float ha    = angle * 0.5f;
+        float sha   = sinf(ha);
+        float invW  = 1.0f / wmag;
+        BsQuat dq = {
+            cosf(ha),
+            gx * invW * sha,
+            gy * invW * sha,
+            gz * invW * sha
+        };
+        p.orient = qmul(p.orient, dq);
+        qnorm(p.orient);
+    } else {
+        // Below dead zone (ball is static): slowly decay quaternion toward
+        // identity to auto-correct any accumulated drift over time.
+        // Slerp toward {1,0,0,0} with a small factor each frame.
+        const float decay = 0.005f;  // ~0.5% per frame toward identity
+        p.orient.w += decay * (1.0f - p.orient.w);
+        p.orient.x += decay * (0.0f - p.orient.x);
+        p.orient.y += decay * (0.0f - p.orient.y);
+        p.orient.z += decay * (0.0f - p.orient.z);
+        qnorm(p.orient);
+    }
+}
+
+BS_HOT uint8_t bsDetect(BsPipeline &p, float ax, float ay, float az, uint32_t nowMs, BsShot &shot) {
+    float accelMag = sqrtf(ax * ax + ay * ay + az * az);
+    uint8_t result = BS_DETECT_NONE;
+
+    if (accelMag > BS_IMPACT_G && (nowMs - p.lastImpactMs) > BS_IMPACT_COOLDOWN_MS) {
+        p.lastImpactMs = nowMs;
+        p.tracking = true;
+        p.trackStartMs = nowMs;
+        p.peakRpm = p.filtRpm;
+        p.peakG = accelMag;
+        p.peakGx = p.filtGx; p.peakGy = p.filtGy; p.peakGz = p.filtGz;
+        result = BS_DETECT_IMPACT;
+    }
+
+    // Track peak values for 100ms after impact
+    if (!p.tracking) return result;
+    if (p.filtRpm > p.peakRpm) p.peakRpm = p.filtRpm;
+    if (accelMag > p.peakG) p.peakG = accelMag;
+    if (fabsf(p.filtGx) + fabsf(p.filtGy) + fabsf(p.filtGz) >
+        fabsf(p.peakGx) + fabsf(p.peakGy) + fabsf(p.peakGz)) {
+        p.peakGx = p.filtGx; p.peakGy = p.filtGy; p.peakGz = p.filtGz;
+    }
+
+    if (nowMs - p.trackStartMs <= BS_PEAK_TRACK_MS) return result;
+    p.tracking = false;
+    shot.id = 0;
+    shot.reserved = 0;
+    shot.tUs = (int64_t)p.lastImpactMs * 1000;
+    shot.peakRpm = p.peakRpm;
+    shot.peakG = p.peakG;
+    shot.gx = p.peakGx; shot.gy = p.peakGy; shot.gz = p.peakGz;
+    // Whole 12-byte row: the labels are NUL padded to the field's size
+    static_assert(sizeof(shot.spinType) == sizeof(SPIN_LABELS[0]), "spin label size");
+    memcpy(shot.spinType, SPIN_LABELS[bsSpinType(p.peakGx, p.peakGy, p.peakGz, p.peakRpm)],
+           sizeof(shot.spinType));
+    return BS_DETECT_SHOT;
+}
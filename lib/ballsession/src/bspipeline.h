@@ -0,0 +1,74 @@
+/**
+ * Ball pipeline - sensor fusion, impact detection, spin classification
+ *
+ * The per-sample processing of the ball, shared by the firmware (run on
+ * every loop iteration) and the host tools (re-run over stored sessions
+ * and CSV traces), so a re-analysis gives the shots the ball would have
+ * reported:
+ *
+ *   bsFuse     gyro bias learning while still, the smoothed gyro / RPM
+ *              bsDetect takes its peaks from (the stream and screen read
+ *              the decimation bank, bsdecimate.h), quaternion integration
+ *              with a dead zone and a slow decay toward identity while static
+ *   bsDetect   |accel| above 4 g starts an impact (200 ms cooldown); the
+ *              peak RPM, peak G and the strongest filtered gyro vector
+ *              of the next 100 ms make the shot
+ *   bsSpinLabel  spin type from the gyro vector at the peak
+ *
+ * All state lives in one BsPipeline, so any number of pipelines can run
+ * side by side. No allocation, no platform calls.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include <stdint.h>
+
+struct BsQuat { float w, x, y, z; };
+
+static const float    BS_IMPACT_G           = 4.0f;   // |accel| threshold
+static const uint32_t BS_IMPACT_COOLDOWN_MS = 200;    // debounce
+static const uint32_t BS_PEAK_TRACK_MS      = 100;    // peak search after an impact
+
+struct BsPipeline {
+    BsQuat   orient;
+    float    filtGx, filtGy, filtGz;    // deg/s
+    float    filtRpm;
+    float    biasX, biasY, biasZ;       // rad/s
+    // Detection
+    uint32_t lastImpactMs;
+    bool     tracking;
+    uint32_t trackStartMs;
+    float    peakRpm, peakG;
+    float    peakGx, peakGy, peakGz;
+};
+
+enum BsDetectResult : uint8_t {
+    BS_DETECT_NONE = 0,
+    BS_DETECT_IMPACT,                   // impact started, peak tracking
+    BS_DETECT_SHOT,                     // tracking done, shot filled in
+};
+
+void bsPipelineInit(BsPipeline &p);
+
+// Raw gyro in deg/s, dt in seconds
+void bsFuse(BsPipeline &p, float gxDeg, float gyDeg, float gzDeg, float dt);
+
+// Accel in g. On BS_DETECT_SHOT, shot holds the impact time (nowMs of the
+// impact, in us), peaks, gyro vector and spin type; its id is left to the caller.
+uint8_t bsDetect(BsPipeline &p, float ax, float ay, float az, uint32_t nowMs, BsShot &shot);
+
+enum BsSpinType : uint8_t {
+    BS_SPIN_FLAT = 0, BS_SPIN_TOPSPIN, BS_SPIN_BACKSPIN, BS_SPIN_SIDE_R, BS_SPIN_SIDE_L,
+    BS_SPIN_SLICE, BS_SPIN_MIXED,
+    BS_SPIN_TYPES
+};
+
+// Spin type from the gyro vector (deg/s) and RPM
+uint8_t bsSpinType(float gx, float gy, float gz, float rpm);
+
+// "FLAT", "TOPSPIN", "BACKSPIN", "SIDE_R", "SIDE_L", "SLICE" or "MIXED"
+const char* bsSpinName(uint8_t type);
+
+// bsSpinName(bsSpinType(...))
+const char* bsSpinLabel(float gx, float gy, float gz, float rpm);
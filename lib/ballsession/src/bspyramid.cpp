@@ -0,0 +1,116 @@
+/**
+ * Multi-resolution summary pyramid - see bspyramid.h
+ */
+
+#include "bspyramid.h"
+#include <string.h>
+
+static void clearPartial(BsPyramidPartial &p) {
+    memset(&p, 0, sizeof(p));
+    for (int c = 0; c < BS_SUM_COUNT; c++) p.min[c] = 0xFFFF;
+}
+
+void bsPyramidInit(BsPyramidBuilder &b, uint16_t base, BsSummaryFn emit, void* ctx) {
+    memset(&b, 0, sizeof(b));
+    b.base = base;
+    b.emit = emit;
+    b.ctx = ctx;
+    for (int k = 0; k < BS_PYRAMID_LEVELS; k++) clearPartial(b.part[k]);
+}
+
+void bsSummaryAdd(BsPyramidPartial &acc, int64_t tUs, uint16_t accel, uint16_t gyro, bool impact) {
+    if (acc.count == 0) acc.tFirstUs = tUs;
+    acc.tLastUs = tUs;
+    acc.count++;
+    acc.impacts += impact;
+    const uint16_t v[BS_SUM_COUNT] = {accel, gyro};
+    for (int c = 0; c < BS_SUM_COUNT; c++) {
+        acc.sum[c] += v[c];
+        if (v[c] < acc.min[c]) acc.min[c] = v[c];
+        if (v[c] > acc.max[c]) acc.max[c] = v[c];
+    }
+}
+
+void bsSummaryMerge(BsPyramidPartial &acc, const BsSummary &s) {
+    if (s.count == 0) return;
+    if (acc.count == 0) acc.tFirstUs = s.tFirstUs;
+    acc.tLastUs = s.tFirstUs + s.spanUs;
+    acc.count += s.count;
+    acc.impacts += s.impacts;
+    for (int c = 0; c < BS_SUM_COUNT; c++) {
+        acc.sum[c] += (uint64_t)s.mean[c] * s.count;
+        if (s.min[c] < acc.min[c]) acc.min[c] = s.min[c];
+        if (s.max[c] > acc.max[c]) acc.max[c] = s.max[c];
+    }
+}
+
+void bsSummaryFrom(BsSummary &s, const BsPyramidPartial &p, uint8_t level) {
+    memset(&s, 0, sizeof(s));
+    s.tFirstUs = p.tFirstUs;
+    s.spanUs = (uint32_t)(p.tLastUs - p.tFirstUs);
+    s.count = p.count;
+    s.impacts = p.impacts > 0xFFFF ? 0xFFFF : (uint16_t)p.impacts;
+    s.level = level;
+    for (int c = 0; c < BS_SUM_COUNT; c++) {
+        s.min[c] = p.count ? p.min[c] : 0;
+        s.max[c] = p.max[c];
+        s.mean[c] = p.count ? (uint16_t)((p.sum[c] + p.count / 2) / p.count) : 0;
+    }
+}
+
+// Emits level k's bucket and folds it into level k + 1
+static void complete(BsPyramidBuilder &b, int k) {
+    BsSummary s;
+    bsSummaryFrom(s, b.part[k], (uint8_t)k);
+    b.emit(b.ctx, s);
+    b.emitted[k]++;
+    clearPartial(b.part[k]);
+    if (k + 1 < BS_PYRAMID_LEVELS) bsSummaryMerge(b.part[k + 1], s);
+}
+
+void bsPyramidAdd(BsPyramidBuilder &b, const BsSample &s) {
+    bsSummaryAdd(b.part[0], s.tUs, bsMagnitude(s.a), bsMagnitude(s.g),
+                 (s.flags & BS_FLAG_IMPACT) != 0);
+    b.samples++;
+    // Bucket k completes every base << k samples: carry up like a counter
+    for (int k = 0; k < BS_PYRAMID_LEVELS && b.part[k].count == ((uint32_t)b.base << k); k++) {
+        complete(b, k);
+    }
+}
+
+void bsPyramidFinish(BsPyramidBuilder &b) {
+    for (int k = 0; k < BS_PYRAMID_LEVELS; k++) {
+        if (b.part[k].count) complete(b, k);
+        if (b.emitted[k] <= 1) break;
+    }
+}
+
+uint32_t bsPyramidCount(uint64_t samples, uint16_t base, uint8_t level) {
+    uint64_t width = (uint64_t)base << level;
+    return (uint32_t)((samples + width - 1) / width);
+}
+
+uint8_t bsPyramidLevels(uint64_t samples, uint16_t base) {
+    if (samples == 0) return 0;
+    uint8_t k = 0;
+    while (k + 1 < BS_PYRAMID_LEVELS && bsPyramidCount(samples, base, k) > 1) k++;
+    return k + 1;
+}
+
+void bsPyramidHeaderInit(BsPyramidHeader &h, uint64_t samples, uint16_t base) {
+    memset(&h, 0, sizeof(h));
+    h.magic = BS_PYRAMID_MAGIC;
+    h.base = base;
+    h.samples = samples;
+    h.levels = bsPyramidLevels(samples, base);
+    for (uint8_t k = 0; k < h.levels; k++) h.counts[k] = bsPyramidCount(samples, base, k);
+}
+
+int bsPyramidPickLevel(const BsPyramidHeader &h, uint64_t samples, uint32_t pixels) {
+    if (pixels == 0 || h.levels == 0) return -1;
+    uint64_t perPixel = samples / pixels;
+    if (perPixel < h.base / 4) return -1;
+    int level = 0;
+    while (level + 1 < h.levels && ((uint64_t)h.base << (level + 1)) <= perPixel) level++;
+    return level;
+}
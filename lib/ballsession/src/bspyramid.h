@@ -0,0 +1,78 @@
+/**
+ * Multi-resolution summary pyramid - see ballsession.h for the file section
+ *
+ * Level k splits the session into buckets of base << k samples and keeps
+ * min/max/mean of |accel| and |gyro| plus the impact count per bucket.
+ * The builder is fed one sample at a time and emits each bucket the
+ * moment it completes, carrying it into the next level, so it costs a
+ * few compares per sample and one partial bucket of memory per level;
+ * nothing has to be revisited at session end except the last, partial
+ * bucket of each level.
+ *
+ * An overview of n samples drawn at p pixels reads level
+ * bsPyramidPickLevel(), i.e. between p and 2p summaries (p/4 when zoomed
+ * in to level 0), regardless of the session length.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include <math.h>
+
+static const uint16_t BS_PYRAMID_BASE = 256;
+
+// Receives every bucket as it completes (s.level tells which level)
+typedef void (*BsSummaryFn)(void* ctx, const BsSummary &s);
+
+struct BsPyramidPartial {
+    int64_t  tFirstUs;
+    int64_t  tLastUs;
+    uint64_t sum[BS_SUM_COUNT];
+    uint32_t count;
+    uint32_t impacts;
+    uint16_t min[BS_SUM_COUNT];
+    uint16_t max[BS_SUM_COUNT];
+};
+
+struct BsPyramidBuilder {
+    BsPyramidPartial part[BS_PYRAMID_LEVELS];
+    uint32_t         emitted[BS_PYRAMID_LEVELS];
+    uint64_t         samples;
+    uint16_t         base;
+    BsSummaryFn      emit;
+    void*            ctx;
+};
+
+// base must be a power of two
+void bsPyramidInit(BsPyramidBuilder &b, uint16_t base, BsSummaryFn emit, void* ctx);
+
+void bsPyramidAdd(BsPyramidBuilder &b, const BsSample &s);
+
+// Emits the partial last bucket of each level, up to the first level
+// that covers the session with one bucket
+void bsPyramidFinish(BsPyramidBuilder &b);
+
+// Shape of the finished pyramid for a session of samples
+uint8_t  bsPyramidLevels(uint64_t samples, uint16_t base);
+uint32_t bsPyramidCount(uint64_t samples, uint16_t base, uint8_t level);
+void     bsPyramidHeaderInit(BsPyramidHeader &h, uint64_t samples, uint16_t base);
+
+// Coarsest level whose buckets are no wider than a pixel when samples
+// are drawn across pixels. Level 0 is still used down to four pixels per
+// bucket; below that it returns -1 and the caller reads the samples
+// themselves, fewer than base / 4 per pixel.
+int bsPyramidPickLevel(const BsPyramidHeader &h, uint64_t samples, uint32_t pixels);
+
+// Folds one sample / a summary into bucket acc (an empty acc has count 0)
+void bsSummaryAdd(BsPyramidPartial &acc, int64_t tUs, uint16_t accel, uint16_t gyro, bool impact);
+void bsSummaryMerge(BsPyramidPartial &acc, const BsSummary &s);
+
+// Summary of a partial bucket at the given level
+void bsSummaryFrom(BsSummary &s, const BsPyramidPartial &p, uint8_t level);
+
+static inline uint16_t bsMagnitude(const int16_t v[3]) {
+    uint32_t sq = (uint32_t)((int32_t)v[0] * v[0]) + (uint32_t)((int32_t)v[1] * v[1]) +
+                  (uint32_t)((int32_t)v[2] * v[2]);
+    float m = sqrtf((float)sq);
+    return m >= 65535.0f ? 65535 : (uint16_t)(m + 0.5f);
+}
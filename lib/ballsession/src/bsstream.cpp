@@ -0,0 +1,186 @@
+/**
+ * Streaming sample codec and framing - see bsstream.h
+ */
+
+#include "bsstream.h"
+#include <string.h>
+
+static int64_t sampleValue(const BsSample &s, uint8_t id) {
+    if (id == BS_COL_T) return s.tUs;
+    if (id == BS_COL_FLAGS) return s.flags;
+    if (id < BS_COL_GX) return s.a[id - BS_COL_AX];
+    if (id < BS_COL_QW) return s.g[id - BS_COL_GX];
+    return s.q[id - BS_COL_QW];
+}
+
+static void setSampleValue(BsSample &s, uint8_t id, int64_t v) {
+    if (id == BS_COL_T)          s.tUs = v;
+    else if (id == BS_COL_FLAGS) s.flags = (uint16_t)v;
+    else if (id < BS_COL_GX)     s.a[id - BS_COL_AX] = (int16_t)v;
+    else if (id < BS_COL_QW)     s.g[id - BS_COL_GX] = (int16_t)v;
+    else                         s.q[id - BS_COL_QW] = (int16_t)v;
+}
+
+// Stream prediction: p2 == p1 right after a keyframe, so delta2 starts as delta
+static inline int64_t predict(uint8_t order, int64_t p1, int64_t p2) {
+    return order == 2 ? (int64_t)(2 * (uint64_t)p1 - (uint64_t)p2) : p1;
+}
+
+void bsStreamInit(BsStreamEncoder &e, uint16_t columns, uint8_t order, uint16_t keyInterval) {
+    memset(&e, 0, sizeof(e));
+    e.columns = columns | (1u << BS_COL_T);
+    e.order = order == 2 ? 2 : 1;
+    e.keyInterval = keyInterval ? keyInterval : 1;
+    e.keyPending = true;
+}
+
+size_t bsStreamEncode(BsStreamEncoder &e, const BsSample &s, uint8_t* out) {
+    bool key = e.keyPending || e.sinceKey >= e.keyInterval;
+    uint8_t* p = out;
+    *p++ = (key ? BS_STREAM_KEY : 0) | (e.order == 2 ? BS_STREAM_ORDER2 : 0);
+    *p++ = e.seq++;
+    if (key) p = bsPutVarint(p, e.columns);
+
+    for (uint8_t id = 0; id < BS_COL_COUNT; id++) {
+        if (!((e.columns >> id) & 1)) continue;
+        int64_t v = sampleValue(s, id);
+        int64_t r = key ? v : (int64_t)((uint64_t)v - (uint64_t)predict(e.order, e.p1[id], e.p2[id]));
+        p = bsPutVarint(p, bsZigzag(r));
+        e.p2[id] = key ? v : e.p1[id];
+        e.p1[id] = v;
+    }
+    e.sinceKey = key ? 1 : e.sinceKey + 1;
+    e.keyPending = false;
+    return p - out;
+}
+
+void bsStreamDecoderInit(BsStreamDecoder &d) {
+    memset(&d, 0, sizeof(d));
+}
+
+bool bsStreamDecode(BsStreamDecoder &d, const uint8_t* p, size_t len, BsSample &s) {
+    const uint8_t* end = p + len;
+    if (len < 2) {
+        d.malformed++;
+        return false;
+    }
+    uint8_t flags = *p++;
+    uint8_t seq = *p++;
+    bool key = flags & BS_STREAM_KEY;
+
+    if (d.synced && seq != d.seq) {
+        d.lost += (uint8_t)(seq - d.seq);
+        d.synced = false;
+    }
+    d.seq = seq + 1;
+    if (!key && !d.synced) {
+        d.discarded++;
+        return false;
+    }
+
+    uint16_t columns = d.columns;
+    if (key) {
+        uint64_t c;
+        p = bsGetVarint(p, end, c);
+        if (!p || c >= (1u << BS_COL_COUNT)) {
+            d.malformed++;
+            d.synced = false;
+            return false;
+        }
+        columns = (uint16_t)c;
+    }
+    uint8_t order = flags & BS_STREAM_ORDER2 ? 2 : 1;
+
+    // Decode into a copy so a truncated packet leaves the state untouched
+    int64_t v[BS_COL_COUNT];
+    for (uint8_t id = 0; id < BS_COL_COUNT; id++) {
+        if (!((columns >> id) & 1)) continue;
+        uint64_t z;
+        p = bsGetVarint(p, end, z);
+        if (!p) {
+            d.malformed++;
+            d.synced = false;
+            return false;
+        }
+        int64_t r = bsUnzigzag(z);
+        v[id] = key ? r : (int64_t)((uint64_t)predict(order, d.p1[id], d.p2[id]) + (uint64_t)r);
+    }
+
+    memset(&s, 0, sizeof(s));
+    for (uint8_t id = 0; id < BS_COL_COUNT; id++) {
+        if (!((columns >> id) & 1)) continue;
+        d.p2[id] = key ? v[id] : d.p1[id];
+        d.p1[id] = v[id];
+        setSampleValue(s, id, v[id]);
+    }
+    d.columns = columns;
+    d.order = order;
+    d.synced = true;
+    d.packets++;
+    if (key) d.keyframes++;
+    return true;
+}
+
+// ==================== Framing ====================
+
+uint8_t bsCrc8(const uint8_t* p, size_t len) {
+    static const uint8_t NIBBLE[16] = {
+        0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+        0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+    };
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *p++;
+        crc = (uint8_t)(crc << 4) ^ NIBBLE[crc >> 4];
+        crc = (uint8_t)(crc << 4) ^ NIBBLE[crc >> 4];
+    }
+    return crc;
+}
+
+size_t bsFramePut(uint8_t* out, const uint8_t* payload, uint8_t len) {
+    out[0] = BS_FRAME_SYNC;
+    out[1] = len;
+    memcpy(out + 2, payload, len);
+    out[2 + len] = bsCrc8(out + 1, len + 1);
+    return len + 3;
+}
+
+static void drop(BsFrameParser &f, uint16_t k) {
+    memmove(f.buf, f.buf + k, f.n - k);
+    f.n -= k;
+}
+
+int bsFrameFeed(BsFrameParser &f, uint8_t byte, const uint8_t** payload) {
+    if (f.done) {
+        drop(f, f.done);
+        f.done = 0;
+    }
+    f.buf[f.n++] = byte;
+
+    for (;;) {
+        uint16_t k = 0;
+        while (k < f.n && f.buf[k] != BS_FRAME_SYNC) k++;
+        if (k) {
+            f.skipped += k;
+            drop(f, k);
+        }
+        if (f.n < 2) return 0;
+        uint8_t len = f.buf[1];
+        if (len == 0) {
+            f.skipped++;
+            drop(f, 1);
+            continue;
+        }
+        if (f.n < len + 3) return 0;
+        if (bsCrc8(f.buf + 1, len + 1) == f.buf[len + 2]) {
+            *payload = f.buf + 2;
+            f.done = len + 3;
+            f.frames++;
+            return len;
+        }
+        // Not a frame after all: resume the search one byte further
+        f.badCrc++;
+        f.skipped++;
+        drop(f, 1);
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * Streaming sample codec for live links (serial, WebSocket)
+ *
+ * One packet per sample, built from the same predictors as the chunk
+ * encodings (ballsession.h): a keyframe carries the column mask and the
+ * absolute values, the packets in between the zigzag varint residual of
+ * each column against the delta or delta2 prediction. A 200Hz IMU
+ * sample at rest is 12-16 bytes instead of ~60 as CSV.
+ *
+ *   packet = flags(1) seq(1) [columns varint, on keyframes] value*
+ *
+ * A receiver that joins late or misses a packet (gap in seq) discards
+ * packets until the next keyframe, which the encoder sends every
+ * keyInterval samples and whenever bsStreamKey() asks for one (a client
+ * connecting).
+ *
+ * Byte streams without message boundaries (UART) wrap each packet in a
+ * frame,  BS_FRAME_SYNC len payload crc8 ; bsFrameFeed() finds the next
+ * frame after dropped or corrupted bytes.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+
+static const uint8_t BS_STREAM_KEY    = 0x01;  // flags: keyframe
+static const uint8_t BS_STREAM_ORDER2 = 0x02;  // flags: delta2 predictor
+static const size_t  BS_STREAM_MAX    = 2 + 3 + BS_COL_COUNT * 10;  // packet bytes, worst case
+
+struct BsStreamEncoder {
+    int64_t  p1[BS_COL_COUNT];
+    int64_t  p2[BS_COL_COUNT];
+    uint16_t columns;
+    uint16_t keyInterval;     // samples between keyframes
+    uint16_t sinceKey;
+    uint8_t  order;           // 1 = delta, 2 = delta2
+    uint8_t  seq;
+    bool     keyPending;
+};
+
+struct BsStreamDecoder {
+    int64_t  p1[BS_COL_COUNT];
+    int64_t  p2[BS_COL_COUNT];
+    uint16_t columns;
+    uint8_t  order;
+    uint8_t  seq;             // expected next
+    bool     synced;
+    uint32_t packets;         // decoded
+    uint32_t keyframes;
+    uint32_t lost;            // packets missing from seq gaps
+    uint32_t discarded;       // received while waiting for a keyframe
+    uint32_t malformed;
+};
+
+void bsStreamInit(BsStreamEncoder &e, uint16_t columns, uint8_t order, uint16_t keyInterval);
+
+// Makes the next packet a keyframe
+static inline void bsStreamKey(BsStreamEncoder &e) { e.keyPending = true; }
+
+// Encodes one sample into out (BS_STREAM_MAX bytes); returns the packet length
+size_t bsStreamEncode(BsStreamEncoder &e, const BsSample &s, uint8_t* out);
+
+void bsStreamDecoderInit(BsStreamDecoder &d);
+
+// True when s holds the decoded sample; false while waiting for a
+// keyframe or for a malformed packet (counted in d)
+bool bsStreamDecode(BsStreamDecoder &d, const uint8_t* p, size_t len, BsSample &s);
+
+// ==================== Framing ====================
+
+static const uint8_t BS_FRAME_SYNC = 0xB5;
+static const size_t  BS_FRAME_MAX  = 255;      // payload bytes
+
+struct BsFrameParser {
+    uint8_t  buf[BS_FRAME_MAX + 3];
+    uint16_t n;
+    uint16_t done;            // bytes of the frame returned by the last call
+    uint32_t frames;
+    uint32_t badCrc;
+    uint32_t skipped;         // bytes dropped while looking for a frame
+};
+
+// CRC-8 (poly 0x07) as used in frames
+uint8_t bsCrc8(const uint8_t* p, size_t len);
+
+// Frames payload into out (len + 3 bytes); returns the frame length
+size_t bsFramePut(uint8_t* out, const uint8_t* payload, uint8_t len);
+
+static inline void bsFrameInit(BsFrameParser &f) { f = BsFrameParser(); }
+
+// Feeds one received byte. Returns the payload length when it completes
+// a frame (*payload points into the parser until the next call), else 0.
+int bsFrameFeed(BsFrameParser &f, uint8_t byte, const uint8_t** payload);
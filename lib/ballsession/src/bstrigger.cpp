@@ -0,0 +1,83 @@
+/**
+ * Trigger capture - see bstrigger.h
+ */
+
+#include "bstrigger.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void bsTrigInit(BsTrigger &t, uint16_t pre, uint16_t post, uint16_t heartbeat, const BsFileHeader &h) {
+    memset(&t, 0, sizeof(t));
+    t.pre = pre < BS_TRIG_MAX_PRE ? pre : BS_TRIG_MAX_PRE;
+    t.post = post;
+    t.heartbeat = heartbeat;
+    t.perG = (float)(1.0 / bsAccelPerG(h));
+    t.perDps = (float)(1.0 / bsGyroPerDps(h));
+}
+
+static inline uint32_t mag2(const int16_t v[3]) {
+    uint32_t m = 0;
+    for (int k = 0; k < 3; k++) m += (uint32_t)((int32_t)v[k] * v[k]);
+    return m;
+}
+
+static void text(BsTrigger &t, const BsTrigOutput &out, const char* line, int len) {
+    if (len <= 0) return;
+    t.textBytes += len;
+    out.text(out.ctx, line, len);
+}
+
+static void pass(BsTrigger &t, const BsTrigOutput &out, const BsSample &s, bool first) {
+    out.sample(out.ctx, s, first);
+    t.sent++;
+    t.hbSent++;
+}
+
+// Window line, then the ring oldest first
+static void openWindow(BsTrigger &t, const BsTrigOutput &out, const BsSample &s) {
+    uint16_t oldest = (uint16_t)((t.head + t.pre - t.held) % (t.pre ? t.pre : 1));
+    const BsSample &first = t.held ? t.ring[oldest] : s;
+    char line[80];
+    text(t, out, line, snprintf(line, sizeof(line), "# WINDOW t=%lld pre=%u post=%u\n",
+                                (long long)(first.tUs / 1000), t.held, t.post));
+    for (uint16_t i = 0; i < t.held; i++) pass(t, out, t.ring[(oldest + i) % t.pre], i == 0);
+    t.windows++;
+}
+
+void bsTrigPush(BsTrigger &t, const BsSample &s, bool trigger, const BsTrigOutput &out) {
+    t.taken++;
+    t.hbTaken++;
+    uint32_t a2 = mag2(s.a), g2 = mag2(s.g);
+    if (a2 > t.hbMaxA2) t.hbMaxA2 = a2;
+    if (g2 > t.hbMaxG2) t.hbMaxG2 = g2;
+
+    if (trigger) {
+        bool first = t.postLeft == 0;
+        if (first) openWindow(t, out, s);
+        bool ringFirst = first && t.held > 0;
+        t.held = 0;
+        t.postLeft = (uint32_t)t.post + 1;   // this sample, then post more
+        pass(t, out, s, first && !ringFirst);
+        t.postLeft--;
+    } else if (t.postLeft) {
+        pass(t, out, s, false);
+        t.postLeft--;
+    } else if (t.pre) {
+        t.ring[t.head] = s;
+        if (++t.head == t.pre) t.head = 0;
+        if (t.held < t.pre) t.held++;
+    }
+
+    if (t.heartbeat && t.hbTaken >= t.heartbeat && !t.postLeft) {
+        char line[128];
+        text(t, out, line, snprintf(line, sizeof(line),
+                                    "# HB t=%lld n=%lu sent=%lu amax=%.2f rpm=%.0f win=%lu\n",
+                                    (long long)(s.tUs / 1000), (unsigned long)t.hbTaken,
+                                    (unsigned long)t.hbSent, sqrtf((float)t.hbMaxA2) * t.perG,
+                                    sqrtf((float)t.hbMaxG2) * t.perDps / 6.0f,
+                                    (unsigned long)t.windows));
+        t.hbTaken = t.hbSent = 0;
+        t.hbMaxA2 = t.hbMaxG2 = 0;
+    }
+}
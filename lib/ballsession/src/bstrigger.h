@@ -0,0 +1,64 @@
+/**
+ * Trigger capture - full-rate windows around impacts, heartbeat between
+ *
+ * A logger that sends every sample spends most of its link on a ball
+ * lying still. In trigger mode it keeps the last `pre` samples in a ring
+ * and passes samples on only inside windows: from `pre` samples before a
+ * trigger (an impact) to `post` samples after the last trigger, so a
+ * trigger inside a window extends it. Whatever is held back is
+ * summarised in a heartbeat line every `heartbeat` samples, sent between
+ * windows:
+ *
+ *   # WINDOW t=<ms> pre=<samples> post=<samples>       before a window
+ *   # HB t=<ms> n=<taken> sent=<passed on> amax=<g> rpm=<max> win=<windows>
+ *
+ * n and sent count since the previous heartbeat (sent includes the ring
+ * samples a window started with). amax is the largest |accel| and rpm
+ * the largest |gyro| / 6 over those samples: a receiver sees the ball
+ * moved without triggering.
+ *
+ * Samples are BsSample in the fixed point of the header given to
+ * bsTrigInit. No allocation, no platform calls: imu_logger,
+ * sessioncap --emulate and trigbench run the same code, so the bytes
+ * trigbench counts are the ones the logger sends.
+ */
+
+#pragma once
+
+#include "ballsession.h"
+#include <stddef.h>
+
+static const int BS_TRIG_MAX_PRE = 200;   // ring samples: 1 s at 200Hz
+
+struct BsTrigOutput {
+    // A sample passed on; first = opens a window (a stream should key here)
+    void (*sample)(void* ctx, const BsSample &s, bool first);
+    // A status line, '\n' terminated
+    void (*text)(void* ctx, const char* line, size_t len);
+    void* ctx;
+};
+
+struct BsTrigger {
+    BsSample ring[BS_TRIG_MAX_PRE];
+    uint16_t pre, post, heartbeat;   // samples
+    uint16_t head;                   // next ring slot
+    uint16_t held;                   // samples in the ring
+    uint32_t postLeft;               // samples the open window still passes on
+    float    perG, perDps;
+    // Since the last heartbeat
+    uint32_t hbTaken, hbSent;
+    uint32_t hbMaxA2, hbMaxG2;       // squared fixed-point magnitudes
+    // Totals
+    uint32_t windows;
+    uint64_t taken, sent;
+    uint64_t textBytes;              // WINDOW and HB lines
+};
+
+// pre is capped at BS_TRIG_MAX_PRE; heartbeat 0 = no heartbeat lines
+void bsTrigInit(BsTrigger &t, uint16_t pre, uint16_t post, uint16_t heartbeat, const BsFileHeader &h);
+
+// One sample; trigger = it is an impact. Calls out for what is passed on.
+void bsTrigPush(BsTrigger &t, const BsSample &s, bool trigger, const BsTrigOutput &out);
+
+// True inside a window
+static inline bool bsTrigOpen(const BsTrigger &t) { return t.postLeft > 0; }
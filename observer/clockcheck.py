@@ -0,0 +1,163 @@
+"""
+clockcheck.py - Check the observer's clock sync against emulated balls.
+
+Starts --balls emulator processes (one ball each, as separate devices
+would be), each with its own clock (--clock-ppm: rate error and uptime)
+and radio delay on the ping/pong (--link-ms). Runs the observer
+receivers (observer.add_ball: clocksync.ClockSync, stored sync_us) on
+them into a scratch database and every --every seconds compares each
+ball's estimate with its true clock (emulator GET /clock):
+
+    error      observer time the ball's stamp for "now" is mapped to,
+               minus now: how far off that ball's frames are stored
+    spread     largest minus smallest error over the balls at one
+               instant: how far two balls' samples of the same moment
+               can land apart
+
+and at the end prints, per ball, the true and estimated skew, the sync
+error the observer reports (and the scatter of its points), and the
+errors actually seen after --warmup. Emulator and observer share the machine's monotonic clock,
+which is what makes the truth available.
+
+Usage:
+    python clockcheck.py                                   # 4 balls, +-40 ppm, 0-5 ms radio delay
+    python clockcheck.py --balls 8 --seconds 300 --clock-ppm 100 --link-ms 20
+"""
+
+import argparse
+import asyncio
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+
+from clocksync import WRAP
+from db import Database
+from latency import client_us
+from observer import add_ball
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def fetch_json(url):
+    with urllib.request.urlopen(url, timeout=2) as r:
+        return json.loads(r.read())
+
+
+def true_device_us(truth, host_us):
+    """The ball's micros() (unwrapped) at an observer-clock time."""
+    return truth['boot_us'] + int((host_us - truth['start_us']) * (1.0 + truth['skew_ppm'] * 1e-6))
+
+
+def mapping_error_us(clock, truth, host_us):
+    """Observer time the ball's own stamp for host_us maps to, minus host_us."""
+    mapped = clock.to_host_us(true_device_us(truth, host_us) % WRAP, host_us)
+    return None if mapped is None else mapped - host_us
+
+
+def percentile(values, p):
+    s = sorted(values)
+    return s[min(int(p * len(s)), len(s) - 1)] if s else None
+
+
+async def run(args):
+    procs, balls, receivers = [], {}, []
+    db_path = os.path.join(tempfile.mkdtemp(prefix='clockcheck-'), 'clockcheck.db')
+    db = Database(db_path)
+    try:
+        for k in range(args.balls):
+            ws_port, http_port = args.port + 2 * k, args.port + 2 * k - 1
+            procs.append(subprocess.Popen(
+                [sys.executable, os.path.join(HERE, 'emulator.py'),
+                 '--ws-port', str(ws_port), '--http-port', str(http_port),
+                 '--imu-hz', '50', '--seed', str(args.seed + k), '--first-id', str(k + 1),
+                 '--clock-ppm', str(args.clock_ppm), '--link-ms', str(args.link_ms)],
+                stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL))
+        truths = []
+        for k in range(args.balls):
+            url = f"http://127.0.0.1:{args.port + 2 * k - 1}/clock"
+            deadline = time.monotonic() + 15
+            while True:
+                try:
+                    truths.append(await asyncio.get_running_loop().run_in_executor(None, fetch_json, url))
+                    break
+                except OSError:
+                    if time.monotonic() > deadline:
+                        raise RuntimeError(f"emulator {k + 1} did not start")
+                    await asyncio.sleep(0.2)
+        for k, truth in enumerate(truths):
+            add_ball(db, balls, receivers, truth['id'], f"ws://127.0.0.1:{args.port + 2 * k}", truth['id'])
+
+        errors = {t['id']: [] for t in truths}
+        spreads = []
+        print(f"{args.balls} balls, clocks +-{args.clock_ppm:g} ppm, radio delay 0-{args.link_ms:g} ms per leg")
+        print(f"{'t s':>5}  " + "  ".join(f"{t['id']:>12}" for t in truths) + f"  {'spread':>8}   (error us)")
+        t0 = time.monotonic()
+        while time.monotonic() - t0 < args.seconds:
+            await asyncio.sleep(args.every)
+            now = client_us()
+            row = []
+            for truth in truths:
+                clock = balls[truth['id']]['clock']
+                err = mapping_error_us(clock, truth, now) if clock is not None else None
+                row.append(err)
+                if err is not None and time.monotonic() - t0 >= args.warmup:
+                    errors[truth['id']].append(err)
+            seen = [e for e in row if e is not None]
+            spread = max(seen) - min(seen) if len(seen) == len(row) else None
+            if spread is not None and time.monotonic() - t0 >= args.warmup:
+                spreads.append(spread)
+            cells = [f"{e:>12.0f}" if e is not None else f"{'-':>12}" for e in row]
+            cells.append(f"{spread:>8.0f}" if spread is not None else f"{'-':>8}")
+            print(f"{time.monotonic() - t0:>5.0f}  " + "  ".join(cells), flush=True)
+
+        print()
+        print(f"After {args.warmup:g} s:")
+        print(f"{'ball':<12} {'true ppm':>9} {'est ppm':>9} {'reported':>9} {'scatter':>9} "
+              f"{'|err| p50':>10} {'|err| max':>10}   (us)")
+        for truth in truths:
+            clock = balls[truth['id']]['clock']
+            errs = [abs(e) for e in errors[truth['id']]]
+            print(f"{truth['id']:<12} {truth['skew_ppm']:>+9.2f} {clock.skew_ppm:>+9.2f} "
+                  f"{clock.err_us:>9.0f} {clock.residual_us:>9.0f} "
+                  f"{percentile(errs, 0.5) or 0:>10.0f} {max(errs) if errs else 0:>10.0f}")
+        if spreads:
+            print(f"Spread between balls: p50 {percentile(spreads, 0.5):.0f} us, max {max(spreads):.0f} us")
+        rows = db.conn.execute("SELECT COUNT(*), COUNT(sync_us) FROM imu_data").fetchone()
+        print(f"Stored frames: {rows[0]}, {rows[1]} with sync_us")
+    finally:
+        for task in receivers:
+            task.cancel()
+        await asyncio.gather(*receivers, return_exceptions=True)
+        for p in procs:
+            p.terminate()
+            p.wait()
+        db.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Observer clock sync against emulated ball clocks')
+    parser.add_argument('--balls', type=int, default=4, help='Emulator processes, one ball each (default: 4)')
+    parser.add_argument('--seconds', type=float, default=120.0, help='Run length (default: 120)')
+    parser.add_argument('--every', type=float, default=5.0, help='Seconds between checks (default: 5)')
+    parser.add_argument('--warmup', type=float, default=30.0,
+                        help='Checks before this are printed but left out of the summary (default: 30)')
+    parser.add_argument('--clock-ppm', type=float, default=40.0,
+                        help='Emulated clock rate errors within +-this (default: 40)')
+    parser.add_argument('--link-ms', type=float, default=5.0,
+                        help='Emulated radio delay per ping/pong leg, 0..this (default: 5)')
+    parser.add_argument('--seed', type=int, default=1, help='Seed of ball 1, +1 per ball (default: 1)')
+    parser.add_argument('--port', type=int, default=9301,
+                        help='WebSocket port of ball 1, +2 per ball (default: 9301)')
+    args = parser.parse_args()
+    try:
+        asyncio.run(run(args))
+    except KeyboardInterrupt:
+        print("\nStopped.")
+
+
+if __name__ == '__main__':
+    main()
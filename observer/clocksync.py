@@ -0,0 +1,202 @@
+"""
+clocksync.py - Per-device clock offset and skew against the observer clock.
+
+Every ball counts time with its own micros() (32-bit, wraps every ~71.6
+min) from its own crystal, so two balls disagree by their boot times and
+drift apart by tens of ppm. The observer clock (client_us(), monotonic)
+is the shared reference: each device is related to it with the existing
+ping/pong exchange (latency.h)
+
+    observer -> "ping <client_us>"
+    device   -> {"event": "pong", "c": <client_us>, "d": <device_us>}
+
+and every stream timestamp is mapped onto it, so frames and shots of
+different balls line up on one time axis.
+
+A pong gives one offset sample d - (c + rx) / 2, wrong by at most half
+its round trip (the unknown split of the round trip). Queueing on the
+radio only ever adds delay, so the smallest-RTT pong of each group of
+GROUP consecutive pongs is kept, and a line offset = a + skew * t is
+fitted by least squares over the last WINDOW groups (~2 min at the
+observer's one pong per second). Until the kept points span MIN_SKEW_SPAN_S the skew is taken
+as 0 and the offset is that of the best pong.
+
+Reported per device:
+    offset_us     device - observer clock, now
+    skew_ppm      device clock rate error (+ = device runs fast)
+    residual_us   RMS of the kept points about the fit (scatter of one point)
+    err_us        standard error of the fitted offset at the newest point:
+                  the sync error reported and stored
+    bound_us      half the smallest kept RTT: what one point can be off by
+"""
+
+from latency import client_us
+
+WRAP = 1 << 32
+GROUP = 4                 # pongs per kept point (the connect burst is one group)
+WINDOW = 32               # kept points in the fit
+MIN_SKEW_SPAN_S = 10.0    # kept points must span this before skew is fitted
+HOST_EPOCH_US = None      # client_us() -> wall-clock µs, fixed at first use
+
+
+def host_epoch_us(host_us):
+    """Observer clock -> wall-clock µs since the epoch (one fixed offset per process)."""
+    global HOST_EPOCH_US
+    if HOST_EPOCH_US is None:
+        import time
+        HOST_EPOCH_US = time.time_ns() // 1000 - client_us()
+    return int(host_us) + HOST_EPOCH_US
+
+
+class ClockSync:
+    """Offset and skew of one device clock against client_us()."""
+
+    def __init__(self, group=GROUP, window=WINDOW):
+        self.group = group
+        self.window = window
+        self.pending = []             # (rtt, host_us, dev_us) of the open group
+        self.points = []              # kept (host_us, offset_us, rtt) per group
+        self.provisional = False      # points[-1] is from a group still open
+        self.last_dev = None          # unwrapped device µs of the latest pong
+        self.ref = 0                  # host µs the fit is centred on
+        self.a = None                 # offset at ref
+        self.b = 0.0                  # skew (dimensionless)
+        self.rtt_us = None
+        self.residual_us = None
+        self.err_us = None
+        self.bound_us = None
+        self.pongs = 0
+
+    # --- Estimation ---
+
+    def ping_payload(self, now_us=None):
+        """Return the text command to send to the device."""
+        return f"ping {client_us() if now_us is None else now_us}"
+
+    def unwrap(self, dev32):
+        """Pong micros() -> monotonic device µs (follows wraps between pongs)."""
+        dev32 = int(dev32) & (WRAP - 1)
+        if self.last_dev is None:
+            self.last_dev = dev32
+        else:
+            delta = (dev32 - self.last_dev) % WRAP
+            if delta >= WRAP // 2:
+                delta -= WRAP
+            self.last_dev += delta
+        return self.last_dev
+
+    def on_pong(self, msg, now_us=None):
+        """Update the estimate from a pong message dict."""
+        now = client_us() if now_us is None else now_us
+        sent = msg.get('c', 0)
+        rtt = now - sent
+        if rtt < 0:
+            return
+        self.pongs += 1
+        host = (sent + now) / 2.0
+        self.pending.append((rtt, host, self.unwrap(msg.get('d', 0))))
+        best_rtt, best_host, best_dev = min(self.pending)
+        point = (best_host, best_dev - best_host, best_rtt)
+        if len(self.pending) >= self.group:
+            self.pending = []
+            if self.provisional:
+                self.points.pop()
+                self.provisional = False
+            self.points.append(point)
+            if len(self.points) > self.window:
+                self.points.pop(0)
+        elif not self.points or self.provisional:
+            # Usable before the first group completes: best pong so far
+            self.points = [point]
+            self.provisional = True
+        else:
+            return
+        self.fit()
+
+    def fit(self):
+        """Least-squares line through the kept points (offset only while they span too little)."""
+        pts = self.points
+        n = len(pts)
+        span = pts[-1][0] - pts[0][0]
+        if n < 3 or span < MIN_SKEW_SPAN_S * 1e6:
+            host, off, rtt = min(pts, key=lambda p: p[2])
+            self.ref, self.a, self.b = host, off, 0.0
+            self.residual_us = self.err_us = rtt / 2.0
+        else:
+            self.ref = sum(p[0] for p in pts) / n
+            mean_off = sum(p[1] for p in pts) / n
+            sxx = sum((p[0] - self.ref) ** 2 for p in pts)
+            sxy = sum((p[0] - self.ref) * (p[1] - mean_off) for p in pts)
+            self.b = sxy / sxx
+            self.a = mean_off
+            ss = sum((p[1] - self.a - self.b * (p[0] - self.ref)) ** 2 for p in pts)
+            self.residual_us = (ss / (n - 2)) ** 0.5
+            self.err_us = self.residual_us * (1.0 / n + (pts[-1][0] - self.ref) ** 2 / sxx) ** 0.5
+        self.rtt_us = min(p[2] for p in pts)
+        self.bound_us = self.rtt_us / 2.0
+
+    # --- Mapping ---
+
+    @property
+    def synced(self):
+        return self.a is not None
+
+    @property
+    def skew_ppm(self):
+        return self.b * 1e6
+
+    @property
+    def offset_us(self):
+        """device - observer clock now (unwrapped device µs), or None."""
+        return self.offset_at(client_us()) if self.synced else None
+
+    def offset_at(self, host_us):
+        return self.a + self.b * (host_us - self.ref)
+
+    def device_at(self, host_us):
+        """Unwrapped device µs at an observer time."""
+        return host_us + self.offset_at(host_us)
+
+    def to_host_us(self, dev32, now_us=None):
+        """Observer µs of a device micros() stamp close to now, or None if not synced.
+
+        The 32-bit stamp is unwrapped against the device time now, so it
+        may lie up to ~35 min either side.
+        """
+        if not self.synced:
+            return None
+        now = client_us() if now_us is None else now_us
+        near = self.device_at(now)
+        delta = (int(dev32) - int(near)) % WRAP
+        if delta >= WRAP // 2:
+            delta -= WRAP
+        dev = near + delta
+        # dev = host + a + b (host - ref)  ->  host
+        return (dev - self.a + self.b * self.ref) / (1.0 + self.b)
+
+    def to_host_ms(self, dev_ms, now_us=None):
+        """Same for a millis() stamp (shots, frames without "ts"); 1 ms resolution.
+
+        millis() is micros() / 1000 rounded down: the middle of its ms is used.
+        """
+        return self.to_host_us((int(dev_ms) * 1000 + 500) % WRAP, now_us)
+
+    def latency_us(self, device_ts, now_us=None):
+        """Latency from a device micros() stamp to now, or None if not yet synced."""
+        now = client_us() if now_us is None else now_us
+        host = self.to_host_us(device_ts, now)
+        if host is None or host > now:
+            return None               # negative: estimate is stale
+        return int(now - host)
+
+    def to_dict(self):
+        return {
+            'synced': self.synced,
+            'offset_us': round(self.offset_us) if self.synced else None,
+            'skew_ppm': round(self.skew_ppm, 2),
+            'residual_us': round(self.residual_us, 1) if self.residual_us is not None else None,
+            'err_us': round(self.err_us, 1) if self.err_us is not None else None,
+            'bound_us': round(self.bound_us, 1) if self.bound_us is not None else None,
+            'points': len(self.points),
+            'pongs': self.pongs,
+        }
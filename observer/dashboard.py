@@ -2,7 +2,8 @@
 dashboard.py - aiohttp web application for the Tennis Ball Spin Observer.
 
 Serves the single-page dashboard HTML and provides REST API endpoints
-for session management, shot data retrieval, and CSV export.
+for session management, shot data retrieval, and CSV export, plus
+/api/live: each connected ball's own session aggregates (GET /stats).
 """
 
 import os
@@ -13,13 +14,15 @@ from aiohttp import web
 STATIC_DIR = os.path.join(os.path.dirname(__file__), 'static')
 
 
-def create_app(db):
+def create_app(db, balls=None):
     """Create and configure the aiohttp web application.
 
     Parameters
     ----------
     db : Database
         An instance of the Database class from db.py.
+    balls : dict, optional
+        The observer's ball key -> receiver state (observer.new_ball_state).
 
     Returns
     -------
@@ -28,6 +31,7 @@ def create_app(db):
     """
     app = web.Application()
     app['db'] = db
+    app['balls'] = balls if balls is not None else {}
 
     # --- Route handlers ---
 
@@ -79,9 +83,24 @@ def create_app(db):
             }
         )
 
+    async def api_live(request):
+        """Return every ball's connection and latest device session aggregates."""
+        return web.json_response([
+            {
+                'ball': key,
+                'device': st.get('device'),
+                'url': st['url'],
+                'connected': st['connected'],
+                'session_id': st['session_id'],
+                'stats': st.get('device_stats'),
+            }
+            for key, st in request.app['balls'].items()
+        ])
+
     # --- Register routes ---
 
     app.router.add_get('/', index)
+    app.router.add_get('/api/live', api_live)
     app.router.add_get('/api/sessions', api_sessions)
     app.router.add_get('/api/sessions/{id}', api_session)
     app.router.add_get('/api/sessions/{id}/shots', api_shots)
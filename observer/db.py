@@ -40,7 +40,10 @@ class Database:
                 total_shots INTEGER DEFAULT 0,
                 avg_rpm REAL DEFAULT 0,
                 max_rpm REAL DEFAULT 0,
-                notes TEXT
+                notes TEXT,
+                device TEXT,
+                clock_skew_ppm REAL,
+                clock_err_us REAL
             );
 
             CREATE TABLE IF NOT EXISTS imu_data (
@@ -60,7 +63,8 @@ class Database:
                 qz REAL,
                 rpm REAL,
                 spin TEXT,
-                impact INTEGER
+                impact INTEGER,
+                sync_us INTEGER
             );
 
             CREATE INDEX IF NOT EXISTS idx_imu_session_ts
@@ -79,14 +83,29 @@ class Database:
                 gz REAL,
                 spin_type TEXT,
                 spin_axis_theta REAL,
-                spin_axis_phi REAL
+                spin_axis_phi REAL,
+                sync_us INTEGER
             );
         """)
+        # Databases from before multi-ball ingest (device) and clock sync
+        for table, column, kind in (('sessions', 'device', 'TEXT'),
+                                    ('sessions', 'clock_skew_ppm', 'REAL'),
+                                    ('sessions', 'clock_err_us', 'REAL'),
+                                    ('imu_data', 'sync_us', 'INTEGER'),
+                                    ('shots', 'sync_us', 'INTEGER')):
+            columns = {row['name'] for row in self.conn.execute(f"PRAGMA table_info({table})")}
+            if column not in columns:
+                self.conn.execute(f"ALTER TABLE {table} ADD COLUMN {column} {kind}")
         self.conn.commit()
 
-    def create_session(self) -> int:
+    def create_session(self, device=None) -> int:
         """Create a new training session.
 
+        Parameters
+        ----------
+        device : str, optional
+            Id of the ball recorded (its "hello" id, e.g. ball-a1b2c3).
+
         Returns
         -------
         int
@@ -94,12 +113,28 @@ class Database:
         """
         now = datetime.now().isoformat(timespec='milliseconds')
         cursor = self.conn.execute(
-            "INSERT INTO sessions (start_time) VALUES (?)",
-            (now,)
+            "INSERT INTO sessions (start_time, device) VALUES (?, ?)",
+            (now, device)
         )
         self.conn.commit()
         return cursor.lastrowid
 
+    def set_session_device(self, session_id, device):
+        """Record which ball a session comes from (once it has said hello)."""
+        self.conn.execute(
+            "UPDATE sessions SET device = ? WHERE id = ?",
+            (device, session_id)
+        )
+        self.conn.commit()
+
+    def set_session_clock(self, session_id, skew_ppm, err_us):
+        """Record the ball's clock skew and sync error (clocksync.py)."""
+        self.conn.execute(
+            "UPDATE sessions SET clock_skew_ppm = ?, clock_err_us = ? WHERE id = ?",
+            (skew_ppm, err_us, session_id)
+        )
+        self.conn.commit()
+
     def end_session(self, session_id, total_samples, total_shots, avg_rpm, max_rpm):
         """Update session with final statistics and end time.
 
@@ -148,7 +183,9 @@ class Database:
         rows : list of dict
             Each dict has keys matching the imu_data columns:
             session_id, device_ts, local_ts, ax, ay, az,
-            gx, gy, gz, qw, qx, qy, qz, rpm, spin, impact.
+            gx, gy, gz, qw, qx, qy, qz, rpm, spin, impact, sync_us
+            (sample time on the observer clock, µs since the epoch;
+            None before the ball's clock is synced).
         """
         if not rows:
             return
@@ -156,11 +193,11 @@ class Database:
             """INSERT INTO imu_data
                (session_id, device_ts, local_ts,
                 ax, ay, az, gx, gy, gz,
-                qw, qx, qy, qz, rpm, spin, impact)
+                qw, qx, qy, qz, rpm, spin, impact, sync_us)
              VALUES
                (:session_id, :device_ts, :local_ts,
                 :ax, :ay, :az, :gx, :gy, :gz,
-                :qw, :qx, :qy, :qz, :rpm, :spin, :impact)""",
+                :qw, :qx, :qy, :qz, :rpm, :spin, :impact, :sync_us)""",
             rows
         )
         self.conn.commit()
@@ -174,15 +211,15 @@ class Database:
             The session this shot belongs to.
         shot_data : dict
             Keys: shot_id, device_ts, rpm, peak_g, gx, gy, gz,
-            spin_type, spin_axis_theta, spin_axis_phi.
+            spin_type, spin_axis_theta, spin_axis_phi, sync_us.
         """
         now = datetime.now().isoformat(timespec='milliseconds')
         self.conn.execute(
             """INSERT INTO shots
                (session_id, shot_id, device_ts, local_ts,
                 rpm, peak_g, gx, gy, gz,
-                spin_type, spin_axis_theta, spin_axis_phi)
-             VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)""",
+                spin_type, spin_axis_theta, spin_axis_phi, sync_us)
+             VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)""",
             (
                 session_id,
                 shot_data.get('shot_id', 0),
@@ -196,6 +233,7 @@ class Database:
                 shot_data.get('spin_type', ''),
                 shot_data.get('spin_axis_theta'),
                 shot_data.get('spin_axis_phi'),
+                shot_data.get('sync_us'),
             )
         )
         self.conn.commit()
@@ -272,6 +310,28 @@ class Database:
         ).fetchall()
         return [dict(row) for row in rows]
 
+    def get_synced_shots(self, from_us, to_us) -> list:
+        """Shots of every ball between two observer-clock times, in time order.
+
+        Parameters
+        ----------
+        from_us, to_us : int
+            Bounds on sync_us (µs since the epoch).
+
+        Returns
+        -------
+        list of dict
+            Shot rows with the session's device id added.
+        """
+        rows = self.conn.execute(
+            """SELECT shots.*, sessions.device FROM shots
+               JOIN sessions ON sessions.id = shots.session_id
+              WHERE shots.sync_us BETWEEN ? AND ?
+              ORDER BY shots.sync_us""",
+            (from_us, to_us)
+        ).fetchall()
+        return [dict(row) for row in rows]
+
     def delete_session(self, session_id):
         """Delete a session and all associated IMU data and shots.
 
@@ -0,0 +1,710 @@
+"""
+emulator.py - Host-side emulator of the ball_spin_webapp device protocol.
+
+Synthesises IMU motion (rest, periodic impacts followed by decaying spin),
+runs the same impact detection / spin classification as the firmware and
+serves the live WebSocket stream plus the HTTP /latency report, so the
+observer and dashboards can be exercised without hardware.
+
+Like the firmware's flash log it keeps every 200 Hz sample per session
+("clear_shots" starts the next one), lists them on GET /sessions and
+streams one back on "replay <session> [speed] [every]". A client that
+reconnects catches up on "resume <seq>" from the last 10 s of frames.
+
+--balls N runs N balls side by side (ball k on ws-port + 2k, http-port + 2k),
+each with its own id, as balls in station mode on one network would be;
+--mdns announces them as _yotb._tcp like the firmware (mdns.py), so
+observer.py --discover finds them all.
+
+--clock-ppm X gives every ball its own clock, as real crystals are: a
+rate error drawn from +-X ppm and a random uptime (0..71 min, so some
+micros() wrap during a run); --link-ms adds random radio delay to both
+legs of the ping/pong. GET /clock tells the true clock of a ball, which
+clockcheck.py compares the observer's sync against.
+
+Session aggregates (per spin type counts and histograms, spin axis
+histogram, shots per minute) are kept as the firmware's sessionstats.cpp
+does and served on GET /stats and the "stats" command.
+
+Usage:
+    python emulator.py
+    python emulator.py --ws-port 8181 --http-port 8180 --rate 50
+    python emulator.py --preload 600        # session 1 already holds 10 min
+    python emulator.py --balls 8 --mdns     # 8 balls: ws://localhost:8181, 8183, ... 8195
+    python emulator.py --balls 4 --clock-ppm 40 --link-ms 5
+    python observer.py --discover
+    python observer.py --ws ws://localhost:8181
+    python observer.py --ws ws://localhost:8181 --sync 1
+"""
+
+import argparse
+import asyncio
+import json
+import math
+import random
+import time
+from collections import deque
+
+import mdns
+from latency import LAT_BIN_MS, LatencyHistogram, client_us
+
+# Firmware constants (ball_spin_webapp/src/main.cpp)
+IMPACT_THRESH = 4.0          # g
+IMPACT_COOLDOWN_MS = 200
+PEAK_TRACK_MS = 100
+MAX_SHOTS = 50
+LOG_CHUNK_SAMPLES = 64       # sessionlog.cpp: a chunk's shots replay after its samples
+FRAME_WINDOW = 500           # recent 50 Hz frames kept for "resume" (10 s)
+
+
+def classify_spin(gx, gy, gz, rpm):
+    """Port of classifySpin() from the firmware."""
+    if rpm < 5.0:
+        return "FLAT"
+    agx, agy, agz = abs(gx), abs(gy), abs(gz)
+    total = agx + agy + agz
+    if total < 1.0:
+        return "FLAT"
+    if agx / total > 0.5:
+        return "TOPSPIN" if gx > 0 else "BACKSPIN"
+    if agy / total > 0.5:
+        return "SIDE_R" if gy > 0 else "SIDE_L"
+    if agz / total > 0.5:
+        return "SLICE"
+    return "MIXED"
+
+
+SPIN_TYPES = ["FLAT", "TOPSPIN", "BACKSPIN", "SIDE_R", "SIDE_L", "SLICE", "MIXED"]  # bspipeline.h order
+
+
+class SessionStats:
+    """Port of sessionstats.cpp: running aggregates served on GET /stats and "stats"."""
+
+    RPM_BINS, RPM_BIN = 20, 50.0
+    G_BINS, G_MIN = 13, 4.0
+    THETA_BINS, PHI_BINS = 12, 24
+    RATE_BINS = 60
+
+    def __init__(self, now_ms=0):
+        self.reset(now_ms)
+
+    def reset(self, now_ms):
+        self.start_ms = now_ms
+        self.types = {t: {'n': 0, 'rpm_sum': 0.0, 'rpm_max': 0.0, 'g_sum': 0.0, 'g_max': 0.0,
+                          'rpm_hist': [0] * self.RPM_BINS, 'g_hist': [0] * self.G_BINS}
+                      for t in SPIN_TYPES}
+        self.axis = [[0] * self.PHI_BINS for _ in range(self.THETA_BINS)]
+        self.axis_none = 0
+        self.rate = {}                # session minute -> shots (last RATE_BINS kept)
+        self.last_min = 0
+        self.shots = 0
+        self.frames = 0
+        self.frame_rpm_sum = 0.0
+        self.frame_rpm_max = 0.0
+
+    @staticmethod
+    def bin_of(v, lo, width, bins):
+        return 0 if v < lo else min(int((v - lo) / width), bins - 1)
+
+    def advance(self, m):
+        if m > self.last_min:
+            self.last_min = m
+            self.rate = {k: v for k, v in self.rate.items() if k > m - self.RATE_BINS}
+
+    def add_shot(self, t_ms, rpm, peak_g, gx, gy, gz):
+        t = self.types[classify_spin(gx, gy, gz, rpm)]
+        t['n'] += 1
+        t['rpm_sum'] += rpm
+        t['g_sum'] += peak_g
+        t['rpm_max'] = max(t['rpm_max'], rpm)
+        t['g_max'] = max(t['g_max'], peak_g)
+        t['rpm_hist'][self.bin_of(rpm, 0.0, self.RPM_BIN, self.RPM_BINS)] += 1
+        t['g_hist'][self.bin_of(peak_g, self.G_MIN, 1.0, self.G_BINS)] += 1
+        omega = math.sqrt(gx * gx + gy * gy + gz * gz)
+        if omega < 1.0:
+            self.axis_none += 1
+        else:
+            theta = math.degrees(math.acos(max(-1.0, min(1.0, gz / omega))))
+            phi = math.degrees(math.atan2(gy, gx)) % 360.0
+            self.axis[self.bin_of(theta, 0.0, 180.0 / self.THETA_BINS, self.THETA_BINS)][
+                self.bin_of(phi, 0.0, 360.0 / self.PHI_BINS, self.PHI_BINS)] += 1
+        m = max(0, t_ms - self.start_ms) // 60000
+        self.advance(m)
+        if m > self.last_min - self.RATE_BINS:
+            self.rate[m] = self.rate.get(m, 0) + 1
+        self.shots += 1
+
+    def add_frame(self, rpm):
+        self.frames += 1
+        self.frame_rpm_sum += rpm
+        self.frame_rpm_max = max(self.frame_rpm_max, rpm)
+
+    def report(self, now_ms, event=False):
+        self.advance((now_ms - self.start_ms) // 60000)
+        types = []
+        for name in SPIN_TYPES:
+            t = self.types[name]
+            entry = {'type': name, 'n': t['n']}
+            if t['n']:
+                entry.update({'rpm_mean': round(t['rpm_sum'] / t['n']), 'rpm_max': round(t['rpm_max']),
+                              'g_mean': round(t['g_sum'] / t['n'], 1), 'g_max': round(t['g_max'], 1),
+                              'rpm_hist': list(t['rpm_hist']), 'g_hist': list(t['g_hist'])})
+            types.append(entry)
+        first = max(0, self.last_min + 1 - self.RATE_BINS)
+        doc = {'event': 'stats'} if event else {}
+        doc.update({
+            'seconds': round((now_ms - self.start_ms) / 1000.0, 1), 'shots': self.shots,
+            'frames': self.frames,
+            'avg_rpm': round(self.frame_rpm_sum / self.frames, 1) if self.frames else 0.0,
+            'max_rpm': round(self.frame_rpm_max),
+            'rpm_bin': int(self.RPM_BIN), 'g_min': int(self.G_MIN), 'g_bin': 1, 'types': types,
+            'axis': {'theta_bin': 180 // self.THETA_BINS, 'phi_bin': 360 // self.PHI_BINS,
+                     'none': self.axis_none, 'counts': [list(r) for r in self.axis]},
+            'rate': {'bin_s': 60, 'first_min': first,
+                     'per_min': [self.rate.get(m, 0) for m in range(first, self.last_min + 1)]},
+        })
+        return doc
+
+
+class BallModel:
+    """Synthetic IMU source: gravity + noise, impacts every few seconds."""
+
+    def __init__(self, shot_every, rng):
+        self.shot_every = shot_every
+        self.rng = rng
+        self.next_shot = shot_every
+        self.impact_until = -1.0
+        self.spin = (0.0, 0.0, 0.0)   # deg/s
+        self.spin_decay = 1.5          # 1/s
+
+    def sample(self, t):
+        """Return (ax, ay, az, gx, gy, gz) in g and deg/s at time t (s)."""
+        if t >= self.next_shot:
+            self.next_shot = t + self.shot_every * self.rng.uniform(0.6, 1.4)
+            self.impact_until = t + 0.012
+            rpm = self.rng.uniform(80, 330)
+            axis = [self.rng.gauss(0, 1) for _ in range(3)]
+            # Bias toward topspin/backspin about X like a real forehand
+            axis[0] *= 3.0
+            n = math.sqrt(sum(a * a for a in axis)) or 1.0
+            self.spin = tuple(a / n * rpm * 6.0 for a in axis)
+        n = self.rng.gauss
+        if t < self.impact_until:
+            g = self.rng.uniform(6.0, 12.0)
+            ax, ay, az = g * 0.8 + n(0, 0.2), g * 0.5 + n(0, 0.2), 1.0
+        else:
+            ax, ay, az = n(0, 0.01), n(0, 0.01), 1.0 + n(0, 0.01)
+        gx, gy, gz = (s + n(0, 0.8) for s in self.spin)
+        decay = math.exp(-self.spin_decay * 0.005)
+        self.spin = tuple(s * decay for s in self.spin)
+        return ax, ay, az, gx, gy, gz
+
+
+class Device:
+    """Emulated firmware state: fusion, impact detection and streaming."""
+
+    def __init__(self, args, ball_id='emu-000000', seed=None):
+        self.args = args
+        self.ball_id = ball_id
+        self.rng = random.Random(args.seed if seed is None else seed)
+        self.model = BallModel(args.shot_every, self.rng)
+        self.start_us = client_us()
+        # Own clock: micros() = boot_us + (client_us() - start_us) * (1 + skew).
+        # Drawn from a separate generator so the motion stays the same per seed
+        clock_rng = random.Random(None if args.seed is None and seed is None
+                                  else f"clock-{args.seed if seed is None else seed}")
+        ppm = getattr(args, 'clock_ppm', 0.0)
+        self.skew = clock_rng.uniform(-ppm, ppm) * 1e-6 if ppm > 0 else 0.0
+        self.boot_us = clock_rng.randrange(1 << 32) if ppm > 0 else 0
+        self.clients = {}             # websocket -> client slot id
+        self.next_client_id = 0
+        self.lat_rx = {}              # slot -> LatencyHistogram
+        self.lat_draw = {}
+        self.lat_seq = {}
+        self.lat_encode = LatencyHistogram()
+        self.seq = 0
+        self.orient = [1.0, 0.0, 0.0, 0.0]
+        self.filt = [0.0, 0.0, 0.0]
+        self.filt_rpm = 0.0
+        self.last_impact_ms = -IMPACT_COOLDOWN_MS
+        self.impact_flag = False
+        self.tracking = None
+        self.shot_count = 0
+        self.last = None
+        # Stored sessions: id -> samples (t_us, ax..az, gx..gz raw, qw..qz,
+        # impact) and (sample index, shot event) pairs
+        self.session = 0
+        self.sessions = {}
+        self.stored = 0
+        self.replay_ws = None
+        self.replay_stop = False
+        # Recent frames (without ts/tx) and shot events, for "resume"
+        self.window = deque(maxlen=FRAME_WINDOW)
+        self.recent_shots = deque(maxlen=MAX_SHOTS)
+        self.resuming = set()
+        self.stats = SessionStats()
+        self.new_session()
+
+    def new_session(self):
+        """Close the current stored session and open the next one."""
+        if self.session in self.sessions:
+            self.sessions[self.session]['complete'] = True
+        self.session += 1
+        self.sessions[self.session] = {'samples': [], 'shots': [], 'complete': False}
+        self.stats.reset(self.millis())
+
+    def store(self, sample):
+        """Append a sample; the oldest sessions go once the store is full."""
+        self.sessions[self.session]['samples'].append(sample)
+        self.stored += 1
+        while self.stored > self.args.store_s * self.args.imu_hz and len(self.sessions) > 1:
+            oldest = min(self.sessions)
+            self.stored -= len(self.sessions.pop(oldest)['samples'])
+
+    def preload(self, seconds):
+        """Record `seconds` of synthetic motion as if the device had been up that long."""
+        dt = 1.0 / self.args.imu_hz
+        n = int(seconds * self.args.imu_hz)
+        for i in range(n):
+            self.step(dt, self.boot_us + int(i * dt * 1e6))
+        self.start_us = client_us() - int(n * dt * 1e6)
+
+    def device_us(self, host_us=None):
+        """The ball's own clock (unwrapped) at a client_us() time."""
+        host = client_us() if host_us is None else host_us
+        return self.boot_us + int((host - self.start_us) * (1.0 + self.skew))
+
+    def micros(self):
+        return self.device_us() & 0xFFFFFFFF
+
+    def millis(self):
+        return (self.device_us() // 1000) & 0xFFFFFFFF
+
+    def clock_report(self):
+        """True clock of this ball (emulator only, for clockcheck.py)."""
+        return {'id': self.ball_id, 'skew_ppm': self.skew * 1e6, 'boot_us': self.boot_us,
+                'start_us': self.start_us, 'host_us': client_us(), 'device_us': self.device_us()}
+
+    def step(self, dt, now_us=None):
+        """Advance one IMU sample; returns a shot event dict or None."""
+        if now_us is None:
+            now_us = self.device_us()
+        now_ms = (now_us // 1000) & 0xFFFFFFFF
+        ax, ay, az, gxd, gyd, gzd = self.model.sample(now_ms / 1000.0)
+        sample_us = now_us & 0xFFFFFFFF
+        for i, v in enumerate((gxd, gyd, gzd)):
+            self.filt[i] += 0.15 * (v - self.filt[i])
+        raw_rpm = math.sqrt(gxd * gxd + gyd * gyd + gzd * gzd) / 6.0
+        self.filt_rpm += 0.08 * (raw_rpm - self.filt_rpm)
+
+        # Quaternion integration (rad/s), no bias model needed here
+        wx, wy, wz = (math.radians(v) for v in (gxd, gyd, gzd))
+        wmag = math.sqrt(wx * wx + wy * wy + wz * wz)
+        if wmag > 0.10:
+            ha = wmag * dt * 0.5
+            s = math.sin(ha) / wmag
+            dq = (math.cos(ha), wx * s, wy * s, wz * s)
+            a = self.orient
+            self.orient = [
+                a[0]*dq[0] - a[1]*dq[1] - a[2]*dq[2] - a[3]*dq[3],
+                a[0]*dq[1] + a[1]*dq[0] + a[2]*dq[3] - a[3]*dq[2],
+                a[0]*dq[2] - a[1]*dq[3] + a[2]*dq[0] + a[3]*dq[1],
+                a[0]*dq[3] + a[1]*dq[2] - a[2]*dq[1] + a[3]*dq[0],
+            ]
+            n = math.sqrt(sum(c * c for c in self.orient))
+            self.orient = [c / n for c in self.orient]
+
+        shot = None
+        mag = math.sqrt(ax * ax + ay * ay + az * az)
+        if mag > IMPACT_THRESH and now_ms - self.last_impact_ms > IMPACT_COOLDOWN_MS:
+            self.last_impact_ms = now_ms
+            self.impact_flag = True
+            self.tracking = {'rpm': self.filt_rpm, 'g': mag, 'gyro': list(self.filt)}
+        if self.tracking:
+            tr = self.tracking
+            tr['rpm'] = max(tr['rpm'], self.filt_rpm)
+            tr['g'] = max(tr['g'], mag)
+            if sum(abs(v) for v in self.filt) > sum(abs(v) for v in tr['gyro']):
+                tr['gyro'] = list(self.filt)
+            if now_ms - self.last_impact_ms > PEAK_TRACK_MS:
+                self.tracking = None
+                gx, gy, gz = tr['gyro']
+                # Aggregates count every shot, also once the shot list is full
+                self.stats.add_shot(self.last_impact_ms, tr['rpm'], tr['g'], gx, gy, gz)
+                if self.shot_count < MAX_SHOTS:
+                    shot = {
+                        'event': 'shot', 'id': self.shot_count,
+                        't': self.last_impact_ms,
+                        'rpm': round(tr['rpm']), 'peakG': round(tr['g'], 1),
+                        'gx': round(gx, 1), 'gy': round(gy, 1), 'gz': round(gz, 1),
+                        'type': classify_spin(gx, gy, gz, tr['rpm']),
+                    }
+                    self.shot_count += 1
+                    self.recent_shots.append(shot)
+                    session = self.sessions[self.session]
+                    session['shots'].append((len(session['samples']), shot))
+        self.store((now_us, ax, ay, az, gxd, gyd, gzd, *self.orient,
+                    1 if now_ms == self.last_impact_ms else 0))
+        self.last = (now_ms, sample_us, ax, ay, az)
+        return shot
+
+    def frame(self):
+        """Build the 50 Hz JSON frame; "tx" is stamped by the caller."""
+        now_ms, sample_us, ax, ay, az = self.last
+        gx, gy, gz = self.filt
+        frame = {
+            't': now_ms, 'seq': self.seq, 'ts': sample_us,
+            'ax': round(ax, 3), 'ay': round(ay, 3), 'az': round(az, 3),
+            'gx': round(gx, 1), 'gy': round(gy, 1), 'gz': round(gz, 1),
+            'qw': round(self.orient[0], 4), 'qx': round(self.orient[1], 4),
+            'qy': round(self.orient[2], 4), 'qz': round(self.orient[3], 4),
+            'rpm': round(self.filt_rpm),
+            'spin': classify_spin(gx, gy, gz, self.filt_rpm),
+            'imp': 1 if self.impact_flag else 0,
+        }
+        self.seq += 1
+        self.impact_flag = False
+        self.stats.add_frame(self.filt_rpm)
+        self.window.append(frame)
+        return frame
+
+    # --- WebSocket command handling (same text protocol as the firmware) ---
+
+    def handle_command(self, slot, text):
+        """Return a reply string for the sending client, or None."""
+        if text == 'reset':
+            self.orient = [1.0, 0.0, 0.0, 0.0]
+        elif text == 'clear_shots':
+            self.shot_count = 0
+            self.new_session()
+        elif text.startswith('ping '):
+            try:
+                c = float(text[5:])
+            except ValueError:
+                c = 0.0
+            return json.dumps({'event': 'pong', 'c': round(c), 'd': self.micros()})
+        elif text == 'stats':
+            return json.dumps(self.stats.report(self.millis(), event=True), separators=(',', ':'))
+        elif text.startswith('lat '):
+            parts = text.split()
+            if len(parts) == 4:
+                try:
+                    seq, rx, draw = int(parts[1]), int(parts[2]), int(parts[3])
+                except ValueError:
+                    return None
+                self.lat_seq[slot] = seq
+                if rx >= 0:
+                    self.lat_rx.setdefault(slot, LatencyHistogram()).add(rx)
+                if draw >= 0:
+                    self.lat_draw.setdefault(slot, LatencyHistogram()).add(draw)
+        return None
+
+    def latency_report(self):
+        """Same document as the firmware GET /latency."""
+        clients = []
+        for slot in sorted(set(self.lat_rx) | set(self.lat_draw)):
+            clients.append({
+                'id': slot,
+                'seq': self.lat_seq.get(slot, 0),
+                'rx': self.lat_rx.get(slot, LatencyHistogram()).to_dict(),
+                'draw': self.lat_draw.get(slot, LatencyHistogram()).to_dict(),
+            })
+        return {'bin_ms': LAT_BIN_MS, 'encode': self.lat_encode.to_dict(), 'clients': clients}
+
+    def sessions_report(self):
+        """Same document as the firmware GET /sessions (newest first)."""
+        out = []
+        for sid in sorted(self.sessions, reverse=True)[:24]:
+            s = self.sessions[sid]
+            samples = s['samples']
+            out.append({
+                'id': sid, 'samples': len(samples), 'shots': len(s['shots']),
+                'chunks': (len(samples) + LOG_CHUNK_SAMPLES - 1) // LOG_CHUNK_SAMPLES,
+                'bytes': 0,
+                'seconds': round((samples[-1][0] - samples[0][0]) / 1e6, 1) if samples else 0.0,
+                'complete': s['complete'],
+            })
+        return {'current': self.session, 'sessions': out, 'listed_max': 24, 'scanning': False}
+
+
+async def replay(device, ws, text):
+    """Stream a stored session back to one client (firmware replayCommand/replayPump)."""
+    args = text.split()
+    try:
+        session_id = int(args[0])
+        speed = float(args[1]) if len(args) > 1 else 1.0
+        every = min(50, max(1, int(args[2]) if len(args) > 2 else 4))
+    except (ValueError, IndexError):
+        return
+    session = device.sessions.get(session_id)
+    error = 'busy' if device.replay_ws not in (None, ws) else None
+    if session is None:
+        error = 'not on flash'
+    if error:
+        await ws.send(json.dumps({'event': 'replay', 'state': 'error',
+                                  'session': session_id, 'error': error}))
+        return
+    device.replay_ws = ws
+    device.replay_stop = False
+    await ws.send(json.dumps({'event': 'replay', 'state': 'start', 'session': session_id,
+                              'speed': max(speed, 0.0), 'every': every,
+                              'hz': round(device.args.imu_hz)}))
+
+    samples, shots = list(session['samples']), list(session['shots'])
+    filt, rpm, imp = [0.0, 0.0, 0.0], 0.0, False
+    frames = sent_bytes = taken = shot_i = 0
+    start = time.monotonic()
+    t0 = samples[0][0] if samples else 0
+
+    async def send(text):
+        nonlocal sent_bytes
+        await ws.send(text)
+        sent_bytes += len(text)
+
+    try:
+        for i, s in enumerate(samples):
+            if device.replay_stop:
+                break
+            if speed > 0:
+                delay = (s[0] - t0) / 1e6 / speed - (time.monotonic() - start)
+                if delay > 0:
+                    await asyncio.sleep(delay)
+            elif i % 256 == 0:
+                await asyncio.sleep(0)  # let the live sampler run
+            t_us, ax, ay, az, gxd, gyd, gzd, qw, qx, qy, qz, impact = s
+            for k, v in enumerate((gxd, gyd, gzd)):
+                filt[k] += 0.15 * (v - filt[k])
+            rpm += 0.08 * (math.sqrt(gxd * gxd + gyd * gyd + gzd * gzd) / 6.0 - rpm)
+            imp = imp or impact
+            taken += 1
+            if taken % every == 0:
+                gx, gy, gz = filt
+                await send(json.dumps({
+                    't': (t_us // 1000) & 0xFFFFFFFF, 'seq': frames,
+                    'ax': round(ax, 3), 'ay': round(ay, 3), 'az': round(az, 3),
+                    'gx': round(gx, 1), 'gy': round(gy, 1), 'gz': round(gz, 1),
+                    'qw': round(qw, 4), 'qx': round(qx, 4), 'qy': round(qy, 4), 'qz': round(qz, 4),
+                    'rpm': round(rpm), 'spin': classify_spin(gx, gy, gz, rpm),
+                    'imp': 1 if imp else 0,
+                }, separators=(',', ':')))
+                frames += 1
+                imp = False
+            if (i + 1) % LOG_CHUNK_SAMPLES == 0 or i + 1 == len(samples):
+                while shot_i < len(shots) and shots[shot_i][0] <= i + 1:
+                    await send(json.dumps(shots[shot_i][1]))
+                    shot_i += 1
+    finally:
+        device.replay_ws = None
+    sec = time.monotonic() - start
+    await ws.send(json.dumps({
+        'event': 'replay', 'state': 'end', 'session': session_id,
+        'stopped': device.replay_stop, 'samples': taken, 'shots': shot_i,
+        'frames': frames, 'bytes': sent_bytes, 'bad_chunks': 0,
+        'ms': round(sec * 1000), 'samples_per_s': round(taken / sec) if sec > 0 else 0,
+    }))
+
+
+async def resume(device, ws, text):
+    """Frames from <seq> on out of the window, shots in between (firmware resumeCommand/resumePump)."""
+    try:
+        seq = int(text)
+    except ValueError:
+        return
+    device.resuming.add(ws)
+    try:
+        oldest = device.window[0]['seq'] if device.window else device.seq
+        start, missed = seq, 0
+        if start > device.seq:           # restarted: seq began again
+            start = oldest
+        if oldest > start:
+            missed, start = oldest - start, oldest
+        await ws.send(json.dumps({'event': 'resume', 'state': 'start', 'from': start, 'missed': missed}))
+        first = next((f for f in device.window if f['seq'] == start), None)
+        last_ms = (first['t'] if first else device.millis()) - 1   # shots after this still to send
+        nxt, sent = start, 0
+        while nxt != device.seq and device.window:
+            oldest = device.window[0]['seq']
+            if oldest > nxt:             # overtaken by the window meanwhile
+                missed, nxt = missed + oldest - nxt, oldest
+            frame = device.window[nxt - oldest]
+            for shot in [s for s in device.recent_shots if last_ms < s['t'] <= frame['t']]:
+                await ws.send(json.dumps(shot))
+            last_ms = max(last_ms, frame['t'])
+            out = {k: v for k, v in frame.items() if k not in ('ts', 'tx')}
+            await ws.send(json.dumps(out, separators=(',', ':')))
+            nxt += 1
+            sent += 1
+        for shot in [s for s in device.recent_shots if s['t'] > last_ms]:
+            await ws.send(json.dumps(shot))
+        await ws.send(json.dumps({'event': 'resume', 'state': 'end', 'seq': device.seq,
+                                  'frames': sent, 'missed': missed}))
+    finally:
+        device.resuming.discard(ws)
+
+
+async def ws_handler(device, ws):
+    """Per-client WebSocket handler."""
+    slot = device.next_client_id
+    device.next_client_id += 1
+    device.clients[ws] = slot
+    import websockets
+    try:
+        await ws.send(json.dumps({'event': 'hello', 'id': device.ball_id,
+                                  'mode': 'sta' if device.args.balls > 1 or device.args.mdns else 'ap',
+                                  'seq': device.seq}))
+        async for msg in ws:
+            if isinstance(msg, str) and msg.startswith('replay '):
+                if msg == 'replay stop':
+                    if device.replay_ws is ws:
+                        device.replay_stop = True
+                else:
+                    asyncio.create_task(replay(device, ws, msg[7:]))
+            elif isinstance(msg, str) and msg.startswith('resume '):
+                asyncio.create_task(resume(device, ws, msg[7:]))
+            elif isinstance(msg, str) and msg.startswith('ping ') and device.args.link_ms > 0:
+                # Radio delay on both legs, independently: the stamp is taken in between
+                await asyncio.sleep(random.uniform(0, device.args.link_ms) / 1000.0)
+                reply = device.handle_command(slot, msg)
+                await asyncio.sleep(random.uniform(0, device.args.link_ms) / 1000.0)
+                await ws.send(reply)
+            elif isinstance(msg, str):
+                reply = device.handle_command(slot, msg)
+                if reply:
+                    await ws.send(reply)
+    except websockets.ConnectionClosed:
+        pass
+    finally:
+        device.clients.pop(ws, None)
+        if device.replay_ws is ws:
+            device.replay_stop = True
+
+
+async def broadcast(device, text):
+    for ws in list(device.clients):
+        if ws is device.replay_ws or ws in device.resuming:
+            continue
+        try:
+            await ws.send(text)
+        except Exception:
+            device.clients.pop(ws, None)
+
+
+async def sampler(devices, args):
+    """IMU loop at --imu-hz for every ball, a WebSocket frame every 1/--rate s."""
+    imu_dt = 1.0 / args.imu_hz
+    send_every = max(1, round(args.imu_hz / args.rate))
+    n = 0
+    next_t = time.monotonic()
+    while True:
+        n += 1
+        for device in devices:
+            shot = device.step(imu_dt)
+            if shot:
+                await broadcast(device, json.dumps(shot))
+            # Frames are made without clients too: the window is what "resume" resends
+            if n % send_every == 0:
+                frame = device.frame()
+            if n % send_every == 0 and device.clients:
+                if args.jitter_ms > 0:
+                    await asyncio.sleep(random.uniform(0, args.jitter_ms) / 1000.0)
+                tx = device.micros()
+                frame['tx'] = tx
+                device.lat_encode.add((tx - frame['ts']) & 0xFFFFFFFF)
+                await broadcast(device, json.dumps(frame, separators=(',', ':')))
+        next_t += imu_dt
+        delay = next_t - time.monotonic()
+        if delay > 0:
+            await asyncio.sleep(delay)
+        else:
+            next_t = time.monotonic()
+
+
+async def main():
+    parser = argparse.ArgumentParser(description='Tennis Ball device emulator')
+    parser.add_argument('--ws-port', type=int, default=8181,
+                        help='WebSocket port (device uses 81, default: 8181)')
+    parser.add_argument('--http-port', type=int, default=8180,
+                        help='HTTP port for /latency (device uses 80, default: 8180)')
+    parser.add_argument('--rate', type=float, default=50.0,
+                        help='WebSocket frame rate in Hz (default: 50)')
+    parser.add_argument('--imu-hz', type=float, default=200.0,
+                        help='Simulated IMU sample rate in Hz (default: 200)')
+    parser.add_argument('--shot-every', type=float, default=3.0,
+                        help='Mean seconds between simulated shots (default: 3)')
+    parser.add_argument('--jitter-ms', type=float, default=0.0,
+                        help='Random delay between sensor read and send (default: 0)')
+    parser.add_argument('--seed', type=int, default=None, help='Random seed')
+    parser.add_argument('--store-s', type=float, default=3600.0,
+                        help='Seconds of samples kept for replay, oldest sessions '
+                             'dropped first (default: 3600)')
+    parser.add_argument('--preload', type=float, default=0.0,
+                        help='Seconds of motion recorded into session 1 at startup (default: 0)')
+    parser.add_argument('--balls', type=int, default=1,
+                        help='Balls to emulate; ball k on --ws-port + 2k and --http-port + 2k (default: 1)')
+    parser.add_argument('--mdns', action='store_true',
+                        help='Announce the balls over mDNS (_yotb._tcp) like station mode')
+    parser.add_argument('--first-id', type=int, default=1,
+                        help='Id number of the first ball, +1 per ball; give each emulator '
+                             'process its own range (default: 1, emu-000001)')
+    parser.add_argument('--clock-ppm', type=float, default=0.0,
+                        help='Per-ball clock rate error drawn from +-this many ppm, plus a random '
+                             'uptime (default: 0, every clock exact and starting at 0)')
+    parser.add_argument('--link-ms', type=float, default=0.0,
+                        help='Random radio delay on each leg of a ping/pong (default: 0)')
+    args = parser.parse_args()
+
+    import websockets
+    from aiohttp import web
+
+    devices = []
+    for k in range(args.balls):
+        seed = None if args.seed is None else args.seed + k
+        devices.append(Device(args, ball_id=f"emu-{args.first_id + k:06x}", seed=seed))
+    if args.preload > 0:
+        for device in devices:
+            device.preload(args.preload)
+
+    address = mdns.local_address()
+    for k, device in enumerate(devices):
+        app = web.Application()
+        # Default arguments bind each route to its own ball
+        app.router.add_get('/latency', lambda request, d=device: web.json_response(d.latency_report()))
+        app.router.add_get('/sessions', lambda request, d=device: web.json_response(d.sessions_report()))
+        app.router.add_get('/stats', lambda request, d=device: web.json_response(d.stats.report(d.millis())))
+        app.router.add_get('/clock', lambda request, d=device: web.json_response(d.clock_report()))
+        app.router.add_get('/wifi', lambda request, d=device, k=k: web.json_response({
+            'mode': 'sta' if args.balls > 1 or args.mdns else 'ap', 'id': d.ball_id,
+            'host': f"{d.ball_id}.local", 'ip': address, 'connected': True, 'mdns': args.mdns,
+            'service': '_yotb._tcp', 'ws_port': args.ws_port + 2 * k}))
+        runner = web.AppRunner(app)
+        await runner.setup()
+        await web.TCPSite(runner, '0.0.0.0', args.http_port + 2 * k).start()
+        await websockets.serve(lambda ws, *_, d=device: ws_handler(d, ws), '0.0.0.0', args.ws_port + 2 * k)
+
+    responder = None
+    if args.mdns:
+        responder = await mdns.Responder.start([
+            (d.ball_id, args.ws_port + 2 * k, address, {'id': d.ball_id, 'http': str(args.http_port + 2 * k), 'mode': 'sta'})
+            for k, d in enumerate(devices)])
+
+    if args.balls == 1:
+        print(f"Emulator: ws://localhost:{args.ws_port}  "
+              f"http://localhost:{args.http_port}/latency  /sessions")
+    else:
+        last = 2 * (args.balls - 1)
+        print(f"Emulator: {args.balls} balls on ws://localhost:{args.ws_port}..{args.ws_port + last}  "
+              f"http://localhost:{args.http_port}..{args.http_port + last} (every other port)")
+    if responder:
+        print(f"mDNS: _yotb._tcp on {address}")
+    try:
+        await sampler(devices, args)
+    finally:
+        if responder:
+            responder.close()
+
+
+if __name__ == '__main__':
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        print("\nStopped.")
@@ -0,0 +1,67 @@
+"""
+latency.py - Sensor-to-receive latency measurement for the device stream.
+
+Frames carry ``seq``, ``ts`` (device micros() at sensor read) and ``tx``
+(device micros() right before send). The client clock is related to the
+device clock with an NTP-style ping/pong exchange:
+
+    client -> "ping <client_us>"
+    device -> {"event": "pong", "c": <client_us>, "d": <device_us>}
+
+clocksync.ClockSync turns the pongs into an offset and skew estimate and
+maps the frame stamps onto the client clock.
+"""
+
+import time
+
+
+# Histogram layout shared with the firmware (/latency): 2 ms bins, last bin = overflow
+LAT_BIN_MS = 2
+LAT_BINS = 61
+
+
+def client_us():
+    """Monotonic client clock in microseconds."""
+    return time.monotonic_ns() // 1000
+
+
+class LatencyHistogram:
+    """2 ms binned latency histogram matching the firmware layout."""
+
+    def __init__(self):
+        self.bins = [0] * LAT_BINS
+        self.n = 0
+        self.sum_us = 0
+        self.max_us = 0
+
+    def add(self, us):
+        """Record one latency sample in microseconds."""
+        self.bins[min(int(us) // (1000 * LAT_BIN_MS), LAT_BINS - 1)] += 1
+        self.n += 1
+        self.sum_us += us
+        if us > self.max_us:
+            self.max_us = us
+
+    def percentile_ms(self, p):
+        """Upper edge (ms) of the bin containing percentile p (0..1)."""
+        if self.n == 0:
+            return None
+        target = min(int(p * self.n), self.n - 1)
+        acc = 0
+        for i, count in enumerate(self.bins):
+            acc += count
+            if acc > target:
+                return (i + 1) * LAT_BIN_MS
+        return LAT_BINS * LAT_BIN_MS
+
+    def to_dict(self):
+        """Serialise in the same shape as the firmware /latency entries."""
+        return {
+            'n': self.n,
+            'mean_us': self.sum_us // self.n if self.n else 0,
+            'max_us': self.max_us,
+            'p50_ms': self.percentile_ms(0.50),
+            'p95_ms': self.percentile_ms(0.95),
+            'p99_ms': self.percentile_ms(0.99),
+            'bins': list(self.bins),
+        }
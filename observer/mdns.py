@@ -0,0 +1,262 @@
+"""
+mdns.py - Minimal mDNS browse / respond for the ball's _yotb._tcp service.
+
+Balls in station mode (ball_spin_webapp/src/wifilink.h) announce
+
+    <id>._yotb._tcp.local   SRV <id>.local:81, TXT id=<id> http=80 mode=sta
+    <id>.local              A <address>
+
+browse() sends a PTR query for the service from an ephemeral port (a
+"legacy unicast" query, RFC 6762 6.7: responders answer straight back to
+it, so nothing has to bind port 5353) and collects the answers.
+Responder answers those queries for emulated balls (emulator.py
+--mdns). Only what these two need is implemented: PTR / SRV / TXT / A,
+name compression on read, no probing, no caching, no IPv6.
+"""
+
+import asyncio
+import socket
+import struct
+import time
+
+MDNS_GROUP = '224.0.0.251'
+MDNS_PORT = 5353
+SERVICE = '_yotb._tcp.local'
+
+TYPE_A, TYPE_PTR, TYPE_TXT, TYPE_SRV, TYPE_ANY = 1, 12, 16, 33, 255
+CLASS_IN = 1
+CACHE_FLUSH = 0x8000
+TTL = 120
+
+
+def encode_name(name):
+    out = bytearray()
+    for label in name.rstrip('.').split('.'):
+        raw = label.encode()
+        out.append(len(raw))
+        out += raw
+    out.append(0)
+    return bytes(out)
+
+
+def read_name(data, off):
+    """Name at off (following compression pointers); returns (name, next offset)."""
+    labels, end, jumps = [], None, 0
+    while True:
+        n = data[off]
+        if n & 0xC0 == 0xC0:
+            if end is None:
+                end = off + 2
+            off = ((n & 0x3F) << 8) | data[off + 1]
+            jumps += 1
+            if jumps > 32:
+                raise ValueError('name pointer loop')
+            continue
+        off += 1
+        if n == 0:
+            break
+        labels.append(data[off:off + n].decode(errors='replace'))
+        off += n
+    return '.'.join(labels), end if end is not None else off
+
+
+def build_query(name, qtype=TYPE_PTR, qid=0):
+    return struct.pack('!HHHHHH', qid, 0, 1, 0, 0, 0) + encode_name(name) + struct.pack('!HH', qtype, CLASS_IN)
+
+
+def parse_message(data):
+    """(id, flags, questions [(name, type)], records [(name, type, rdata)]) of one message."""
+    qid, flags, qd, an, ns, ar = struct.unpack_from('!HHHHHH', data)
+    off = 12
+    questions = []
+    for _ in range(qd):
+        name, off = read_name(data, off)
+        qtype, _qclass = struct.unpack_from('!HH', data, off)
+        off += 4
+        questions.append((name, qtype))
+    records = []
+    for _ in range(an + ns + ar):
+        name, off = read_name(data, off)
+        rtype, _rclass, _ttl, rdlen = struct.unpack_from('!HHIH', data, off)
+        off += 10
+        rd = data[off:off + rdlen]
+        if rtype == TYPE_PTR:
+            value = read_name(data, off)[0]
+        elif rtype == TYPE_SRV:
+            _prio, _weight, port = struct.unpack_from('!HHH', data, off)
+            value = (read_name(data, off + 6)[0], port)
+        elif rtype == TYPE_TXT:
+            value, i = {}, 0
+            while i < len(rd):
+                item = rd[i + 1:i + 1 + rd[i]].decode(errors='replace')
+                i += 1 + rd[i]
+                key, _, val = item.partition('=')
+                if key:
+                    value[key] = val
+        elif rtype == TYPE_A and rdlen == 4:
+            value = socket.inet_ntoa(rd)
+        else:
+            value = rd
+        records.append((name, rtype, value))
+        off += rdlen
+    return qid, flags, questions, records
+
+
+def browse(service=SERVICE, timeout=1.5, interface_ip='0.0.0.0'):
+    """Balls answering for `service` within `timeout` s.
+
+    Returns a list of dicts: id, instance, host, address, port, url, txt;
+    sorted by id.
+    """
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 255)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    if interface_ip != '0.0.0.0':
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(interface_ip))
+    sock.bind((interface_ip, 0))
+    query = build_query(service, TYPE_PTR, qid=0x7b7b)
+    instances, srv, txt, addr = set(), {}, {}, {}
+    t0 = time.monotonic()
+    resend = [0.0, 0.3, 0.9]      # repeat the query: UDP, and slow responders
+    try:
+        while True:
+            now = time.monotonic() - t0
+            if resend and now >= resend[0]:
+                resend.pop(0)
+                sock.sendto(query, (MDNS_GROUP, MDNS_PORT))
+            if now >= timeout:
+                break
+            wait = min(timeout, resend[0] if resend else timeout) - now
+            sock.settimeout(max(wait, 0.01))
+            try:
+                data, _src = sock.recvfrom(65535)
+            except socket.timeout:
+                continue
+            try:
+                _qid, flags, _q, records = parse_message(data)
+            except (ValueError, IndexError, struct.error):
+                continue
+            if not flags & 0x8000:
+                continue              # another query
+            for name, rtype, value in records:
+                if rtype == TYPE_PTR and name.lower() == service.lower():
+                    instances.add(value)
+                elif rtype == TYPE_SRV:
+                    srv[name] = value
+                elif rtype == TYPE_TXT:
+                    txt[name] = value
+                elif rtype == TYPE_A:
+                    addr[name.lower()] = value
+    finally:
+        sock.close()
+
+    balls = []
+    for inst in instances:
+        if inst not in srv:
+            continue
+        host, port = srv[inst]
+        address = addr.get(host.lower())
+        if not address:
+            continue
+        info = txt.get(inst, {})
+        ball_id = info.get('id') or inst.split('.')[0]
+        balls.append({
+            'id': ball_id, 'instance': inst, 'host': host, 'address': address,
+            'port': port, 'url': f"ws://{address}:{port}", 'txt': info,
+        })
+    return sorted(balls, key=lambda b: b['id'])
+
+
+async def browse_async(service=SERVICE, timeout=1.5):
+    return await asyncio.get_running_loop().run_in_executor(None, browse, service, timeout)
+
+
+def local_address():
+    """Address of the interface multicast goes out on (no packet is sent)."""
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        s.connect((MDNS_GROUP, MDNS_PORT))
+        return s.getsockname()[0]
+    except OSError:
+        return '127.0.0.1'
+    finally:
+        s.close()
+
+
+class Responder(asyncio.DatagramProtocol):
+    """Answers PTR queries for SERVICE on behalf of `balls`.
+
+    balls: list of (id, port, address, txt dict). Each becomes
+    <id>._yotb._tcp.local -> <id>.local:port. Legacy unicast queries are
+    answered to their source port, others to the multicast group.
+    """
+
+    def __init__(self, balls, service=SERVICE):
+        self.balls = balls
+        self.service = service
+        self.transport = None
+        self.answered = 0
+
+    @classmethod
+    async def start(cls, balls, service=SERVICE):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        if hasattr(socket, 'SO_REUSEPORT'):
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+        sock.bind(('', MDNS_PORT))
+        mreq = struct.pack('4s4s', socket.inet_aton(MDNS_GROUP), socket.inet_aton('0.0.0.0'))
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+        loop = asyncio.get_running_loop()
+        _transport, proto = await loop.create_datagram_endpoint(lambda: cls(balls, service), sock=sock)
+        return proto
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def close(self):
+        if self.transport:
+            self.transport.close()
+
+    def _records(self, legacy):
+        flush = 0 if legacy else CACHE_FLUSH
+        answers, extra = [], []
+        for ball_id, port, address, txt in self.balls:
+            inst = f"{ball_id}.{self.service}"
+            host = f"{ball_id}.local"
+            answers.append(self._rr(self.service, TYPE_PTR, 0, encode_name(inst)))
+            extra.append(self._rr(inst, TYPE_SRV, flush, struct.pack('!HHH', 0, 0, port) + encode_name(host)))
+            items = b''.join(bytes([len(f"{k}={v}".encode())]) + f"{k}={v}".encode() for k, v in txt.items())
+            extra.append(self._rr(inst, TYPE_TXT, flush, items or b'\x00'))
+            extra.append(self._rr(host, TYPE_A, flush, socket.inet_aton(address)))
+        return answers, extra
+
+    @staticmethod
+    def _rr(name, rtype, cls_flags, rdata):
+        return encode_name(name) + struct.pack('!HHIH', rtype, CLASS_IN | cls_flags, TTL, len(rdata)) + rdata
+
+    def datagram_received(self, data, addr):
+        try:
+            qid, flags, questions, _records = parse_message(data)
+        except (ValueError, IndexError, struct.error):
+            return
+        if flags & 0x8000:
+            return                    # a response
+        asked = any(name.lower() == self.service.lower() and qtype in (TYPE_PTR, TYPE_ANY)
+                    for name, qtype in questions)
+        if not asked or not self.balls:
+            return
+        legacy = addr[1] != MDNS_PORT
+        answers, extra = self._records(legacy)
+        if legacy:
+            # Echo id and question (RFC 6762 6.7)
+            head = struct.pack('!HHHHHH', qid, 0x8400, 1, len(answers), 0, len(extra))
+            msg = head + encode_name(self.service) + struct.pack('!HH', TYPE_PTR, CLASS_IN)
+            dest = addr
+        else:
+            head = struct.pack('!HHHHHH', 0, 0x8400, 0, len(answers), 0, len(extra))
+            msg = head
+            dest = (MDNS_GROUP, MDNS_PORT)
+        msg += b''.join(answers) + b''.join(extra)
+        self.transport.sendto(msg, dest)
+        self.answered += 1
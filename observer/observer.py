@@ -4,10 +4,23 @@ observer.py - Main entry point for Tennis Ball Spin Observer.
 Connects to the ATOM S3 WebSocket data stream, persists IMU data
 and shot events to SQLite, and optionally serves a dashboard.
 
+Several balls at once: balls in station mode (wifilink.h) share one
+network and announce themselves over mDNS; --discover finds them (and
+any that join later), or give one --ws per ball. Each ball gets its own
+receiver and its own database sessions, tagged with the ball's id.
+
+Each ball's clock is synced to this one (clocksync.py: offset and skew
+from the ping/pong probes), and every stored frame and shot gets sync_us,
+its time on the observer clock, so the balls line up on one time axis.
+The sessions table keeps each ball's skew and sync error.
+
 Usage:
     python observer.py
     python observer.py --ws ws://192.168.4.1:81 --db tennis_data.db
+    python observer.py --discover                       # every ball on the network
+    python observer.py --ws ws://10.0.0.21:81 --ws ws://10.0.0.22:81
     python observer.py --no-dashboard --port 8080
+    python observer.py --sync 12            # pull stored session 12 at link speed
 """
 
 import asyncio
@@ -16,9 +29,115 @@ import json
 import sys
 from datetime import datetime
 
+import mdns
 from db import Database
+from clocksync import ClockSync, host_epoch_us
+from latency import LatencyHistogram, client_us
 from spin_analysis import calc_spin_axis
 
+# Report a latency sample back to the device every Nth frame
+LAT_REPORT_EVERY = 5
+
+# Seconds between clock probes (clocksync.py keeps the best of every 4)
+PING_EVERY = 1.0
+
+# Seconds between mDNS browses for balls that joined later (--discover)
+DISCOVER_EVERY = 10.0
+
+
+def new_ball_state(session_id, url, device=None, latency_log=None):
+    """Per-ball receiver state shared with the terminal display."""
+    return {
+        'url': url,
+        'device': device,
+        'connected': False,
+        'session_id': session_id,
+        'total_samples': 0,
+        'total_shots': 0,
+        'rpm_sum': 0.0,
+        'max_rpm': 0.0,
+        'last_shot': None,
+        'last_connect': None,
+        'last_disconnect': None,
+        'latency': LatencyHistogram(),
+        'latency_log': latency_log,
+        'lat_frames': 0,
+        'clock': None,
+        'device_stats': None,         # the ball's own session aggregates (GET /stats)
+    }
+
+
+async def ping_sender(ws, clock):
+    """Send clock probes: a short burst on connect, then one every PING_EVERY s."""
+    for _ in range(4):
+        await ws.send(clock.ping_payload())
+        await asyncio.sleep(0.1)
+    while True:
+        await asyncio.sleep(PING_EVERY)
+        await ws.send(clock.ping_payload())
+
+
+def sync_time(clock, data, now_us):
+    """Observer-clock time of a frame or shot (µs since the epoch), or None.
+
+    Live frames carry the micros() stamp "ts"; shots and resumed frames
+    only the millis() stamp "t".
+    """
+    if clock is None or not clock.synced:
+        return None
+    if 'ts' in data:
+        host = clock.to_host_us(data['ts'], now_us)
+    elif 't' in data:
+        host = clock.to_host_ms(data['t'], now_us)
+    else:
+        return None
+    return host_epoch_us(host)
+
+
+def imu_row(data, session_id, now_str, sync_us=None):
+    """imu_data row for one frame (live or replayed)."""
+    return {
+        'session_id': session_id,
+        'device_ts': data.get('t', 0),
+        'local_ts': now_str,
+        'ax': data.get('ax', 0),
+        'ay': data.get('ay', 0),
+        'az': data.get('az', 0),
+        'gx': data.get('gx', 0),
+        'gy': data.get('gy', 0),
+        'gz': data.get('gz', 0),
+        'qw': data.get('qw', 0),
+        'qx': data.get('qx', 0),
+        'qy': data.get('qy', 0),
+        'qz': data.get('qz', 0),
+        'rpm': data.get('rpm', 0),
+        'spin': data.get('spin', ''),
+        'impact': data.get('imp', 0),
+        'sync_us': sync_us,
+    }
+
+
+def shot_row(data, sync_us=None):
+    """shots row for one shot event (live or replayed)."""
+    theta, phi = calc_spin_axis(
+        data.get('gx', 0),
+        data.get('gy', 0),
+        data.get('gz', 0),
+    )
+    return {
+        'shot_id': data.get('id', 0),
+        'device_ts': data.get('t', 0),
+        'rpm': data.get('rpm', 0),
+        'peak_g': data.get('peakG', 0),
+        'gx': data.get('gx', 0),
+        'gy': data.get('gy', 0),
+        'gz': data.get('gz', 0),
+        'spin_type': data.get('type', ''),
+        'spin_axis_theta': theta,
+        'spin_axis_phi': phi,
+        'sync_us': sync_us,
+    }
+
 
 async def ws_receiver(ws_url, db, session_id, state):
     """Connect to WebSocket, receive data, buffer IMU rows, insert shots immediately.
@@ -37,17 +156,35 @@ async def ws_receiver(ws_url, db, session_id, state):
     state : dict
         Shared mutable state dictionary for cross-coroutine communication.
     """
+    imu_buffer = []
+    state.setdefault('url', ws_url)
+    try:
+        await receive_loop(db, state, imu_buffer)
+    finally:
+        # Cancelled (scaling runs, shutdown): keep what was buffered
+        if imu_buffer:
+            db.insert_imu_batch(imu_buffer)
+            imu_buffer.clear()
+
+
+async def receive_loop(db, state, imu_buffer):
+    """The reconnecting receive loop of ws_receiver."""
     import websockets
 
-    imu_buffer = []
+    pinger = None
     last_flush = asyncio.get_event_loop().time()
     last_stats_update = last_flush
-
     while True:
         try:
-            async with websockets.connect(ws_url) as ws:
+            # state['url'] may move when discovery sees the ball at a new address
+            async with websockets.connect(state['url']) as ws:
                 state['connected'] = True
                 state['last_connect'] = datetime.now()
+                # A new connection may be a rebooted ball: its clock starts over
+                clock = ClockSync()
+                state['clock'] = clock
+                pinger = asyncio.create_task(ping_sender(ws, clock))
+                await ws.send('stats')
 
                 # Check if we need a new session (disconnected >= 30 seconds)
                 if state.get('last_disconnect'):
@@ -60,7 +197,7 @@ async def ws_receiver(ws_url, db, session_id, state):
                             state['total_shots'], avg, state['max_rpm']
                         )
                         # Create new session and reset counters
-                        new_sid = db.create_session()
+                        new_sid = db.create_session(state.get('device'))
                         state['session_id'] = new_sid
                         state['total_samples'] = 0
                         state['total_shots'] = 0
@@ -70,29 +207,45 @@ async def ws_receiver(ws_url, db, session_id, state):
 
                 while True:
                     msg = await ws.recv()
+                    rx_us = client_us()
                     data = json.loads(msg)
                     now_str = datetime.now().isoformat(timespec='milliseconds')
                     current_session = state['session_id']
 
+                    event = data.get('event')
+                    if event == 'pong':
+                        clock.on_pong(data, rx_us)
+                        continue
+                    if event == 'hello':
+                        # Ball id, sent by the firmware on connect
+                        if data.get('id') and data['id'] != state.get('device'):
+                            state['device'] = data['id']
+                            db.set_session_device(current_session, data['id'])
+                        continue
+                    if event == 'stats':
+                        state['device_stats'] = data
+                        continue
+                    if event and event != 'shot':
+                        continue  # resume / bin / replay status
+
+                    sync_us = sync_time(clock, data, rx_us)
+                    if 'ts' in data:
+                        lat = clock.latency_us(data['ts'], rx_us)
+                        if lat is not None:
+                            state['latency'].add(lat)
+                            if state['latency_log']:
+                                state['latency_log'].write(
+                                    f"{data.get('seq', 0)},{data['ts']},"
+                                    f"{data.get('tx', 0)},{lat},{clock.rtt_us:.0f}\n"
+                                )
+                            state['lat_frames'] += 1
+                            if state['lat_frames'] % LAT_REPORT_EVERY == 0:
+                                # The observer does not render: draw latency = -1
+                                await ws.send(f"lat {data.get('seq', 0)} {lat} -1")
+
                     if data.get('event') == 'shot':
                         # Shot event -- insert immediately
-                        theta, phi = calc_spin_axis(
-                            data.get('gx', 0),
-                            data.get('gy', 0),
-                            data.get('gz', 0),
-                        )
-                        db.insert_shot(current_session, {
-                            'shot_id': data.get('id', 0),
-                            'device_ts': data.get('t', 0),
-                            'rpm': data.get('rpm', 0),
-                            'peak_g': data.get('peakG', 0),
-                            'gx': data.get('gx', 0),
-                            'gy': data.get('gy', 0),
-                            'gz': data.get('gz', 0),
-                            'spin_type': data.get('type', ''),
-                            'spin_axis_theta': theta,
-                            'spin_axis_phi': phi,
-                        })
+                        db.insert_shot(current_session, shot_row(data, sync_us))
                         state['total_shots'] += 1
                         state['last_shot'] = data
                     else:
@@ -103,24 +256,7 @@ async def ws_receiver(ws_url, db, session_id, state):
                         if rpm_val > state['max_rpm']:
                             state['max_rpm'] = rpm_val
 
-                        imu_buffer.append({
-                            'session_id': current_session,
-                            'device_ts': data.get('t', 0),
-                            'local_ts': now_str,
-                            'ax': data.get('ax', 0),
-                            'ay': data.get('ay', 0),
-                            'az': data.get('az', 0),
-                            'gx': data.get('gx', 0),
-                            'gy': data.get('gy', 0),
-                            'gz': data.get('gz', 0),
-                            'qw': data.get('qw', 0),
-                            'qx': data.get('qx', 0),
-                            'qy': data.get('qy', 0),
-                            'qz': data.get('qz', 0),
-                            'rpm': rpm_val,
-                            'spin': data.get('spin', ''),
-                            'impact': data.get('imp', 0),
-                        })
+                        imu_buffer.append(imu_row(data, current_session, now_str, sync_us))
 
                     # Flush buffer every 100 rows or every 2 seconds
                     now_time = asyncio.get_event_loop().time()
@@ -137,9 +273,20 @@ async def ws_receiver(ws_url, db, session_id, state):
                             current_session, state['total_samples'],
                             state['total_shots'], avg, state['max_rpm']
                         )
+                        if clock.synced:
+                            db.set_session_clock(current_session, round(clock.skew_ppm, 2),
+                                                 round(clock.err_us, 1))
+                        await ws.send('stats')
                         last_stats_update = now_time
 
+        except asyncio.CancelledError:
+            if pinger:
+                pinger.cancel()
+            raise
         except Exception as e:
+            if pinger:
+                pinger.cancel()
+                pinger = None
             state['connected'] = False
             state['last_disconnect'] = datetime.now()
             # Flush any remaining buffered data before waiting
@@ -152,21 +299,115 @@ async def ws_receiver(ws_url, db, session_id, state):
             await asyncio.sleep(2)
 
 
-async def terminal_display(state, db_path, ws_url, dashboard_url):
+async def sync_session(ws_url, db, device_session, speed, every):
+    """Replay one stored device session into a new database session.
+
+    Sends "replay <session> <speed> <every>" and stores the frames and
+    shot events until the device's end event, then prints the sync
+    throughput as measured by the device (stored samples read and sent
+    per second) and on this side.
+
+    Returns the database session id, or None if the replay failed.
+    """
+    import websockets
+    import time
+
+    async with websockets.connect(ws_url, max_queue=None) as ws:
+        await ws.send(f"replay {device_session} {speed:g} {every}")
+        session_id = None
+        rows, frames, shots, rpm_sum, max_rpm = [], 0, 0, 0.0, 0.0
+        t0 = None
+        while True:
+            data = json.loads(await ws.recv())
+            event = data.get('event')
+            if event == 'replay':
+                if data['state'] == 'error':
+                    print(f"Replay of session {device_session} failed: {data.get('error')}")
+                    return None
+                if data['state'] == 'start':
+                    session_id = db.create_session()
+                    t0 = time.perf_counter()
+                    continue
+                break
+            if session_id is None or event == 'pong':
+                continue  # live traffic before our start event
+            if event == 'shot':
+                db.insert_shot(session_id, shot_row(data))
+                shots += 1
+                continue
+            now_str = datetime.now().isoformat(timespec='milliseconds')
+            rows.append(imu_row(data, session_id, now_str))
+            frames += 1
+            rpm_sum += data.get('rpm', 0)
+            max_rpm = max(max_rpm, data.get('rpm', 0))
+            if len(rows) >= 1000:
+                db.insert_imu_batch(rows)
+                rows.clear()
+        db.insert_imu_batch(rows)
+        host_sec = time.perf_counter() - t0 if t0 else 0.0
+        db.end_session(session_id, frames, shots, rpm_sum / max(frames, 1), max_rpm)
+
+    print(f"Session {device_session} -> db session {session_id}: "
+          f"{data['samples']} samples, {frames} frames, {shots} shots")
+    print(f"  device: {data['ms']:.0f} ms, {data['samples_per_s']:.0f} samples/s")
+    if host_sec > 0:
+        print(f"  host:   {host_sec * 1000:.0f} ms, {data['samples'] / host_sec:.0f} samples/s, "
+              f"{frames / host_sec:.0f} frames/s")
+    return session_id
+
+
+def ball_summary(state):
+    """One status line for a ball in the multi-ball display."""
+    indicator = "\u25cf" if state['connected'] else "\u25cb"
+    lat = state['latency']
+    p95 = f"{lat.percentile_ms(0.95)} ms" if lat.n else "-"
+    clock = state['clock']
+    if clock is not None and clock.synced:
+        sync = f"{clock.skew_ppm:+7.1f} {clock.err_us:>6.0f}"
+    else:
+        sync = f"{'-':>7} {'-':>6}"
+    return (f"{indicator} {(state['device'] or '?'):<12} {state['url']:<24} #{state['session_id']:<5} "
+            f"{state['total_samples']:>8} {state['total_shots']:>6} {state['max_rpm']:>7.0f} {p95:>8} {sync}")
+
+
+async def terminal_display(balls, db_path, dashboard_url):
     """Print live status to the terminal, refreshing every second.
 
     Parameters
     ----------
-    state : dict
-        Shared state dictionary with connection and stats info.
+    balls : dict
+        Ball key -> shared state dictionary with connection and stats info;
+        a single ball gets the detailed view, several get one line each.
     db_path : str
         Path to the database file (for display).
-    ws_url : str
-        WebSocket URL (for display).
     dashboard_url : str
         Dashboard URL (for display).
     """
+    last_samples, last_t = 0, asyncio.get_event_loop().time()
     while True:
+        if len(balls) != 1:
+            now = asyncio.get_event_loop().time()
+            samples = sum(st['total_samples'] for st in balls.values())
+            rate = (samples - last_samples) / max(now - last_t, 1e-3)
+            last_samples, last_t = samples, now
+            up = sum(1 for st in balls.values() if st['connected'])
+            print("\033[2J\033[H", end="")
+            print("Tennis Ball Observer v1.0")
+            print("=" * 93)
+            print(f"Balls:      {up} connected of {len(balls)}   {rate:.0f} frames/s")
+            print(f"Database:   {db_path}")
+            print(f"Dashboard:  {dashboard_url}")
+            print("=" * 93)
+            print(f"  {'ball':<12} {'url':<24} {'sess':<6} {'samples':>8} {'shots':>6} {'max rpm':>7} {'p95':>8} "
+                  f"{'ppm':>7} {'err us':>6}")
+            for st in balls.values():
+                print(ball_summary(st))
+            print("=" * 93)
+            print("Press Ctrl+C to stop")
+            await asyncio.sleep(1)
+            continue
+
+        state = next(iter(balls.values()))
         session_id = state['session_id']
         avg_rpm = (
             state['rpm_sum'] / state['total_samples']
@@ -181,7 +422,9 @@ async def terminal_display(state, db_path, ws_url, dashboard_url):
         print("\033[2J\033[H", end="")
         print("Tennis Ball Observer v1.0")
         print("=" * 40)
-        print(f"WebSocket:  {ws_url}  {indicator} {status}")
+        print(f"WebSocket:  {state['url']}  {indicator} {status}")
+        if state['device']:
+            print(f"Ball:       {state['device']}")
         print(f"Database:   {db_path}")
         print(f"Dashboard:  {dashboard_url}")
         print(f"Session:    #{session_id}")
@@ -197,18 +440,68 @@ async def terminal_display(state, db_path, ws_url, dashboard_url):
             )
         print(f"Avg RPM:    {avg_rpm:.0f}")
         print(f"Max RPM:    {state['max_rpm']:.0f}")
+        ds = state['device_stats']
+        if ds and ds.get('shots'):
+            kinds = "  ".join(f"{t['type']} {t['n']}" for t in ds['types'] if t['n'])
+            print(f"Ball stats: {ds['shots']} shots  {kinds}")
+        lat = state['latency']
+        if lat.n:
+            print(
+                f"Latency:    p50 {lat.percentile_ms(0.5)} ms  "
+                f"p95 {lat.percentile_ms(0.95)} ms  "
+                f"max {lat.max_us / 1000:.1f} ms  (n={lat.n})"
+            )
+        clock = state['clock']
+        if clock is not None and clock.synced:
+            print(
+                f"Clock:      {clock.skew_ppm:+.1f} ppm  "
+                f"err {clock.err_us:.0f} us (bound {clock.bound_us:.0f} us)"
+            )
         print("=" * 40)
         print("Press Ctrl+C to stop")
 
         await asyncio.sleep(1)
 
 
+def add_ball(db, balls, receivers, key, url, device=None, latency_log=None):
+    """Open a session for a new ball and start its receiver."""
+    state = new_ball_state(db.create_session(device), url, device, latency_log)
+    balls[key] = state
+    receivers.append(asyncio.create_task(ws_receiver(url, db, state['session_id'], state)))
+    return state
+
+
+async def discover_balls(db, balls, receivers, interval=DISCOVER_EVERY):
+    """Browse mDNS for station-mode balls; start a receiver for each new one.
+
+    A known ball seen at a new address (DHCP) keeps its receiver, which
+    reconnects to the new URL.
+    """
+    while True:
+        try:
+            found = await mdns.browse_async()
+        except OSError as e:
+            print(f"mDNS browse failed: {e}")
+            found = []
+        for ball in found:
+            state = balls.get(ball['id'])
+            if state is None:
+                add_ball(db, balls, receivers, ball['id'], ball['url'], ball['id'])
+            elif state['url'] != ball['url']:
+                state['url'] = ball['url']
+        await asyncio.sleep(interval)
+
+
 async def main():
     """Parse arguments, initialise database and session, launch all tasks."""
     parser = argparse.ArgumentParser(description='Tennis Ball Spin Observer')
     parser.add_argument(
-        '--ws', default='ws://192.168.4.1:81',
-        help='WebSocket URL (default: ws://192.168.4.1:81)',
+        '--ws', action='append', default=None,
+        help='WebSocket URL, repeat for several balls (default: ws://192.168.4.1:81)',
+    )
+    parser.add_argument(
+        '--discover', action='store_true',
+        help='Find station-mode balls over mDNS (_yotb._tcp), including ones joining later',
     )
     parser.add_argument(
         '--db', default='tennis_data.db',
@@ -222,35 +515,65 @@ async def main():
         '--port', type=int, default=8080,
         help='Dashboard HTTP port (default: 8080)',
     )
+    parser.add_argument(
+        '--latency-log', default=None,
+        help='Write per-frame latency samples to this CSV file',
+    )
+    parser.add_argument(
+        '--sync', type=int, default=None, metavar='SESSION',
+        help='Replay this stored device session into the database and exit',
+    )
+    parser.add_argument(
+        '--speed', type=float, default=0,
+        help='Replay speed for --sync: 1 = real time, 0 = as fast as possible (default)',
+    )
+    parser.add_argument(
+        '--every', type=int, default=1,
+        help='Stored 200Hz samples per frame for --sync (default: 1, every sample)',
+    )
     args = parser.parse_args()
+    urls = args.ws or ([] if args.discover else ['ws://192.168.4.1:81'])
+
+    if args.sync is not None:
+        if not urls:
+            found = await mdns.browse_async()
+            if len(found) != 1:
+                print(f"--sync needs one ball, found {len(found)}: give --ws")
+                sys.exit(1)
+            urls = [found[0]['url']]
+        db = Database(args.db)
+        try:
+            ok = await sync_session(urls[0], db, args.sync, args.speed, args.every)
+        finally:
+            db.close()
+        sys.exit(0 if ok else 1)
+
+    latency_log = None
+    if args.latency_log:
+        latency_log = open(args.latency_log, 'w', buffering=1)
+        latency_log.write("seq,ts_us,tx_us,latency_us,rtt_us\n")
 
     db = Database(args.db)
-    session_id = db.create_session()
 
-    state = {
-        'connected': False,
-        'session_id': session_id,
-        'total_samples': 0,
-        'total_shots': 0,
-        'rpm_sum': 0.0,
-        'max_rpm': 0.0,
-        'last_shot': None,
-        'last_connect': None,
-        'last_disconnect': None,
-    }
+    # One receiver per ball; the latency log has no ball column, so it
+    # only follows a single --ws ball
+    balls, receivers = {}, []
+    for url in urls:
+        single = len(urls) == 1 and not args.discover
+        add_ball(db, balls, receivers, url, url, latency_log=latency_log if single else None)
 
     dashboard_url = f"http://localhost:{args.port}"
 
-    tasks = [
-        asyncio.create_task(ws_receiver(args.ws, db, session_id, state)),
-        asyncio.create_task(terminal_display(state, args.db, args.ws, dashboard_url)),
-    ]
+    tasks = [asyncio.create_task(terminal_display(balls, args.db, dashboard_url))]
+    if args.discover:
+        tasks.append(asyncio.create_task(discover_balls(db, balls, receivers)))
+    tasks += receivers
 
     if not args.no_dashboard:
         from dashboard import create_app
         from aiohttp import web
 
-        app = create_app(db)
+        app = create_app(db, balls)
         runner = web.AppRunner(app)
         await runner.setup()
         site = web.TCPSite(runner, '0.0.0.0', args.port)
@@ -262,13 +585,19 @@ async def main():
     except KeyboardInterrupt:
         pass
     finally:
-        # Flush final session statistics
-        avg = state['rpm_sum'] / max(state['total_samples'], 1)
-        db.end_session(
-            state['session_id'], state['total_samples'],
-            state['total_shots'], avg, state['max_rpm']
-        )
+        # Flush buffered rows and final session statistics
+        for task in receivers:
+            task.cancel()
+        await asyncio.gather(*receivers, return_exceptions=True)
+        for state in balls.values():
+            avg = state['rpm_sum'] / max(state['total_samples'], 1)
+            db.end_session(
+                state['session_id'], state['total_samples'],
+                state['total_shots'], avg, state['max_rpm']
+            )
         db.close()
+        if latency_log:
+            latency_log.close()
 
 
 if __name__ == '__main__':
@@ -0,0 +1,149 @@
+"""
+scaling.py - Ingest throughput of one observer against the number of balls.
+
+For each ball count N: starts `emulator.py --balls N --mdns` as its own
+process, finds the balls over mDNS (mdns.browse, as observer.py
+--discover does), runs one observer receiver per ball (ws_receiver, the
+code observer.py runs: JSON decode, clock sync, latency, buffered SQLite
+inserts) into a scratch database for --seconds, and reports per N:
+
+    frames/s received against N x --rate sent, the slowest ball's share,
+    rows in the database, sensor-to-observer latency p50 / p95 over all
+    balls, and the CPU used by the observer and by the emulator
+
+Emulator and observer share the machine: on a small one the emulator's
+own CPU use is part of the limit, which the report shows.
+
+Usage:
+    python scaling.py                                 # 1 2 4 8 16 32 balls, 15 s each
+    python scaling.py --balls 1 8 32 64 --seconds 30 --rate 100
+"""
+
+import argparse
+import asyncio
+import os
+import resource
+import subprocess
+import sys
+import tempfile
+import time
+
+import mdns
+from db import Database
+from latency import LatencyHistogram
+from observer import add_ball
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+CLK_TCK = os.sysconf('SC_CLK_TCK')
+
+
+def process_cpu_s(pid):
+    """utime + stime of another process, seconds."""
+    with open(f"/proc/{pid}/stat") as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / CLK_TCK
+
+
+def self_cpu_s():
+    ru = resource.getrusage(resource.RUSAGE_SELF)
+    return ru.ru_utime + ru.ru_stime
+
+
+def merged_latency(balls):
+    h = LatencyHistogram()
+    for st in balls.values():
+        lat = st['latency']
+        h.bins = [a + b for a, b in zip(h.bins, lat.bins)]
+        h.n += lat.n
+        h.sum_us += lat.sum_us
+        h.max_us = max(h.max_us, lat.max_us)
+    return h
+
+
+async def run_one(n, args, port):
+    """One ball count; returns the report row as a dict."""
+    emu = subprocess.Popen(
+        [sys.executable, os.path.join(HERE, 'emulator.py'), '--balls', str(n), '--mdns',
+         '--ws-port', str(port), '--http-port', str(port - 1),
+         '--rate', str(args.rate), '--imu-hz', str(args.imu_hz), '--seed', '1'],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    db_path = os.path.join(tempfile.mkdtemp(prefix='scaling-'), 'scaling.db')
+    db = Database(db_path)
+    balls, receivers = {}, []
+    try:
+        # Wait for all N to answer (the emulator needs a moment to start)
+        found = []
+        deadline = time.monotonic() + 20
+        while len(found) < n and time.monotonic() < deadline:
+            found = [b for b in await mdns.browse_async(timeout=1.0) if b['port'] >= port]
+        if len(found) < n:
+            raise RuntimeError(f"discovered {len(found)} of {n} balls")
+        for ball in found:
+            add_ball(db, balls, receivers, ball['id'], ball['url'], ball['id'])
+
+        await asyncio.sleep(args.warmup)
+        base = {k: st['total_samples'] for k, st in balls.items()}
+        for st in balls.values():
+            st['latency'] = LatencyHistogram()   # steady state only
+        cpu0, emu0, t0 = self_cpu_s(), process_cpu_s(emu.pid), time.monotonic()
+        await asyncio.sleep(args.seconds)
+        got = {k: st['total_samples'] - base[k] for k, st in balls.items()}
+        wall = time.monotonic() - t0
+        cpu, emu_cpu = self_cpu_s() - cpu0, process_cpu_s(emu.pid) - emu0
+        lat = merged_latency(balls)
+    finally:
+        for task in receivers:
+            task.cancel()
+        await asyncio.gather(*receivers, return_exceptions=True)
+        emu.terminate()
+        emu.wait()
+    rows = db.conn.execute("SELECT COUNT(*) FROM imu_data").fetchone()[0]
+    db.close()
+
+    total = sum(got.values())
+    return {
+        'balls': n,
+        'sent': n * args.rate,
+        'received': total / wall,
+        'slowest': min(got.values()) / wall / args.rate if got else 0.0,
+        'rows': rows,
+        'p50': lat.percentile_ms(0.5) if lat.n else None,
+        'p95': lat.percentile_ms(0.95) if lat.n else None,
+        'cpu': cpu / wall * 100,
+        'emu_cpu': emu_cpu / wall * 100,
+    }
+
+
+async def main():
+    parser = argparse.ArgumentParser(description='Observer ingest throughput vs number of balls')
+    parser.add_argument('--balls', type=int, nargs='+', default=[1, 2, 4, 8, 16, 32],
+                        help='Ball counts to run (default: 1 2 4 8 16 32)')
+    parser.add_argument('--seconds', type=float, default=15.0,
+                        help='Measured seconds per ball count (default: 15)')
+    parser.add_argument('--warmup', type=float, default=3.0,
+                        help='Seconds before measuring: connect, clock sync (default: 3)')
+    parser.add_argument('--rate', type=float, default=50.0,
+                        help='Frames/s per ball (default: 50, as the firmware)')
+    parser.add_argument('--imu-hz', type=float, default=50.0,
+                        help='Emulated IMU rate (default: 50, one sample per frame, keeps the '
+                             'emulator light)')
+    parser.add_argument('--port', type=int, default=9101,
+                        help='First WebSocket port of the emulated balls (default: 9101)')
+    args = parser.parse_args()
+
+    print(f"{os.cpu_count()} CPUs, {args.rate:g} frames/s per ball, {args.seconds:g} s per run")
+    print(f"{'balls':>5} {'sent/s':>8} {'recv/s':>8} {'recv %':>7} {'slowest':>8} {'rows':>8} "
+          f"{'p50 ms':>7} {'p95 ms':>7} {'obs cpu':>8} {'emu cpu':>8}")
+    for n in args.balls:
+        r = await run_one(n, args, args.port)
+        print(f"{r['balls']:>5} {r['sent']:>8.0f} {r['received']:>8.0f} "
+              f"{r['received'] / r['sent'] * 100:>6.1f}% {r['slowest'] * 100:>7.1f}% {r['rows']:>8} "
+              f"{r['p50'] if r['p50'] is not None else '-':>7} {r['p95'] if r['p95'] is not None else '-':>7} "
+              f"{r['cpu']:>7.0f}% {r['emu_cpu']:>7.0f}%", flush=True)
+
+
+if __name__ == '__main__':
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        print("\nStopped.")